@@ -228,6 +228,27 @@ S_write_parcel_h(CFCBindCore *self, CFCParcel *parcel) {
         "    return cfish_method(*parent_ptr, offset);\n"
         "}\n"
         "\n"
+        "extern CFISH_VISIBLE uint32_t cfish_Class_offset_of_depth;\n"
+        "extern CFISH_VISIBLE uint32_t cfish_Class_offset_of_display;\n"
+        "\n"
+        "/* Indicate whether `klass` is `ancestor` or one of its subclasses.\n"
+        " * Every class has a display of its ancestors indexed by depth, so\n"
+        " * this takes constant time.  Neither argument may be NULL.\n"
+        " */\n"
+        "static CFISH_INLINE bool\n"
+        "cfish_class_is_a(const void *klass, const void *ancestor) {\n"
+        "    const char *class_as_char    = (const char*)klass;\n"
+        "    const char *ancestor_as_char = (const char*)ancestor;\n"
+        "    uint32_t depth = *(const uint32_t*)(ancestor_as_char\n"
+        "                                        + cfish_Class_offset_of_depth);\n"
+        "    uint32_t class_depth = *(const uint32_t*)(class_as_char\n"
+        "                                              + cfish_Class_offset_of_depth);\n"
+        "    if (depth > class_depth) { return false; }\n"
+        "    void **display = *(void***)(class_as_char\n"
+        "                                + cfish_Class_offset_of_display);\n"
+        "    return display[depth] == ancestor;\n"
+        "}\n"
+        "\n"
         "typedef void\n"
         "(*cfish_destroy_t)(void *vself);\n"
         "extern CFISH_VISIBLE uint32_t CFISH_Obj_Destroy_OFFSET;\n"
@@ -290,6 +311,31 @@ S_write_parcel_h(CFCBindCore *self, CFCParcel *parcel) {
         "#define CFISH_REFCOUNT_NN(_self) \\\n"
         "    cfish_get_refcount(_self)\n"
         "\n"
+        "/** Increment the refcounts of `num` objects in place, skipping NULL\n"
+        " * elements.  Elements are replaced with the return value of\n"
+        " * `cfish_inc_refcount`.\n"
+        " */\n"
+        "extern CFISH_VISIBLE void\n"
+        "cfish_incref_array(cfish_Obj **elems, size_t num);\n"
+        "\n"
+        "/** Decrement the refcounts of `num` objects, skipping NULL elements.\n"
+        " */\n"
+        "extern CFISH_VISIBLE void\n"
+        "cfish_decref_array(cfish_Obj **elems, size_t num);\n"
+        "\n"
+        "/** Make an object immortal.  Its refcount is frozen from now on, so\n"
+        " * `cfish_inc_refcount` and `cfish_dec_refcount` neither modify nor\n"
+        " * destroy it.  Meant for objects whose memory is managed by other\n"
+        " * means or which live until the process exits.\n"
+        " */\n"
+        "extern CFISH_VISIBLE void\n"
+        "cfish_make_immortal(void *vself);\n"
+        "\n"
+        "/** Return true if refcounting is a no-op for `vself`.\n"
+        " */\n"
+        "extern CFISH_VISIBLE bool\n"
+        "cfish_is_immortal(void *vself);\n"
+        "\n"
         "/* Flags for internal use. */\n"
         "#define CFISH_fREFCOUNTSPECIAL 0x00000001\n"
         "#define CFISH_fFINAL           0x00000002\n"
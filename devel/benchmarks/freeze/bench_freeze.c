@@ -0,0 +1,175 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Benchmark for Obj_Freeze_Graph.
+ *
+ * Builds a Hash of Vectors of Strings, forks worker processes which walk
+ * the graph the way host bindings do, fetching and INCREFing every value,
+ * and reports how much memory each worker un-shares from the parent.  The
+ * walk is run once before and once after freezing the graph.
+ *
+ * Un-shared memory is measured as the growth of Private_Dirty in
+ * /proc/self/smaps_rollup, so this benchmark only runs on Linux.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Hash.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Vector.h"
+
+#define NUM_WORKERS 4
+#define VEC_SIZE    8
+
+static double
+S_now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// Return the sum of the given field in kB, or 0 if it can't be read.
+static uint64_t
+S_proc_kb(const char *path, const char *field) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) { return 0; }
+    size_t   field_len = strlen(field);
+    uint64_t total     = 0;
+    char     line[256];
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, field, field_len) == 0) {
+            total += strtoull(line + field_len, NULL, 10);
+        }
+    }
+    fclose(file);
+    return total;
+}
+
+static Hash*
+S_make_graph(int32_t num_keys) {
+    Hash *hash = Hash_new(num_keys);
+    for (int32_t i = 0; i < num_keys; i++) {
+        Vector *vector = Vec_new(VEC_SIZE);
+        for (int32_t j = 0; j < VEC_SIZE; j++) {
+            Vec_Push(vector, (Obj*)Str_newf("value %i32 of entry %i32",
+                                            j, i));
+        }
+        String *key = Str_newf("key%i32", i);
+        Hash_Store(hash, key, (Obj*)vector);
+        DECREF(key);
+    }
+    return hash;
+}
+
+static void
+S_walk(Hash *hash) {
+    HashIterator *iter = HashIter_new(hash);
+    while (HashIter_Next(iter)) {
+        Vector *vector = (Vector*)INCREF(HashIter_Get_Value(iter));
+        size_t  size   = Vec_Get_Size(vector);
+        for (size_t i = 0; i < size; i++) {
+            Obj *elem = INCREF(Vec_Fetch(vector, i));
+            DECREF(elem);
+        }
+        DECREF(vector);
+    }
+    DECREF(iter);
+}
+
+// Fork workers which walk the graph and report the growth of their
+// private dirty memory through a pipe.  Return the average in kB.
+static uint64_t
+S_run_workers(Hash *hash) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    for (int i = 0; i < NUM_WORKERS; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(1);
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            uint64_t before = S_proc_kb("/proc/self/smaps_rollup",
+                                        "Private_Dirty:");
+            S_walk(hash);
+            uint64_t after  = S_proc_kb("/proc/self/smaps_rollup",
+                                        "Private_Dirty:");
+            uint64_t growth = after - before;
+            if (write(fds[1], &growth, sizeof(growth)) != sizeof(growth)) {
+                _exit(1);
+            }
+            _exit(0);
+        }
+    }
+
+    close(fds[1]);
+    uint64_t total = 0;
+    uint64_t growth;
+    while (read(fds[0], &growth, sizeof(growth)) == sizeof(growth)) {
+        total += growth;
+    }
+    close(fds[0]);
+    for (int i = 0; i < NUM_WORKERS; i++) {
+        wait(NULL);
+    }
+    return total / NUM_WORKERS;
+}
+
+int
+main(int argc, char **argv) {
+    cfish_bootstrap_parcel();
+
+    int32_t num_keys = argc > 1 ? atoi(argv[1]) : 200000;
+    if (S_proc_kb("/proc/self/smaps_rollup", "Private_Dirty:") == 0) {
+        fprintf(stderr, "Can't read /proc/self/smaps_rollup\n");
+        return 1;
+    }
+
+    Hash *hash = S_make_graph(num_keys);
+    printf("%" PRId32 " keys, %d strings per key, parent RSS %" PRIu64
+           " kB\n", num_keys, VEC_SIZE,
+           S_proc_kb("/proc/self/status", "VmRSS:"));
+
+    uint64_t unfrozen_kb = S_run_workers(hash);
+    printf("unfrozen  %8" PRIu64 " kB un-shared per worker\n", unfrozen_kb);
+
+    double start = S_now();
+    Hash_Freeze_Graph(hash);
+    double freeze_secs = S_now() - start;
+
+    uint64_t frozen_kb = S_run_workers(hash);
+    printf("frozen    %8" PRIu64 " kB un-shared per worker\n", frozen_kb);
+    printf("Freeze_Graph took %.2f ms\n", freeze_secs * 1e3);
+
+    // Frozen objects are never destroyed.
+    return 0;
+}
@@ -0,0 +1,151 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Multi-threaded benchmark for LockFreeRegistry.
+ *
+ * Registers NUM_KEYS class names in a registry which starts out with 256
+ * buckets like the class registry, then looks them up at random.  Every
+ * thread registers all keys in its own shuffled order, so that threads
+ * contend on the same entries.  Reports throughput for each thread count.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+
+#include "Clownfish/LockFreeRegistry.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Util/Memory.h"
+
+#define NUM_KEYS        50000
+#define NUM_LOOKUPS     1000000
+#define MAX_THREADS     8
+
+typedef struct {
+    LockFreeRegistry  *registry;
+    String           **keys;
+    uint32_t          *order;
+    uint64_t           seed;
+} ThreadArgs;
+
+static double
+S_now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static uint64_t
+S_xorshift(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static void*
+S_register(void *varg) {
+    ThreadArgs *args = (ThreadArgs*)varg;
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        String *key = args->keys[args->order[i]];
+        LFReg_register(args->registry, key, (Obj*)key);
+    }
+    return NULL;
+}
+
+static void*
+S_fetch(void *varg) {
+    ThreadArgs *args  = (ThreadArgs*)varg;
+    uint64_t    state = args->seed;
+    for (uint32_t i = 0; i < NUM_LOOKUPS; i++) {
+        String *key = args->keys[S_xorshift(&state) % NUM_KEYS];
+        if (LFReg_fetch(args->registry, key) != (Obj*)key) {
+            fprintf(stderr, "Fetch failed\n");
+            exit(1);
+        }
+    }
+    return NULL;
+}
+
+static double
+S_run(void *(*func)(void*), ThreadArgs *args, int num_threads) {
+    pthread_t threads[MAX_THREADS];
+    double start = S_now();
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, func, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return S_now() - start;
+}
+
+int
+main() {
+    cfish_bootstrap_parcel();
+
+    String **keys = (String**)MALLOCATE(NUM_KEYS * sizeof(String*));
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        keys[i] = Str_newf("Host::Generated::Subclass%u32", i);
+    }
+
+    ThreadArgs args[MAX_THREADS];
+    uint64_t   state = UINT64_C(0x9E3779B97F4A7C15);
+    for (int i = 0; i < MAX_THREADS; i++) {
+        uint32_t *order = (uint32_t*)MALLOCATE(NUM_KEYS * sizeof(uint32_t));
+        for (uint32_t j = 0; j < NUM_KEYS; j++) { order[j] = j; }
+        for (uint32_t j = NUM_KEYS - 1; j > 0; j--) {
+            uint32_t r   = (uint32_t)(S_xorshift(&state) % (j + 1));
+            uint32_t tmp = order[j];
+            order[j] = order[r];
+            order[r] = tmp;
+        }
+        args[i].keys  = keys;
+        args[i].order = order;
+        args[i].seed  = S_xorshift(&state);
+    }
+
+    printf("%d keys, %d lookups per thread\n", NUM_KEYS, NUM_LOOKUPS);
+    for (int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+        LockFreeRegistry *registry = LFReg_new(256);
+        for (int i = 0; i < num_threads; i++) {
+            args[i].registry = registry;
+        }
+        double reg_secs   = S_run(S_register, args, num_threads);
+        double fetch_secs = S_run(S_fetch, args, num_threads);
+        printf("%d threads: register %7.1f ms, fetch %6.1f ns/lookup"
+               " (%6.1f M lookups/s)\n",
+               num_threads, reg_secs * 1e3,
+               fetch_secs * 1e9 / NUM_LOOKUPS,
+               num_threads * NUM_LOOKUPS / fetch_secs / 1e6);
+        LFReg_destroy(registry);
+    }
+
+    for (int i = 0; i < MAX_THREADS; i++) {
+        FREEMEM(args[i].order);
+    }
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        DECREF(keys[i]);
+    }
+    FREEMEM(keys);
+    return 0;
+}
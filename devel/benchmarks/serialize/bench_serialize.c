@@ -0,0 +1,120 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+/* Benchmark for Clownfish::Serializer and Clownfish::Deserializer.
+ *
+ * Serializes a Vector of records resembling typical service payloads into
+ * a ByteBuf and reads it back, reporting throughput and output size.  The
+ * size of the To_String representation, which is close to JSON, is shown
+ * for comparison.  bench_serialize.pl compares against host-side JSON.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Boolean.h"
+#include "Clownfish/ByteBuf.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/InStream.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/OutStream.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Vector.h"
+
+#define NUM_RECORDS 100000
+#define ITERATIONS  10
+
+static double
+S_now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static Vector*
+S_make_records() {
+    Vector *records = Vec_new(NUM_RECORDS);
+    for (int32_t i = 0; i < NUM_RECORDS; i++) {
+        Hash   *record = Hash_new(0);
+        Vector *tags   = Vec_new(3);
+        Vec_Push(tags, (Obj*)Str_newf("tag%i32", i % 7));
+        Vec_Push(tags, (Obj*)Str_newf("group%i32", i % 13));
+        Vec_Push(tags, (Obj*)Str_newf("region%i32", i % 5));
+        Hash_Store_Utf8(record, "id", 2, (Obj*)Int_new(i));
+        Hash_Store_Utf8(record, "name", 4, (Obj*)Str_newf("user %i32", i));
+        Hash_Store_Utf8(record, "score", 5, (Obj*)Float_new(i * 0.37));
+        Hash_Store_Utf8(record, "active", 6,
+                        (Obj*)INCREF(i % 3 ? CFISH_TRUE : CFISH_FALSE));
+        Hash_Store_Utf8(record, "tags", 4, (Obj*)tags);
+        Vec_Push(records, (Obj*)record);
+    }
+    return records;
+}
+
+int
+main() {
+    cfish_bootstrap_parcel();
+
+    Vector *records = S_make_records();
+    ByteBuf *bb = NULL;
+
+    double start = S_now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        DECREF(bb);
+        bb = BB_new(0);
+        OutStream *outstream = OutStream_new_bytebuf(bb);
+        Vec_Serialize(records, outstream);
+        OutStream_Close(outstream);
+        DECREF(outstream);
+    }
+    double write_secs = (S_now() - start) / ITERATIONS;
+
+    start = S_now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        InStream *instream = InStream_new_bytebuf(bb);
+        Obj      *copy     = Obj_deserialize(instream);
+        if (i == 0 && !Vec_Equals(records, copy)) {
+            fprintf(stderr, "Round trip failed\n");
+            return 1;
+        }
+        DECREF(copy);
+        DECREF(instream);
+    }
+    double read_secs = (S_now() - start) / ITERATIONS;
+
+    String *text = Vec_To_String(records);
+    size_t  size = BB_Get_Size(bb);
+    printf("%d records, %" PRIu64 " bytes (%" PRIu64 " as text)\n",
+           NUM_RECORDS, (uint64_t)size, (uint64_t)Str_Get_Size(text));
+    printf("serialize   %7.2f ms  %7.1f MB/s  %6.0f ns/record\n",
+           write_secs * 1e3, size / write_secs / 1e6,
+           write_secs * 1e9 / NUM_RECORDS);
+    printf("deserialize %7.2f ms  %7.1f MB/s  %6.0f ns/record\n",
+           read_secs * 1e3, size / read_secs / 1e6,
+           read_secs * 1e9 / NUM_RECORDS);
+
+    DECREF(text);
+    DECREF(bb);
+    DECREF(records);
+    return 0;
+}
+
@@ -0,0 +1,73 @@
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.
+# The ASF licenses this file to You under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License.  You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Compares round trips of a Clownfish object graph through the native
+# binary serialization with the conversion to Perl data and back that is
+# needed to use a host-side JSON library.
+
+use strict;
+use warnings;
+
+use Benchmark qw( cmpthese );
+use JSON::PP;
+use Clownfish qw( to_clownfish );
+
+my $have_json_xs = eval { require JSON::XS; 1 };
+
+my @records = map {
+    {   id     => $_,
+        name   => "user $_",
+        score  => $_ * 0.37,
+        active => $_ % 3 ? 1 : 0,
+        tags   => [ 'tag' . $_ % 7, 'group' . $_ % 13, 'region' . $_ % 5 ],
+    }
+} 0 .. 9_999;
+my $records = to_clownfish( \@records );
+
+sub serialize {
+    my $bytebuf   = Clownfish::ByteBuf->new('');
+    my $outstream = Clownfish::OutStream->new_bytebuf( bytebuf => $bytebuf );
+    $records->serialize($outstream);
+    $outstream->close;
+    return $bytebuf;
+}
+
+my $serialized = serialize();
+my $json_pp    = JSON::PP->new->canonical(0);
+my $json_text  = $json_pp->encode( $records->to_perl );
+printf( "%d records: %d bytes serialized, %d bytes as JSON\n",
+    scalar @records, $serialized->get_size, length $json_text );
+
+my %tests = (
+    clownfish => sub {
+        my $instream = Clownfish::InStream->new_blob(
+            blob => serialize()->yield_blob );
+        my $copy = Clownfish::Deserializer->new( instream => $instream )->read;
+    },
+    json_pp => sub {
+        my $json = $json_pp->encode( $records->to_perl );
+        my $copy = to_clownfish( $json_pp->decode($json) );
+    },
+);
+if ($have_json_xs) {
+    my $json_xs = JSON::XS->new;
+    $tests{json_xs} = sub {
+        my $json = $json_xs->encode( $records->to_perl );
+        my $copy = to_clownfish( $json_xs->decode($json) );
+    };
+}
+
+cmpthese( -3, \%tests );
+
@@ -0,0 +1,169 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Benchmark for Sort_mergesort in Clownfish/Util/SortUtils.h.
+ *
+ * Sorts arrays of pointers to 64-bit integers, the way Vec_Sort sorts
+ * object pointers, for random, sorted, reversed and nearly sorted inputs.
+ * A plain top-down merge sort, the algorithm used by earlier versions of
+ * SortUtils, serves as baseline.  Reports time and number of comparisons,
+ * followed by the time of Sort_parallel_mergesort.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Util/SortUtils.h"
+
+#define NUM_ELEMS 1000000
+
+static uint64_t num_compares;
+
+static int
+S_compare_no_count(void *context, const void *va, const void *vb) {
+    int64_t a = **(int64_t* const*)va;
+    int64_t b = **(int64_t* const*)vb;
+    (void)context;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static double
+S_now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int
+S_compare(void *context, const void *va, const void *vb) {
+    int64_t a = **(int64_t* const*)va;
+    int64_t b = **(int64_t* const*)vb;
+    (void)context;
+    num_compares++;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+// Called through a volatile pointer so that the baseline can't inline the
+// comparison function, just like Sort_mergesort.
+static CFISH_Sort_Compare_t volatile baseline_compare = S_compare;
+
+static void
+S_baseline_msort(int64_t **elems, int64_t **scratch, size_t left,
+                 size_t right, CFISH_Sort_Compare_t compare) {
+    if (right <= left) { return; }
+    size_t mid = left + (right - left) / 2 + 1;
+    S_baseline_msort(elems, scratch, left, mid - 1, compare);
+    S_baseline_msort(elems, scratch, mid, right, compare);
+
+    size_t i = left, j = mid, k = 0;
+    while (i < mid && j <= right) {
+        if (compare(NULL, &elems[i], &elems[j]) < 1) {
+            scratch[k++] = elems[i++];
+        }
+        else {
+            scratch[k++] = elems[j++];
+        }
+    }
+    while (i < mid)    { scratch[k++] = elems[i++]; }
+    while (j <= right) { scratch[k++] = elems[j++]; }
+    memcpy(elems + left, scratch, k * sizeof(int64_t*));
+}
+
+static void
+S_fill(int64_t *values, const char *pattern) {
+    for (size_t i = 0; i < NUM_ELEMS; i++) {
+        if (strcmp(pattern, "random") == 0) {
+            values[i] = ((int64_t)rand() << 31) ^ rand();
+        }
+        else if (strcmp(pattern, "reversed") == 0) {
+            values[i] = (int64_t)(NUM_ELEMS - i);
+        }
+        else {
+            values[i] = (int64_t)i;
+        }
+    }
+    if (strcmp(pattern, "nearly sorted") == 0) {
+        // Swap 1% of the elements.
+        for (size_t i = 0; i < NUM_ELEMS / 100; i++) {
+            size_t a = (size_t)rand() % NUM_ELEMS;
+            size_t b = (size_t)rand() % NUM_ELEMS;
+            int64_t temp = values[a];
+            values[a] = values[b];
+            values[b] = temp;
+        }
+    }
+}
+
+static void
+S_bench(const char *pattern) {
+    int64_t  *values  = (int64_t*)malloc(NUM_ELEMS * sizeof(int64_t));
+    int64_t **elems   = (int64_t**)malloc(NUM_ELEMS * sizeof(int64_t*));
+    int64_t **scratch = (int64_t**)malloc(NUM_ELEMS * sizeof(int64_t*));
+    double    start, base_secs, sort_secs, par_secs;
+    uint64_t  base_compares, sort_compares;
+
+    S_fill(values, pattern);
+
+    for (size_t i = 0; i < NUM_ELEMS; i++) { elems[i] = &values[i]; }
+    num_compares = 0;
+    start = S_now();
+    S_baseline_msort(elems, scratch, 0, NUM_ELEMS - 1, baseline_compare);
+    base_secs = S_now() - start;
+    base_compares = num_compares;
+
+    for (size_t i = 0; i < NUM_ELEMS; i++) { elems[i] = &values[i]; }
+    num_compares = 0;
+    start = S_now();
+    Sort_mergesort(elems, scratch, NUM_ELEMS, sizeof(int64_t*), S_compare,
+                   NULL);
+    sort_secs = S_now() - start;
+    sort_compares = num_compares;
+
+    // The counting compare function isn't thread-safe.
+    for (size_t i = 0; i < NUM_ELEMS; i++) { elems[i] = &values[i]; }
+    start = S_now();
+    Sort_parallel_mergesort(elems, scratch, NUM_ELEMS, sizeof(int64_t*),
+                            S_compare_no_count, NULL);
+    par_secs = S_now() - start;
+
+    printf("%-14s baseline %7.1f ms %9" PRIu64 " cmps | "
+           "mergesort %7.1f ms %9" PRIu64 " cmps | parallel %7.1f ms\n",
+           pattern, base_secs * 1000, base_compares,
+           sort_secs * 1000, sort_compares, par_secs * 1000);
+
+    free(scratch);
+    free(elems);
+    free(values);
+}
+
+int
+main() {
+    srand(1);
+    printf("Sorting %d pointers to int64_t, up to %u threads\n", NUM_ELEMS,
+           (unsigned)Sort_get_max_threads());
+    S_bench("random");
+    S_bench("sorted");
+    S_bench("reversed");
+    S_bench("nearly sorted");
+    return 0;
+}
+
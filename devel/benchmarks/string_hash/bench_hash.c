@@ -0,0 +1,122 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Benchmark for the string hash functions in Clownfish/Util/Hashing.h.
+ *
+ * Measures raw throughput of SipHash-1-3 and wyhash for several key sizes,
+ * then Hash store/fetch throughput with the hash function selected by the
+ * CLOWNFISH_HASH_FUNC environment variable.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Boolean.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Util/Hashing.h"
+
+#define NUM_KEYS 1000000
+
+static double
+S_now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+S_bench_raw(const char *buf, size_t size, uint64_t iterations) {
+    volatile uint64_t sink = 0;
+    double start, sip_secs, wy_secs;
+
+    start = S_now();
+    for (uint64_t i = 0; i < iterations; i++) {
+        sink += Hashing_siphash13(buf, size, i, 0);
+    }
+    sip_secs = S_now() - start;
+
+    start = S_now();
+    for (uint64_t i = 0; i < iterations; i++) {
+        sink += Hashing_wyhash(buf, size, i);
+    }
+    wy_secs = S_now() - start;
+
+    printf("%6u bytes: siphash13 %7.2f ns/key %6.2f GB/s | "
+           "wyhash %7.2f ns/key %6.2f GB/s\n",
+           (unsigned)size,
+           sip_secs * 1e9 / iterations,
+           size * iterations / sip_secs / 1e9,
+           wy_secs * 1e9 / iterations,
+           size * iterations / wy_secs / 1e9);
+}
+
+static void
+S_bench_hash() {
+    String **keys = (String**)malloc(NUM_KEYS * sizeof(String*));
+    for (int i = 0; i < NUM_KEYS; i++) {
+        keys[i] = Str_newf("user-supplied-key-%i32", (int32_t)i);
+    }
+
+    Hash *hash = Hash_new(0);
+    double start = S_now();
+    for (int i = 0; i < NUM_KEYS; i++) {
+        Hash_Store(hash, keys[i], (Obj*)CFISH_TRUE);
+    }
+    double store_secs = S_now() - start;
+
+    start = S_now();
+    for (int i = 0; i < NUM_KEYS; i++) {
+        if (!Hash_Fetch(hash, keys[i])) { abort(); }
+    }
+    double fetch_secs = S_now() - start;
+
+    printf("Hash with %s: store %.1f ns/key, fetch %.1f ns/key\n",
+           Hashing_get_func() == HASHING_WYHASH ? "wyhash" : "siphash13",
+           store_secs * 1e9 / NUM_KEYS, fetch_secs * 1e9 / NUM_KEYS);
+
+    DECREF(hash);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        DECREF(keys[i]);
+    }
+    free(keys);
+}
+
+int
+main() {
+    static const size_t sizes[] = { 8, 16, 32, 64, 256, 1024, 65536 };
+    char *buf = (char*)malloc(65536);
+    for (size_t i = 0; i < 65536; i++) {
+        buf[i] = (char)('a' + i % 26);
+    }
+
+    cfish_bootstrap_parcel();
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        S_bench_raw(buf, sizes[i], UINT64_C(200000000) / (sizes[i] + 16));
+    }
+    S_bench_hash();
+
+    free(buf);
+    return 0;
+}
+
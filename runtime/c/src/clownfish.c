@@ -54,6 +54,9 @@ SI_immortal(cfish_Class *klass) {
     return false;
 }
 
+// Refcount of objects made immortal with cfish_make_immortal.
+#define IMMORTAL_REFCOUNT SIZE_MAX
+
 static CFISH_INLINE bool
 SI_is_string_type(cfish_Class *klass) {
     if (klass == CFISH_STRING) {
@@ -76,8 +79,11 @@ cfish_inc_refcount(void *vself) {
     cfish_Class *const klass = self->klass;
     if (klass->flags & CFISH_fREFCOUNTSPECIAL) {
         if (SI_is_string_type(klass)) {
-            // Only copy-on-incref Strings get special-cased.  Ordinary
-            // strings fall through to the general case.
+            // Immortal and copy-on-incref Strings get special-cased.
+            // Ordinary strings fall through to the general case.
+            if (cfish_Str_is_immortal((cfish_String*)self)) {
+                return self;
+            }
             if (CFISH_Str_Is_Copy_On_IncRef((cfish_String*)self)) {
                 const char *utf8 = CFISH_Str_Get_Ptr8((cfish_String*)self);
                 size_t size = CFISH_Str_Get_Size((cfish_String*)self);
@@ -89,7 +95,9 @@ cfish_inc_refcount(void *vself) {
         }
     }
 
-    self->refcount++;
+    if (self->refcount != IMMORTAL_REFCOUNT) {
+        self->refcount++;
+    }
     return self;
 }
 
@@ -101,6 +109,11 @@ cfish_dec_refcount(void *vself) {
         if (SI_immortal(klass)) {
             return (uint32_t)self->refcount;
         }
+        else if (SI_is_string_type(klass)
+                 && cfish_Str_is_immortal((cfish_String*)self)
+                ) {
+            return (uint32_t)self->refcount;
+        }
     }
 
     size_t modified_refcount = 0;
@@ -112,6 +125,9 @@ cfish_dec_refcount(void *vself) {
             modified_refcount = 0;
             Obj_Destroy(self);
             break;
+        case IMMORTAL_REFCOUNT:
+            modified_refcount = UINT32_MAX;
+            break;
         default:
             modified_refcount = --self->refcount;
             break;
@@ -119,6 +135,61 @@ cfish_dec_refcount(void *vself) {
     return (uint32_t)modified_refcount;
 }
 
+void
+cfish_incref_array(cfish_Obj **elems, size_t num) {
+    for (size_t i = 0; i < num; i++) {
+        cfish_Obj *elem = elems[i];
+        if (elem == NULL) { continue; }
+        // Only special cases need the full function call.
+        if (elem->klass->flags & CFISH_fREFCOUNTSPECIAL) {
+            elems[i] = cfish_inc_refcount(elem);
+        }
+        else if (elem->refcount != IMMORTAL_REFCOUNT) {
+            elem->refcount++;
+        }
+    }
+}
+
+void
+cfish_decref_array(cfish_Obj **elems, size_t num) {
+    for (size_t i = 0; i < num; i++) {
+        cfish_Obj *elem = elems[i];
+        if (elem == NULL) { continue; }
+        // Special cases, destruction and errors are left to
+        // cfish_dec_refcount.
+        if (!(elem->klass->flags & CFISH_fREFCOUNTSPECIAL)
+            && elem->refcount > 1
+            && elem->refcount != IMMORTAL_REFCOUNT
+           ) {
+            elem->refcount--;
+        }
+        else {
+            cfish_dec_refcount(elem);
+        }
+    }
+}
+
+void
+cfish_make_immortal(void *vself) {
+    cfish_Obj *self = (cfish_Obj*)vself;
+    self->refcount = IMMORTAL_REFCOUNT;
+}
+
+bool
+cfish_is_immortal(void *vself) {
+    cfish_Obj *self = (cfish_Obj*)vself;
+    cfish_Class *klass = self->klass;
+    if (SI_immortal(klass)) {
+        return true;
+    }
+    if (SI_is_string_type(klass)
+        && cfish_Str_is_immortal((cfish_String*)self)
+       ) {
+        return true;
+    }
+    return self->refcount == IMMORTAL_REFCOUNT;
+}
+
 void*
 Obj_To_Host_IMP(Obj *self, void *vcache) {
     UNUSED_VAR(self);
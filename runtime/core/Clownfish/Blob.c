@@ -17,13 +17,56 @@
 #define C_CFISH_BLOB
 #define CFISH_USE_SHORT_NAMES
 
+#include "charmony.h"
+
+#include <errno.h>
 #include <string.h>
 
+#if defined(CHY_HAS_SYS_MMAN_H) && defined(CHY_HAS_UNISTD_H)
+  #define CFISH_BLOB_MMAP_POSIX
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#elif defined(CHY_HAS_WINDOWS_H)
+  #define CFISH_BLOB_MMAP_WINDOWS
+  #include <windows.h>
+#endif
+
 #include "Clownfish/Class.h"
 #include "Clownfish/Blob.h"
+#include "Clownfish/ByteBuf.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Util/Hashing.h"
 #include "Clownfish/Util/Memory.h"
 
+typedef struct {
+    uint64_t offset;  // Start of the mapping, aligned to the granularity.
+    uint64_t delta;   // Offset of the requested range within the mapping.
+    uint64_t size;    // Size of the requested range.
+} MapRange;
+
+// Validate the requested range against the file size and compute the
+// aligned mapping.  Return an error message on failure, NULL otherwise.
+static String*
+S_check_range(String *path, int64_t offset, int64_t length,
+              uint64_t file_size, uint64_t granularity, MapRange *range);
+
+// Map a range of the file at `path` into `self`.  Return an error message on
+// failure, NULL otherwise.
+static String*
+S_map_file(Blob *self, String *path, int64_t offset, int64_t length);
+
+// Release a mapping created by S_map_file.
+static void
+S_unmap(void *base, size_t size);
+
+// Return the Blob which owns the mapping backing `self`, or NULL if `self`
+// isn't memory-mapped.
+static Blob*
+S_mapping_owner(Blob *self);
+
 Blob*
 Blob_new(const void *bytes, size_t size) {
     Blob *self = (Blob*)Class_Make_Obj(BLOB);
@@ -72,9 +115,309 @@ Blob_init_wrap(Blob *self, const void *bytes, size_t size) {
     return self;
 }
 
+Blob*
+Blob_new_mmap(String *path, int64_t offset, int64_t length) {
+    Blob *self = (Blob*)Class_Make_Obj(BLOB);
+    return Blob_init_mmap(self, path, offset, length);
+}
+
+Blob*
+Blob_init_mmap(Blob *self, String *path, int64_t offset, int64_t length) {
+    self->buf      = "";
+    self->size     = 0;
+    self->owns_buf = false;
+    self->map_base = NULL;
+    self->map_size = 0;
+
+    String *mess = S_map_file(self, path, offset, length);
+    if (mess) {
+        DECREF(self);
+        Err_throw_mess(ERR, mess);
+    }
+
+    return self;
+}
+
+static String*
+S_check_range(String *path, int64_t offset, int64_t length,
+              uint64_t file_size, uint64_t granularity, MapRange *range) {
+    if (offset < 0) {
+        return MAKE_MESS("Invalid offset for '%o': %i64", path, offset);
+    }
+    uint64_t start = (uint64_t)offset;
+    if (start > file_size) {
+        return MAKE_MESS("Offset %i64 past end of '%o' (%u64 bytes)", offset,
+                         path, file_size);
+    }
+    uint64_t size = length < 0 ? file_size - start : (uint64_t)length;
+    if (size > file_size - start) {
+        return MAKE_MESS("Range %i64 + %i64 past end of '%o' (%u64 bytes)",
+                         offset, length, path, file_size);
+    }
+
+    range->offset = start - start % granularity;
+    range->delta  = start - range->offset;
+    range->size   = size;
+    if (size + range->delta > SIZE_MAX) {
+        return MAKE_MESS("Range too large to map: %u64 bytes", size);
+    }
+
+    return NULL;
+}
+
+#if defined(CFISH_BLOB_MMAP_POSIX)
+
+static String*
+S_map_file(Blob *self, String *path, int64_t offset, int64_t length) {
+    char *path_c = Str_To_Utf8(path);
+    int   fd     = open(path_c, O_RDONLY);
+    FREEMEM(path_c);
+    if (fd < 0) {
+        return MAKE_MESS("Can't open '%o': %s", path, strerror(errno));
+    }
+
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) != 0) {
+        int error = errno;
+        close(fd);
+        return MAKE_MESS("Can't stat '%o': %s", path, strerror(error));
+    }
+
+    long     page_size   = sysconf(_SC_PAGESIZE);
+    uint64_t granularity = page_size > 0 ? (uint64_t)page_size : 4096;
+    MapRange range = { 0, 0, 0 };
+    String  *mess = S_check_range(path, offset, length,
+                                  (uint64_t)stat_buf.st_size, granularity,
+                                  &range);
+    if (mess) {
+        close(fd);
+        return mess;
+    }
+
+    if (range.size > 0) {
+        size_t map_size = (size_t)(range.size + range.delta);
+        void *base = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd,
+                          (off_t)range.offset);
+        if (base == MAP_FAILED) {
+            int error = errno;
+            close(fd);
+            return MAKE_MESS("Can't mmap '%o': %s", path, strerror(error));
+        }
+        self->map_base = base;
+        self->map_size = map_size;
+        self->buf      = (const char*)base + range.delta;
+        self->size     = (size_t)range.size;
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    return NULL;
+}
+
+static void
+S_unmap(void *base, size_t size) {
+    munmap(base, size);
+}
+
+#elif defined(CFISH_BLOB_MMAP_WINDOWS)
+
+static String*
+S_map_file(Blob *self, String *path, int64_t offset, int64_t length) {
+    char   *path_c = Str_To_Utf8(path);
+    HANDLE  file   = CreateFileA(path_c, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    FREEMEM(path_c);
+    if (file == INVALID_HANDLE_VALUE) {
+        return MAKE_MESS("Can't open '%o': error %u32", path,
+                         (uint32_t)GetLastError());
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        DWORD error = GetLastError();
+        CloseHandle(file);
+        return MAKE_MESS("Can't get size of '%o': error %u32", path,
+                         (uint32_t)error);
+    }
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    MapRange range = { 0, 0, 0 };
+    String  *mess = S_check_range(path, offset, length,
+                                  (uint64_t)file_size.QuadPart,
+                                  info.dwAllocationGranularity, &range);
+    if (mess) {
+        CloseHandle(file);
+        return mess;
+    }
+
+    if (range.size > 0) {
+        size_t  map_size = (size_t)(range.size + range.delta);
+        void   *base     = NULL;
+        HANDLE  mapping  = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0,
+                                              NULL);
+        if (mapping != NULL) {
+            base = MapViewOfFile(mapping, FILE_MAP_READ,
+                                 (DWORD)(range.offset >> 32),
+                                 (DWORD)(range.offset & 0xFFFFFFFF),
+                                 (SIZE_T)map_size);
+            // The view keeps the mapping object alive.
+            CloseHandle(mapping);
+        }
+        if (base == NULL) {
+            DWORD error = GetLastError();
+            CloseHandle(file);
+            return MAKE_MESS("Can't map '%o': error %u32", path,
+                             (uint32_t)error);
+        }
+        self->map_base = base;
+        self->map_size = map_size;
+        self->buf      = (const char*)base + range.delta;
+        self->size     = (size_t)range.size;
+    }
+
+    CloseHandle(file);
+    return NULL;
+}
+
+static void
+S_unmap(void *base, size_t size) {
+    UNUSED_VAR(size);
+    UnmapViewOfFile(base);
+}
+
+#else
+
+static String*
+S_map_file(Blob *self, String *path, int64_t offset, int64_t length) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(offset);
+    UNUSED_VAR(length);
+    UNUSED_VAR(S_check_range);
+    return MAKE_MESS("Can't map '%o': memory-mapped files not supported",
+                     path);
+}
+
+static void
+S_unmap(void *base, size_t size) {
+    UNUSED_VAR(base);
+    UNUSED_VAR(size);
+}
+
+#endif
+
+void
+Blob_Advise_IMP(Blob *self, String *advice) {
+    int flag = 0;
+
+    if (Str_Equals_Utf8(advice, "normal", 6)) {
+#ifdef MADV_NORMAL
+        flag = MADV_NORMAL;
+#endif
+    }
+    else if (Str_Equals_Utf8(advice, "sequential", 10)) {
+#ifdef MADV_SEQUENTIAL
+        flag = MADV_SEQUENTIAL;
+#endif
+    }
+    else if (Str_Equals_Utf8(advice, "random", 6)) {
+#ifdef MADV_RANDOM
+        flag = MADV_RANDOM;
+#endif
+    }
+    else if (Str_Equals_Utf8(advice, "willneed", 8)) {
+#ifdef MADV_WILLNEED
+        flag = MADV_WILLNEED;
+#endif
+    }
+    else {
+        THROW(ERR, "Invalid advice: '%o'", advice);
+    }
+
+    Blob *owner = S_mapping_owner(self);
+    if (owner == NULL || self->size == 0) { return; }
+
+#if defined(CFISH_BLOB_MMAP_POSIX) && defined(MADV_NORMAL)
+    // Only advise the pages covered by this Blob, which may be a slice.
+    // The start of the mapping is page-aligned.
+    long   page_size = sysconf(_SC_PAGESIZE);
+    size_t start     = (size_t)(self->buf - (const char*)owner->map_base);
+    size_t end       = start + self->size;
+    if (page_size > 0) { start -= start % (size_t)page_size; }
+    // Failure only means that the hint is ignored.
+    madvise((char*)owner->map_base + start, end - start, flag);
+#else
+    UNUSED_VAR(flag);
+#endif
+}
+
+bool
+Blob_Is_Mapped_IMP(Blob *self) {
+    return S_mapping_owner(self) != NULL;
+}
+
+static Blob*
+S_mapping_owner(Blob *self) {
+    Blob *owner = self;
+    if (self->origin) {
+        if (!Obj_is_a(self->origin, BLOB)) { return NULL; }
+        owner = (Blob*)self->origin;
+    }
+    return owner->map_base ? owner : NULL;
+}
+
+Blob*
+Blob_new_view(ByteBuf *bytebuf) {
+    Blob *self = (Blob*)Class_Make_Obj(BLOB);
+    return Blob_init_view(self, bytebuf);
+}
+
+Blob*
+Blob_init_view(Blob *self, ByteBuf *bytebuf) {
+    BB_Freeze(bytebuf);
+    const char *buf = BB_Get_Buf(bytebuf);
+
+    self->buf      = buf ? buf : "";
+    self->size     = BB_Get_Size(bytebuf);
+    self->owns_buf = false;
+    self->origin   = INCREF(bytebuf);
+
+    return self;
+}
+
+Blob*
+Blob_Slice_IMP(Blob *self, size_t offset, size_t length) {
+    if (offset > self->size) {
+        offset = self->size;
+    }
+    if (length > self->size - offset) {
+        length = self->size - offset;
+    }
+    if (offset == 0 && length == self->size) {
+        return (Blob*)INCREF(self);
+    }
+
+    Blob *slice = (Blob*)Class_Make_Obj(BLOB);
+    slice->buf      = self->buf + offset;
+    slice->size     = length;
+    slice->owns_buf = false;
+    // Point directly at the owner of the buffer to avoid chains of slices.
+    slice->origin   = self->origin ? INCREF(self->origin) : INCREF(self);
+
+    return slice;
+}
+
 void
 Blob_Destroy_IMP(Blob *self) {
-    if (self->owns_buf) { FREEMEM((char*)self->buf); }
+    if (self->origin) {
+        DECREF(self->origin);
+    }
+    else if (self->map_base) {
+        S_unmap(self->map_base, self->map_size);
+    }
+    else if (self->owns_buf) {
+        FREEMEM((char*)self->buf);
+    }
     SUPER_DESTROY(self, BLOB);
 }
 
@@ -107,6 +450,11 @@ Blob_Equals_IMP(Blob *self, Obj *other) {
     return SI_equals_bytes(self, twin->buf, twin->size);
 }
 
+void
+Blob_Digest_IMP(Blob *self, uint64_t *digest) {
+    Hashing_digest_bytes(digest, HASHING_DIGEST_BLOB, self->buf, self->size);
+}
+
 bool
 Blob_Equals_Bytes_IMP(Blob *self, const void *bytes, size_t size) {
     return SI_equals_bytes(self, bytes, size);
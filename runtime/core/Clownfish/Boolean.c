@@ -20,25 +20,30 @@
 #define CFISH_USE_SHORT_NAMES
 #include "Clownfish/Boolean.h"
 
+#include "Clownfish/CharBuf.h"
 #include "Clownfish/Class.h"
 #include "Clownfish/String.h"
 #include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/Hashing.h"
 
 Boolean *Bool_true_singleton;
 Boolean *Bool_false_singleton;
 
+DECLARE_STR_CONST(TRUE_STRING, "true");
+DECLARE_STR_CONST(FALSE_STRING, "false");
+
 void
 Bool_init_class() {
     Boolean *true_obj = (Boolean*)Class_Make_Obj(BOOLEAN);
     true_obj->value   = true;
-    true_obj->string  = Str_newf("true");
+    true_obj->string  = STR_CONST(TRUE_STRING);
     if (!Atomic_cas_ptr((void**)&Bool_true_singleton, NULL, true_obj)) {
         Bool_Destroy(true_obj);
     }
 
     Boolean *false_obj = (Boolean*)Class_Make_Obj(BOOLEAN);
     false_obj->value   = false;
-    false_obj->string  = Str_newf("false");
+    false_obj->string  = STR_CONST(FALSE_STRING);
     if (!Atomic_cas_ptr((void**)&Bool_false_singleton, NULL, false_obj)) {
         Bool_Destroy(false_obj);
     }
@@ -72,8 +77,18 @@ Bool_To_String_IMP(Boolean *self) {
     return (String*)INCREF(self->string);
 }
 
+void
+Bool_Cat_To_IMP(Boolean *self, CharBuf *buf) {
+    CB_Cat(buf, self->string);
+}
+
 bool
 Bool_Equals_IMP(Boolean *self, Obj *other) {
     return self == (Boolean*)other;
 }
 
+void
+Bool_Digest_IMP(Boolean *self, uint64_t *digest) {
+    Hashing_digest_u64(digest, HASHING_DIGEST_BOOLEAN, self->value);
+}
+
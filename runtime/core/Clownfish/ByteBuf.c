@@ -27,6 +27,7 @@
 #include "Clownfish/Err.h"
 #include "Clownfish/String.h"
 #include "Clownfish/Util/Memory.h"
+#include "Clownfish/Util/Hashing.h"
 
 // Ensure that the ByteBuf's capacity is at least (size + extra).
 // If the buffer must be grown, oversize the allocation.
@@ -44,6 +45,13 @@ S_grow_and_oversize(ByteBuf *self, size_t min_size);
 static void
 S_overflow_error(void);
 
+// Throw an error if the ByteBuf is frozen.
+static CFISH_INLINE void
+SI_check_frozen(ByteBuf *self);
+
+static void
+S_frozen_error(void);
+
 ByteBuf*
 BB_new(size_t capacity) {
     ByteBuf *self = (ByteBuf*)Class_Make_Obj(BYTEBUF);
@@ -57,9 +65,10 @@ BB_init(ByteBuf *self, size_t min_cap) {
     // Check for overflow.
     if (capacity < min_cap) { capacity = SIZE_MAX; }
 
-    self->buf  = (char*)MALLOCATE(capacity);
-    self->size = 0;
-    self->cap  = capacity;
+    self->buf    = (char*)MALLOCATE(capacity);
+    self->size   = 0;
+    self->cap    = capacity;
+    self->frozen = false;
     return self;
 }
 
@@ -76,9 +85,10 @@ BB_init_bytes(ByteBuf *self, const void *bytes, size_t size) {
     // Check for overflow.
     if (capacity < size) { capacity = SIZE_MAX; }
 
-    self->buf  = (char*)MALLOCATE(capacity);
-    self->size = size;
-    self->cap  = capacity;
+    self->buf    = (char*)MALLOCATE(capacity);
+    self->size   = size;
+    self->cap    = capacity;
+    self->frozen = false;
     memcpy(self->buf, bytes, size);
     return self;
 }
@@ -92,9 +102,10 @@ BB_new_steal_bytes(void *bytes, size_t size, size_t capacity) {
 ByteBuf*
 BB_init_steal_bytes(ByteBuf *self, void *bytes, size_t size,
                     size_t capacity) {
-    self->buf  = (char*)bytes;
-    self->size = size;
-    self->cap  = capacity;
+    self->buf    = (char*)bytes;
+    self->size   = size;
+    self->cap    = capacity;
+    self->frozen = false;
     return self;
 }
 
@@ -111,6 +122,7 @@ BB_Clone_IMP(ByteBuf *self) {
 
 void
 BB_Set_Size_IMP(ByteBuf *self, size_t size) {
+    SI_check_frozen(self);
     if (size > self->cap) {
         THROW(ERR, "Can't set size to %u64 (greater than capacity of %u64)",
               (uint64_t)size, (uint64_t)self->cap);
@@ -147,6 +159,12 @@ BB_Equals_IMP(ByteBuf *self, Obj *other) {
     return SI_equals_bytes(self, twin->buf, twin->size);
 }
 
+void
+BB_Digest_IMP(ByteBuf *self, uint64_t *digest) {
+    Hashing_digest_bytes(digest, HASHING_DIGEST_BYTEBUF, self->buf,
+                         self->size);
+}
+
 bool
 BB_Equals_Bytes_IMP(ByteBuf *self, const void *bytes, size_t size) {
     return SI_equals_bytes(self, bytes, size);
@@ -154,6 +172,7 @@ BB_Equals_Bytes_IMP(ByteBuf *self, const void *bytes, size_t size) {
 
 static CFISH_INLINE void
 SI_cat_bytes(ByteBuf *self, const void *bytes, size_t size) {
+    SI_check_frozen(self);
     SI_add_grow_and_oversize(self, self->size, size);
     memcpy(self->buf + self->size, bytes, size);
     self->size += size;
@@ -171,6 +190,7 @@ BB_Cat_IMP(ByteBuf *self, Blob *blob) {
 
 char*
 BB_Grow_IMP(ByteBuf *self, size_t min_cap) {
+    SI_check_frozen(self);
     if (min_cap > self->cap) {
         // Round up to next multiple of eight.
         size_t capacity = (min_cap + 7) & ((size_t)~7);
@@ -186,6 +206,7 @@ BB_Grow_IMP(ByteBuf *self, size_t min_cap) {
 
 Blob*
 BB_Yield_Blob_IMP(ByteBuf *self) {
+    SI_check_frozen(self);
     Blob *blob = Blob_new_steal(self->buf, self->size);
     self->buf  = NULL;
     self->size = 0;
@@ -193,6 +214,16 @@ BB_Yield_Blob_IMP(ByteBuf *self) {
     return blob;
 }
 
+void
+BB_Freeze_IMP(ByteBuf *self) {
+    self->frozen = true;
+}
+
+bool
+BB_Is_Frozen_IMP(ByteBuf *self) {
+    return self->frozen;
+}
+
 String*
 BB_Utf8_To_String_IMP(ByteBuf *self) {
     return Str_new_from_utf8(self->buf, self->size);
@@ -250,4 +281,13 @@ S_overflow_error() {
     THROW(ERR, "ByteBuf buffer overflow");
 }
 
+static CFISH_INLINE void
+SI_check_frozen(ByteBuf *self) {
+    if (self->frozen) { S_frozen_error(); }
+}
+
+static void
+S_frozen_error() {
+    THROW(ERR, "Can't modify frozen ByteBuf");
+}
 
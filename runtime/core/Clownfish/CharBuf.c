@@ -29,6 +29,7 @@
 
 #include "Clownfish/Err.h"
 #include "Clownfish/String.h"
+#include "Clownfish/Util/Atomic.h"
 #include "Clownfish/Util/Memory.h"
 #include "Clownfish/Class.h"
 
@@ -60,6 +61,46 @@ S_overflow_error(void);
 static void
 S_die_invalid_specifier(const char *specifier);
 
+typedef enum {
+    FORMAT_OP_LITERAL,
+    FORMAT_OP_OBJ,
+    FORMAT_OP_CSTR,
+    FORMAT_OP_I32,
+    FORMAT_OP_I64,
+    FORMAT_OP_U32,
+    FORMAT_OP_U64,
+    FORMAT_OP_F64,
+    FORMAT_OP_X32
+} FormatOpType;
+
+typedef struct {
+    FormatOpType  type;
+    const char   *ptr;   // Literal text.
+    size_t        size;  // Size of literal text in bytes.
+} FormatOp;
+
+struct cfish_CompiledFormat {
+    const char *pattern;   // Address of the original pattern.
+    const char *text;      // Copy of the pattern.
+    size_t      text_len;
+    FormatOp   *ops;
+    size_t      num_ops;
+    size_t      estimate;  // Estimated size of the output.
+};
+
+// Cache of compiled formats keyed by pattern address.  Entries are never
+// removed.
+#define FORMAT_CACHE_BITS      9
+#define FORMAT_CACHE_SIZE      (1 << FORMAT_CACHE_BITS)
+#define FORMAT_CACHE_MAX_PROBE 8
+static CompiledFormat *volatile format_cache[FORMAT_CACHE_SIZE];
+
+// Find the compiled format for `pattern` in the cache, compiling it if
+// necessary.  Sets `cached` to false if the format couldn't be cached and
+// must be freed by the caller.
+static CompiledFormat*
+S_lookup_format(const char *pattern, bool *cached);
+
 CharBuf*
 CB_new(size_t size) {
     CharBuf *self = (CharBuf*)Class_Make_Obj(CHARBUF);
@@ -126,133 +167,288 @@ CB_catf(CharBuf *self, const char *pattern, ...) {
 
 void
 CB_VCatF_IMP(CharBuf *self, const char *pattern, va_list args) {
-    size_t      pattern_len = strlen(pattern);
-    const char *pattern_end = pattern + pattern_len;
-    char        buf[64];
+    bool            cached;
+    CompiledFormat *format = S_lookup_format(pattern, &cached);
+    CB_vcatf_compiled(self, format, args);
+    if (!cached) { CB_free_format(format); }
+}
 
-    for (; pattern < pattern_end; pattern++) {
-        const char *slice_end = pattern;
+CompiledFormat*
+CB_compile_format(const char *pattern) {
+    // Every '%' yields at most one conversion and one literal op.
+    size_t num_percents = 0;
+    const char *end = pattern;
+    for (; *end != '\0'; end++) {
+        if (*end == '%') { num_percents++; }
+    }
+    size_t pattern_len = (size_t)(end - pattern);
+    size_t max_ops     = num_percents * 2 + 1;
+
+    // Allocate the struct, the ops and a copy of the pattern in one block.
+    size_t alloc_size = sizeof(CompiledFormat)
+                        + max_ops * sizeof(FormatOp)
+                        + pattern_len + 1;
+    CompiledFormat *format = (CompiledFormat*)MALLOCATE(alloc_size);
+    FormatOp *ops  = (FormatOp*)(format + 1);
+    char     *text = (char*)(ops + max_ops);
+    memcpy(text, pattern, pattern_len + 1);
+    format->pattern  = pattern;
+    format->text     = text;
+    format->text_len = pattern_len;
+    format->ops      = ops;
+
+    size_t      num_ops  = 0;
+    size_t      estimate = 0;
+    const char *ptr      = text;
+    const char *text_end = text + pattern_len;
+
+    while (ptr < text_end) {
+        const char *slice_end = ptr;
 
         // Consume all characters leading up to a '%'.
-        while (slice_end < pattern_end && *slice_end != '%') { slice_end++; }
-        if (pattern != slice_end) {
-            ptrdiff_t size = slice_end - pattern;
-            VALIDATE_UTF8(pattern, size);
-            S_cat_utf8(self, pattern, (size_t)size);
-            pattern = slice_end;
+        while (slice_end < text_end && *slice_end != '%') { slice_end++; }
+        if (ptr != slice_end) {
+            size_t size = (size_t)(slice_end - ptr);
+            if (!Str_utf8_valid(ptr, size)) {
+                size_t offset = (size_t)(ptr - text);
+                FREEMEM(format);
+                VALIDATE_UTF8(pattern + offset, size);
+            }
+            ops[num_ops].type = FORMAT_OP_LITERAL;
+            ops[num_ops].ptr  = ptr;
+            ops[num_ops].size = size;
+            num_ops++;
+            estimate += size;
+            ptr = slice_end;
+            if (ptr == text_end) { break; }
         }
 
-        if (pattern < pattern_end) {
-            pattern++; // Move past '%'.
-
-            switch (*pattern) {
-                case '%': {
-                        S_cat_utf8(self, "%", 1);
+        ptr++; // Move past '%'.
+
+        // Assume NULL-terminated pattern string, which eliminates the need
+        // for bounds checking if '%' is the last visible character.
+        FormatOpType type    = FORMAT_OP_LITERAL;
+        size_t       guess   = 0;
+        size_t       advance = 1;
+        switch (*ptr) {
+            case '%':
+                type  = FORMAT_OP_LITERAL;
+                guess = 1;
+                break;
+            case 'o':
+                type  = FORMAT_OP_OBJ;
+                guess = 16;
+                break;
+            case 's':
+                type  = FORMAT_OP_CSTR;
+                guess = 16;
+                break;
+            case 'i':
+            case 'u': {
+                    bool is_signed = *ptr == 'i';
+                    if (ptr[1] == '8') {
+                        type    = is_signed ? FORMAT_OP_I32 : FORMAT_OP_U32;
+                        advance = 2;
                     }
-                    break;
-                case 'o': {
-                        Obj *obj = va_arg(args, Obj*);
-                        if (!obj) {
-                            S_cat_utf8(self, "[NULL]", 6);
-                        }
-                        else if (Obj_is_a(obj, STRING)) {
-                            CB_Cat(self, (String*)obj);
-                        }
-                        else {
-                            String *string = Obj_To_String(obj);
-                            CB_Cat(self, string);
-                            DECREF(string);
-                        }
+                    else if (ptr[1] == '3' && ptr[2] == '2') {
+                        type    = is_signed ? FORMAT_OP_I32 : FORMAT_OP_U32;
+                        advance = 3;
                     }
-                    break;
-                case 'i': {
-                        int64_t val = 0;
-                        if (pattern[1] == '8') {
-                            val = va_arg(args, int32_t);
-                            pattern++;
-                        }
-                        else if (pattern[1] == '3' && pattern[2] == '2') {
-                            val = va_arg(args, int32_t);
-                            pattern += 2;
-                        }
-                        else if (pattern[1] == '6' && pattern[2] == '4') {
-                            val = va_arg(args, int64_t);
-                            pattern += 2;
-                        }
-                        else {
-                            S_die_invalid_specifier(pattern);
-                        }
-                        int size = sprintf(buf, "%" PRId64, val);
-                        S_cat_utf8(self, buf, (size_t)size);
+                    else if (ptr[1] == '6' && ptr[2] == '4') {
+                        type    = is_signed ? FORMAT_OP_I64 : FORMAT_OP_U64;
+                        advance = 3;
                     }
-                    break;
-                case 'u': {
-                        uint64_t val = 0;
-                        if (pattern[1] == '8') {
-                            val = va_arg(args, uint32_t);
-                            pattern += 1;
-                        }
-                        else if (pattern[1] == '3' && pattern[2] == '2') {
-                            val = va_arg(args, uint32_t);
-                            pattern += 2;
-                        }
-                        else if (pattern[1] == '6' && pattern[2] == '4') {
-                            val = va_arg(args, uint64_t);
-                            pattern += 2;
-                        }
-                        else {
-                            S_die_invalid_specifier(pattern);
-                        }
-                        int size = sprintf(buf, "%" PRIu64, val);
-                        S_cat_utf8(self, buf, (size_t)size);
+                    else {
+                        advance = 0;
                     }
-                    break;
-                case 'f': {
-                        if (pattern[1] == '6' && pattern[2] == '4') {
-                            double num  = va_arg(args, double);
-                            char bigbuf[512];
-                            int size = sprintf(bigbuf, "%g", num);
-                            S_cat_utf8(self, bigbuf, (size_t)size);
-                            pattern += 2;
-                        }
-                        else {
-                            S_die_invalid_specifier(pattern);
-                        }
+                    guess = 20;
+                }
+                break;
+            case 'f':
+                if (ptr[1] == '6' && ptr[2] == '4') {
+                    type    = FORMAT_OP_F64;
+                    advance = 3;
+                }
+                else {
+                    advance = 0;
+                }
+                guess = 24;
+                break;
+            case 'x':
+                if (ptr[1] == '3' && ptr[2] == '2') {
+                    type    = FORMAT_OP_X32;
+                    advance = 3;
+                }
+                else {
+                    advance = 0;
+                }
+                guess = 8;
+                break;
+            default:
+                advance = 0;
+        }
+
+        if (advance == 0) {
+            size_t offset = (size_t)(ptr - text);
+            FREEMEM(format);
+            S_die_invalid_specifier(pattern + offset);
+        }
+
+        ops[num_ops].type = type;
+        ops[num_ops].ptr  = ptr; // For "%%", points to the second '%'.
+        ops[num_ops].size = 1;
+        num_ops++;
+        estimate += guess;
+        ptr += advance;
+    }
+
+    format->num_ops  = num_ops;
+    format->estimate = estimate;
+    return format;
+}
+
+void
+CB_free_format(CompiledFormat *format) {
+    FREEMEM(format);
+}
+
+size_t
+CB_format_size_estimate(const CompiledFormat *format) {
+    return format->estimate;
+}
+
+void
+CB_catf_compiled(CharBuf *self, const CompiledFormat *format, ...) {
+    va_list args;
+    va_start(args, format);
+    CB_vcatf_compiled(self, format, args);
+    va_end(args);
+}
+
+void
+CB_vcatf_compiled(CharBuf *self, const CompiledFormat *format,
+                  va_list args) {
+    const FormatOp *op  = format->ops;
+    const FormatOp *end = op + format->num_ops;
+    char            buf[64];
+
+    // Grow once up front so that most appends don't have to reallocate.
+    SI_add_grow_and_oversize(self, self->size, format->estimate);
+
+    for (; op < end; op++) {
+        switch (op->type) {
+            case FORMAT_OP_LITERAL:
+                SI_cat_utf8(self, op->ptr, op->size);
+                break;
+            case FORMAT_OP_OBJ: {
+                    Obj *obj = va_arg(args, Obj*);
+                    if (!obj) {
+                        S_cat_utf8(self, "[NULL]", 6);
                     }
-                    break;
-                case 'x': {
-                        if (pattern[1] == '3' && pattern[2] == '2') {
-                            unsigned long val = va_arg(args, uint32_t);
-                            int size = sprintf(buf, "%.8lx", val);
-                            S_cat_utf8(self, buf, (size_t)size);
-                            pattern += 2;
-                        }
-                        else {
-                            S_die_invalid_specifier(pattern);
-                        }
+                    else {
+                        Obj_Cat_To(obj, self);
                     }
-                    break;
-                case 's': {
-                        char *string = va_arg(args, char*);
-                        if (string == NULL) {
-                            S_cat_utf8(self, "[NULL]", 6);
-                        }
-                        else {
-                            size_t size = strlen(string);
-                            VALIDATE_UTF8(string, size);
-                            S_cat_utf8(self, string, size);
-                        }
+                }
+                break;
+            case FORMAT_OP_CSTR: {
+                    char *string = va_arg(args, char*);
+                    if (string == NULL) {
+                        S_cat_utf8(self, "[NULL]", 6);
                     }
-                    break;
-                default: {
-                        // Assume NULL-terminated pattern string, which
-                        // eliminates the need for bounds checking if '%' is
-                        // the last visible character.
-                        S_die_invalid_specifier(pattern);
+                    else {
+                        size_t size = strlen(string);
+                        VALIDATE_UTF8(string, size);
+                        S_cat_utf8(self, string, size);
                     }
+                }
+                break;
+            case FORMAT_OP_I32: {
+                    int64_t val = va_arg(args, int32_t);
+                    int size = sprintf(buf, "%" PRId64, val);
+                    S_cat_utf8(self, buf, (size_t)size);
+                }
+                break;
+            case FORMAT_OP_I64: {
+                    int64_t val = va_arg(args, int64_t);
+                    int size = sprintf(buf, "%" PRId64, val);
+                    S_cat_utf8(self, buf, (size_t)size);
+                }
+                break;
+            case FORMAT_OP_U32: {
+                    uint64_t val = va_arg(args, uint32_t);
+                    int size = sprintf(buf, "%" PRIu64, val);
+                    S_cat_utf8(self, buf, (size_t)size);
+                }
+                break;
+            case FORMAT_OP_U64: {
+                    uint64_t val = va_arg(args, uint64_t);
+                    int size = sprintf(buf, "%" PRIu64, val);
+                    S_cat_utf8(self, buf, (size_t)size);
+                }
+                break;
+            case FORMAT_OP_F64: {
+                    double num  = va_arg(args, double);
+                    char bigbuf[512];
+                    int size = sprintf(bigbuf, "%g", num);
+                    S_cat_utf8(self, bigbuf, (size_t)size);
+                }
+                break;
+            case FORMAT_OP_X32: {
+                    unsigned long val = va_arg(args, uint32_t);
+                    int size = sprintf(buf, "%.8lx", val);
+                    S_cat_utf8(self, buf, (size_t)size);
+                }
+                break;
+        }
+    }
+}
+
+static CFISH_INLINE bool
+SI_format_matches(const CompiledFormat *format, const char *pattern) {
+    // The address may have been reused for different text, so verify the
+    // contents.  strncmp stops at the first NUL in either string.
+    return format->pattern == pattern
+           && strncmp(format->text, pattern, format->text_len + 1) == 0;
+}
+
+static CompiledFormat*
+S_lookup_format(const char *pattern, bool *cached) {
+    // Fibonacci hashing of the pattern address.
+    uint64_t addr  = (uint64_t)(uintptr_t)pattern;
+    uint64_t hash  = addr * UINT64_C(0x9E3779B97F4A7C15);
+    size_t   start = (size_t)(hash >> (64 - FORMAT_CACHE_BITS));
+    CompiledFormat *format = NULL;
+
+    for (size_t i = 0; i < FORMAT_CACHE_MAX_PROBE; i++) {
+        size_t tick = (start + i) & (FORMAT_CACHE_SIZE - 1);
+        CompiledFormat *entry = format_cache[tick];
+
+        if (entry == NULL) {
+            if (format == NULL) { format = CB_compile_format(pattern); }
+            if (Atomic_cas_ptr((void*volatile*)&format_cache[tick], NULL,
+                               format)) {
+                *cached = true;
+                return format;
             }
+            // Lost a race.  Examine the entry which was installed.
+            entry = format_cache[tick];
+        }
+
+        if (entry->pattern == pattern) {
+            if (SI_format_matches(entry, pattern)) {
+                if (format != NULL) { CB_free_format(format); }
+                *cached = true;
+                return entry;
+            }
+            // Same address, different text.  Don't cache.
+            break;
         }
     }
+
+    // No room in the cache.  Compile a temporary format.
+    if (format == NULL) { format = CB_compile_format(pattern); }
+    *cached = false;
+    return format;
 }
 
 String*
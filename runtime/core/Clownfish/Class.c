@@ -41,7 +41,9 @@
 #define InheritedMethSpec        cfish_InheritedMethSpec
 #define ClassSpec                cfish_ClassSpec
 
-uint32_t Class_offset_of_parent = offsetof(Class, parent);
+uint32_t Class_offset_of_parent  = offsetof(Class, parent);
+uint32_t Class_offset_of_depth   = offsetof(Class, depth);
+uint32_t Class_offset_of_display = offsetof(Class, display);
 
 static void
 S_set_name(Class *self, const char *utf8, size_t size);
@@ -49,6 +51,9 @@ S_set_name(Class *self, const char *utf8, size_t size);
 static Method*
 S_find_method(Class *self, const char *meth_name);
 
+static void
+S_init_display(Class *self, Class *parent);
+
 static LockFreeRegistry *Class_registry;
 cfish_Class_bootstrap_hook1_t cfish_Class_bootstrap_hook1;
 
@@ -133,6 +138,7 @@ Class_bootstrap(const cfish_ParcelSpec *parcel_spec) {
 
         klass->parent      = parent;
         klass->parcel_spec = parcel_spec;
+        S_init_display(klass, parent);
 
         // CLASS->obj_alloc_size must stay at 0.
         if (klass != CLASS) {
@@ -201,20 +207,12 @@ Class_bootstrap(const cfish_ParcelSpec *parcel_spec) {
         const ClassSpec *spec = &specs[i];
         Class *klass = *spec->klass;
 
-        String *name_internal
-            = Str_new_from_trusted_utf8(spec->name, strlen(spec->name));
-        if (!Atomic_cas_ptr((void**)&klass->name_internal, NULL,
-                            name_internal)
-           ) {
-            DECREF(name_internal);
-            name_internal = klass->name_internal;
-        }
-
-        String *name = Str_new_wrap_trusted_utf8(Str_Get_Ptr8(name_internal),
-                                                 Str_Get_Size(name_internal));
+        // Class names are immortal Strings wrapping the literals in the
+        // parcel spec, so they never have to be copied.
+        String *name = Str_new_immortal_trusted_utf8(spec->name,
+                                                     strlen(spec->name));
         if (!Atomic_cas_ptr((void**)&klass->name, NULL, name)) {
-            DECREF(name);
-            name = klass->name;
+            Str_discard_immortal(name);
         }
 
         Method **methods = (Method**)MALLOCATE((spec->num_novel_meths + 1)
@@ -223,7 +221,8 @@ Class_bootstrap(const cfish_ParcelSpec *parcel_spec) {
         // Only store novel methods for now.
         for (size_t i = 0; i < spec->num_novel_meths; ++i) {
             const NovelMethSpec *mspec = &novel_specs[num_novel++];
-            String *name = SSTR_WRAP_C(mspec->name);
+            String *name = Str_new_immortal_trusted_utf8(mspec->name,
+                                                         strlen(mspec->name));
             Method *method = Method_new(name, mspec->callback_func,
                                         *mspec->offset);
             methods[i] = method;
@@ -234,7 +233,9 @@ Class_bootstrap(const cfish_ParcelSpec *parcel_spec) {
         if (!Atomic_cas_ptr((void**)&klass->methods, NULL, methods)) {
             // Another thread beat us to it.
             for (size_t i = 0; i < spec->num_novel_meths; ++i) {
+                String *name = methods[i]->name;
                 Method_Destroy(methods[i]);
+                Str_discard_immortal(name);
             }
             FREEMEM(methods);
         }
@@ -292,6 +293,27 @@ Class_init_registry() {
     }
 }
 
+/* Every class stores its depth in the hierarchy and a display of all its
+ * ancestors indexed by depth, ending with the class itself.  `klass` is a
+ * subclass of `ancestor` if the display of `klass` has `ancestor` at the
+ * depth of `ancestor`, which makes subtype checks take constant time.
+ */
+static void
+S_init_display(Class *self, Class *parent) {
+    uint32_t depth = parent ? parent->depth + 1 : 0;
+    Class **display = (Class**)MALLOCATE((depth + 1) * sizeof(Class*));
+    if (parent) {
+        memcpy(display, parent->display, depth * sizeof(Class*));
+    }
+    display[depth] = self;
+
+    self->depth = depth;
+    if (!Atomic_cas_ptr((void**)&self->display, NULL, display)) {
+        // Another thread beat us to it.
+        FREEMEM(display);
+    }
+}
+
 static Class*
 S_subclass_from_host(Class *parent, String *name) {
     if (parent->flags & CFISH_fFINAL) {
@@ -303,6 +325,7 @@ S_subclass_from_host(Class *parent, String *name) {
     Class_Init_Obj(parent->klass, subclass);
 
     subclass->parent           = parent;
+    S_init_display(subclass, parent);
     subclass->flags            = parent->flags;
     subclass->obj_alloc_size   = parent->obj_alloc_size;
     subclass->class_alloc_size = parent->class_alloc_size;
@@ -454,13 +477,14 @@ Class_Exclude_Host_Method_IMP(Class *self, const char *meth_name) {
 static void
 S_set_name(Class *self, const char *utf8, size_t size) {
     /*
-     * We use a "wrapped" String for `name` because it's effectively
-     * threadsafe: the sole reference is owned by an immortal object and any
-     * INCREF spawns a copy.
+     * We use an immortal String for `name` because it's threadsafe and
+     * INCREF is free.  It wraps the buffer of `name_internal` which lives
+     * as long as the Class.
      */
     self->name_internal = Str_new_from_trusted_utf8(utf8, size);
-    self->name = Str_new_wrap_trusted_utf8(Str_Get_Ptr8(self->name_internal),
-                                           Str_Get_Size(self->name_internal));
+    self->name = Str_new_immortal_trusted_utf8(
+                     Str_Get_Ptr8(self->name_internal),
+                     Str_Get_Size(self->name_internal));
 }
 
 static Method*
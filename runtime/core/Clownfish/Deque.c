@@ -0,0 +1,195 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define C_CFISH_DEQUE
+#define CFISH_USE_SHORT_NAMES
+
+#include <string.h>
+
+#include "Clownfish/Deque.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Util/Hashing.h"
+#include "Clownfish/Util/Memory.h"
+
+// The capacity is always zero or a power of two, so that indices can be
+// wrapped with a mask.
+#define MAX_DEQUE_CAP (((SIZE_MAX / sizeof(Obj*)) >> 1) + 1)
+
+static void
+S_grow(Deque *self, size_t min_cap);
+
+static CFISH_INLINE size_t
+SI_slot(Deque *self, size_t tick) {
+    return (self->head + tick) & (self->cap - 1);
+}
+
+Deque*
+Deque_new(size_t capacity) {
+    Deque *self = (Deque*)Class_Make_Obj(DEQUE);
+    return Deque_init(self, capacity);
+}
+
+Deque*
+Deque_init(Deque *self, size_t capacity) {
+    self->elems = NULL;
+    self->cap   = 0;
+    self->head  = 0;
+    self->size  = 0;
+    if (capacity) { S_grow(self, capacity); }
+    return self;
+}
+
+void
+Deque_Destroy_IMP(Deque *self) {
+    Deque_Clear(self);
+    FREEMEM(self->elems);
+    SUPER_DESTROY(self, DEQUE);
+}
+
+void
+Deque_Push_IMP(Deque *self, Obj *element) {
+    if (self->size == self->cap) { S_grow(self, self->size + 1); }
+    self->elems[SI_slot(self, self->size)] = element;
+    self->size++;
+}
+
+void
+Deque_Push_Front_IMP(Deque *self, Obj *element) {
+    if (self->size == self->cap) { S_grow(self, self->size + 1); }
+    self->head = (self->head - 1) & (self->cap - 1);
+    self->elems[self->head] = element;
+    self->size++;
+}
+
+Obj*
+Deque_Pop_IMP(Deque *self) {
+    if (!self->size) { return NULL; }
+    self->size--;
+    return self->elems[SI_slot(self, self->size)];
+}
+
+Obj*
+Deque_Pop_Front_IMP(Deque *self) {
+    if (!self->size) { return NULL; }
+    Obj *elem = self->elems[self->head];
+    self->head = (self->head + 1) & (self->cap - 1);
+    self->size--;
+    return elem;
+}
+
+Obj*
+Deque_Fetch_IMP(Deque *self, size_t tick) {
+    if (tick >= self->size) { return NULL; }
+    return self->elems[SI_slot(self, tick)];
+}
+
+void
+Deque_Grow_IMP(Deque *self, size_t capacity) {
+    if (capacity > self->cap) { S_grow(self, capacity); }
+}
+
+void
+Deque_Clear_IMP(Deque *self) {
+    for (size_t i = 0; i < self->size; i++) {
+        DECREF(self->elems[SI_slot(self, i)]);
+    }
+    self->head = 0;
+    self->size = 0;
+}
+
+size_t
+Deque_Get_Size_IMP(Deque *self) {
+    return self->size;
+}
+
+size_t
+Deque_Get_Capacity_IMP(Deque *self) {
+    return self->cap;
+}
+
+bool
+Deque_Equals_IMP(Deque *self, Obj *other) {
+    Deque *twin = (Deque*)other;
+    if (twin == self)             { return true; }
+    if (!Obj_is_a(other, DEQUE))  { return false; }
+    if (twin->size != self->size) { return false; }
+
+    for (size_t i = 0; i < self->size; i++) {
+        Obj *val       = self->elems[SI_slot(self, i)];
+        Obj *other_val = twin->elems[SI_slot(twin, i)];
+        if (val) {
+            if (!other_val || !Obj_Equals(val, other_val)) { return false; }
+        }
+        else if (other_val) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+Deque_Digest_IMP(Deque *self, uint64_t *digest) {
+    Hashing_digest_init(digest, HASHING_DIGEST_DEQUE);
+    Hashing_digest_mix(digest, (uint64_t)self->size);
+    for (size_t i = 0; i < self->size; i++) {
+        Obj      *elem = self->elems[SI_slot(self, i)];
+        uint64_t  elem_digest[2];
+        if (elem) {
+            Obj_Digest(elem, elem_digest);
+        }
+        else {
+            Hashing_digest_init(elem_digest, HASHING_DIGEST_NULL);
+        }
+        Hashing_digest_mix_digest(digest, elem_digest);
+    }
+}
+
+Deque*
+Deque_Clone_IMP(Deque *self) {
+    Deque *twin = Deque_new(self->size);
+    for (size_t i = 0; i < self->size; i++) {
+        twin->elems[i] = INCREF(self->elems[SI_slot(self, i)]);
+    }
+    twin->size = self->size;
+    return twin;
+}
+
+// Grow the ring buffer to the smallest power of two >= `min_cap`.
+static void
+S_grow(Deque *self, size_t min_cap) {
+    if (min_cap > MAX_DEQUE_CAP) {
+        THROW(ERR, "Deque capacity overflow");
+    }
+    size_t new_cap = self->cap ? self->cap : 4;
+    while (new_cap < min_cap) { new_cap <<= 1; }
+
+    size_t old_cap = self->cap;
+    self->elems = (Obj**)REALLOCATE(self->elems, new_cap * sizeof(Obj*));
+    self->cap   = new_cap;
+
+    // If the elements wrapped around the end of the old buffer, move the
+    // wrapped part behind the old end.  The new capacity is at least twice
+    // the old one, so it fits.
+    if (self->head + self->size > old_cap) {
+        size_t num_wrapped = self->head + self->size - old_cap;
+        memcpy(self->elems + old_cap, self->elems,
+               num_wrapped * sizeof(Obj*));
+    }
+}
+
@@ -54,6 +54,21 @@ Err_To_String_IMP(Err *self) {
     return (String*)INCREF(self->mess);
 }
 
+void
+Err_Cat_To_IMP(Err *self, CharBuf *buf) {
+    // Err isn't final, so respect subclasses which only override To_String.
+    Err_To_String_t to_string
+        = METHOD_PTR(Obj_get_class((Obj*)self), CFISH_Err_To_String);
+    if (to_string != Err_To_String_IMP) {
+        String *string = to_string(self);
+        CB_Cat(buf, string);
+        DECREF(string);
+    }
+    else {
+        CB_Cat(buf, self->mess);
+    }
+}
+
 void
 Err_Cat_Mess_IMP(Err *self, String *mess) {
     String *new_mess = Str_Cat(self->mess, mess);
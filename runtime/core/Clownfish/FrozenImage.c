@@ -0,0 +1,1003 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define C_CFISH_FROZENIMAGE
+#define C_CFISH_STRING
+#define C_CFISH_BLOB
+#define C_CFISH_VECTOR
+#define C_CFISH_HASH
+#define C_CFISH_INTEGER
+#define C_CFISH_FLOAT
+#define CFISH_USE_SHORT_NAMES
+
+#include "charmony.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(CHY_HAS_SYS_MMAN_H) && defined(CHY_HAS_UNISTD_H)
+  #define CFISH_IMAGE_MMAP_POSIX
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#elif defined(CHY_HAS_WINDOWS_H)
+  #define CFISH_IMAGE_MMAP_WINDOWS
+  #include <windows.h>
+#endif
+
+#include "Clownfish/FrozenImage.h"
+#include "Clownfish/Blob.h"
+#include "Clownfish/Boolean.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/OutStream.h"
+#include "Clownfish/PtrHash.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Hashing.h"
+#include "Clownfish/Util/Memory.h"
+
+#define IMG_VERSION 1
+
+// Object kinds.
+#define IMG_STRING   1
+#define IMG_BLOB     2
+#define IMG_VECTOR   3
+#define IMG_HASH     4
+#define IMG_INTEGER  5
+#define IMG_FLOAT    6
+#define IMG_MAX_KIND 6
+
+// References to objects are offsets from the start of the image.  Small
+// values which can't be offsets stand for NULL and the Booleans.
+#define IMG_REF_NULL  0
+#define IMG_REF_TRUE  1
+#define IMG_REF_FALSE 2
+
+// Strings are hashed with this probe to detect whether the hash function or
+// seed differs from the writer's.
+#define IMG_HASH_PROBE      "Clownfish::FrozenImage"
+#define IMG_HASH_PROBE_SIZE (sizeof(IMG_HASH_PROBE) - 1)
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;    /* 0x01020304 in the writer's byte order */
+    uint32_t ptr_size;
+    uint32_t alloc_sizes[IMG_MAX_KIND + 1];
+    uint64_t hash_probe;
+    uint64_t size;
+    uint64_t root;
+    uint64_t objs_start;
+    uint64_t objs_end;
+    uint64_t arrays_end;    /* arrays start at objs_end */
+    uint64_t bytes_end;     /* bytes start at arrays_end */
+} ImageHeader;
+
+// Before relocation, every object slot starts with a record describing the
+// object.  Relocation turns it into a real object of at least the same size.
+typedef struct {
+    uint64_t kind;
+    uint64_t a;  /* data or array offset, or the value of numbers */
+    uint64_t b;  /* size of data or Vectors, capacity of Hashes */
+    uint64_t c;  /* size of Hashes */
+} ObjRecord;
+
+// Must match the layout in Hash.c.
+typedef struct HashEntry {
+    String *key;
+    Obj    *value;
+    size_t  hash_sum;
+} HashEntry;
+
+typedef struct {
+    Vector   *objs;
+    PtrHash  *seen;       /* maps objects to their number + 1 */
+    Hash     *strings;    /* maps String contents to their number + 1 */
+    uint64_t *slot_offs;
+    uint64_t *aux_offs;   /* offset of arrays and data */
+    uint64_t  objs_end;
+    uint64_t  arrays_end;
+    uint64_t  bytes_end;
+} ImageWriter;
+
+static const char IMG_MAGIC[8] = { 'C', 'F', 'I', 'S', 'H', 'I', 'M', 'G' };
+
+static int
+S_kind(Obj *obj);
+
+static Class*
+S_kind_class(int kind);
+
+static size_t
+S_slot_size(int kind);
+
+static size_t
+S_hash_capacity(size_t size);
+
+static void
+S_do_write(void *context);
+
+static void
+S_register(ImageWriter *writer, Obj *obj);
+
+static uint64_t
+S_ref(ImageWriter *writer, Obj *obj);
+
+static void
+S_write_hash_entries(ImageWriter *writer, Hash *hash, uint64_t capacity,
+                     OutStream *outstream);
+
+static void
+S_write_padding(OutStream *outstream, size_t size);
+
+static void
+S_load(FrozenImage *self);
+
+static String*
+S_relocate(char *base, size_t size, Obj **root_ptr, bool *rehashed_ptr);
+
+static void
+S_rehash(Hash *hash);
+
+static String*
+S_map_private(String *path, void **base_ptr, size_t *size_ptr);
+
+static void
+S_unmap(void *base, size_t size);
+
+static CFISH_INLINE uint64_t
+SI_align8(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+/**************************** Writing *************************************/
+
+typedef struct {
+    Obj       *root;
+    OutStream *outstream;
+    ImageWriter writer;
+} WriteContext;
+
+void
+FrozenImage_write(Obj *root, OutStream *outstream) {
+    WriteContext context;
+    context.root             = root;
+    context.outstream        = outstream;
+    context.writer.objs      = Vec_new(0);
+    context.writer.seen      = PtrHash_new(0);
+    context.writer.strings   = Hash_new(0);
+    context.writer.slot_offs = NULL;
+    context.writer.aux_offs  = NULL;
+
+    Err *error = Err_trap(S_do_write, &context);
+
+    DECREF(context.writer.objs);
+    PtrHash_Destroy(context.writer.seen);
+    DECREF(context.writer.strings);
+    FREEMEM(context.writer.slot_offs);
+    FREEMEM(context.writer.aux_offs);
+    if (error) {
+        RETHROW(error);
+    }
+}
+
+static void
+S_do_write(void *vcontext) {
+    WriteContext *context   = (WriteContext*)vcontext;
+    ImageWriter  *writer    = &context->writer;
+    OutStream    *outstream = context->outstream;
+
+    // Collect all objects breadth-first, so that deep graphs don't need
+    // deep recursion.
+    S_register(writer, context->root);
+    for (size_t i = 0; i < Vec_Get_Size(writer->objs); i++) {
+        Obj *obj = Vec_Fetch(writer->objs, i);
+        switch (S_kind(obj)) {
+            case IMG_VECTOR: {
+                Vector *vector = (Vector*)obj;
+                for (size_t j = 0; j < vector->size; j++) {
+                    S_register(writer, vector->elems[j]);
+                }
+                break;
+            }
+            case IMG_HASH: {
+                HashIterator *iter = HashIter_new((Hash*)obj);
+                while (HashIter_Next(iter)) {
+                    S_register(writer, (Obj*)HashIter_Get_Key(iter));
+                    S_register(writer, HashIter_Get_Value(iter));
+                }
+                DECREF(iter);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // Lay out the sections.
+    size_t num_objs = Vec_Get_Size(writer->objs);
+    writer->slot_offs
+        = (uint64_t*)MALLOCATE((num_objs + 1) * sizeof(uint64_t));
+    writer->aux_offs
+        = (uint64_t*)MALLOCATE((num_objs + 1) * sizeof(uint64_t));
+
+    uint64_t objs_start = SI_align8(sizeof(ImageHeader));
+    uint64_t offset     = objs_start;
+    for (size_t i = 0; i < num_objs; i++) {
+        writer->slot_offs[i] = offset;
+        offset += S_slot_size(S_kind(Vec_Fetch(writer->objs, i)));
+    }
+    writer->objs_end = offset;
+    for (size_t i = 0; i < num_objs; i++) {
+        Obj *obj = Vec_Fetch(writer->objs, i);
+        switch (S_kind(obj)) {
+            case IMG_VECTOR:
+                writer->aux_offs[i] = offset;
+                offset += ((Vector*)obj)->size * sizeof(Obj*);
+                break;
+            case IMG_HASH:
+                writer->aux_offs[i] = offset;
+                offset += S_hash_capacity(Hash_Get_Size((Hash*)obj))
+                          * sizeof(HashEntry);
+                break;
+            default:
+                break;
+        }
+    }
+    writer->arrays_end = offset;
+    for (size_t i = 0; i < num_objs; i++) {
+        Obj *obj = Vec_Fetch(writer->objs, i);
+        switch (S_kind(obj)) {
+            case IMG_STRING:
+                writer->aux_offs[i] = offset;
+                offset += ((String*)obj)->size;
+                break;
+            case IMG_BLOB:
+                writer->aux_offs[i] = offset;
+                offset += ((Blob*)obj)->size;
+                break;
+            default:
+                break;
+        }
+    }
+    writer->bytes_end = offset;
+
+    // Header.
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMG_MAGIC, sizeof(IMG_MAGIC));
+    header.version    = IMG_VERSION;
+    header.byte_order = 0x01020304;
+    header.ptr_size   = (uint32_t)sizeof(void*);
+    for (int kind = 1; kind <= IMG_MAX_KIND; kind++) {
+        header.alloc_sizes[kind]
+            = (uint32_t)Class_Get_Obj_Alloc_Size(S_kind_class(kind));
+    }
+    header.hash_probe = Hashing_hash_bytes(IMG_HASH_PROBE,
+                                           IMG_HASH_PROBE_SIZE);
+    header.size       = writer->bytes_end;
+    header.root       = S_ref(writer, context->root);
+    header.objs_start = objs_start;
+    header.objs_end   = writer->objs_end;
+    header.arrays_end = writer->arrays_end;
+    header.bytes_end  = writer->bytes_end;
+
+    int64_t start = OutStream_Tell(outstream);
+    OutStream_Write_Bytes(outstream, &header, sizeof(header));
+    S_write_padding(outstream, (size_t)(objs_start - sizeof(header)));
+
+    // Object records, padded to the size of the relocated objects.
+    for (size_t i = 0; i < num_objs; i++) {
+        Obj *obj  = Vec_Fetch(writer->objs, i);
+        int  kind = S_kind(obj);
+        ObjRecord record = { (uint64_t)kind, 0, 0, 0 };
+        switch (kind) {
+            case IMG_STRING:
+                record.a = writer->aux_offs[i];
+                record.b = ((String*)obj)->size;
+                break;
+            case IMG_BLOB:
+                record.a = writer->aux_offs[i];
+                record.b = ((Blob*)obj)->size;
+                break;
+            case IMG_VECTOR:
+                record.a = writer->aux_offs[i];
+                record.b = ((Vector*)obj)->size;
+                break;
+            case IMG_HASH:
+                record.a = writer->aux_offs[i];
+                record.b = S_hash_capacity(Hash_Get_Size((Hash*)obj));
+                record.c = Hash_Get_Size((Hash*)obj);
+                break;
+            case IMG_INTEGER:
+                record.a = (uint64_t)((Integer*)obj)->value;
+                break;
+            case IMG_FLOAT:
+                memcpy(&record.a, &((Float*)obj)->value, sizeof(double));
+                break;
+        }
+        OutStream_Write_Bytes(outstream, &record, sizeof(record));
+        S_write_padding(outstream, S_slot_size(kind) - sizeof(record));
+    }
+
+    // Element arrays.
+    for (size_t i = 0; i < num_objs; i++) {
+        Obj *obj = Vec_Fetch(writer->objs, i);
+        switch (S_kind(obj)) {
+            case IMG_VECTOR: {
+                Vector *vector = (Vector*)obj;
+                for (size_t j = 0; j < vector->size; j++) {
+                    uintptr_t ref
+                        = (uintptr_t)S_ref(writer, vector->elems[j]);
+                    OutStream_Write_Bytes(outstream, &ref, sizeof(ref));
+                }
+                break;
+            }
+            case IMG_HASH: {
+                Hash *hash = (Hash*)obj;
+                S_write_hash_entries(writer, hash,
+                                     S_hash_capacity(Hash_Get_Size(hash)),
+                                     outstream);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // String and Blob contents.
+    for (size_t i = 0; i < num_objs; i++) {
+        Obj *obj = Vec_Fetch(writer->objs, i);
+        switch (S_kind(obj)) {
+            case IMG_STRING:
+                OutStream_Write_Bytes(outstream, ((String*)obj)->ptr,
+                                      ((String*)obj)->size);
+                break;
+            case IMG_BLOB:
+                OutStream_Write_Bytes(outstream, ((Blob*)obj)->buf,
+                                      ((Blob*)obj)->size);
+                break;
+            default:
+                break;
+        }
+    }
+
+    if ((uint64_t)(OutStream_Tell(outstream) - start) != header.size) {
+        THROW(ERR, "Internal error: image size mismatch");
+    }
+}
+
+static void
+S_register(ImageWriter *writer, Obj *obj) {
+    if (obj == NULL || Obj_get_class(obj) == BOOLEAN) { return; }
+    if (PtrHash_Fetch(writer->seen, obj)) { return; }
+
+    int kind = S_kind(obj);
+    if (kind == 0) {
+        THROW(ERR, "Can't freeze object of class %o",
+              Obj_get_class_name(obj));
+    }
+
+    uintptr_t num = Vec_Get_Size(writer->objs) + 1;
+    if (kind == IMG_STRING) {
+        // Store Strings with equal contents only once.
+        Integer *string_num
+            = (Integer*)Hash_Fetch(writer->strings, (String*)obj);
+        if (string_num) {
+            PtrHash_Store(writer->seen, obj,
+                          (void*)(uintptr_t)string_num->value);
+            return;
+        }
+        Hash_Store(writer->strings, (String*)obj,
+                   (Obj*)Int_new((int64_t)num));
+    }
+
+    PtrHash_Store(writer->seen, obj, (void*)num);
+    Vec_Push(writer->objs, INCREF(obj));
+}
+
+static uint64_t
+S_ref(ImageWriter *writer, Obj *obj) {
+    if (obj == NULL) {
+        return IMG_REF_NULL;
+    }
+    if (Obj_get_class(obj) == BOOLEAN) {
+        return Bool_Get_Value((Boolean*)obj) ? IMG_REF_TRUE : IMG_REF_FALSE;
+    }
+    uintptr_t num = (uintptr_t)PtrHash_Fetch(writer->seen, obj);
+    return writer->slot_offs[num - 1];
+}
+
+static void
+S_write_hash_entries(ImageWriter *writer, Hash *hash, uint64_t capacity,
+                     OutStream *outstream) {
+    // Rebuild the table at the final capacity with linear probing, like
+    // Hash.c.  Key and value slots hold references until relocation.
+    HashEntry *entries
+        = (HashEntry*)CALLOCATE((size_t)capacity, sizeof(HashEntry));
+    HashIterator *iter = HashIter_new(hash);
+    while (HashIter_Next(iter)) {
+        String *key      = HashIter_Get_Key(iter);
+        size_t  hash_sum = Str_Hash_Sum(key);
+        size_t  tick     = hash_sum;
+        while (1) {
+            tick &= (size_t)capacity - 1;
+            if (!entries[tick].key) { break; }
+            tick++;
+        }
+        entries[tick].key = (String*)(uintptr_t)S_ref(writer, (Obj*)key);
+        entries[tick].value
+            = (Obj*)(uintptr_t)S_ref(writer, HashIter_Get_Value(iter));
+        entries[tick].hash_sum = hash_sum;
+    }
+    DECREF(iter);
+
+    OutStream_Write_Bytes(outstream, entries,
+                          (size_t)capacity * sizeof(HashEntry));
+    FREEMEM(entries);
+}
+
+static void
+S_write_padding(OutStream *outstream, size_t size) {
+    static const char zeroes[64] = { 0 };
+    while (size > 0) {
+        size_t chunk = size < sizeof(zeroes) ? size : sizeof(zeroes);
+        OutStream_Write_Bytes(outstream, zeroes, chunk);
+        size -= chunk;
+    }
+}
+
+static int
+S_kind(Obj *obj) {
+    Class *klass = Obj_get_class(obj);
+    if (klass == STRING)  { return IMG_STRING; }
+    if (klass == BLOB)    { return IMG_BLOB; }
+    if (klass == VECTOR)  { return IMG_VECTOR; }
+    if (klass == HASH)    { return IMG_HASH; }
+    if (klass == INTEGER) { return IMG_INTEGER; }
+    if (klass == FLOAT)   { return IMG_FLOAT; }
+    return 0;
+}
+
+static Class*
+S_kind_class(int kind) {
+    switch (kind) {
+        case IMG_STRING:  return STRING;
+        case IMG_BLOB:    return BLOB;
+        case IMG_VECTOR:  return VECTOR;
+        case IMG_HASH:    return HASH;
+        case IMG_INTEGER: return INTEGER;
+        case IMG_FLOAT:   return FLOAT;
+        default:          return NULL;
+    }
+}
+
+static size_t
+S_slot_size(int kind) {
+    size_t size = (size_t)SI_align8(
+                      Class_Get_Obj_Alloc_Size(S_kind_class(kind)));
+    return size > sizeof(ObjRecord) ? size : sizeof(ObjRecord);
+}
+
+// Frozen Hashes never grow, so use the smallest power of two which keeps
+// the load factor at or below that of Hash.c.
+static size_t
+S_hash_capacity(size_t size) {
+    size_t capacity = 1;
+    while (size >= capacity || size > (capacity / 3) * 2) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/**************************** Loading *************************************/
+
+FrozenImage*
+FrozenImage_new(Blob *image) {
+    FrozenImage *self = (FrozenImage*)Class_Make_Obj(FROZENIMAGE);
+    return FrozenImage_init(self, image);
+}
+
+FrozenImage*
+FrozenImage_init(FrozenImage *self, Blob *image) {
+    size_t size = Blob_Get_Size(image);
+    self->base     = (char*)MALLOCATE(size ? size : 1);
+    self->size     = size;
+    self->map_base = NULL;
+    self->map_size = 0;
+    self->root     = NULL;
+    self->rehashed = false;
+    memcpy(self->base, Blob_Get_Buf(image), size);
+
+    S_load(self);
+
+    return self;
+}
+
+FrozenImage*
+FrozenImage_new_mmap(String *path) {
+    FrozenImage *self = (FrozenImage*)Class_Make_Obj(FROZENIMAGE);
+    return FrozenImage_init_mmap(self, path);
+}
+
+FrozenImage*
+FrozenImage_init_mmap(FrozenImage *self, String *path) {
+    self->base     = NULL;
+    self->size     = 0;
+    self->map_base = NULL;
+    self->map_size = 0;
+    self->root     = NULL;
+    self->rehashed = false;
+
+    String *mess = S_map_private(path, &self->map_base, &self->map_size);
+    if (mess) {
+        DECREF(self);
+        Err_throw_mess(ERR, mess);
+    }
+    self->base = (char*)self->map_base;
+    self->size = self->map_size;
+
+    S_load(self);
+
+    return self;
+}
+
+static void
+S_load(FrozenImage *self) {
+    String *mess = S_relocate(self->base, self->size, &self->root,
+                              &self->rehashed);
+    if (mess) {
+        DECREF(self);
+        Err_throw_mess(ERR, mess);
+    }
+}
+
+Obj*
+FrozenImage_Get_Root_IMP(FrozenImage *self) {
+    return self->root;
+}
+
+bool
+FrozenImage_Was_Rehashed_IMP(FrozenImage *self) {
+    return self->rehashed;
+}
+
+size_t
+FrozenImage_Get_Size_IMP(FrozenImage *self) {
+    return self->size;
+}
+
+void
+FrozenImage_Destroy_IMP(FrozenImage *self) {
+    if (self->map_base) {
+        S_unmap(self->map_base, self->map_size);
+    }
+    else {
+        FREEMEM(self->base);
+    }
+    SUPER_DESTROY(self, FROZENIMAGE);
+}
+
+typedef struct {
+    char          *base;
+    const uint8_t *slot_bits;  /* one bit per 8 bytes of the objects */
+    uint64_t       objs_start;
+    uint64_t       objs_end;
+} Relocator;
+
+static CFISH_INLINE bool
+SI_valid_ref(Relocator *reloc, uint64_t ref) {
+    if (ref <= IMG_REF_FALSE) {
+        return true;
+    }
+    if (ref < reloc->objs_start || ref >= reloc->objs_end || (ref & 7)) {
+        return false;
+    }
+    uint64_t unit = (ref - reloc->objs_start) >> 3;
+    return (reloc->slot_bits[unit >> 3] >> (unit & 7)) & 1;
+}
+
+static CFISH_INLINE Obj*
+SI_resolve(Relocator *reloc, uint64_t ref) {
+    switch (ref) {
+        case IMG_REF_NULL:  return NULL;
+        case IMG_REF_TRUE:  return (Obj*)CFISH_TRUE;
+        case IMG_REF_FALSE: return (Obj*)CFISH_FALSE;
+        default:            return (Obj*)(reloc->base + ref);
+    }
+}
+
+static String*
+S_check_header(const ImageHeader *header, size_t size) {
+    if (size < sizeof(ImageHeader)
+        || memcmp(header->magic, IMG_MAGIC, sizeof(IMG_MAGIC)) != 0
+       ) {
+        return Str_newf("Not a frozen image");
+    }
+    if (header->version != IMG_VERSION) {
+        return Str_newf("Unsupported frozen image version %u32",
+                        header->version);
+    }
+    if (header->byte_order != 0x01020304
+        || header->ptr_size != sizeof(void*)
+       ) {
+        return Str_newf("Frozen image was written on an incompatible "
+                        "platform");
+    }
+    for (int kind = 1; kind <= IMG_MAX_KIND; kind++) {
+        Class *klass = S_kind_class(kind);
+        if (header->alloc_sizes[kind] != Class_Get_Obj_Alloc_Size(klass)) {
+            return Str_newf("Frozen image has incompatible layout of %o",
+                            Class_Get_Name(klass));
+        }
+    }
+    if (header->size != size
+        || header->objs_start < sizeof(ImageHeader)
+        || header->objs_start > header->objs_end
+        || header->objs_end > header->arrays_end
+        || header->arrays_end > header->bytes_end
+        || header->bytes_end != size
+        || (header->objs_start & 7)
+        || (header->objs_end & 7)
+       ) {
+        return Str_newf("Corrupt frozen image: bad section sizes");
+    }
+    return NULL;
+}
+
+static String*
+S_relocate(char *base, size_t size, Obj **root_ptr, bool *rehashed_ptr) {
+    ImageHeader header;
+    if (size >= sizeof(header)) {
+        memcpy(&header, base, sizeof(header));
+    }
+    else {
+        memset(&header, 0, sizeof(header));
+    }
+    String *mess = S_check_header(&header, size);
+    if (mess) { return mess; }
+
+    // First pass: validate the object records and mark where objects
+    // start.
+    uint64_t objs_size = header.objs_end - header.objs_start;
+    uint8_t *slot_bits
+        = (uint8_t*)CALLOCATE((size_t)(objs_size / 64 + 1), 1);
+    uint64_t offset = header.objs_start;
+    while (offset < header.objs_end) {
+        ObjRecord *record = (ObjRecord*)(base + offset);
+        if (header.objs_end - offset < sizeof(ObjRecord)
+            || record->kind == 0
+            || record->kind > IMG_MAX_KIND
+            || header.objs_end - offset < S_slot_size((int)record->kind)
+           ) {
+            FREEMEM(slot_bits);
+            return Str_newf("Corrupt frozen image: bad object at %u64",
+                            offset);
+        }
+        uint64_t unit = (offset - header.objs_start) >> 3;
+        slot_bits[unit >> 3] |= (uint8_t)(1 << (unit & 7));
+        offset += S_slot_size((int)record->kind);
+    }
+
+    Relocator reloc;
+    reloc.base       = base;
+    reloc.slot_bits  = slot_bits;
+    reloc.objs_start = header.objs_start;
+    reloc.objs_end   = header.objs_end;
+    if (!SI_valid_ref(&reloc, header.root)) {
+        FREEMEM(slot_bits);
+        return Str_newf("Corrupt frozen image: bad root");
+    }
+
+    // Second pass: turn records into objects.  Element arrays must follow
+    // each other in object order, so that every array is converted once.
+    uint64_t arrays_pos = header.objs_end;
+    offset = header.objs_start;
+    while (offset < header.objs_end) {
+        ObjRecord record;
+        memcpy(&record, base + offset, sizeof(record));
+        int   kind  = (int)record.kind;
+        Obj  *obj   = Class_Init_Obj(S_kind_class(kind), base + offset);
+        bool  valid = true;
+
+        switch (kind) {
+            case IMG_STRING:
+            case IMG_BLOB:
+                if (record.a < header.arrays_end
+                    || record.a > header.bytes_end
+                    || record.b > header.bytes_end - record.a
+                   ) {
+                    valid = false;
+                }
+                else if (kind == IMG_STRING) {
+                    String *string = (String*)obj;
+                    string->ptr    = base + record.a;
+                    string->size   = (size_t)record.b;
+                    string->origin = string;
+                }
+                else {
+                    Blob *blob = (Blob*)obj;
+                    blob->buf      = base + record.a;
+                    blob->size     = (size_t)record.b;
+                    blob->owns_buf = false;
+                }
+                break;
+            case IMG_VECTOR: {
+                uint64_t max = (header.arrays_end - arrays_pos)
+                               / sizeof(Obj*);
+                if (record.a != arrays_pos || record.b > max) {
+                    valid = false;
+                    break;
+                }
+                Vector *vector = (Vector*)obj;
+                vector->elems = (Obj**)(base + record.a);
+                vector->size  = (size_t)record.b;
+                vector->cap   = (size_t)record.b;
+                for (size_t i = 0; i < vector->size; i++) {
+                    uint64_t ref = (uintptr_t)vector->elems[i];
+                    if (!SI_valid_ref(&reloc, ref)) {
+                        valid = false;
+                        break;
+                    }
+                    vector->elems[i] = SI_resolve(&reloc, ref);
+                }
+                arrays_pos += record.b * sizeof(Obj*);
+                break;
+            }
+            case IMG_HASH: {
+                uint64_t max = (header.arrays_end - arrays_pos)
+                               / sizeof(HashEntry);
+                uint64_t capacity = record.b;
+                if (record.a != arrays_pos
+                    || capacity == 0
+                    || (capacity & (capacity - 1))
+                    || capacity > max
+                    || record.c >= capacity
+                   ) {
+                    valid = false;
+                    break;
+                }
+                Hash *hash = (Hash*)obj;
+                hash->entries   = base + record.a;
+                hash->capacity  = (size_t)capacity;
+                hash->size      = (size_t)record.c;
+                hash->threshold = (size_t)(capacity / 3) * 2;
+                HashEntry *entries = (HashEntry*)hash->entries;
+                size_t num_keys = 0;
+                for (size_t i = 0; i < hash->capacity; i++) {
+                    uint64_t key_ref   = (uintptr_t)entries[i].key;
+                    uint64_t value_ref = (uintptr_t)entries[i].value;
+                    if (key_ref == IMG_REF_NULL) {
+                        if (value_ref != IMG_REF_NULL) { valid = false; }
+                        continue;
+                    }
+                    if (key_ref <= IMG_REF_FALSE
+                        || !SI_valid_ref(&reloc, key_ref)
+                        || !SI_valid_ref(&reloc, value_ref)
+                       ) {
+                        valid = false;
+                        break;
+                    }
+                    entries[i].key   = (String*)SI_resolve(&reloc, key_ref);
+                    entries[i].value = SI_resolve(&reloc, value_ref);
+                    num_keys++;
+                }
+                if (num_keys != hash->size) { valid = false; }
+                arrays_pos += capacity * sizeof(HashEntry);
+                break;
+            }
+            case IMG_INTEGER:
+                ((Integer*)obj)->value = (int64_t)record.a;
+                break;
+            case IMG_FLOAT:
+                memcpy(&((Float*)obj)->value, &record.a, sizeof(double));
+                break;
+        }
+
+        // Objects in the image must never be freed or refcounted.
+        cfish_make_immortal(obj);
+        if (!valid) {
+            FREEMEM(slot_bits);
+            return Str_newf("Corrupt frozen image: bad object at %u64",
+                            offset);
+        }
+        offset += S_slot_size(kind);
+    }
+    FREEMEM(slot_bits);
+    if (arrays_pos != header.arrays_end) {
+        return Str_newf("Corrupt frozen image: bad array section");
+    }
+
+    // Third pass: check Hash keys and rebuild Hash tables if this process
+    // hashes Strings differently.
+    bool rehash = header.hash_probe
+                  != Hashing_hash_bytes(IMG_HASH_PROBE, IMG_HASH_PROBE_SIZE);
+    offset = header.objs_start;
+    while (offset < header.objs_end) {
+        Obj *obj = (Obj*)(base + offset);
+        if (Obj_get_class(obj) == HASH) {
+            Hash      *hash    = (Hash*)obj;
+            HashEntry *entries = (HashEntry*)hash->entries;
+            for (size_t i = 0; i < hash->capacity; i++) {
+                if (entries[i].key
+                    && Obj_get_class((Obj*)entries[i].key) != STRING
+                   ) {
+                    return Str_newf("Corrupt frozen image: bad key at %u64",
+                                    offset);
+                }
+            }
+            if (rehash) { S_rehash(hash); }
+        }
+        offset += S_slot_size(S_kind(obj));
+    }
+
+    *root_ptr     = SI_resolve(&reloc, header.root);
+    *rehashed_ptr = rehash;
+    return NULL;
+}
+
+static void
+S_rehash(Hash *hash) {
+    size_t     capacity = hash->capacity;
+    HashEntry *entries  = (HashEntry*)hash->entries;
+    HashEntry *old      = (HashEntry*)MALLOCATE(capacity * sizeof(HashEntry));
+    memcpy(old, entries, capacity * sizeof(HashEntry));
+    memset(entries, 0, capacity * sizeof(HashEntry));
+
+    for (size_t i = 0; i < capacity; i++) {
+        if (!old[i].key) { continue; }
+        size_t hash_sum = Str_Hash_Sum(old[i].key);
+        size_t tick     = hash_sum;
+        while (1) {
+            tick &= capacity - 1;
+            if (!entries[tick].key) { break; }
+            tick++;
+        }
+        entries[tick].key      = old[i].key;
+        entries[tick].value    = old[i].value;
+        entries[tick].hash_sum = hash_sum;
+    }
+
+    FREEMEM(old);
+}
+
+/**************************** Mapping *************************************/
+
+#if defined(CFISH_IMAGE_MMAP_POSIX)
+
+static String*
+S_map_private(String *path, void **base_ptr, size_t *size_ptr) {
+    char *path_c = Str_To_Utf8(path);
+    int   fd     = open(path_c, O_RDONLY);
+    FREEMEM(path_c);
+    if (fd < 0) {
+        return Str_newf("Can't open '%o': %s", path, strerror(errno));
+    }
+
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) != 0) {
+        int error = errno;
+        close(fd);
+        return Str_newf("Can't stat '%o': %s", path, strerror(error));
+    }
+    if ((uint64_t)stat_buf.st_size < sizeof(ImageHeader)
+        || (uint64_t)stat_buf.st_size > SIZE_MAX
+       ) {
+        close(fd);
+        return Str_newf("Not a frozen image: '%o'", path);
+    }
+
+    // Relocation writes to the mapping, so map it copy-on-write.
+    size_t size = (size_t)stat_buf.st_size;
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                      0);
+    if (base == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        return Str_newf("Can't mmap '%o': %s", path, strerror(error));
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    *base_ptr = base;
+    *size_ptr = size;
+    return NULL;
+}
+
+static void
+S_unmap(void *base, size_t size) {
+    munmap(base, size);
+}
+
+#elif defined(CFISH_IMAGE_MMAP_WINDOWS)
+
+static String*
+S_map_private(String *path, void **base_ptr, size_t *size_ptr) {
+    char   *path_c = Str_To_Utf8(path);
+    HANDLE  file   = CreateFileA(path_c, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    FREEMEM(path_c);
+    if (file == INVALID_HANDLE_VALUE) {
+        return Str_newf("Can't open '%o': error %u32", path,
+                        (uint32_t)GetLastError());
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        DWORD error = GetLastError();
+        CloseHandle(file);
+        return Str_newf("Can't get size of '%o': error %u32", path,
+                        (uint32_t)error);
+    }
+    if ((uint64_t)file_size.QuadPart < sizeof(ImageHeader)
+        || (uint64_t)file_size.QuadPart > SIZE_MAX
+       ) {
+        CloseHandle(file);
+        return Str_newf("Not a frozen image: '%o'", path);
+    }
+
+    // Relocation writes to the mapping, so map it copy-on-write.
+    size_t  size    = (size_t)file_size.QuadPart;
+    void   *base    = NULL;
+    HANDLE  mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0,
+                                         NULL);
+    if (mapping != NULL) {
+        base = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, (SIZE_T)size);
+        // The view keeps the mapping object alive.
+        CloseHandle(mapping);
+    }
+    if (base == NULL) {
+        DWORD error = GetLastError();
+        CloseHandle(file);
+        return Str_newf("Can't map '%o': error %u32", path, (uint32_t)error);
+    }
+
+    CloseHandle(file);
+    *base_ptr = base;
+    *size_ptr = size;
+    return NULL;
+}
+
+static void
+S_unmap(void *base, size_t size) {
+    UNUSED_VAR(size);
+    UnmapViewOfFile(base);
+}
+
+#else
+
+static String*
+S_map_private(String *path, void **base_ptr, size_t *size_ptr) {
+    UNUSED_VAR(base_ptr);
+    UNUSED_VAR(size_ptr);
+    return Str_newf("Can't map '%o': memory-mapped files not supported",
+                    path);
+}
+
+static void
+S_unmap(void *base, size_t size) {
+    UNUSED_VAR(base);
+    UNUSED_VAR(size);
+}
+
+#endif
+
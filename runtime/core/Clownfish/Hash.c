@@ -23,16 +23,22 @@
 #include "Clownfish/Class.h"
 
 #include "Clownfish/Hash.h"
+#include "Clownfish/CharBuf.h"
 #include "Clownfish/String.h"
 #include "Clownfish/Err.h"
 #include "Clownfish/Vector.h"
 #include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/Hashing.h"
 #include "Clownfish/Util/Memory.h"
 
 // TOMBSTONE is shared across threads, so it must never be incref'd or
 // decref'd.
 static String *TOMBSTONE;
 
+// Number of keys and values collected before decrementing their refcounts
+// in bulk.  Must be even.
+#define DECREF_BATCH_SIZE 64
+
 #define HashEntry cfish_HashEntry
 
 typedef struct HashEntry {
@@ -99,20 +105,28 @@ void
 Hash_Clear_IMP(Hash *self) {
     HashEntry *entry       = (HashEntry*)self->entries;
     HashEntry *const limit = entry + self->capacity;
+    Obj       *batch[DECREF_BATCH_SIZE];
+    size_t     num_batched = 0;
 
-    // Iterate through all entries.
+    // Iterate through all entries, collecting keys and values so that they
+    // can be decref'd in bulk.
     for (; entry < limit; entry++) {
         if (!entry->key) { continue; }
         if (entry->key == TOMBSTONE) {
             entry->key = NULL;
             continue;
         }
-        DECREF(entry->key);
-        DECREF(entry->value);
+        batch[num_batched++] = (Obj*)entry->key;
+        batch[num_batched++] = entry->value;
         entry->key       = NULL;
         entry->value     = NULL;
         entry->hash_sum  = 0;
+        if (num_batched == DECREF_BATCH_SIZE) {
+            cfish_decref_array(batch, num_batched);
+            num_batched = 0;
+        }
     }
+    cfish_decref_array(batch, num_batched);
 
     self->size = 0;
     // All tombstones were removed, reset threshold.
@@ -207,9 +221,10 @@ Hash_Delete_IMP(Hash *self, String *key) {
     if (entry) {
         Obj *value = entry->value;
         DECREF(entry->key);
+        // The tombstone keeps the hash sum of the deleted key, so it is
+        // identified by its key alone.
         entry->key       = TOMBSTONE;
         entry->value     = NULL;
-        entry->hash_sum  = 0;
         self->size--;
         self->threshold--; // limit number of tombstones
         return value;
@@ -284,6 +299,54 @@ Hash_Equals_IMP(Hash *self, Obj *other) {
     return true;
 }
 
+void
+Hash_Digest_IMP(Hash *self, uint64_t *digest) {
+    // Add up the digests of the entries.  Unlike mixing, addition doesn't
+    // depend on the order of the entries.
+    uint64_t sum[2] = { 0, 0 };
+
+    HashEntry *entry       = (HashEntry*)self->entries;
+    HashEntry *const limit = entry + self->capacity;
+
+    for (; entry < limit; entry++) {
+        if (entry->key && entry->key != TOMBSTONE) {
+            uint64_t entry_digest[2];
+            uint64_t part[2];
+            Hashing_digest_init(entry_digest, HASHING_DIGEST_ENTRY);
+            Str_Digest(entry->key, part);
+            Hashing_digest_mix_digest(entry_digest, part);
+            if (entry->value) {
+                Obj_Digest(entry->value, part);
+            }
+            else {
+                Hashing_digest_init(part, HASHING_DIGEST_NULL);
+            }
+            Hashing_digest_mix_digest(entry_digest, part);
+            sum[0] += entry_digest[0];
+            sum[1] += entry_digest[1];
+        }
+    }
+
+    Hashing_digest_init(digest, HASHING_DIGEST_HASH);
+    Hashing_digest_mix(digest, (uint64_t)self->size);
+    Hashing_digest_mix_digest(digest, sum);
+}
+
+String*
+Hash_To_String_IMP(Hash *self) {
+    CharBuf *buf = CB_new(self->size * 16 + 2);
+    Hash_Cat_To_IMP(self, buf);
+    String *string = CB_Yield_String(buf);
+    DECREF(buf);
+    return string;
+}
+
+void
+Hash_Cat_To_IMP(Hash *self, CharBuf *buf) {
+    // Shares the cycle detection with Vectors.
+    Vec_cat_container_to((Obj*)self, buf);
+}
+
 size_t
 Hash_Get_Capacity_IMP(Hash *self) {
     return self->capacity;
@@ -0,0 +1,629 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define C_CFISH_INSTREAM
+#define CFISH_USE_SHORT_NAMES
+
+#include "charmony.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(CHY_HAS_UNISTD_H)
+  #include <fcntl.h>
+  #include <sys/stat.h>
+  #include <sys/types.h>
+  #include <unistd.h>
+#elif defined(CHY_HAS_WINDOWS_H)
+  #include <fcntl.h>
+  #include <io.h>
+#endif
+
+#include "Clownfish/InStream.h"
+#include "Clownfish/Blob.h"
+#include "Clownfish/ByteBuf.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Util/Memory.h"
+
+#define INSTREAM_BUF_SIZE 65536
+
+// Make sure that at least `wanted` bytes are buffered, if the stream has
+// that many left.  Return the number of buffered bytes.
+static size_t
+S_refill(InStream *self, size_t wanted);
+
+// Throw an error if fewer than `size` bytes are left.
+static CFISH_INLINE void
+SI_require(InStream *self, size_t size);
+
+static void
+S_eof_error(InStream *self, size_t size);
+
+// Slow paths for variable-width integers near the end of the buffer.
+static uint32_t
+S_read_c32_slow(InStream *self);
+
+static uint64_t
+S_read_c64_slow(InStream *self);
+
+// Decode the bytes of a C64 after the first four, which have been
+// accumulated in `result`.
+static CFISH_INLINE uint64_t
+SI_decode_c64_tail(InStream *self, const uint8_t *p, uint64_t result);
+
+// Platform-specific file access.
+static int
+S_open_fd(const char *path);
+
+static int64_t
+S_read_fd(int fd, char *buf, size_t len);
+
+static int64_t
+S_seek_fd(int fd, int64_t pos);
+
+static int64_t
+S_fd_length(int fd);
+
+static void
+S_close_fd(int fd);
+
+InStream*
+InStream_open(String *path) {
+    InStream *self = (InStream*)Class_Make_Obj(INSTREAM);
+    return InStream_do_open(self, path);
+}
+
+InStream*
+InStream_do_open(InStream *self, String *path) {
+    char *path_c = Str_To_Utf8(path);
+    int   fd     = S_open_fd(path_c);
+    FREEMEM(path_c);
+    if (fd < 0) {
+        THROW(ERR, "Can't open '%o': %s", path, strerror(errno));
+    }
+    return InStream_init_fd(self, fd, true);
+}
+
+InStream*
+InStream_new_fd(int fd, bool close_fd) {
+    InStream *self = (InStream*)Class_Make_Obj(INSTREAM);
+    return InStream_init_fd(self, fd, close_fd);
+}
+
+InStream*
+InStream_init_fd(InStream *self, int fd, bool close_fd) {
+    int64_t pos = S_seek_fd(fd, -1);
+
+    self->owned_buf = (char*)MALLOCATE(INSTREAM_BUF_SIZE);
+    self->buf_cap   = INSTREAM_BUF_SIZE;
+    self->buf       = self->owned_buf;
+    self->ptr       = self->owned_buf;
+    self->limit     = self->owned_buf;
+    // Pipes and sockets can't report their position.
+    self->buf_pos   = pos < 0 ? 0 : pos;
+    self->length    = S_fd_length(fd);
+    self->blob      = NULL;
+    self->fd        = fd;
+    self->owns_fd   = close_fd;
+
+    return self;
+}
+
+InStream*
+InStream_new_blob(Blob *blob) {
+    InStream *self = (InStream*)Class_Make_Obj(INSTREAM);
+    return InStream_init_blob(self, blob);
+}
+
+InStream*
+InStream_init_blob(InStream *self, Blob *blob) {
+    size_t size = Blob_Get_Size(blob);
+
+    self->owned_buf = NULL;
+    self->buf_cap   = size;
+    self->buf       = Blob_Get_Buf(blob);
+    self->ptr       = self->buf;
+    self->limit     = self->buf + size;
+    self->buf_pos   = 0;
+    self->length    = (int64_t)size;
+    self->blob      = (Blob*)INCREF(blob);
+    self->fd        = -1;
+    self->owns_fd   = false;
+
+    return self;
+}
+
+InStream*
+InStream_new_bytebuf(ByteBuf *bytebuf) {
+    Blob     *view = Blob_new_view(bytebuf);
+    InStream *self = InStream_new_blob(view);
+    DECREF(view);
+    return self;
+}
+
+void
+InStream_Close_IMP(InStream *self) {
+    if (self->owns_fd && self->fd >= 0) {
+        S_close_fd(self->fd);
+    }
+    self->fd      = -1;
+    self->owns_fd = false;
+    self->buf_pos = InStream_Tell_IMP(self);
+    FREEMEM(self->owned_buf);
+    self->owned_buf = NULL;
+    DECREF(self->blob);
+    self->blob  = NULL;
+    self->buf   = "";
+    self->ptr   = self->buf;
+    self->limit = self->buf;
+}
+
+void
+InStream_Destroy_IMP(InStream *self) {
+    InStream_Close_IMP(self);
+    SUPER_DESTROY(self, INSTREAM);
+}
+
+/***************************************************************************/
+
+static size_t
+S_refill(InStream *self, size_t wanted) {
+    size_t avail = (size_t)(self->limit - self->ptr);
+    if (avail >= wanted || self->fd < 0) { return avail; }
+
+    // Move the unread bytes to the start of the buffer.
+    char *buf = self->owned_buf;
+    memmove(buf, self->ptr, avail);
+    self->buf_pos += self->ptr - self->buf;
+    self->buf      = buf;
+    self->ptr      = buf;
+
+    // Don't wait for more than `wanted` bytes, which matters for pipes.
+    while (avail < wanted) {
+        int64_t got = S_read_fd(self->fd, buf + avail, self->buf_cap - avail);
+        if (got < 0) {
+            THROW(ERR, "Error reading InStream: %s", strerror(errno));
+        }
+        if (got == 0) { break; }
+        avail += (size_t)got;
+    }
+
+    self->limit = buf + avail;
+    return avail;
+}
+
+static CFISH_INLINE void
+SI_require(InStream *self, size_t size) {
+    if ((size_t)(self->limit - self->ptr) < size
+        && S_refill(self, size) < size
+       ) {
+        S_eof_error(self, size);
+    }
+}
+
+static void
+S_eof_error(InStream *self, size_t size) {
+    THROW(ERR, "Read of %u64 bytes past end of InStream at position %i64",
+          (uint64_t)size, InStream_Tell_IMP(self));
+}
+
+/***************************************************************************/
+
+uint8_t
+InStream_Read_U8_IMP(InStream *self) {
+    SI_require(self, 1);
+    return (uint8_t)*self->ptr++;
+}
+
+uint16_t
+InStream_Read_U16_IMP(InStream *self) {
+    SI_require(self, 2);
+    const uint8_t *p = (const uint8_t*)self->ptr;
+    self->ptr += 2;
+    return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+uint16_t
+InStream_Read_U16_LE_IMP(InStream *self) {
+    SI_require(self, 2);
+    const uint8_t *p = (const uint8_t*)self->ptr;
+    self->ptr += 2;
+    return (uint16_t)(((uint16_t)p[1] << 8) | p[0]);
+}
+
+uint32_t
+InStream_Read_U32_IMP(InStream *self) {
+    SI_require(self, 4);
+    const uint8_t *p = (const uint8_t*)self->ptr;
+    self->ptr += 4;
+    return ((uint32_t)p[0] << 24)
+           | ((uint32_t)p[1] << 16)
+           | ((uint32_t)p[2] << 8)
+           | (uint32_t)p[3];
+}
+
+uint32_t
+InStream_Read_U32_LE_IMP(InStream *self) {
+    SI_require(self, 4);
+    const uint8_t *p = (const uint8_t*)self->ptr;
+    self->ptr += 4;
+    return ((uint32_t)p[3] << 24)
+           | ((uint32_t)p[2] << 16)
+           | ((uint32_t)p[1] << 8)
+           | (uint32_t)p[0];
+}
+
+uint64_t
+InStream_Read_U64_IMP(InStream *self) {
+    SI_require(self, 8);
+    const uint8_t *p = (const uint8_t*)self->ptr;
+    self->ptr += 8;
+    uint64_t hi = ((uint32_t)p[0] << 24)
+                  | ((uint32_t)p[1] << 16)
+                  | ((uint32_t)p[2] << 8)
+                  | (uint32_t)p[3];
+    uint64_t lo = ((uint32_t)p[4] << 24)
+                  | ((uint32_t)p[5] << 16)
+                  | ((uint32_t)p[6] << 8)
+                  | (uint32_t)p[7];
+    return (hi << 32) | lo;
+}
+
+uint64_t
+InStream_Read_U64_LE_IMP(InStream *self) {
+    SI_require(self, 8);
+    const uint8_t *p = (const uint8_t*)self->ptr;
+    self->ptr += 8;
+    uint64_t lo = ((uint32_t)p[3] << 24)
+                  | ((uint32_t)p[2] << 16)
+                  | ((uint32_t)p[1] << 8)
+                  | (uint32_t)p[0];
+    uint64_t hi = ((uint32_t)p[7] << 24)
+                  | ((uint32_t)p[6] << 16)
+                  | ((uint32_t)p[5] << 8)
+                  | (uint32_t)p[4];
+    return (hi << 32) | lo;
+}
+
+int32_t
+InStream_Read_I32_IMP(InStream *self) {
+    return (int32_t)InStream_Read_U32_IMP(self);
+}
+
+int64_t
+InStream_Read_I64_IMP(InStream *self) {
+    return (int64_t)InStream_Read_U64_IMP(self);
+}
+
+float
+InStream_Read_F32_IMP(InStream *self) {
+    union { uint32_t u; float f; } bits;
+    bits.u = InStream_Read_U32_IMP(self);
+    return bits.f;
+}
+
+double
+InStream_Read_F64_IMP(InStream *self) {
+    union { uint64_t u; double d; } bits;
+    bits.u = InStream_Read_U64_IMP(self);
+    return bits.d;
+}
+
+uint32_t
+InStream_Read_C32_IMP(InStream *self) {
+    if (self->limit - self->ptr < 5) {
+        return S_read_c32_slow(self);
+    }
+
+    // Unrolled decode of up to five bytes.
+    const uint8_t *p = (const uint8_t*)self->ptr;
+    uint32_t byte   = *p++;
+    uint32_t result = byte & 0x7F;
+    if (byte >= 0x80) {
+        byte = *p++;
+        result |= (byte & 0x7F) << 7;
+        if (byte >= 0x80) {
+            byte = *p++;
+            result |= (byte & 0x7F) << 14;
+            if (byte >= 0x80) {
+                byte = *p++;
+                result |= (byte & 0x7F) << 21;
+                if (byte >= 0x80) {
+                    byte = *p++;
+                    if (byte > 0x0F) {
+                        THROW(ERR, "Invalid C32 at position %i64",
+                              InStream_Tell_IMP(self));
+                    }
+                    result |= byte << 28;
+                }
+            }
+        }
+    }
+
+    self->ptr = (const char*)p;
+    return result;
+}
+
+static uint32_t
+S_read_c32_slow(InStream *self) {
+    uint32_t result = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint32_t byte = InStream_Read_U8_IMP(self);
+        if (shift == 28 && byte > 0x0F) {
+            THROW(ERR, "Invalid C32 at position %i64",
+                  InStream_Tell_IMP(self));
+        }
+        result |= (byte & 0x7F) << shift;
+        if (byte < 0x80) { return result; }
+    }
+}
+
+uint64_t
+InStream_Read_C64_IMP(InStream *self) {
+    if (self->limit - self->ptr < 10) {
+        return S_read_c64_slow(self);
+    }
+
+    // Decode the low 28 bits with 32-bit arithmetic, which covers the
+    // common case of small values.
+    const uint8_t *p = (const uint8_t*)self->ptr;
+    uint32_t byte = *p++;
+    uint32_t low  = byte & 0x7F;
+    if (byte >= 0x80) {
+        byte = *p++;
+        low |= (byte & 0x7F) << 7;
+        if (byte >= 0x80) {
+            byte = *p++;
+            low |= (byte & 0x7F) << 14;
+            if (byte >= 0x80) {
+                byte = *p++;
+                low |= (byte & 0x7F) << 21;
+                if (byte >= 0x80) {
+                    return SI_decode_c64_tail(self, p, low);
+                }
+            }
+        }
+    }
+
+    self->ptr = (const char*)p;
+    return low;
+}
+
+static CFISH_INLINE uint64_t
+SI_decode_c64_tail(InStream *self, const uint8_t *p, uint64_t result) {
+    for (int shift = 28; shift < 63; shift += 7) {
+        uint64_t byte = *p++;
+        result |= (byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            self->ptr = (const char*)p;
+            return result;
+        }
+    }
+
+    uint64_t byte = *p++;
+    if (byte > 0x01) {
+        THROW(ERR, "Invalid C64 at position %i64", InStream_Tell_IMP(self));
+    }
+    self->ptr = (const char*)p;
+    return result | (byte << 63);
+}
+
+static uint64_t
+S_read_c64_slow(InStream *self) {
+    uint64_t result = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint64_t byte = InStream_Read_U8_IMP(self);
+        if (shift == 63 && byte > 0x01) {
+            THROW(ERR, "Invalid C64 at position %i64",
+                  InStream_Tell_IMP(self));
+        }
+        result |= (byte & 0x7F) << shift;
+        if (byte < 0x80) { return result; }
+    }
+}
+
+void
+InStream_Read_Bytes_IMP(InStream *self, char *buf, size_t len) {
+    size_t avail = (size_t)(self->limit - self->ptr);
+    if (len <= avail) {
+        memcpy(buf, self->ptr, len);
+        self->ptr += len;
+        return;
+    }
+
+    // Drain the buffer.
+    memcpy(buf, self->ptr, avail);
+    self->ptr += avail;
+    buf       += avail;
+    len       -= avail;
+
+    if (len < self->buf_cap) {
+        if (S_refill(self, len) < len) { S_eof_error(self, len); }
+        memcpy(buf, self->ptr, len);
+        self->ptr += len;
+        return;
+    }
+
+    // Read large amounts directly into the destination.
+    if (self->fd < 0) { S_eof_error(self, len); }
+    self->buf_pos += self->ptr - self->buf;
+    self->buf      = self->owned_buf;
+    self->ptr      = self->buf;
+    self->limit    = self->buf;
+    while (len > 0) {
+        int64_t got = S_read_fd(self->fd, buf, len);
+        if (got < 0) {
+            THROW(ERR, "Error reading InStream: %s", strerror(errno));
+        }
+        if (got == 0) { S_eof_error(self, len); }
+        self->buf_pos += got;
+        buf           += got;
+        len           -= (size_t)got;
+    }
+}
+
+Blob*
+InStream_Read_Blob_IMP(InStream *self, size_t len) {
+    if (self->blob) {
+        SI_require(self, len);
+        size_t offset = (size_t)(self->ptr - self->buf);
+        self->ptr += len;
+        return Blob_Slice(self->blob, offset, len);
+    }
+
+    if (self->length >= 0) {
+        int64_t remaining = self->length - InStream_Tell_IMP(self);
+        if (remaining < 0 || (uint64_t)len > (uint64_t)remaining) {
+            S_eof_error(self, len);
+        }
+        char *bytes = (char*)MALLOCATE(len);
+        InStream_Read_Bytes_IMP(self, bytes, len);
+        return Blob_new_steal(bytes, len);
+    }
+
+    // The length of pipes is unknown, so grow the buffer as the bytes
+    // arrive rather than trusting `len`.  Each chunk is buffered before it's
+    // copied, so `bytes` can be freed before an EOF error is thrown.
+    size_t  cap   = len < INSTREAM_BUF_SIZE ? len : INSTREAM_BUF_SIZE;
+    char   *bytes = (char*)MALLOCATE(cap);
+    size_t  done  = 0;
+    while (done < len) {
+        size_t wanted = len - done;
+        if (wanted > self->buf_cap) { wanted = self->buf_cap; }
+        if (S_refill(self, wanted) < wanted) {
+            FREEMEM(bytes);
+            S_eof_error(self, wanted);
+        }
+        if (done + wanted > cap) {
+            cap   = cap < len / 2 ? cap * 2 : len;
+            bytes = (char*)REALLOCATE(bytes, cap);
+        }
+        memcpy(bytes + done, self->ptr, wanted);
+        self->ptr += wanted;
+        done      += wanted;
+    }
+    return Blob_new_steal(bytes, len);
+}
+
+int64_t
+InStream_Tell_IMP(InStream *self) {
+    return self->buf_pos + (self->ptr - self->buf);
+}
+
+void
+InStream_Seek_IMP(InStream *self, int64_t target) {
+    if (target < 0 || (self->length >= 0 && target > self->length)) {
+        THROW(ERR, "Can't seek to %i64, stream length %i64", target,
+              self->length);
+    }
+
+    // Stay within the buffer if possible.
+    if (target >= self->buf_pos
+        && target <= self->buf_pos + (self->limit - self->buf)
+       ) {
+        self->ptr = self->buf + (target - self->buf_pos);
+        return;
+    }
+
+    if (self->fd < 0 || S_seek_fd(self->fd, target) < 0) {
+        THROW(ERR, "Can't seek to %i64", target);
+    }
+    self->buf_pos = target;
+    self->buf     = self->owned_buf;
+    self->ptr     = self->buf;
+    self->limit   = self->buf;
+}
+
+int64_t
+InStream_Length_IMP(InStream *self) {
+    return self->length;
+}
+
+/***************************************************************************/
+
+#if defined(CHY_HAS_UNISTD_H)
+
+static int
+S_open_fd(const char *path) {
+    return open(path, O_RDONLY);
+}
+
+static int64_t
+S_read_fd(int fd, char *buf, size_t len) {
+    ssize_t got;
+    do {
+        got = read(fd, buf, len);
+    } while (got < 0 && errno == EINTR);
+    return (int64_t)got;
+}
+
+static int64_t
+S_seek_fd(int fd, int64_t pos) {
+    off_t result = pos < 0
+                   ? lseek(fd, 0, SEEK_CUR)
+                   : lseek(fd, (off_t)pos, SEEK_SET);
+    return (int64_t)result;
+}
+
+static int64_t
+S_fd_length(int fd) {
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) != 0 || !S_ISREG(stat_buf.st_mode)) {
+        return -1;
+    }
+    return (int64_t)stat_buf.st_size;
+}
+
+static void
+S_close_fd(int fd) {
+    close(fd);
+}
+
+#elif defined(CHY_HAS_WINDOWS_H)
+
+static int
+S_open_fd(const char *path) {
+    return _open(path, _O_RDONLY | _O_BINARY);
+}
+
+static int64_t
+S_read_fd(int fd, char *buf, size_t len) {
+    unsigned count = len > 0x40000000 ? 0x40000000 : (unsigned)len;
+    return (int64_t)_read(fd, buf, count);
+}
+
+static int64_t
+S_seek_fd(int fd, int64_t pos) {
+    return pos < 0 ? _lseeki64(fd, 0, SEEK_CUR) : _lseeki64(fd, pos, SEEK_SET);
+}
+
+static int64_t
+S_fd_length(int fd) {
+    return _filelengthi64(fd);
+}
+
+static void
+S_close_fd(int fd) {
+    _close(fd);
+}
+
+#else
+  #error "Need either unistd.h or windows.h"
+#endif
+
@@ -0,0 +1,750 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define CFISH_USE_SHORT_NAMES
+
+#include "charmony.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Clownfish/Json.h"
+#include "Clownfish/Boolean.h"
+#include "Clownfish/CharBuf.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Memory.h"
+
+// SSE2 is part of the x86-64 baseline, so it's always available on 64-bit
+// x86.  Other platforms scan eight bytes at a time in a general purpose
+// register.
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define CFISH_JSON_SSE2
+  #include <emmintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+#endif
+
+#define JSON_MAX_DEPTH 512
+
+typedef struct {
+    const char *ptr;
+    const char *start;
+    const char *limit;
+    String     *source;
+    Vector     *pending;  /* objects to release if an error is thrown */
+    char       *scratch;
+    size_t      scratch_cap;
+    int         depth;
+    Obj        *result;
+} JsonParser;
+
+typedef struct {
+    Obj     *obj;
+    CharBuf *buf;
+} JsonEncoder;
+
+static Obj*
+S_decode(String *json, bool owns_json);
+
+static void
+S_do_decode(void *context);
+
+static Obj*
+S_parse_value(JsonParser *parser);
+
+static Obj*
+S_parse_array(JsonParser *parser);
+
+static Obj*
+S_parse_object(JsonParser *parser);
+
+static String*
+S_parse_string(JsonParser *parser);
+
+static String*
+S_parse_escaped_string(JsonParser *parser, const char *start,
+                       const char *special);
+
+static Obj*
+S_parse_number(JsonParser *parser);
+
+static void
+S_parse_literal(JsonParser *parser, const char *literal, size_t size);
+
+static void
+S_syntax_error(JsonParser *parser, const char *problem);
+
+static void
+S_do_encode(void *context);
+
+static void
+S_encode(Obj *obj, CharBuf *buf, int depth);
+
+static void
+S_encode_string(const char *ptr, size_t size, CharBuf *buf);
+
+static void
+S_encode_float(double value, CharBuf *buf);
+
+// Return a pointer to the first quote, backslash or control character
+// between `ptr` and `limit`, or `limit` if there is none.
+static const char*
+S_scan_string(const char *ptr, const char *limit);
+
+static CFISH_INLINE const char*
+SI_skip_whitespace(const char *ptr, const char *limit) {
+    while (ptr < limit
+           && (*ptr == ' ' || *ptr == '\n' || *ptr == '\r' || *ptr == '\t')
+          ) {
+        ptr++;
+    }
+    return ptr;
+}
+
+static CFISH_INLINE bool
+SI_is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/***************************************************************************/
+
+Obj*
+Json_decode(String *json) {
+    return S_decode(json, false);
+}
+
+Obj*
+Json_decode_utf8(const char *utf8, size_t size) {
+    // Copy and validate once, so that decoded strings can share the copy.
+    String *json = Str_new_from_utf8(utf8, size);
+    return S_decode(json, true);
+}
+
+static Obj*
+S_decode(String *json, bool owns_json) {
+    JsonParser parser;
+    parser.start       = Str_Get_Ptr8(json);
+    parser.ptr         = parser.start;
+    parser.limit       = parser.start + Str_Get_Size(json);
+    parser.source      = json;
+    parser.pending     = Vec_new(0);
+    parser.scratch     = NULL;
+    parser.scratch_cap = 0;
+    parser.depth       = 0;
+    parser.result      = NULL;
+
+    Err *error = Err_trap(S_do_decode, &parser);
+    DECREF(parser.pending);
+    FREEMEM(parser.scratch);
+    if (owns_json) {
+        DECREF(json);
+    }
+    if (error) {
+        RETHROW(error);
+    }
+
+    return parser.result;
+}
+
+static void
+S_do_decode(void *context) {
+    JsonParser *parser = (JsonParser*)context;
+
+    parser->ptr = SI_skip_whitespace(parser->ptr, parser->limit);
+    Obj *result = S_parse_value(parser);
+    Vec_Push(parser->pending, result);
+    parser->ptr = SI_skip_whitespace(parser->ptr, parser->limit);
+    if (parser->ptr != parser->limit) {
+        S_syntax_error(parser, "trailing characters");
+    }
+
+    parser->result = Vec_Pop(parser->pending);
+}
+
+static Obj*
+S_parse_value(JsonParser *parser) {
+    if (parser->ptr >= parser->limit) {
+        S_syntax_error(parser, "unexpected end of input");
+    }
+
+    switch (*parser->ptr) {
+        case '{':
+            return S_parse_object(parser);
+        case '[':
+            return S_parse_array(parser);
+        case '"':
+            parser->ptr++;
+            return (Obj*)S_parse_string(parser);
+        case 't':
+            S_parse_literal(parser, "true", 4);
+            return (Obj*)INCREF(CFISH_TRUE);
+        case 'f':
+            S_parse_literal(parser, "false", 5);
+            return (Obj*)INCREF(CFISH_FALSE);
+        case 'n':
+            S_parse_literal(parser, "null", 4);
+            return NULL;
+        default:
+            if (*parser->ptr == '-' || SI_is_digit(*parser->ptr)) {
+                return S_parse_number(parser);
+            }
+            S_syntax_error(parser, "unexpected character");
+            return NULL; // unreachable
+    }
+}
+
+static Obj*
+S_parse_array(JsonParser *parser) {
+    if (++parser->depth > JSON_MAX_DEPTH) {
+        S_syntax_error(parser, "nesting too deep");
+    }
+    parser->ptr = SI_skip_whitespace(parser->ptr + 1, parser->limit);
+
+    Vector *vector = Vec_new(0);
+    Vec_Push(parser->pending, (Obj*)vector);
+
+    if (parser->ptr < parser->limit && *parser->ptr == ']') {
+        parser->ptr++;
+    }
+    else {
+        while (1) {
+            Vec_Push(vector, S_parse_value(parser));
+            parser->ptr = SI_skip_whitespace(parser->ptr, parser->limit);
+            if (parser->ptr >= parser->limit) {
+                S_syntax_error(parser, "unterminated array");
+            }
+            char c = *parser->ptr++;
+            if (c == ']') { break; }
+            if (c != ',') {
+                parser->ptr--;
+                S_syntax_error(parser, "expected ',' or ']'");
+            }
+            parser->ptr = SI_skip_whitespace(parser->ptr, parser->limit);
+        }
+    }
+
+    parser->depth--;
+    return Vec_Pop(parser->pending);
+}
+
+static Obj*
+S_parse_object(JsonParser *parser) {
+    if (++parser->depth > JSON_MAX_DEPTH) {
+        S_syntax_error(parser, "nesting too deep");
+    }
+    parser->ptr = SI_skip_whitespace(parser->ptr + 1, parser->limit);
+
+    Hash *hash = Hash_new(0);
+    Vec_Push(parser->pending, (Obj*)hash);
+
+    if (parser->ptr < parser->limit && *parser->ptr == '}') {
+        parser->ptr++;
+    }
+    else {
+        while (1) {
+            if (parser->ptr >= parser->limit || *parser->ptr != '"') {
+                S_syntax_error(parser, "expected string key");
+            }
+            parser->ptr++;
+            String *key = S_parse_string(parser);
+            Vec_Push(parser->pending, (Obj*)key);
+
+            parser->ptr = SI_skip_whitespace(parser->ptr, parser->limit);
+            if (parser->ptr >= parser->limit || *parser->ptr != ':') {
+                S_syntax_error(parser, "expected ':'");
+            }
+            parser->ptr = SI_skip_whitespace(parser->ptr + 1, parser->limit);
+            Hash_Store(hash, key, S_parse_value(parser));
+            DECREF(Vec_Pop(parser->pending));
+
+            parser->ptr = SI_skip_whitespace(parser->ptr, parser->limit);
+            if (parser->ptr >= parser->limit) {
+                S_syntax_error(parser, "unterminated object");
+            }
+            char c = *parser->ptr++;
+            if (c == '}') { break; }
+            if (c != ',') {
+                parser->ptr--;
+                S_syntax_error(parser, "expected ',' or '}'");
+            }
+            parser->ptr = SI_skip_whitespace(parser->ptr, parser->limit);
+        }
+    }
+
+    parser->depth--;
+    return Vec_Pop(parser->pending);
+}
+
+// Parse a string after the opening quote.
+static String*
+S_parse_string(JsonParser *parser) {
+    const char *start   = parser->ptr;
+    const char *special = S_scan_string(start, parser->limit);
+
+    if (special < parser->limit && *special == '"') {
+        // No escapes, so share the source buffer.
+        parser->ptr = special + 1;
+        return Str_new_from_byte_range(parser->source,
+                                       (size_t)(start - parser->start),
+                                       (size_t)(special - start));
+    }
+
+    return S_parse_escaped_string(parser, start, special);
+}
+
+static uint32_t
+S_parse_hex4(JsonParser *parser, const char *ptr) {
+    if (parser->limit - ptr < 4) {
+        parser->ptr = ptr;
+        S_syntax_error(parser, "truncated \\u escape");
+    }
+
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = ptr[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9')      { value |= (uint32_t)(c - '0'); }
+        else if (c >= 'a' && c <= 'f') { value |= (uint32_t)(c - 'a' + 10); }
+        else if (c >= 'A' && c <= 'F') { value |= (uint32_t)(c - 'A' + 10); }
+        else {
+            parser->ptr = ptr + i;
+            S_syntax_error(parser, "invalid \\u escape");
+        }
+    }
+
+    return value;
+}
+
+static String*
+S_parse_escaped_string(JsonParser *parser, const char *start,
+                       const char *special) {
+    const char *limit = parser->limit;
+
+    // Unescaped output is never longer than the input.
+    size_t max_size = (size_t)(limit - start);
+    if (max_size > parser->scratch_cap) {
+        parser->scratch     = (char*)REALLOCATE(parser->scratch, max_size);
+        parser->scratch_cap = max_size;
+    }
+    char *dest = parser->scratch;
+
+    const char *ptr = start;
+    while (1) {
+        size_t run = (size_t)(special - ptr);
+        memcpy(dest, ptr, run);
+        dest += run;
+        ptr   = special;
+
+        if (ptr >= limit) {
+            parser->ptr = ptr;
+            S_syntax_error(parser, "unterminated string");
+        }
+        if (*ptr == '"') {
+            break;
+        }
+        if (*ptr != '\\') {
+            parser->ptr = ptr;
+            S_syntax_error(parser, "control character in string");
+        }
+        if (limit - ptr < 2) {
+            parser->ptr = ptr;
+            S_syntax_error(parser, "unterminated string");
+        }
+
+        switch (ptr[1]) {
+            case '"':  *dest++ = '"';  break;
+            case '\\': *dest++ = '\\'; break;
+            case '/':  *dest++ = '/';  break;
+            case 'b':  *dest++ = '\b'; break;
+            case 'f':  *dest++ = '\f'; break;
+            case 'n':  *dest++ = '\n'; break;
+            case 'r':  *dest++ = '\r'; break;
+            case 't':  *dest++ = '\t'; break;
+            case 'u': {
+                uint32_t code_point = S_parse_hex4(parser, ptr + 2);
+                if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                    parser->ptr = ptr;
+                    S_syntax_error(parser, "unpaired surrogate");
+                }
+                if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                    // Surrogate pair.
+                    if (limit - ptr < 12 || ptr[6] != '\\' || ptr[7] != 'u') {
+                        parser->ptr = ptr;
+                        S_syntax_error(parser, "unpaired surrogate");
+                    }
+                    uint32_t low = S_parse_hex4(parser, ptr + 8);
+                    if (low < 0xDC00 || low > 0xDFFF) {
+                        parser->ptr = ptr;
+                        S_syntax_error(parser, "unpaired surrogate");
+                    }
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10)
+                                 + (low - 0xDC00);
+                    ptr += 6;
+                }
+                dest += Str_encode_utf8_char((int32_t)code_point, dest);
+                ptr += 4;
+                break;
+            }
+            default:
+                parser->ptr = ptr;
+                S_syntax_error(parser, "invalid escape");
+        }
+        ptr    += 2;
+        special = S_scan_string(ptr, limit);
+    }
+
+    parser->ptr = ptr + 1;
+    return Str_new_from_trusted_utf8(parser->scratch,
+                                     (size_t)(dest - parser->scratch));
+}
+
+static Obj*
+S_parse_number(JsonParser *parser) {
+    const char *start    = parser->ptr;
+    const char *ptr      = start;
+    const char *limit    = parser->limit;
+    bool        is_float = false;
+
+    if (*ptr == '-') { ptr++; }
+    const char *digits = ptr;
+    if (ptr >= limit || !SI_is_digit(*ptr)) {
+        parser->ptr = ptr;
+        S_syntax_error(parser, "invalid number");
+    }
+    if (*ptr == '0') {
+        ptr++;
+    }
+    else {
+        while (ptr < limit && SI_is_digit(*ptr)) { ptr++; }
+    }
+    const char *digits_end = ptr;
+
+    if (ptr < limit && *ptr == '.') {
+        is_float = true;
+        ptr++;
+        if (ptr >= limit || !SI_is_digit(*ptr)) {
+            parser->ptr = ptr;
+            S_syntax_error(parser, "invalid number");
+        }
+        while (ptr < limit && SI_is_digit(*ptr)) { ptr++; }
+    }
+    if (ptr < limit && (*ptr == 'e' || *ptr == 'E')) {
+        is_float = true;
+        ptr++;
+        if (ptr < limit && (*ptr == '+' || *ptr == '-')) { ptr++; }
+        if (ptr >= limit || !SI_is_digit(*ptr)) {
+            parser->ptr = ptr;
+            S_syntax_error(parser, "invalid number");
+        }
+        while (ptr < limit && SI_is_digit(*ptr)) { ptr++; }
+    }
+    parser->ptr = ptr;
+
+    if (!is_float) {
+        // Accumulate digits, falling back to a Float on overflow.
+        bool     negative = *start == '-';
+        uint64_t max      = negative
+                            ? (uint64_t)INT64_MAX + 1
+                            : (uint64_t)INT64_MAX;
+        uint64_t value    = 0;
+        const char *digit = digits;
+        for (; digit < digits_end; digit++) {
+            uint64_t d = (uint64_t)(*digit - '0');
+            if (value > (max - d) / 10) { break; }
+            value = value * 10 + d;
+        }
+        if (digit == digits_end) {
+            int64_t result = negative
+                             ? (int64_t)(0 - value)
+                             : (int64_t)value;
+            return (Obj*)Int_new(result);
+        }
+    }
+
+    // The number isn't terminated, so strtod needs a copy.
+    char    stack_buf[64];
+    size_t  size = (size_t)(ptr - start);
+    char   *copy = size < sizeof(stack_buf)
+                   ? stack_buf
+                   : (char*)MALLOCATE(size + 1);
+    memcpy(copy, start, size);
+    copy[size] = '\0';
+    double value = strtod(copy, NULL);
+    if (copy != stack_buf) { FREEMEM(copy); }
+
+    return (Obj*)Float_new(value);
+}
+
+static void
+S_parse_literal(JsonParser *parser, const char *literal, size_t size) {
+    if ((size_t)(parser->limit - parser->ptr) < size
+        || memcmp(parser->ptr, literal, size) != 0
+       ) {
+        S_syntax_error(parser, "invalid literal");
+    }
+    parser->ptr += size;
+}
+
+static void
+S_syntax_error(JsonParser *parser, const char *problem) {
+    THROW(ERR, "JSON syntax error at byte %u64: %s",
+          (uint64_t)(parser->ptr - parser->start), problem);
+}
+
+/***************************************************************************/
+
+String*
+Json_encode(Obj *obj) {
+    CharBuf *buf = CB_new(64);
+    JsonEncoder encoder;
+    encoder.obj = obj;
+    encoder.buf = buf;
+
+    Err *error = Err_trap(S_do_encode, &encoder);
+    if (error) {
+        DECREF(buf);
+        RETHROW(error);
+    }
+
+    String *json = CB_Yield_String(buf);
+    DECREF(buf);
+    return json;
+}
+
+void
+Json_encode_to(Obj *obj, CharBuf *buf) {
+    S_encode(obj, buf, 0);
+}
+
+static void
+S_do_encode(void *context) {
+    JsonEncoder *encoder = (JsonEncoder*)context;
+    S_encode(encoder->obj, encoder->buf, 0);
+}
+
+static void
+S_encode(Obj *obj, CharBuf *buf, int depth) {
+    if (obj == NULL) {
+        CB_Cat_Trusted_Utf8(buf, "null", 4);
+        return;
+    }
+
+    Class *klass = Obj_get_class(obj);
+    if (klass == INTEGER) {
+        // Convert by hand to avoid the overhead of format strings.
+        int64_t  value = Int_Get_Value((Integer*)obj);
+        uint64_t abs   = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+        char     digits[24];
+        char    *ptr   = digits + sizeof(digits);
+        do {
+            *--ptr = (char)('0' + abs % 10);
+            abs /= 10;
+        } while (abs);
+        if (value < 0) { *--ptr = '-'; }
+        CB_Cat_Trusted_Utf8(buf, ptr, (size_t)(digits + sizeof(digits) - ptr));
+    }
+    else if (klass == FLOAT) {
+        S_encode_float(Float_Get_Value((Float*)obj), buf);
+    }
+    else if (klass == BOOLEAN) {
+        if (Bool_Get_Value((Boolean*)obj)) {
+            CB_Cat_Trusted_Utf8(buf, "true", 4);
+        }
+        else {
+            CB_Cat_Trusted_Utf8(buf, "false", 5);
+        }
+    }
+    else if (Obj_is_a(obj, STRING)) {
+        String *string = (String*)obj;
+        S_encode_string(Str_Get_Ptr8(string), Str_Get_Size(string), buf);
+    }
+    else if (Obj_is_a(obj, VECTOR)) {
+        Vector *vector = (Vector*)obj;
+        size_t  size   = Vec_Get_Size(vector);
+        if (++depth > JSON_MAX_DEPTH) {
+            THROW(ERR, "Can't encode JSON: nesting too deep");
+        }
+        CB_Cat_Trusted_Utf8(buf, "[", 1);
+        for (size_t i = 0; i < size; i++) {
+            if (i > 0) { CB_Cat_Trusted_Utf8(buf, ",", 1); }
+            S_encode(Vec_Fetch(vector, i), buf, depth);
+        }
+        CB_Cat_Trusted_Utf8(buf, "]", 1);
+    }
+    else if (Obj_is_a(obj, HASH)) {
+        if (++depth > JSON_MAX_DEPTH) {
+            THROW(ERR, "Can't encode JSON: nesting too deep");
+        }
+        HashIterator *iter  = HashIter_new((Hash*)obj);
+        bool          first = true;
+        CB_Cat_Trusted_Utf8(buf, "{", 1);
+        while (HashIter_Next(iter)) {
+            String *key = HashIter_Get_Key(iter);
+            if (!first) { CB_Cat_Trusted_Utf8(buf, ",", 1); }
+            first = false;
+            S_encode_string(Str_Get_Ptr8(key), Str_Get_Size(key), buf);
+            CB_Cat_Trusted_Utf8(buf, ":", 1);
+            S_encode(HashIter_Get_Value(iter), buf, depth);
+        }
+        DECREF(iter);
+        CB_Cat_Trusted_Utf8(buf, "}", 1);
+    }
+    else {
+        THROW(ERR, "Can't encode object of class %o as JSON",
+              Obj_get_class_name(obj));
+    }
+}
+
+static void
+S_encode_string(const char *ptr, size_t size, CharBuf *buf) {
+    static const char hex_digits[] = "0123456789abcdef";
+    const char *limit = ptr + size;
+
+    CB_Cat_Trusted_Utf8(buf, "\"", 1);
+    while (1) {
+        const char *special = S_scan_string(ptr, limit);
+        if (special > ptr) {
+            CB_Cat_Trusted_Utf8(buf, ptr, (size_t)(special - ptr));
+        }
+        if (special == limit) { break; }
+
+        char escape[6] = { '\\', 0, 0, 0, 0, 0 };
+        size_t escape_size = 2;
+        switch (*special) {
+            case '"':  escape[1] = '"';  break;
+            case '\\': escape[1] = '\\'; break;
+            case '\b': escape[1] = 'b';  break;
+            case '\f': escape[1] = 'f';  break;
+            case '\n': escape[1] = 'n';  break;
+            case '\r': escape[1] = 'r';  break;
+            case '\t': escape[1] = 't';  break;
+            default:
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex_digits[(*special >> 4) & 0xF];
+                escape[5] = hex_digits[*special & 0xF];
+                escape_size = 6;
+        }
+        CB_Cat_Trusted_Utf8(buf, escape, escape_size);
+        ptr = special + 1;
+    }
+    CB_Cat_Trusted_Utf8(buf, "\"", 1);
+}
+
+static void
+S_encode_float(double value, CharBuf *buf) {
+    if (isnan(value) || isinf(value)) {
+        THROW(ERR, "Can't encode %f64 as JSON", value);
+    }
+
+    // Use the shortest of two precisions which round-trips.
+    char num_buf[40];
+    int  size = snprintf(num_buf, sizeof(num_buf), "%.15g", value);
+    if (strtod(num_buf, NULL) != value) {
+        size = snprintf(num_buf, sizeof(num_buf), "%.17g", value);
+    }
+    CB_Cat_Trusted_Utf8(buf, num_buf, (size_t)size);
+
+    // Keep Floats with integral values from decoding as Integers.
+    if (strpbrk(num_buf, ".e") == NULL) {
+        CB_Cat_Trusted_Utf8(buf, ".0", 2);
+    }
+}
+
+/***************************************************************************/
+
+#if defined(CFISH_JSON_SSE2)
+
+static CFISH_INLINE unsigned
+SI_count_trailing_zeros(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
+}
+
+static const char*
+S_scan_string(const char *ptr, const char *limit) {
+    const __m128i quote     = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i max_ctrl  = _mm_set1_epi8(0x1F);
+
+    while (limit - ptr >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)ptr);
+        __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                     _mm_cmpeq_epi8(chunk, backslash));
+        // Unsigned bytes up to 0x1F are unchanged by the minimum.
+        __m128i ctrl  = _mm_cmpeq_epi8(_mm_min_epu8(chunk, max_ctrl), chunk);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(found, ctrl));
+        if (mask) {
+            return ptr + SI_count_trailing_zeros(mask);
+        }
+        ptr += 16;
+    }
+
+    for (; ptr < limit; ptr++) {
+        unsigned char c = (unsigned char)*ptr;
+        if (c == '"' || c == '\\' || c < 0x20) { break; }
+    }
+    return ptr;
+}
+
+#else
+
+static const char*
+S_scan_string(const char *ptr, const char *limit) {
+    const uint64_t ones  = UINT64_C(0x0101010101010101);
+    const uint64_t highs = UINT64_C(0x8080808080808080);
+
+    while (limit - ptr >= 8) {
+        uint64_t word;
+        memcpy(&word, ptr, sizeof(word));
+        // Flag bytes which are zero after XOR, or below 0x20.  False
+        // positives are possible above a true match, so locate the exact
+        // byte with the scalar loop below.
+        uint64_t quote     = word ^ (ones * '"');
+        uint64_t backslash = word ^ (ones * '\\');
+        uint64_t found     = ((quote - ones) & ~quote)
+                             | ((backslash - ones) & ~backslash)
+                             | ((word - ones * 0x20) & ~word);
+        if (found & highs) { break; }
+        ptr += 8;
+    }
+
+    for (; ptr < limit; ptr++) {
+        unsigned char c = (unsigned char)*ptr;
+        if (c == '"' || c == '\\' || c < 0x20) { break; }
+    }
+    return ptr;
+}
+
+#endif
+
@@ -16,6 +16,8 @@
 
 #define CFISH_USE_SHORT_NAMES
 
+#include <stdint.h>
+
 #include "Clownfish/Obj.h"
 #include "Clownfish/LockFreeRegistry.h"
 #include "Clownfish/Err.h"
@@ -24,123 +26,290 @@
 #include "Clownfish/Util/Atomic.h"
 #include "Clownfish/Util/Memory.h"
 
-struct cfish_LockFreeRegistry {
-    size_t  capacity;
-    void   *entries;
-};
+/* The registry is a split-ordered list (Shalev and Shavit, "Split-Ordered
+ * Lists: Lock-Free Extensible Hash Tables").  All entries live in a single
+ * linked list sorted by their bit-reversed hash sums.  In this order, the
+ * entries of bucket `b` in a table with `2n` buckets directly follow the
+ * ones of bucket `b` in a table with `n` buckets, and the entries of bucket
+ * `b + n` come right after them.  Every bucket starts with a dummy entry,
+ * and the bucket table only holds pointers to the dummies.  So the table
+ * can grow by swapping in a larger one without moving any entries.  Dummies
+ * of new buckets are inserted lazily, splitting their parent bucket.
+ *
+ * Entries are never removed, which keeps insertion a single
+ * compare-and-swap.  Replaced bucket tables are kept until the registry is
+ * destroyed, since other threads may still be reading them.
+ */
+
+// Grow the bucket table when there are more entries per bucket.
+#define LFREG_MAX_LOAD 2
 
 typedef struct cfish_LFRegEntry {
+    size_t so_key;
+    size_t hash_sum;
     String *key;
     Obj *value;
-    size_t hash_sum;
     struct cfish_LFRegEntry *volatile next;
 } cfish_LFRegEntry;
 #define LFRegEntry cfish_LFRegEntry
 
+typedef struct cfish_LFRegTable {
+    size_t capacity;
+    struct cfish_LFRegTable *old_table;
+    LFRegEntry *volatile *buckets;
+} cfish_LFRegTable;
+#define LFRegTable cfish_LFRegTable
+
+struct cfish_LockFreeRegistry {
+    LFRegTable *volatile  table;
+    LFRegEntry           *head;
+    volatile size_t       size;
+};
+
+static CFISH_INLINE size_t
+SI_reverse_bits(size_t bits) {
+#if (SIZE_MAX > UINT32_MAX)
+    uint64_t x = (uint64_t)bits;
+    x = ((x >> 1)  & UINT64_C(0x5555555555555555))
+        | ((x & UINT64_C(0x5555555555555555)) << 1);
+    x = ((x >> 2)  & UINT64_C(0x3333333333333333))
+        | ((x & UINT64_C(0x3333333333333333)) << 2);
+    x = ((x >> 4)  & UINT64_C(0x0F0F0F0F0F0F0F0F))
+        | ((x & UINT64_C(0x0F0F0F0F0F0F0F0F)) << 4);
+    x = ((x >> 8)  & UINT64_C(0x00FF00FF00FF00FF))
+        | ((x & UINT64_C(0x00FF00FF00FF00FF)) << 8);
+    x = ((x >> 16) & UINT64_C(0x0000FFFF0000FFFF))
+        | ((x & UINT64_C(0x0000FFFF0000FFFF)) << 16);
+    x = (x >> 32) | (x << 32);
+    return (size_t)x;
+#else
+    uint32_t x = (uint32_t)bits;
+    x = ((x >> 1)  & 0x55555555) | ((x & 0x55555555) << 1);
+    x = ((x >> 2)  & 0x33333333) | ((x & 0x33333333) << 2);
+    x = ((x >> 4)  & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+    x = ((x >> 8)  & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+    x = (x >> 16) | (x << 16);
+    return (size_t)x;
+#endif
+}
+
+// Sort keys of entries are odd and sort keys of dummies are even, so that
+// the dummy of a bucket sorts before all of the bucket's entries.
+static CFISH_INLINE size_t
+SI_entry_so_key(size_t hash_sum) {
+    return SI_reverse_bits(hash_sum) | 1;
+}
+
+static CFISH_INLINE size_t
+SI_dummy_so_key(size_t bucket) {
+    return SI_reverse_bits(bucket);
+}
+
+static LFRegTable*
+S_new_table(size_t capacity, LFRegTable *old_table) {
+    LFRegTable *table = (LFRegTable*)MALLOCATE(sizeof(LFRegTable));
+    table->capacity  = capacity;
+    table->old_table = old_table;
+    table->buckets   = (LFRegEntry*volatile*)CALLOCATE(capacity,
+                                                        sizeof(void*));
+    return table;
+}
+
+static size_t
+S_increment_size(LockFreeRegistry *self) {
+    while (1) {
+        size_t size = self->size;
+        if (Atomic_cas_ptr((void*volatile*)&self->size,
+                           (void*)(uintptr_t)size,
+                           (void*)(uintptr_t)(size + 1))) {
+            return size + 1;
+        }
+    }
+}
+
 LockFreeRegistry*
 LFReg_new(size_t capacity) {
+    size_t table_cap = 1;
+    while (table_cap < capacity) { table_cap *= 2; }
+
     LockFreeRegistry *self
         = (LockFreeRegistry*)CALLOCATE(1, sizeof(LockFreeRegistry));
-    self->capacity = capacity;
-    self->entries  = CALLOCATE(capacity, sizeof(void*));
+    self->head  = (LFRegEntry*)CALLOCATE(1, sizeof(LFRegEntry));
+    self->table = S_new_table(table_cap, NULL);
+    self->table->buckets[0] = self->head;
     return self;
 }
 
-bool
-LFReg_register(LockFreeRegistry *self, String *key, Obj *value) {
-    LFRegEntry  *new_entry = NULL;
-    size_t       hash_sum  = Str_Hash_Sum(key);
-    size_t       bucket    = hash_sum  % self->capacity;
-    LFRegEntry  *volatile *entries = (LFRegEntry*volatile*)self->entries;
-    LFRegEntry  *volatile *slot    = &(entries[bucket]);
-
-    // Proceed through the linked list.  Bail out if the key has already been
-    // registered.
-FIND_END_OF_LINKED_LIST:
-    while (*slot) {
-        LFRegEntry *entry = *slot;
-        if (entry->hash_sum == hash_sum) {
-            if (Str_Equals(key, (Obj*)entry->key)) {
-                if (new_entry) {
-                    DECREF(new_entry->key);
-                    DECREF(new_entry->value);
-                    FREEMEM(new_entry);
-                }
-                return false;
+// Find the entry with the given key, starting after `start`.
+static LFRegEntry*
+S_find(LFRegEntry *start, size_t so_key, size_t hash_sum, String *key) {
+    LFRegEntry *entry = start->next;
+
+    while (entry && entry->so_key < so_key) {
+        entry = entry->next;
+    }
+    while (entry && entry->so_key == so_key) {
+        if (entry->hash_sum == hash_sum
+            && Str_Equals(key, (Obj*)entry->key)
+           ) {
+            return entry;
+        }
+        entry = entry->next;
+    }
+
+    return NULL;
+}
+
+/* Insert `new_entry` into the list after `start`.  Return the entry which
+ * is in the list afterwards, which is an existing entry if another one with
+ * the same key was found.
+ */
+static LFRegEntry*
+S_insert(LFRegEntry *start, LFRegEntry *new_entry) {
+    size_t      so_key = new_entry->so_key;
+    LFRegEntry *prev   = start;
+
+    while (1) {
+        LFRegEntry *entry = prev->next;
+        while (entry && entry->so_key < so_key) {
+            prev  = entry;
+            entry = entry->next;
+        }
+
+        for (LFRegEntry *dupe = entry;
+             dupe && dupe->so_key == so_key;
+             dupe = dupe->next
+            ) {
+            // Dummies are identified by their sort key alone.
+            if (new_entry->key == NULL) { return dupe; }
+            if (dupe->hash_sum == new_entry->hash_sum
+                && Str_Equals(new_entry->key, (Obj*)dupe->key)
+               ) {
+                return dupe;
             }
         }
-        slot = &(entry->next);
+
+        /* Link the new entry in front of the first entry with an equal or
+         * larger sort key.  If another thread inserted an entry after `prev`
+         * in the meantime, the compare-and-swap fails.  Since entries are
+         * never removed, `prev` stays in the list, so search again from
+         * there. */
+        new_entry->next = entry;
+        if (Atomic_cas_ptr((void*volatile*)&prev->next, entry, new_entry)) {
+            return new_entry;
+        }
     }
+}
+
+// Return the dummy entry of a bucket, inserting it if necessary.
+static LFRegEntry*
+S_bucket(LFRegTable *table, size_t bucket) {
+    LFRegEntry *dummy = table->buckets[bucket];
+    if (dummy) { return dummy; }
 
-    // We've found an empty slot. Create the new entry.
-    if (!new_entry) {
-        new_entry = (LFRegEntry*)MALLOCATE(sizeof(LFRegEntry));
-        new_entry->hash_sum  = hash_sum;
-        new_entry->key       = Str_new_from_trusted_utf8(Str_Get_Ptr8(key),
-                                                         Str_Get_Size(key));
-        new_entry->value     = INCREF(value);
-        new_entry->next      = NULL;
+    // The parent bucket is the bucket with the highest bit cleared.  This
+    // recursion ends at bucket 0, which always has a dummy.
+    size_t high_bit = table->capacity >> 1;
+    while (!(bucket & high_bit)) { high_bit >>= 1; }
+    LFRegEntry *parent = S_bucket(table, bucket & ~high_bit);
+
+    LFRegEntry *new_dummy = (LFRegEntry*)CALLOCATE(1, sizeof(LFRegEntry));
+    new_dummy->so_key = SI_dummy_so_key(bucket);
+    dummy = S_insert(parent, new_dummy);
+    if (dummy != new_dummy) {
+        FREEMEM(new_dummy);
     }
 
-    /* Attempt to append the new node onto the end of the linked list.
-     * However, if another thread filled the slot since we found it (perhaps
-     * while we were allocating that new node), the compare-and-swap will
-     * fail.  If that happens, we have to go back and find the new end of the
-     * linked list, then try again. */
-#if 1
-    if (!Atomic_cas_ptr((void*volatile*)slot, NULL, new_entry)) {
-        goto FIND_END_OF_LINKED_LIST;
+    // Racing threads store the same dummy.
+    table->buckets[bucket] = dummy;
+    return dummy;
+}
+
+static void
+S_grow(LockFreeRegistry *self, LFRegTable *table) {
+    if (table->capacity > SIZE_MAX / 2 / sizeof(void*)) { return; }
+
+    LFRegTable *new_table = S_new_table(table->capacity * 2, table);
+    for (size_t i = 0; i < table->capacity; i++) {
+        new_table->buckets[i] = table->buckets[i];
     }
-#else
-    // This non-atomic version can be used to check whether the test suite
-    // catches any race conditions.
-    if (*slot == NULL) {
-        *slot = new_entry;
+
+    if (!Atomic_cas_ptr((void*volatile*)&self->table, table, new_table)) {
+        // Another thread grew the table first.
+        FREEMEM((void*)new_table->buckets);
+        FREEMEM(new_table);
+    }
+}
+
+bool
+LFReg_register(LockFreeRegistry *self, String *key, Obj *value) {
+    size_t      hash_sum = Str_Hash_Sum(key);
+    size_t      so_key   = SI_entry_so_key(hash_sum);
+    LFRegTable *table    = self->table;
+    LFRegEntry *bucket   = S_bucket(table, hash_sum & (table->capacity - 1));
+
+    // Bail out early if the key has already been registered.
+    if (S_find(bucket, so_key, hash_sum, key)) {
+        return false;
     }
-    else {
-        goto FIND_END_OF_LINKED_LIST;
+
+    LFRegEntry *new_entry = (LFRegEntry*)MALLOCATE(sizeof(LFRegEntry));
+    new_entry->so_key    = so_key;
+    new_entry->hash_sum  = hash_sum;
+    // Immortal keys such as class names can be shared without a copy.
+    new_entry->key       = Str_is_immortal(key)
+                           ? key
+                           : Str_new_from_trusted_utf8(Str_Get_Ptr8(key),
+                                                       Str_Get_Size(key));
+    new_entry->value     = INCREF(value);
+    new_entry->next      = NULL;
+
+    if (S_insert(bucket, new_entry) != new_entry) {
+        // Another thread registered the key in the meantime.
+        DECREF(new_entry->key);
+        DECREF(new_entry->value);
+        FREEMEM(new_entry);
+        return false;
+    }
+
+    if (S_increment_size(self) > table->capacity * LFREG_MAX_LOAD) {
+        S_grow(self, table);
     }
-#endif
 
     return true;
 }
 
 Obj*
 LFReg_fetch(LockFreeRegistry *self, String *key) {
-    size_t       hash_sum  = Str_Hash_Sum(key);
-    size_t       bucket    = hash_sum  % self->capacity;
-    LFRegEntry **entries   = (LFRegEntry**)self->entries;
-    LFRegEntry  *entry     = entries[bucket];
-
-    while (entry) {
-        if (entry->hash_sum  == hash_sum) {
-            if (Str_Equals(key, (Obj*)entry->key)) {
-                return entry->value;
-            }
-        }
-        entry = entry->next;
-    }
-
-    return NULL;
+    size_t      hash_sum = Str_Hash_Sum(key);
+    LFRegTable *table    = self->table;
+    LFRegEntry *bucket   = S_bucket(table, hash_sum & (table->capacity - 1));
+    LFRegEntry *entry    = S_find(bucket, SI_entry_so_key(hash_sum),
+                                  hash_sum, key);
+    return entry ? entry->value : NULL;
 }
 
 void
 LFReg_destroy(LockFreeRegistry *self) {
-    LFRegEntry **entries = (LFRegEntry**)self->entries;
-
-    for (size_t i = 0; i < self->capacity; i++) {
-        LFRegEntry *entry = entries[i];
-        while (entry) {
-            LFRegEntry *next_entry = entry->next;
+    LFRegEntry *entry = self->head;
+    while (entry) {
+        LFRegEntry *next_entry = entry->next;
+        if (entry->key) {
             DECREF(entry->key);
             DECREF(entry->value);
-            FREEMEM(entry);
-            entry = next_entry;
         }
+        FREEMEM(entry);
+        entry = next_entry;
+    }
+
+    LFRegTable *table = self->table;
+    while (table) {
+        LFRegTable *old_table = table->old_table;
+        FREEMEM((void*)table->buckets);
+        FREEMEM(table);
+        table = old_table;
     }
-    FREEMEM(self->entries);
 
     FREEMEM(self);
 }
 
-
@@ -35,14 +35,21 @@ Method*
 Method_init(Method *self, String *name, cfish_method_t callback_func,
             uint32_t offset) {
     /* The `name` member which Method exposes via the `Get_Name` accessor uses
-     * a "wrapped" string because that is effectively threadsafe: an INCREF
-     * results in a copy and the only reference is owned by an immortal
-     * object. */
-    self->name_internal
-        = Str_new_from_trusted_utf8(Str_Get_Ptr8(name), Str_Get_Size(name));
-    self->name
-        = Str_new_wrap_trusted_utf8(Str_Get_Ptr8(self->name_internal),
-                                    Str_Get_Size(self->name_internal));
+     * an immortal or a "wrapped" string because that is effectively
+     * threadsafe: an INCREF is either free or results in a copy, and the
+     * only reference is owned by an immortal object. */
+    if (Str_is_immortal(name)) {
+        self->name_internal = NULL;
+        self->name          = name;
+    }
+    else {
+        self->name_internal
+            = Str_new_from_trusted_utf8(Str_Get_Ptr8(name),
+                                        Str_Get_Size(name));
+        self->name
+            = Str_new_wrap_trusted_utf8(Str_Get_Ptr8(self->name_internal),
+                                        Str_Get_Size(self->name_internal));
+    }
 
     self->host_alias    = NULL;
     self->callback_func = callback_func;
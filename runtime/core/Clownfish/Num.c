@@ -19,13 +19,16 @@
 #define CFISH_USE_SHORT_NAMES
 
 #include <float.h>
+#include <string.h>
 
 #include "charmony.h"
 
 #include "Clownfish/Num.h"
+#include "Clownfish/CharBuf.h"
 #include "Clownfish/String.h"
 #include "Clownfish/Err.h"
 #include "Clownfish/Class.h"
+#include "Clownfish/Util/Hashing.h"
 
 #if FLT_RADIX != 2
   #error Unsupported FLT_RADIX
@@ -76,6 +79,24 @@ Float_Equals_IMP(Float *self, Obj *other) {
     }
 }
 
+void
+Float_Digest_IMP(Float *self, uint64_t *digest) {
+    double value = self->value;
+    // Integral values in the range of int64_t can equal an Integer, so
+    // they must be digested like one.  This also maps -0.0 to 0.
+    if (value >= -POW_2_63 && value < POW_2_63
+        && (double)(int64_t)value == value
+       ) {
+        Hashing_digest_u64(digest, HASHING_DIGEST_INTEGER,
+                           (uint64_t)(int64_t)value);
+    }
+    else {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        Hashing_digest_u64(digest, HASHING_DIGEST_FLOAT, bits);
+    }
+}
+
 int32_t
 Float_Compare_To_IMP(Float *self, Obj *other) {
     if (Obj_is_a(other, FLOAT)) {
@@ -112,6 +133,11 @@ Float_To_String_IMP(Float *self) {
     return Str_newf("%f64", self->value);
 }
 
+void
+Float_Cat_To_IMP(Float *self, CharBuf *buf) {
+    CB_catf(buf, "%f64", self->value);
+}
+
 Float*
 Float_Clone_IMP(Float *self) {
     return (Float*)INCREF(self);
@@ -146,6 +172,11 @@ Int_Equals_IMP(Integer *self, Obj *other) {
     }
 }
 
+void
+Int_Digest_IMP(Integer *self, uint64_t *digest) {
+    Hashing_digest_u64(digest, HASHING_DIGEST_INTEGER, (uint64_t)self->value);
+}
+
 int32_t
 Int_Compare_To_IMP(Integer *self, Obj *other) {
     if (Obj_is_a(other, INTEGER)) {
@@ -179,6 +210,11 @@ Int_To_String_IMP(Integer *self) {
     return Str_newf("%i64", self->value);
 }
 
+void
+Int_Cat_To_IMP(Integer *self, CharBuf *buf) {
+    CB_catf(buf, "%i64", self->value);
+}
+
 Integer*
 Int_Clone_IMP(Integer *self) {
     return (Integer*)INCREF(self);
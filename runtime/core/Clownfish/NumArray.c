@@ -0,0 +1,725 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define C_CFISH_NUMARRAY
+#define C_CFISH_I32ARRAY
+#define C_CFISH_I64ARRAY
+#define C_CFISH_F32ARRAY
+#define C_CFISH_F64ARRAY
+#define CFISH_USE_SHORT_NAMES
+
+#include <string.h>
+
+#include "charmony.h"
+
+#include "Clownfish/NumArray.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Util/Hashing.h"
+#include "Clownfish/Util/Memory.h"
+
+// SSE2 is part of the x86-64 baseline, so it's always available on 64-bit
+// x86.  Other platforms use scalar loops with independent accumulators which
+// compilers can vectorize.
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define CFISH_NUMARR_SSE2
+  #include <emmintrin.h>
+#endif
+
+static void
+S_overflow_error(void);
+
+/******************************** NumArray *********************************/
+
+NumArray*
+NumArr_init(NumArray *self, size_t width, size_t capacity) {
+    if (capacity > SIZE_MAX / width) {
+        S_overflow_error();
+    }
+    self->elems = MALLOCATE(capacity * width);
+    self->size  = 0;
+    self->cap   = capacity;
+    self->width = width;
+    return self;
+}
+
+void
+NumArr_Destroy_IMP(NumArray *self) {
+    FREEMEM(self->elems);
+    SUPER_DESTROY(self, NUMARRAY);
+}
+
+size_t
+NumArr_Get_Size_IMP(NumArray *self) {
+    return self->size;
+}
+
+size_t
+NumArr_Get_Capacity_IMP(NumArray *self) {
+    return self->cap;
+}
+
+void
+NumArr_Grow_IMP(NumArray *self, size_t capacity) {
+    if (capacity > self->cap) {
+        if (capacity > SIZE_MAX / self->width) {
+            S_overflow_error();
+            return;
+        }
+        self->elems = REALLOCATE(self->elems, capacity * self->width);
+        self->cap   = capacity;
+    }
+}
+
+// Grow the array to hold at least `min_size` elements, oversizing the
+// allocation.
+static void
+S_grow_and_oversize(NumArray *self, size_t min_size) {
+    size_t max_size = SIZE_MAX / self->width;
+    if (min_size > max_size) {
+        S_overflow_error();
+        return;
+    }
+
+    // Oversize by 25%, but at least four elements.
+    size_t extra = min_size / 4;
+    if (extra < 4) { extra = 4; }
+
+    size_t capacity = extra > max_size - min_size
+                      ? max_size
+                      : min_size + extra;
+    self->elems = REALLOCATE(self->elems, capacity * self->width);
+    self->cap   = capacity;
+}
+
+void
+NumArr_Resize_IMP(NumArray *self, size_t size) {
+    if (size > self->size) {
+        if (size > self->cap) {
+            NumArr_Grow(self, size);
+        }
+        memset((char*)self->elems + self->size * self->width, 0,
+               (size - self->size) * self->width);
+    }
+    self->size = size;
+}
+
+void
+NumArr_Clear_IMP(NumArray *self) {
+    self->size = 0;
+}
+
+// Append an element and return a pointer to it.
+static CFISH_INLINE void*
+SI_push_slot(NumArray *self) {
+    if (self->size == self->cap) {
+        if (self->size == SIZE_MAX) {
+            S_overflow_error();
+        }
+        S_grow_and_oversize(self, self->size + 1);
+    }
+    return (char*)self->elems + self->size++ * self->width;
+}
+
+// Return a pointer to the element at `tick`, growing the array with zeroes
+// if necessary.
+static CFISH_INLINE void*
+SI_store_slot(NumArray *self, size_t tick) {
+    if (tick >= self->size) {
+        if (tick >= self->cap) {
+            if (tick == SIZE_MAX) {
+                S_overflow_error();
+            }
+            S_grow_and_oversize(self, tick + 1);
+        }
+        memset((char*)self->elems + self->size * self->width, 0,
+               (tick - self->size) * self->width);
+        self->size = tick + 1;
+    }
+    return (char*)self->elems + tick * self->width;
+}
+
+static CFISH_INLINE void
+SI_check_tick(NumArray *self, size_t tick) {
+    if (tick >= self->size) {
+        THROW(ERR, "Tick %u64 out of range for %o of size %u64",
+              (uint64_t)tick, Obj_get_class_name((Obj*)self),
+              (uint64_t)self->size);
+    }
+}
+
+static CFISH_INLINE void
+SI_check_not_empty(NumArray *self) {
+    if (self->size == 0) {
+        THROW(ERR, "Can't compute minimum or maximum of empty %o",
+              Obj_get_class_name((Obj*)self));
+    }
+}
+
+static CFISH_INLINE void
+SI_check_same_size(NumArray *self, NumArray *other) {
+    if (other->size != self->size) {
+        THROW(ERR, "Size mismatch in Dot: %u64 != %u64",
+              (uint64_t)self->size, (uint64_t)other->size);
+    }
+}
+
+static bool
+S_equals_header(NumArray *self, Obj *other, Class *klass) {
+    if (!Obj_is_a(other, klass)) { return false; }
+    return ((NumArray*)other)->size == self->size;
+}
+
+static void
+S_overflow_error() {
+    THROW(ERR, "NumArray index overflow");
+}
+
+/********************************* Kernels *********************************/
+
+static int64_t
+S_sum_i32(const int32_t *data, size_t size) {
+    size_t  i   = 0;
+    int64_t sum = 0;
+#ifdef CFISH_NUMARR_SSE2
+    // Sign-extend to 64-bit lanes.
+    __m128i acc_lo = _mm_setzero_si128();
+    __m128i acc_hi = _mm_setzero_si128();
+    for (; i + 4 <= size; i += 4) {
+        __m128i value = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i sign  = _mm_srai_epi32(value, 31);
+        acc_lo = _mm_add_epi64(acc_lo, _mm_unpacklo_epi32(value, sign));
+        acc_hi = _mm_add_epi64(acc_hi, _mm_unpackhi_epi32(value, sign));
+    }
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, _mm_add_epi64(acc_lo, acc_hi));
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < size; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static int32_t
+S_min_max_i32(const int32_t *data, size_t size, bool want_max) {
+    size_t  i    = 0;
+    int32_t best = data[0];
+#ifdef CFISH_NUMARR_SSE2
+    if (size >= 4) {
+        // SSE2 has no 32-bit min/max, so select with compare masks.
+        __m128i acc = _mm_set1_epi32(best);
+        for (; i + 4 <= size; i += 4) {
+            __m128i value = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i mask  = want_max
+                            ? _mm_cmpgt_epi32(value, acc)
+                            : _mm_cmplt_epi32(value, acc);
+            acc = _mm_or_si128(_mm_and_si128(mask, value),
+                               _mm_andnot_si128(mask, acc));
+        }
+        int32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        for (size_t j = 0; j < 4; j++) {
+            if (want_max ? lanes[j] > best : lanes[j] < best) {
+                best = lanes[j];
+            }
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        if (want_max ? data[i] > best : data[i] < best) { best = data[i]; }
+    }
+    return best;
+}
+
+static int64_t
+S_dot_i32(const int32_t *a, const int32_t *b, size_t size) {
+    // Independent accumulators.  Unsigned arithmetic wraps on overflow.
+    uint64_t acc[4] = { 0, 0, 0, 0 };
+    size_t   i      = 0;
+    for (; i + 4 <= size; i += 4) {
+        for (size_t j = 0; j < 4; j++) {
+            acc[j] += (uint64_t)((int64_t)a[i+j] * b[i+j]);
+        }
+    }
+    for (; i < size; i++) {
+        acc[0] += (uint64_t)((int64_t)a[i] * b[i]);
+    }
+    return (int64_t)(acc[0] + acc[1] + acc[2] + acc[3]);
+}
+
+static int64_t
+S_sum_i64(const int64_t *data, size_t size) {
+    size_t   i   = 0;
+    uint64_t sum = 0;
+#ifdef CFISH_NUMARR_SSE2
+    __m128i acc_0 = _mm_setzero_si128();
+    __m128i acc_1 = _mm_setzero_si128();
+    for (; i + 4 <= size; i += 4) {
+        acc_0 = _mm_add_epi64(acc_0,
+                              _mm_loadu_si128((const __m128i*)(data + i)));
+        acc_1 = _mm_add_epi64(acc_1,
+                              _mm_loadu_si128((const __m128i*)(data + i + 2)));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, _mm_add_epi64(acc_0, acc_1));
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < size; i++) {
+        sum += (uint64_t)data[i];
+    }
+    return (int64_t)sum;
+}
+
+static int64_t
+S_min_max_i64(const int64_t *data, size_t size, bool want_max) {
+    // SSE2 has no 64-bit compares, so rely on independent accumulators.
+    int64_t best[4] = { data[0], data[0], data[0], data[0] };
+    size_t  i       = 0;
+    for (; i + 4 <= size; i += 4) {
+        for (size_t j = 0; j < 4; j++) {
+            int64_t value = data[i+j];
+            if (want_max ? value > best[j] : value < best[j]) {
+                best[j] = value;
+            }
+        }
+    }
+    for (; i < size; i++) {
+        if (want_max ? data[i] > best[0] : data[i] < best[0]) {
+            best[0] = data[i];
+        }
+    }
+    for (size_t j = 1; j < 4; j++) {
+        if (want_max ? best[j] > best[0] : best[j] < best[0]) {
+            best[0] = best[j];
+        }
+    }
+    return best[0];
+}
+
+static int64_t
+S_dot_i64(const int64_t *a, const int64_t *b, size_t size) {
+    uint64_t acc[4] = { 0, 0, 0, 0 };
+    size_t   i      = 0;
+    for (; i + 4 <= size; i += 4) {
+        for (size_t j = 0; j < 4; j++) {
+            acc[j] += (uint64_t)a[i+j] * (uint64_t)b[i+j];
+        }
+    }
+    for (; i < size; i++) {
+        acc[0] += (uint64_t)a[i] * (uint64_t)b[i];
+    }
+    return (int64_t)(acc[0] + acc[1] + acc[2] + acc[3]);
+}
+
+/* Floating point reductions can't be vectorized by compilers without
+ * relaxed math flags because reordering changes rounding.  The kernels use
+ * several independent accumulators, which changes the summation order but
+ * also tends to reduce rounding error.
+ */
+
+#ifdef CFISH_NUMARR_SSE2
+
+static float
+S_hsum_ps(__m128 acc) {
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+static double
+S_hsum_pd(__m128d acc) {
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    return lanes[0] + lanes[1];
+}
+
+#endif
+
+static float
+S_sum_f32(const float *data, size_t size) {
+    size_t i   = 0;
+    float  sum = 0.0f;
+#ifdef CFISH_NUMARR_SSE2
+    __m128 acc_0 = _mm_setzero_ps();
+    __m128 acc_1 = _mm_setzero_ps();
+    __m128 acc_2 = _mm_setzero_ps();
+    __m128 acc_3 = _mm_setzero_ps();
+    for (; i + 16 <= size; i += 16) {
+        acc_0 = _mm_add_ps(acc_0, _mm_loadu_ps(data + i));
+        acc_1 = _mm_add_ps(acc_1, _mm_loadu_ps(data + i + 4));
+        acc_2 = _mm_add_ps(acc_2, _mm_loadu_ps(data + i + 8));
+        acc_3 = _mm_add_ps(acc_3, _mm_loadu_ps(data + i + 12));
+    }
+    sum = S_hsum_ps(_mm_add_ps(_mm_add_ps(acc_0, acc_1),
+                               _mm_add_ps(acc_2, acc_3)));
+#else
+    float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (; i + 4 <= size; i += 4) {
+        for (size_t j = 0; j < 4; j++) { acc[j] += data[i+j]; }
+    }
+    sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    for (; i < size; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static float
+S_dot_f32(const float *a, const float *b, size_t size) {
+    size_t i   = 0;
+    float  sum = 0.0f;
+#ifdef CFISH_NUMARR_SSE2
+    __m128 acc_0 = _mm_setzero_ps();
+    __m128 acc_1 = _mm_setzero_ps();
+    __m128 acc_2 = _mm_setzero_ps();
+    __m128 acc_3 = _mm_setzero_ps();
+    for (; i + 16 <= size; i += 16) {
+        acc_0 = _mm_add_ps(acc_0, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                             _mm_loadu_ps(b + i)));
+        acc_1 = _mm_add_ps(acc_1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+                                             _mm_loadu_ps(b + i + 4)));
+        acc_2 = _mm_add_ps(acc_2, _mm_mul_ps(_mm_loadu_ps(a + i + 8),
+                                             _mm_loadu_ps(b + i + 8)));
+        acc_3 = _mm_add_ps(acc_3, _mm_mul_ps(_mm_loadu_ps(a + i + 12),
+                                             _mm_loadu_ps(b + i + 12)));
+    }
+    sum = S_hsum_ps(_mm_add_ps(_mm_add_ps(acc_0, acc_1),
+                               _mm_add_ps(acc_2, acc_3)));
+#else
+    float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (; i + 4 <= size; i += 4) {
+        for (size_t j = 0; j < 4; j++) { acc[j] += a[i+j] * b[i+j]; }
+    }
+    sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    for (; i < size; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static float
+S_min_max_f32(const float *data, size_t size, bool want_max) {
+    size_t i    = 0;
+    float  best = data[0];
+#ifdef CFISH_NUMARR_SSE2
+    if (size >= 8) {
+        __m128 acc_0 = _mm_set1_ps(best);
+        __m128 acc_1 = acc_0;
+        for (; i + 8 <= size; i += 8) {
+            __m128 value_0 = _mm_loadu_ps(data + i);
+            __m128 value_1 = _mm_loadu_ps(data + i + 4);
+            if (want_max) {
+                acc_0 = _mm_max_ps(acc_0, value_0);
+                acc_1 = _mm_max_ps(acc_1, value_1);
+            }
+            else {
+                acc_0 = _mm_min_ps(acc_0, value_0);
+                acc_1 = _mm_min_ps(acc_1, value_1);
+            }
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, want_max ? _mm_max_ps(acc_0, acc_1)
+                                      : _mm_min_ps(acc_0, acc_1));
+        for (size_t j = 0; j < 4; j++) {
+            if (want_max ? lanes[j] > best : lanes[j] < best) {
+                best = lanes[j];
+            }
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        if (want_max ? data[i] > best : data[i] < best) { best = data[i]; }
+    }
+    return best;
+}
+
+static double
+S_sum_f64(const double *data, size_t size) {
+    size_t i   = 0;
+    double sum = 0.0;
+#ifdef CFISH_NUMARR_SSE2
+    __m128d acc_0 = _mm_setzero_pd();
+    __m128d acc_1 = _mm_setzero_pd();
+    __m128d acc_2 = _mm_setzero_pd();
+    __m128d acc_3 = _mm_setzero_pd();
+    for (; i + 8 <= size; i += 8) {
+        acc_0 = _mm_add_pd(acc_0, _mm_loadu_pd(data + i));
+        acc_1 = _mm_add_pd(acc_1, _mm_loadu_pd(data + i + 2));
+        acc_2 = _mm_add_pd(acc_2, _mm_loadu_pd(data + i + 4));
+        acc_3 = _mm_add_pd(acc_3, _mm_loadu_pd(data + i + 6));
+    }
+    sum = S_hsum_pd(_mm_add_pd(_mm_add_pd(acc_0, acc_1),
+                               _mm_add_pd(acc_2, acc_3)));
+#else
+    double acc[4] = { 0.0, 0.0, 0.0, 0.0 };
+    for (; i + 4 <= size; i += 4) {
+        for (size_t j = 0; j < 4; j++) { acc[j] += data[i+j]; }
+    }
+    sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    for (; i < size; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static double
+S_dot_f64(const double *a, const double *b, size_t size) {
+    size_t i   = 0;
+    double sum = 0.0;
+#ifdef CFISH_NUMARR_SSE2
+    __m128d acc_0 = _mm_setzero_pd();
+    __m128d acc_1 = _mm_setzero_pd();
+    __m128d acc_2 = _mm_setzero_pd();
+    __m128d acc_3 = _mm_setzero_pd();
+    for (; i + 8 <= size; i += 8) {
+        acc_0 = _mm_add_pd(acc_0, _mm_mul_pd(_mm_loadu_pd(a + i),
+                                             _mm_loadu_pd(b + i)));
+        acc_1 = _mm_add_pd(acc_1, _mm_mul_pd(_mm_loadu_pd(a + i + 2),
+                                             _mm_loadu_pd(b + i + 2)));
+        acc_2 = _mm_add_pd(acc_2, _mm_mul_pd(_mm_loadu_pd(a + i + 4),
+                                             _mm_loadu_pd(b + i + 4)));
+        acc_3 = _mm_add_pd(acc_3, _mm_mul_pd(_mm_loadu_pd(a + i + 6),
+                                             _mm_loadu_pd(b + i + 6)));
+    }
+    sum = S_hsum_pd(_mm_add_pd(_mm_add_pd(acc_0, acc_1),
+                               _mm_add_pd(acc_2, acc_3)));
+#else
+    double acc[4] = { 0.0, 0.0, 0.0, 0.0 };
+    for (; i + 4 <= size; i += 4) {
+        for (size_t j = 0; j < 4; j++) { acc[j] += a[i+j] * b[i+j]; }
+    }
+    sum = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    for (; i < size; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static double
+S_min_max_f64(const double *data, size_t size, bool want_max) {
+    size_t i    = 0;
+    double best = data[0];
+#ifdef CFISH_NUMARR_SSE2
+    if (size >= 4) {
+        __m128d acc_0 = _mm_set1_pd(best);
+        __m128d acc_1 = acc_0;
+        for (; i + 4 <= size; i += 4) {
+            __m128d value_0 = _mm_loadu_pd(data + i);
+            __m128d value_1 = _mm_loadu_pd(data + i + 2);
+            if (want_max) {
+                acc_0 = _mm_max_pd(acc_0, value_0);
+                acc_1 = _mm_max_pd(acc_1, value_1);
+            }
+            else {
+                acc_0 = _mm_min_pd(acc_0, value_0);
+                acc_1 = _mm_min_pd(acc_1, value_1);
+            }
+        }
+        double lanes[2];
+        _mm_storeu_pd(lanes, want_max ? _mm_max_pd(acc_0, acc_1)
+                                      : _mm_min_pd(acc_0, acc_1));
+        for (size_t j = 0; j < 2; j++) {
+            if (want_max ? lanes[j] > best : lanes[j] < best) {
+                best = lanes[j];
+            }
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        if (want_max ? data[i] > best : data[i] < best) { best = data[i]; }
+    }
+    return best;
+}
+
+/* Kernels for comparing elements.  Floating point numbers are compared by
+ * value rather than by bits: 0.0 equals -0.0, NaN equals nothing.
+ */
+
+static bool
+S_equals_i32(const int32_t *a, const int32_t *b, size_t size) {
+    return memcmp(a, b, size * sizeof(int32_t)) == 0;
+}
+
+static bool
+S_equals_i64(const int64_t *a, const int64_t *b, size_t size) {
+    return memcmp(a, b, size * sizeof(int64_t)) == 0;
+}
+
+static bool
+S_equals_f32(const float *a, const float *b, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (a[i] != b[i]) { return false; }
+    }
+    return true;
+}
+
+static bool
+S_equals_f64(const double *a, const double *b, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (a[i] != b[i]) { return false; }
+    }
+    return true;
+}
+
+/******************************** Digest ***********************************/
+
+// Integer arrays are equal if their bytes are equal, so the bytes are
+// digested in one go.
+
+static void
+S_digest_i32(uint64_t *digest, const int32_t *elems, size_t size) {
+    Hashing_digest_bytes(digest, HASHING_DIGEST_I32ARRAY, elems,
+                         size * sizeof(int32_t));
+}
+
+static void
+S_digest_i64(uint64_t *digest, const int64_t *elems, size_t size) {
+    Hashing_digest_bytes(digest, HASHING_DIGEST_I64ARRAY, elems,
+                         size * sizeof(int64_t));
+}
+
+// Floats are compared by value, so -0.0 is digested like 0.0.  NaNs never
+// compare equal and need no special treatment.
+
+static void
+S_digest_f32(uint64_t *digest, const float *elems, size_t size) {
+    Hashing_digest_init(digest, HASHING_DIGEST_F32ARRAY);
+    Hashing_digest_mix(digest, (uint64_t)size);
+    for (size_t i = 0; i < size; i++) {
+        float    value = elems[i] == 0.0f ? 0.0f : elems[i];
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        Hashing_digest_mix(digest, bits);
+    }
+}
+
+static void
+S_digest_f64(uint64_t *digest, const double *elems, size_t size) {
+    Hashing_digest_init(digest, HASHING_DIGEST_F64ARRAY);
+    Hashing_digest_mix(digest, (uint64_t)size);
+    for (size_t i = 0; i < size; i++) {
+        double   value = elems[i] == 0.0 ? 0.0 : elems[i];
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        Hashing_digest_mix(digest, bits);
+    }
+}
+
+/****************************** Typed arrays *******************************/
+
+/* Define the methods of a typed array class.
+ *
+ * ARRAY    - the struct name, e.g. I32Array.
+ * PREFIX   - the short name prefix of its methods, e.g. I32Arr.
+ * KLASS    - its Class, e.g. I32ARRAY.
+ * TYPE     - the element type.
+ * SUM_TYPE - the return type of Sum and Dot.
+ * SUFFIX   - the suffix of the kernels for TYPE, e.g. i32.
+ */
+#define NUMARR_DEFINE_TYPED_ARRAY(ARRAY, PREFIX, KLASS, TYPE, SUM_TYPE, \
+                                  SUFFIX) \
+    ARRAY* \
+    PREFIX##_new(size_t capacity) { \
+        ARRAY *self = (ARRAY*)Class_Make_Obj(KLASS); \
+        return PREFIX##_init(self, capacity); \
+    } \
+    \
+    ARRAY* \
+    PREFIX##_init(ARRAY *self, size_t capacity) { \
+        NumArr_init((NumArray*)self, sizeof(TYPE), capacity); \
+        return self; \
+    } \
+    \
+    void \
+    PREFIX##_Push_IMP(ARRAY *self, TYPE value) { \
+        *(TYPE*)SI_push_slot((NumArray*)self) = value; \
+    } \
+    \
+    TYPE \
+    PREFIX##_Fetch_IMP(ARRAY *self, size_t tick) { \
+        SI_check_tick((NumArray*)self, tick); \
+        return ((TYPE*)self->elems)[tick]; \
+    } \
+    \
+    void \
+    PREFIX##_Store_IMP(ARRAY *self, size_t tick, TYPE value) { \
+        *(TYPE*)SI_store_slot((NumArray*)self, tick) = value; \
+    } \
+    \
+    TYPE* \
+    PREFIX##_Get_Data_IMP(ARRAY *self) { \
+        return (TYPE*)self->elems; \
+    } \
+    \
+    SUM_TYPE \
+    PREFIX##_Sum_IMP(ARRAY *self) { \
+        return S_sum_##SUFFIX((TYPE*)self->elems, self->size); \
+    } \
+    \
+    TYPE \
+    PREFIX##_Min_IMP(ARRAY *self) { \
+        SI_check_not_empty((NumArray*)self); \
+        return S_min_max_##SUFFIX((TYPE*)self->elems, self->size, false); \
+    } \
+    \
+    TYPE \
+    PREFIX##_Max_IMP(ARRAY *self) { \
+        SI_check_not_empty((NumArray*)self); \
+        return S_min_max_##SUFFIX((TYPE*)self->elems, self->size, true); \
+    } \
+    \
+    SUM_TYPE \
+    PREFIX##_Dot_IMP(ARRAY *self, ARRAY *other) { \
+        SI_check_same_size((NumArray*)self, (NumArray*)other); \
+        return S_dot_##SUFFIX((TYPE*)self->elems, (TYPE*)other->elems, \
+                              self->size); \
+    } \
+    \
+    bool \
+    PREFIX##_Equals_IMP(ARRAY *self, Obj *other) { \
+        if ((ARRAY*)other == self) { return true; } \
+        if (!S_equals_header((NumArray*)self, other, KLASS)) { \
+            return false; \
+        } \
+        return S_equals_##SUFFIX((TYPE*)self->elems, \
+                                 (TYPE*)((ARRAY*)other)->elems, self->size); \
+    } \
+    \
+    void \
+    PREFIX##_Digest_IMP(ARRAY *self, uint64_t *digest) { \
+        S_digest_##SUFFIX(digest, (TYPE*)self->elems, self->size); \
+    } \
+    \
+    ARRAY* \
+    PREFIX##_Clone_IMP(ARRAY *self) { \
+        ARRAY *twin = PREFIX##_new(self->size); \
+        memcpy(twin->elems, self->elems, self->size * sizeof(TYPE)); \
+        twin->size = self->size; \
+        return twin; \
+    }
+
+NUMARR_DEFINE_TYPED_ARRAY(I32Array, I32Arr, I32ARRAY, int32_t, int64_t, i32)
+NUMARR_DEFINE_TYPED_ARRAY(I64Array, I64Arr, I64ARRAY, int64_t, int64_t, i64)
+NUMARR_DEFINE_TYPED_ARRAY(F32Array, F32Arr, F32ARRAY, float, float, f32)
+NUMARR_DEFINE_TYPED_ARRAY(F64Array, F64Arr, F64ARRAY, double, double, f64)
+
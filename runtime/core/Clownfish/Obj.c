@@ -16,6 +16,7 @@
 
 #define C_CFISH_OBJ
 #define C_CFISH_CLASS
+#define C_CFISH_STRING
 #define CFISH_USE_SHORT_NAMES
 
 #include "charmony.h"
@@ -25,24 +26,26 @@
 #include <string.h>
 
 #include "Clownfish/Obj.h"
+#include "Clownfish/CharBuf.h"
 #include "Clownfish/String.h"
 #include "Clownfish/Err.h"
 #include "Clownfish/Hash.h"
+#include "Clownfish/HashIterator.h"
 #include "Clownfish/Class.h"
+#include "Clownfish/InStream.h"
+#include "Clownfish/OutStream.h"
+#include "Clownfish/PtrHash.h"
+#include "Clownfish/Serializer.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Hashing.h"
 #include "Clownfish/Util/Memory.h"
 
 static CFISH_INLINE bool
 SI_obj_is_a(Obj *obj, Class *ancestor) {
-    Class *klass = obj->klass;
-
-    while (klass != NULL) {
-        if (klass == ancestor) {
-            return true;
-        }
-        klass = klass->parent;
-    }
-
-    return false;
+    // See the display tables in Class.c.
+    Class    *klass = obj->klass;
+    uint32_t  depth = ancestor->depth;
+    return depth <= klass->depth && klass->display[depth] == ancestor;
 }
 
 Obj*
@@ -90,6 +93,11 @@ Obj_Equals_IMP(Obj *self, Obj *other) {
     return (self == other);
 }
 
+void
+Obj_Digest_IMP(Obj *self, uint64_t *digest) {
+    Hashing_digest_u64(digest, HASHING_DIGEST_OBJ, (uint64_t)(uintptr_t)self);
+}
+
 String*
 Obj_To_String_IMP(Obj *self) {
 #if (CHY_SIZEOF_PTR == 4)
@@ -106,6 +114,156 @@ Obj_To_String_IMP(Obj *self) {
 #endif
 }
 
+void
+Obj_Cat_To_IMP(Obj *self, CharBuf *buf) {
+    String *string = Obj_To_String(self);
+    CB_Cat(buf, string);
+    DECREF(string);
+}
+
+// State of a serialization run, kept outside of Err_trap so that the
+// (de)serializer can be released if an error is thrown.
+typedef struct {
+    Serializer   *serializer;
+    Deserializer *deserializer;
+    Obj          *obj;
+} SerializeContext;
+
+static void
+S_do_serialize(void *vcontext) {
+    SerializeContext *context = (SerializeContext*)vcontext;
+    Serializer_Write(context->serializer, context->obj);
+}
+
+static void
+S_do_deserialize(void *vcontext) {
+    SerializeContext *context = (SerializeContext*)vcontext;
+    context->obj = Deserializer_Read(context->deserializer);
+}
+
+void
+Obj_Serialize_IMP(Obj *self, OutStream *outstream) {
+    SerializeContext context;
+    context.serializer   = Serializer_new(outstream);
+    context.deserializer = NULL;
+    context.obj          = self;
+
+    Err *error = Err_trap(S_do_serialize, &context);
+    DECREF(context.serializer);
+    if (error) {
+        RETHROW(error);
+    }
+}
+
+Obj*
+Obj_deserialize(InStream *instream) {
+    SerializeContext context;
+    context.serializer   = NULL;
+    context.deserializer = Deserializer_new(instream);
+    context.obj          = NULL;
+
+    Err *error = Err_trap(S_do_deserialize, &context);
+    DECREF(context.deserializer);
+    if (error) {
+        RETHROW(error);
+    }
+
+    return context.obj;
+}
+
+// Objects which have been frozen but whose members haven't been visited
+// yet.
+typedef struct {
+    Obj    **objs;
+    size_t   size;
+    size_t   cap;
+} FreezeStack;
+
+// Return true for objects whose members are followed by Freeze_Graph.
+static bool
+S_has_members(Obj *obj) {
+    if (SI_obj_is_a(obj, STRING)) {
+        // Substrings share the buffer of their origin.  Immortal String
+        // constants store a marker in place of the origin.
+        String *origin = ((String*)obj)->origin;
+        return origin != NULL
+               && origin != (String*)obj
+               && !Str_is_immortal((String*)obj);
+    }
+    return SI_obj_is_a(obj, VECTOR) || SI_obj_is_a(obj, HASH);
+}
+
+static void
+S_freeze(Obj *obj, PtrHash *seen, FreezeStack *stack) {
+    if (obj == NULL || PtrHash_Fetch(seen, obj) != NULL) { return; }
+    bool has_members = S_has_members(obj);
+    if (cfish_is_immortal(obj)) {
+        // Containers made immortal with `cfish_make_immortal` may still
+        // hold mortal members, so they are walked as well.
+        if (!has_members) { return; }
+    }
+    else {
+        cfish_make_immortal(obj);
+    }
+    if (has_members || !cfish_is_immortal(obj)) {
+        // Remember containers so that cycles are only walked once.  Some
+        // hosts can't tell whether an object which has a host wrapper was
+        // made immortal, so remember those as well.
+        PtrHash_Store(seen, obj, obj);
+    }
+
+    if (stack->size == stack->cap) {
+        stack->cap  = stack->cap * 2;
+        stack->objs = (Obj**)REALLOCATE(stack->objs,
+                                        stack->cap * sizeof(Obj*));
+    }
+    stack->objs[stack->size++] = obj;
+}
+
+void
+Obj_Freeze_Graph_IMP(Obj *self) {
+    PtrHash     *seen  = PtrHash_new(0);
+    FreezeStack  stack;
+    stack.size = 0;
+    stack.cap  = 64;
+    stack.objs = (Obj**)MALLOCATE(stack.cap * sizeof(Obj*));
+
+    // Walk the graph depth-first with an explicit stack, so that deeply
+    // nested data can't overflow the C stack.
+    S_freeze(self, seen, &stack);
+    while (stack.size > 0) {
+        Obj *obj = stack.objs[--stack.size];
+
+        if (SI_obj_is_a(obj, STRING)) {
+            // Substrings share the buffer of their origin, which gets
+            // INCREFed whenever a new substring is created.
+            // Immortal Strings with a marker origin never get here.
+            String *origin = ((String*)obj)->origin;
+            if (origin != NULL && origin != (String*)obj) {
+                S_freeze((Obj*)origin, seen, &stack);
+            }
+        }
+        else if (SI_obj_is_a(obj, VECTOR)) {
+            Vector *vector = (Vector*)obj;
+            size_t  size   = Vec_Get_Size(vector);
+            for (size_t i = 0; i < size; i++) {
+                S_freeze(Vec_Fetch(vector, i), seen, &stack);
+            }
+        }
+        else if (SI_obj_is_a(obj, HASH)) {
+            HashIterator *iter = HashIter_new((Hash*)obj);
+            while (HashIter_Next(iter)) {
+                S_freeze((Obj*)HashIter_Get_Key(iter), seen, &stack);
+                S_freeze(HashIter_Get_Value(iter), seen, &stack);
+            }
+            DECREF(iter);
+        }
+    }
+
+    FREEMEM(stack.objs);
+    PtrHash_Destroy(seen);
+}
+
 Class*
 Obj_get_class(Obj *self) {
     return self->klass;
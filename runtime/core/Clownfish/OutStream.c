@@ -0,0 +1,422 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define C_CFISH_OUTSTREAM
+#define CFISH_USE_SHORT_NAMES
+
+#include "charmony.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(CHY_HAS_UNISTD_H)
+  #include <fcntl.h>
+  #include <sys/types.h>
+  #include <sys/uio.h>
+  #include <unistd.h>
+#elif defined(CHY_HAS_WINDOWS_H)
+  #include <fcntl.h>
+  #include <io.h>
+  #include <sys/stat.h>
+#endif
+
+#include "Clownfish/OutStream.h"
+#include "Clownfish/Blob.h"
+#include "Clownfish/ByteBuf.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Util/Memory.h"
+
+#define OUTSTREAM_BUF_SIZE 65536
+
+// Make room for `size` bytes in the buffer.
+static CFISH_INLINE char*
+SI_reserve(OutStream *self, size_t size);
+
+// Write the buffered data followed by `len` bytes from `bytes`.
+static void
+S_write_through(OutStream *self, const void *bytes, size_t len);
+
+// Platform-specific file access.
+static int
+S_open_fd(const char *path);
+
+static int64_t
+S_seek_fd(int fd);
+
+// Write two buffers, retrying after partial writes.  Return false on
+// error.
+static bool
+S_write_fd(int fd, const char *buf1, size_t len1, const char *buf2,
+           size_t len2);
+
+static void
+S_close_fd(int fd);
+
+OutStream*
+OutStream_open(String *path) {
+    OutStream *self = (OutStream*)Class_Make_Obj(OUTSTREAM);
+    return OutStream_do_open(self, path);
+}
+
+OutStream*
+OutStream_do_open(OutStream *self, String *path) {
+    char *path_c = Str_To_Utf8(path);
+    int   fd     = S_open_fd(path_c);
+    FREEMEM(path_c);
+    if (fd < 0) {
+        THROW(ERR, "Can't open '%o': %s", path, strerror(errno));
+    }
+    return OutStream_init_fd(self, fd, true);
+}
+
+OutStream*
+OutStream_new_fd(int fd, bool close_fd) {
+    OutStream *self = (OutStream*)Class_Make_Obj(OUTSTREAM);
+    return OutStream_init_fd(self, fd, close_fd);
+}
+
+OutStream*
+OutStream_init_fd(OutStream *self, int fd, bool close_fd) {
+    int64_t pos = S_seek_fd(fd);
+
+    self->buf      = (char*)MALLOCATE(OUTSTREAM_BUF_SIZE);
+    self->buf_size = 0;
+    self->buf_cap  = OUTSTREAM_BUF_SIZE;
+    // Pipes and sockets can't report their position.
+    self->buf_pos  = pos < 0 ? 0 : pos;
+    self->bytebuf  = NULL;
+    self->fd       = fd;
+    self->owns_fd  = close_fd;
+
+    return self;
+}
+
+OutStream*
+OutStream_new_bytebuf(ByteBuf *bytebuf) {
+    OutStream *self = (OutStream*)Class_Make_Obj(OUTSTREAM);
+    return OutStream_init_bytebuf(self, bytebuf);
+}
+
+OutStream*
+OutStream_init_bytebuf(OutStream *self, ByteBuf *bytebuf) {
+    self->buf      = (char*)MALLOCATE(OUTSTREAM_BUF_SIZE);
+    self->buf_size = 0;
+    self->buf_cap  = OUTSTREAM_BUF_SIZE;
+    self->buf_pos  = (int64_t)BB_Get_Size(bytebuf);
+    self->bytebuf  = (ByteBuf*)INCREF(bytebuf);
+    self->fd       = -1;
+    self->owns_fd  = false;
+
+    return self;
+}
+
+void
+OutStream_Close_IMP(OutStream *self) {
+    if (self->buf == NULL) { return; }
+
+    OutStream_Flush_IMP(self);
+    if (self->owns_fd && self->fd >= 0) {
+        S_close_fd(self->fd);
+    }
+    self->fd      = -1;
+    self->owns_fd = false;
+    DECREF(self->bytebuf);
+    self->bytebuf = NULL;
+    FREEMEM(self->buf);
+    self->buf     = NULL;
+    self->buf_cap = 0;
+}
+
+void
+OutStream_Destroy_IMP(OutStream *self) {
+    OutStream_Close_IMP(self);
+    SUPER_DESTROY(self, OUTSTREAM);
+}
+
+/***************************************************************************/
+
+static CFISH_INLINE char*
+SI_reserve(OutStream *self, size_t size) {
+    if (self->buf_cap - self->buf_size < size) {
+        S_write_through(self, NULL, 0);
+    }
+    return self->buf + self->buf_size;
+}
+
+static void
+S_write_through(OutStream *self, const void *bytes, size_t len) {
+    if (self->buf == NULL) {
+        THROW(ERR, "Can't write to closed OutStream");
+    }
+
+    size_t buffered = self->buf_size;
+    if (self->bytebuf) {
+        BB_Cat_Bytes(self->bytebuf, self->buf, buffered);
+        BB_Cat_Bytes(self->bytebuf, bytes, len);
+    }
+    else if (!S_write_fd(self->fd, self->buf, buffered, (const char*)bytes,
+                         len)) {
+        THROW(ERR, "Error writing OutStream: %s", strerror(errno));
+    }
+
+    self->buf_pos  += (int64_t)(buffered + len);
+    self->buf_size  = 0;
+}
+
+void
+OutStream_Write_U8_IMP(OutStream *self, uint8_t value) {
+    char *dest = SI_reserve(self, 1);
+    dest[0] = (char)value;
+    self->buf_size += 1;
+}
+
+void
+OutStream_Write_U16_IMP(OutStream *self, uint16_t value) {
+    uint8_t *dest = (uint8_t*)SI_reserve(self, 2);
+    dest[0] = (uint8_t)(value >> 8);
+    dest[1] = (uint8_t)value;
+    self->buf_size += 2;
+}
+
+void
+OutStream_Write_U16_LE_IMP(OutStream *self, uint16_t value) {
+    uint8_t *dest = (uint8_t*)SI_reserve(self, 2);
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+    self->buf_size += 2;
+}
+
+void
+OutStream_Write_U32_IMP(OutStream *self, uint32_t value) {
+    uint8_t *dest = (uint8_t*)SI_reserve(self, 4);
+    dest[0] = (uint8_t)(value >> 24);
+    dest[1] = (uint8_t)(value >> 16);
+    dest[2] = (uint8_t)(value >> 8);
+    dest[3] = (uint8_t)value;
+    self->buf_size += 4;
+}
+
+void
+OutStream_Write_U32_LE_IMP(OutStream *self, uint32_t value) {
+    uint8_t *dest = (uint8_t*)SI_reserve(self, 4);
+    dest[0] = (uint8_t)value;
+    dest[1] = (uint8_t)(value >> 8);
+    dest[2] = (uint8_t)(value >> 16);
+    dest[3] = (uint8_t)(value >> 24);
+    self->buf_size += 4;
+}
+
+void
+OutStream_Write_U64_IMP(OutStream *self, uint64_t value) {
+    uint8_t *dest = (uint8_t*)SI_reserve(self, 8);
+    for (int i = 7; i >= 0; i--) {
+        dest[i] = (uint8_t)value;
+        value >>= 8;
+    }
+    self->buf_size += 8;
+}
+
+void
+OutStream_Write_U64_LE_IMP(OutStream *self, uint64_t value) {
+    uint8_t *dest = (uint8_t*)SI_reserve(self, 8);
+    for (int i = 0; i < 8; i++) {
+        dest[i] = (uint8_t)value;
+        value >>= 8;
+    }
+    self->buf_size += 8;
+}
+
+void
+OutStream_Write_I32_IMP(OutStream *self, int32_t value) {
+    OutStream_Write_U32_IMP(self, (uint32_t)value);
+}
+
+void
+OutStream_Write_I64_IMP(OutStream *self, int64_t value) {
+    OutStream_Write_U64_IMP(self, (uint64_t)value);
+}
+
+void
+OutStream_Write_F32_IMP(OutStream *self, float value) {
+    union { uint32_t u; float f; } bits;
+    bits.f = value;
+    OutStream_Write_U32_IMP(self, bits.u);
+}
+
+void
+OutStream_Write_F64_IMP(OutStream *self, double value) {
+    union { uint64_t u; double d; } bits;
+    bits.d = value;
+    OutStream_Write_U64_IMP(self, bits.u);
+}
+
+void
+OutStream_Write_C32_IMP(OutStream *self, uint32_t value) {
+    uint8_t *dest  = (uint8_t*)SI_reserve(self, 5);
+    uint8_t *start = dest;
+    while (value >= 0x80) {
+        *dest++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *dest++ = (uint8_t)value;
+    self->buf_size += (size_t)(dest - start);
+}
+
+void
+OutStream_Write_C64_IMP(OutStream *self, uint64_t value) {
+    uint8_t *dest  = (uint8_t*)SI_reserve(self, 10);
+    uint8_t *start = dest;
+    while (value >= 0x80) {
+        *dest++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *dest++ = (uint8_t)value;
+    self->buf_size += (size_t)(dest - start);
+}
+
+void
+OutStream_Write_Bytes_IMP(OutStream *self, const void *bytes, size_t len) {
+    if (len <= self->buf_cap - self->buf_size) {
+        memcpy(self->buf + self->buf_size, bytes, len);
+        self->buf_size += len;
+    }
+    else {
+        // Hand the buffer and the new bytes to the OS in a single call.
+        S_write_through(self, bytes, len);
+    }
+}
+
+void
+OutStream_Write_Blob_IMP(OutStream *self, Blob *blob) {
+    OutStream_Write_Bytes_IMP(self, Blob_Get_Buf(blob), Blob_Get_Size(blob));
+}
+
+int64_t
+OutStream_Tell_IMP(OutStream *self) {
+    return self->buf_pos + (int64_t)self->buf_size;
+}
+
+void
+OutStream_Flush_IMP(OutStream *self) {
+    if (self->buf_size > 0) {
+        S_write_through(self, NULL, 0);
+    }
+}
+
+/***************************************************************************/
+
+#if defined(CHY_HAS_UNISTD_H)
+
+static int
+S_open_fd(const char *path) {
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+}
+
+static int64_t
+S_seek_fd(int fd) {
+    return (int64_t)lseek(fd, 0, SEEK_CUR);
+}
+
+static bool
+S_write_fd(int fd, const char *buf1, size_t len1, const char *buf2,
+           size_t len2) {
+    struct iovec iov[2];
+    int          num_iov = 0;
+
+    if (len1 > 0) {
+        iov[num_iov].iov_base = (void*)buf1;
+        iov[num_iov].iov_len  = len1;
+        num_iov++;
+    }
+    if (len2 > 0) {
+        iov[num_iov].iov_base = (void*)buf2;
+        iov[num_iov].iov_len  = len2;
+        num_iov++;
+    }
+
+    struct iovec *vec = iov;
+    while (num_iov > 0) {
+        ssize_t written = writev(fd, vec, num_iov);
+        if (written < 0) {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+
+        // Skip past what was written after a partial write.
+        size_t remaining = (size_t)written;
+        while (num_iov > 0 && remaining >= vec->iov_len) {
+            remaining -= vec->iov_len;
+            vec++;
+            num_iov--;
+        }
+        if (num_iov > 0) {
+            vec->iov_base = (char*)vec->iov_base + remaining;
+            vec->iov_len -= remaining;
+        }
+    }
+
+    return true;
+}
+
+static void
+S_close_fd(int fd) {
+    close(fd);
+}
+
+#elif defined(CHY_HAS_WINDOWS_H)
+
+static int
+S_open_fd(const char *path) {
+    return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                 _S_IREAD | _S_IWRITE);
+}
+
+static int64_t
+S_seek_fd(int fd) {
+    return _lseeki64(fd, 0, SEEK_CUR);
+}
+
+static bool
+S_write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        unsigned count = len > 0x40000000 ? 0x40000000 : (unsigned)len;
+        int written = _write(fd, buf, count);
+        if (written < 0) { return false; }
+        buf += written;
+        len -= (size_t)written;
+    }
+    return true;
+}
+
+// Windows has no writev for file descriptors.
+static bool
+S_write_fd(int fd, const char *buf1, size_t len1, const char *buf2,
+           size_t len2) {
+    return S_write_all(fd, buf1, len1) && S_write_all(fd, buf2, len2);
+}
+
+static void
+S_close_fd(int fd) {
+    _close(fd);
+}
+
+#else
+  #error "Need either unistd.h or windows.h"
+#endif
+
@@ -0,0 +1,300 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define C_CFISH_SEGMENTEDVECTOR
+#define CFISH_USE_SHORT_NAMES
+
+#include <string.h>
+
+#include "Clownfish/SegmentedVector.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Hashing.h"
+#include "Clownfish/Util/Memory.h"
+
+// 1024 elements, or 8 KB on 64-bit systems.  Large enough to keep the
+// segment table small, small enough to waste little memory.
+#define SEGMENT_SHIFT 10
+#define SEGMENT_SIZE  ((size_t)1 << SEGMENT_SHIFT)
+#define SEGMENT_MASK  (SEGMENT_SIZE - 1)
+
+#define MAX_NUM_SEGMENTS ((SIZE_MAX >> SEGMENT_SHIFT) / sizeof(Obj*))
+
+static void
+S_add_segments(SegmentedVector *self, size_t min_cap);
+
+static CFISH_INLINE Obj**
+SI_slot(SegmentedVector *self, size_t tick) {
+    return self->segments[tick >> SEGMENT_SHIFT] + (tick & SEGMENT_MASK);
+}
+
+// Set the slots from the current size up to `size` to NULL and update the
+// size.  Assumes sufficient capacity.
+static void
+S_extend_with_nulls(SegmentedVector *self, size_t size) {
+    for (size_t tick = self->size; tick < size; tick++) {
+        *SI_slot(self, tick) = NULL;
+    }
+    self->size = size;
+}
+
+SegmentedVector*
+SegVec_new(size_t capacity) {
+    SegmentedVector *self
+        = (SegmentedVector*)Class_Make_Obj(SEGMENTEDVECTOR);
+    return SegVec_init(self, capacity);
+}
+
+SegmentedVector*
+SegVec_init(SegmentedVector *self, size_t capacity) {
+    self->segments     = NULL;
+    self->num_segments = 0;
+    self->segments_cap = 0;
+    self->size         = 0;
+    if (capacity) { S_add_segments(self, capacity); }
+    return self;
+}
+
+void
+SegVec_Destroy_IMP(SegmentedVector *self) {
+    for (size_t tick = 0; tick < self->size; tick++) {
+        DECREF(*SI_slot(self, tick));
+    }
+    for (size_t i = 0; i < self->num_segments; i++) {
+        FREEMEM(self->segments[i]);
+    }
+    FREEMEM(self->segments);
+    SUPER_DESTROY(self, SEGMENTEDVECTOR);
+}
+
+void
+SegVec_Push_IMP(SegmentedVector *self, Obj *element) {
+    if (self->size >> SEGMENT_SHIFT == self->num_segments) {
+        S_add_segments(self, self->size + 1);
+    }
+    *SI_slot(self, self->size) = element;
+    self->size++;
+}
+
+void
+SegVec_Push_All_IMP(SegmentedVector *self, Vector *other) {
+    size_t other_size = Vec_Get_Size(other);
+    if (other_size > SIZE_MAX - self->size) {
+        THROW(ERR, "SegmentedVector index overflow");
+    }
+    SegVec_Grow(self, self->size + other_size);
+    for (size_t i = 0; i < other_size; i++) {
+        *SI_slot(self, self->size + i) = INCREF(Vec_Fetch(other, i));
+    }
+    self->size += other_size;
+}
+
+Obj*
+SegVec_Pop_IMP(SegmentedVector *self) {
+    if (!self->size) {
+        return NULL;
+    }
+    self->size--;
+    return *SI_slot(self, self->size);
+}
+
+void
+SegVec_Store_IMP(SegmentedVector *self, size_t tick, Obj *elem) {
+    if (tick < self->size) {
+        Obj **slot = SI_slot(self, tick);
+        DECREF(*slot);
+        *slot = elem;
+        return;
+    }
+    if (tick == SIZE_MAX) {
+        THROW(ERR, "SegmentedVector index overflow");
+    }
+    SegVec_Grow(self, tick + 1);
+    S_extend_with_nulls(self, tick);
+    *SI_slot(self, tick) = elem;
+    self->size = tick + 1;
+}
+
+Obj*
+SegVec_Fetch_IMP(SegmentedVector *self, size_t tick) {
+    if (tick >= self->size) {
+        return NULL;
+    }
+    return *SI_slot(self, tick);
+}
+
+Obj**
+SegVec_Fetch_Addr_IMP(SegmentedVector *self, size_t tick) {
+    if (tick >= self->size) {
+        return NULL;
+    }
+    return SI_slot(self, tick);
+}
+
+Obj*
+SegVec_Delete_IMP(SegmentedVector *self, size_t tick) {
+    if (tick >= self->size) {
+        return NULL;
+    }
+    Obj **slot = SI_slot(self, tick);
+    Obj  *elem = *slot;
+    *slot = NULL;
+    return elem;
+}
+
+void
+SegVec_Grow_IMP(SegmentedVector *self, size_t capacity) {
+    if (capacity > self->num_segments << SEGMENT_SHIFT) {
+        S_add_segments(self, capacity);
+    }
+}
+
+void
+SegVec_Resize_IMP(SegmentedVector *self, size_t size) {
+    if (size < self->size) {
+        for (size_t tick = size; tick < self->size; tick++) {
+            DECREF(*SI_slot(self, tick));
+        }
+        self->size = size;
+    }
+    else if (size > self->size) {
+        SegVec_Grow(self, size);
+        S_extend_with_nulls(self, size);
+    }
+}
+
+void
+SegVec_Clear_IMP(SegmentedVector *self) {
+    SegVec_Resize(self, 0);
+}
+
+size_t
+SegVec_Get_Size_IMP(SegmentedVector *self) {
+    return self->size;
+}
+
+size_t
+SegVec_Get_Capacity_IMP(SegmentedVector *self) {
+    return self->num_segments << SEGMENT_SHIFT;
+}
+
+Vector*
+SegVec_Slice_IMP(SegmentedVector *self, size_t offset, size_t length) {
+    // Adjust ranges if necessary.
+    if (offset >= self->size) {
+        offset = 0;
+        length = 0;
+    }
+    else if (length > self->size - offset) {
+        length = self->size - offset;
+    }
+
+    Vector *slice = Vec_new(length);
+    for (size_t i = 0; i < length; i++) {
+        Vec_Push(slice, INCREF(*SI_slot(self, offset + i)));
+    }
+
+    return slice;
+}
+
+bool
+SegVec_Equals_IMP(SegmentedVector *self, Obj *other) {
+    if ((SegmentedVector*)other == self) { return true; }
+
+    SegmentedVector *twin = NULL;
+    Vector          *vec  = NULL;
+    size_t           other_size;
+    if (Obj_is_a(other, SEGMENTEDVECTOR)) {
+        twin       = (SegmentedVector*)other;
+        other_size = twin->size;
+    }
+    else if (Obj_is_a(other, VECTOR)) {
+        vec        = (Vector*)other;
+        other_size = Vec_Get_Size(vec);
+    }
+    else {
+        return false;
+    }
+    if (other_size != self->size) { return false; }
+
+    for (size_t tick = 0; tick < self->size; tick++) {
+        Obj *val       = *SI_slot(self, tick);
+        Obj *other_val = twin ? *SI_slot(twin, tick) : Vec_Fetch(vec, tick);
+        if (val) {
+            if (!other_val || !Obj_Equals(val, other_val)) { return false; }
+        }
+        else if (other_val) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+SegVec_Digest_IMP(SegmentedVector *self, uint64_t *digest) {
+    // Equal Vectors and SegmentedVectors must have the same digest, so
+    // follow Vec_Digest exactly.
+    Hashing_digest_init(digest, HASHING_DIGEST_VECTOR);
+    Hashing_digest_mix(digest, (uint64_t)self->size);
+    for (size_t tick = 0; tick < self->size; tick++) {
+        Obj      *elem = *SI_slot(self, tick);
+        uint64_t  elem_digest[2];
+        if (elem) {
+            Obj_Digest(elem, elem_digest);
+        }
+        else {
+            Hashing_digest_init(elem_digest, HASHING_DIGEST_NULL);
+        }
+        Hashing_digest_mix_digest(digest, elem_digest);
+    }
+}
+
+SegmentedVector*
+SegVec_Clone_IMP(SegmentedVector *self) {
+    SegmentedVector *twin = SegVec_new(self->size);
+    for (size_t tick = 0; tick < self->size; tick++) {
+        *SI_slot(twin, tick) = INCREF(*SI_slot(self, tick));
+    }
+    twin->size = self->size;
+    return twin;
+}
+
+// Allocate segments until the capacity is at least `min_cap`.  Only the
+// segment table is ever reallocated, never the segments.
+static void
+S_add_segments(SegmentedVector *self, size_t min_cap) {
+    size_t num_needed = (min_cap >> SEGMENT_SHIFT)
+                        + ((min_cap & SEGMENT_MASK) ? 1 : 0);
+    if (num_needed > MAX_NUM_SEGMENTS) {
+        THROW(ERR, "SegmentedVector index overflow");
+    }
+
+    if (num_needed > self->segments_cap) {
+        size_t new_cap = Memory_oversize(num_needed, sizeof(Obj**));
+        self->segments = (Obj***)REALLOCATE(self->segments,
+                                            new_cap * sizeof(Obj**));
+        self->segments_cap = new_cap;
+    }
+
+    while (self->num_segments < num_needed) {
+        self->segments[self->num_segments++]
+            = (Obj**)MALLOCATE(SEGMENT_SIZE * sizeof(Obj*));
+    }
+}
+
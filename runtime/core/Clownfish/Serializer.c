@@ -0,0 +1,422 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define C_CFISH_SERIALIZER
+#define C_CFISH_DESERIALIZER
+#define CFISH_USE_SHORT_NAMES
+
+#include "charmony.h"
+
+#include <string.h>
+
+#include "Clownfish/Serializer.h"
+#include "Clownfish/Blob.h"
+#include "Clownfish/Boolean.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/InStream.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/OutStream.h"
+#include "Clownfish/PtrHash.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Memory.h"
+
+static void
+S_write_obj(Serializer *self, Obj *obj);
+
+static void
+S_write_key(Serializer *self, String *key);
+
+static Obj*
+S_read_obj(Deserializer *self);
+
+static String*
+S_read_key(Deserializer *self);
+
+// Set up reading the contents of a Vector or Hash.
+static void
+S_begin_container(Deserializer *self, Obj *container, uint8_t tag);
+
+static void
+S_end_container(Deserializer *self);
+
+// Read a length or count and check it against the rest of the stream,
+// assuming that each item takes up at least `min_item_size` bytes.
+static size_t
+S_read_size(Deserializer *self, size_t min_item_size);
+
+// Read and validate UTF-8 string content into the scratch buffer.
+static char*
+S_read_utf8(Deserializer *self, size_t size);
+
+Serializer*
+Serializer_new(OutStream *outstream) {
+    Serializer *self = (Serializer*)Class_Make_Obj(SERIALIZER);
+    return Serializer_init(self, outstream);
+}
+
+Serializer*
+Serializer_init(Serializer *self, OutStream *outstream) {
+    self->outstream = (OutStream*)INCREF(outstream);
+    self->objs      = Vec_new(0);
+    self->seen      = PtrHash_new(0);
+    self->key_nums  = Hash_new(0);
+    self->num_keys  = 0;
+    self->depth     = 0;
+    return self;
+}
+
+void
+Serializer_Destroy_IMP(Serializer *self) {
+    DECREF(self->outstream);
+    DECREF(self->objs);
+    PtrHash_Destroy((PtrHash*)self->seen);
+    DECREF(self->key_nums);
+    SUPER_DESTROY(self, SERIALIZER);
+}
+
+void
+Serializer_Write_IMP(Serializer *self, Obj *obj) {
+    self->depth = 0;
+    S_write_obj(self, obj);
+}
+
+static void
+S_write_obj(Serializer *self, Obj *obj) {
+    OutStream *outstream = self->outstream;
+
+    if (obj == NULL) {
+        OutStream_Write_U8(outstream, SER_NULL);
+        return;
+    }
+
+    // Scalars are written by value.
+    Class *klass = Obj_get_class(obj);
+    if (klass == INTEGER) {
+        int64_t value = Int_Get_Value((Integer*)obj);
+        // Zigzag encoding keeps small negative numbers short.
+        uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+        OutStream_Write_U8(outstream, SER_INTEGER);
+        OutStream_Write_C64(outstream, zigzag);
+        return;
+    }
+    if (klass == FLOAT) {
+        OutStream_Write_U8(outstream, SER_FLOAT);
+        OutStream_Write_F64(outstream, Float_Get_Value((Float*)obj));
+        return;
+    }
+    if (klass == BOOLEAN) {
+        OutStream_Write_U8(outstream, Bool_Get_Value((Boolean*)obj)
+                                      ? SER_TRUE : SER_FALSE);
+        return;
+    }
+
+    uint8_t tag;
+    if (Obj_is_a(obj, STRING))      { tag = SER_STRING; }
+    else if (Obj_is_a(obj, BLOB))   { tag = SER_BLOB; }
+    else if (Obj_is_a(obj, VECTOR)) { tag = SER_VECTOR; }
+    else if (Obj_is_a(obj, HASH))   { tag = SER_HASH; }
+    else {
+        THROW(ERR, "Can't serialize object of class %o",
+              Obj_get_class_name(obj));
+        return; // unreachable
+    }
+
+    // An object referenced only once can't show up again, except for the
+    // root which the caller might pass to another call to Write.
+    if (self->depth == 0 || cfish_get_refcount(obj) > 1) {
+        // Refer back to objects which were already written.
+        PtrHash   *seen = (PtrHash*)self->seen;
+        uintptr_t  num  = (uintptr_t)PtrHash_Fetch(seen, obj);
+        if (num) {
+            OutStream_Write_U8(outstream, SER_BACKREF);
+            OutStream_Write_C32(outstream, (uint32_t)(num - 1));
+            return;
+        }
+        // Hold a reference so that the address can't be reused by another
+        // object while the Serializer is alive.
+        Vec_Push(self->objs, INCREF(obj));
+        PtrHash_Store(seen, obj, (void*)(uintptr_t)Vec_Get_Size(self->objs));
+        tag |= SER_SHARED;
+    }
+
+    OutStream_Write_U8(outstream, tag);
+    switch (tag & ~SER_SHARED) {
+        case SER_STRING: {
+            String *string = (String*)obj;
+            size_t  size   = Str_Get_Size(string);
+            OutStream_Write_C64(outstream, size);
+            OutStream_Write_Bytes(outstream, Str_Get_Ptr8(string), size);
+            break;
+        }
+        case SER_BLOB:
+            OutStream_Write_C64(outstream, Blob_Get_Size((Blob*)obj));
+            OutStream_Write_Blob(outstream, (Blob*)obj);
+            break;
+        case SER_VECTOR: {
+            Vector *vector = (Vector*)obj;
+            size_t  size   = Vec_Get_Size(vector);
+            if (++self->depth > SER_MAX_DEPTH) {
+                THROW(ERR, "Can't serialize: nesting too deep");
+            }
+            OutStream_Write_C64(outstream, size);
+            for (size_t i = 0; i < size; i++) {
+                S_write_obj(self, Vec_Fetch(vector, i));
+            }
+            self->depth--;
+            break;
+        }
+        case SER_HASH: {
+            Hash *hash = (Hash*)obj;
+            if (++self->depth > SER_MAX_DEPTH) {
+                THROW(ERR, "Can't serialize: nesting too deep");
+            }
+            OutStream_Write_C64(outstream, Hash_Get_Size(hash));
+            HashIterator *iter = HashIter_new(hash);
+            while (HashIter_Next(iter)) {
+                S_write_key(self, HashIter_Get_Key(iter));
+                S_write_obj(self, HashIter_Get_Value(iter));
+            }
+            DECREF(iter);
+            self->depth--;
+            break;
+        }
+    }
+}
+
+static void
+S_write_key(Serializer *self, String *key) {
+    OutStream *outstream = self->outstream;
+    Integer   *num       = (Integer*)Hash_Fetch(self->key_nums, key);
+
+    // Key numbers are written off by one, with zero announcing a new key.
+    if (num) {
+        OutStream_Write_C32(outstream, (uint32_t)Int_Get_Value(num) + 1);
+        return;
+    }
+    Hash_Store(self->key_nums, key, (Obj*)Int_new(self->num_keys++));
+
+    size_t size = Str_Get_Size(key);
+    OutStream_Write_C32(outstream, 0);
+    OutStream_Write_C64(outstream, size);
+    OutStream_Write_Bytes(outstream, Str_Get_Ptr8(key), size);
+}
+
+/***************************************************************************/
+
+Deserializer*
+Deserializer_new(InStream *instream) {
+    Deserializer *self = (Deserializer*)Class_Make_Obj(DESERIALIZER);
+    return Deserializer_init(self, instream);
+}
+
+Deserializer*
+Deserializer_init(Deserializer *self, InStream *instream) {
+    self->instream    = (InStream*)INCREF(instream);
+    self->objs        = Vec_new(0);
+    self->keys        = Vec_new(0);
+    self->pending     = Vec_new(0);
+    self->scratch     = NULL;
+    self->scratch_cap = 0;
+    self->depth       = 0;
+    return self;
+}
+
+void
+Deserializer_Destroy_IMP(Deserializer *self) {
+    DECREF(self->instream);
+    DECREF(self->objs);
+    DECREF(self->keys);
+    DECREF(self->pending);
+    FREEMEM(self->scratch);
+    SUPER_DESTROY(self, DESERIALIZER);
+}
+
+Obj*
+Deserializer_Read_IMP(Deserializer *self) {
+    // Release containers left over from a failed read.
+    Vec_Clear(self->pending);
+    self->depth = 0;
+    return S_read_obj(self);
+}
+
+static Obj*
+S_read_obj(Deserializer *self) {
+    InStream *instream = self->instream;
+    uint8_t   tag      = InStream_Read_U8(instream);
+
+    switch (tag) {
+        case SER_NULL:
+            return NULL;
+        case SER_FALSE:
+            return (Obj*)INCREF(CFISH_FALSE);
+        case SER_TRUE:
+            return (Obj*)INCREF(CFISH_TRUE);
+        case SER_INTEGER: {
+            uint64_t zigzag = InStream_Read_C64(instream);
+            int64_t  value  = (int64_t)(zigzag >> 1)
+                              ^ -(int64_t)(zigzag & 1);
+            return (Obj*)Int_new(value);
+        }
+        case SER_FLOAT:
+            return (Obj*)Float_new(InStream_Read_F64(instream));
+        case SER_BACKREF: {
+            uint32_t num = InStream_Read_C32(instream);
+            if (num >= Vec_Get_Size(self->objs)) {
+                THROW(ERR, "Invalid object reference %u32", num);
+            }
+            return INCREF(Vec_Fetch(self->objs, num));
+        }
+        case SER_STRING:
+        case SER_STRING | SER_SHARED: {
+            size_t  size   = S_read_size(self, 1);
+            char   *utf8   = S_read_utf8(self, size);
+            String *string = Str_new_from_trusted_utf8(utf8, size);
+            if (tag & SER_SHARED) { Vec_Push(self->objs, INCREF(string)); }
+            return (Obj*)string;
+        }
+        case SER_BLOB:
+        case SER_BLOB | SER_SHARED: {
+            size_t  size = S_read_size(self, 1);
+            Blob   *blob = InStream_Read_Blob(instream, size);
+            if (tag & SER_SHARED) { Vec_Push(self->objs, INCREF(blob)); }
+            return (Obj*)blob;
+        }
+        case SER_VECTOR:
+        case SER_VECTOR | SER_SHARED: {
+            size_t  size   = S_read_size(self, 1);
+            Vector *vector = Vec_new(size < SER_MAX_PREALLOC
+                                     ? size : SER_MAX_PREALLOC);
+            S_begin_container(self, (Obj*)vector, tag);
+            for (size_t i = 0; i < size; i++) {
+                Vec_Push(vector, S_read_obj(self));
+            }
+            S_end_container(self);
+            return (Obj*)vector;
+        }
+        case SER_HASH:
+        case SER_HASH | SER_SHARED: {
+            size_t  size = S_read_size(self, 2);
+            Hash   *hash = Hash_new(size < SER_MAX_PREALLOC
+                                    ? size : SER_MAX_PREALLOC);
+            S_begin_container(self, (Obj*)hash, tag);
+            for (size_t i = 0; i < size; i++) {
+                String *key = S_read_key(self);
+                Hash_Store(hash, key, S_read_obj(self));
+            }
+            S_end_container(self);
+            return (Obj*)hash;
+        }
+        default:
+            THROW(ERR, "Invalid serialization tag %u32", (uint32_t)tag);
+            return NULL; // unreachable
+    }
+}
+
+static void
+S_begin_container(Deserializer *self, Obj *container, uint8_t tag) {
+    // Register shared containers before reading their contents, so that
+    // cyclic references resolve.
+    if (tag & SER_SHARED) {
+        Vec_Push(self->objs, INCREF(container));
+    }
+    // Hand the caller's reference to `pending` while the contents are
+    // read, so that the container is cleaned up if an error is thrown.
+    Vec_Push(self->pending, container);
+    if (++self->depth > SER_MAX_DEPTH) {
+        THROW(ERR, "Can't deserialize: nesting too deep");
+    }
+}
+
+static void
+S_end_container(Deserializer *self) {
+    // Give the reference back to the caller.
+    self->depth--;
+    Vec_Pop(self->pending);
+}
+
+static String*
+S_read_key(Deserializer *self) {
+    uint32_t num = InStream_Read_C32(self->instream);
+
+    if (num == 0) {
+        size_t  size = S_read_size(self, 1);
+        char   *utf8 = S_read_utf8(self, size);
+        String *key  = Str_new_from_trusted_utf8(utf8, size);
+        Vec_Push(self->keys, (Obj*)key);
+        return key;
+    }
+
+    if (num > Vec_Get_Size(self->keys)) {
+        THROW(ERR, "Invalid key reference %u32", num);
+    }
+    return (String*)Vec_Fetch(self->keys, num - 1);
+}
+
+static size_t
+S_read_size(Deserializer *self, size_t min_item_size) {
+    InStream *instream = self->instream;
+    uint64_t  size     = InStream_Read_C64(instream);
+    int64_t   length   = InStream_Length(instream);
+
+    if (length >= 0) {
+        uint64_t remaining = (uint64_t)(length - InStream_Tell(instream));
+        if (size > remaining / min_item_size) {
+            THROW(ERR, "Invalid size %u64 with %u64 bytes left in stream",
+                  size, remaining);
+        }
+    }
+    else if (size > SIZE_MAX / 2) {
+        THROW(ERR, "Invalid size %u64", size);
+    }
+
+    return (size_t)size;
+}
+
+static char*
+S_read_utf8(Deserializer *self, size_t size) {
+    // S_read_size has checked `size` against the rest of the stream if its
+    // length is known.  Otherwise, only grow the scratch buffer as the bytes
+    // arrive, so that a corrupt size fails with an EOF error rather than a
+    // huge allocation.
+    bool   trusted = InStream_Length(self->instream) >= 0;
+    size_t done    = 0;
+    while (done < size) {
+        if (done == self->scratch_cap) {
+            size_t cap = size;
+            if (!trusted) {
+                size_t limit = done > SER_MAX_PREALLOC_BYTES
+                               ? done * 2 : SER_MAX_PREALLOC_BYTES;
+                if (cap > limit) { cap = limit; }
+            }
+            cap = Memory_oversize(cap, sizeof(char));
+            self->scratch     = (char*)REALLOCATE(self->scratch, cap);
+            self->scratch_cap = cap;
+        }
+        size_t end = size < self->scratch_cap ? size : self->scratch_cap;
+        InStream_Read_Bytes(self->instream, self->scratch + done, end - done);
+        done = end;
+    }
+    if (!Str_utf8_valid(self->scratch, size)) {
+        THROW(ERR, "Invalid UTF-8 in serialized string");
+    }
+    return self->scratch;
+}
+
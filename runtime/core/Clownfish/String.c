@@ -29,17 +29,52 @@
 #include "Clownfish/ByteBuf.h"
 #include "Clownfish/CharBuf.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/Hashing.h"
 #include "Clownfish/Util/Memory.h"
 
 #define STACK_ITER(string, byte_offset) \
     S_new_stack_iter(alloca(sizeof(StringIterator)), string, byte_offset)
 
+// Immortal Strings point to this sentinel instead of a real origin.
+static const char IMMORTAL_MARKER = 0;
+#define IMMORTAL_ORIGIN ((String*)&IMMORTAL_MARKER)
+
 static const char*
 S_memmem(String *self, const char *substring, size_t size);
 
 static StringIterator*
 S_new_stack_iter(void *allocation, String *string, size_t byte_offset);
 
+static String*
+S_new_substring(String *string, size_t byte_offset, size_t size);
+
+static size_t
+S_decode_utf8(const uint8_t *ptr, size_t size, int32_t *buffer, size_t max,
+              size_t *num_bytes_ptr);
+
+// Mask selecting the high bit of every byte in a 64-bit word.
+#define HIGH_BITS_64 UINT64_C(0x8080808080808080)
+
+// Return the offset of the first byte after a run of ASCII characters
+// starting at `byte_offset`. The run is scanned a machine word at a time,
+// so up to seven trailing ASCII bytes may remain unskipped. At most
+// `max_bytes` bytes are skipped.
+static CFISH_INLINE size_t
+SI_skip_ascii_words(const uint8_t *ptr, size_t byte_offset, size_t size,
+                    size_t max_bytes) {
+    size_t limit = size - byte_offset < max_bytes
+                   ? size
+                   : byte_offset + max_bytes;
+    while (limit - byte_offset >= 8) {
+        uint64_t word;
+        memcpy(&word, ptr + byte_offset, 8);
+        if (word & HIGH_BITS_64) { break; }
+        byte_offset += 8;
+    }
+    return byte_offset;
+}
+
 // Return a pointer to the first invalid UTF-8 sequence, or NULL if
 // the UTF-8 is valid.
 static const uint8_t*
@@ -276,6 +311,39 @@ Str_new_wrap_trusted_utf8(const char *utf8, size_t size) {
     return Str_init_wrap_trusted_utf8(self, utf8, size);
 }
 
+String*
+Str_new_immortal_trusted_utf8(const char *utf8, size_t size) {
+    String *self = (String*)Class_Make_Obj(STRING);
+    self->ptr    = utf8;
+    self->size   = size;
+    self->origin = IMMORTAL_ORIGIN;
+    return self;
+}
+
+String*
+Str_init_const(StrConst *str_const) {
+    String *string = Str_new_immortal_trusted_utf8(str_const->utf8,
+                                                   str_const->size);
+    if (!Atomic_cas_ptr((void*volatile*)&str_const->string, NULL, string)) {
+        // Another thread beat us to it.
+        Str_discard_immortal(string);
+    }
+    return str_const->string;
+}
+
+bool
+Str_is_immortal(String *string) {
+    return string->origin == IMMORTAL_ORIGIN;
+}
+
+void
+Str_discard_immortal(String *string) {
+    // Turn the String into a plain wrapped String, so that it can be
+    // destroyed.
+    string->origin = NULL;
+    DECREF(string);
+}
+
 String*
 Str_init_stack_string(void *allocation, const char *utf8, size_t size) {
     String *self = (String*)Class_Init_Obj(STRING, allocation);
@@ -290,6 +358,15 @@ Str_init_wrap_trusted_utf8(String *self, const char *ptr, size_t size) {
     return self;
 }
 
+String*
+Str_new_from_byte_range(String *string, size_t byte_offset, size_t size) {
+    if (byte_offset > string->size || size > string->size - byte_offset) {
+        THROW(ERR, "Byte range %u64 + %u64 exceeds string size %u64",
+              (uint64_t)byte_offset, (uint64_t)size, (uint64_t)string->size);
+    }
+    return S_new_substring(string, byte_offset, size);
+}
+
 String*
 Str_new_from_char(int32_t code_point) {
     const size_t MAX_UTF8_BYTES = 4;
@@ -306,7 +383,7 @@ Str_new_from_char(int32_t code_point) {
 
 String*
 Str_newf(const char *pattern, ...) {
-    CharBuf *buf = CB_new(strlen(pattern));
+    CharBuf *buf = CB_new(0);
     va_list args;
     va_start(args, pattern);
     CB_VCatF(buf, pattern, args);
@@ -324,6 +401,12 @@ S_new_substring(String *string, size_t byte_offset, size_t size) {
         // Copy substring of wrapped strings.
         Str_init_from_trusted_utf8(self, string->ptr + byte_offset, size);
     }
+    else if (string->origin == IMMORTAL_ORIGIN) {
+        // Share the buffer of immortal strings without refcounting.
+        self->ptr    = string->ptr + byte_offset;
+        self->size   = size;
+        self->origin = string;
+    }
     else {
         self->ptr    = string->ptr + byte_offset;
         self->size   = size;
@@ -351,16 +434,7 @@ Str_Destroy_IMP(String *self) {
 
 size_t
 Str_Hash_Sum_IMP(String *self) {
-    size_t hashvalue = 5381;
-    StringIterator *iter = STACK_ITER(self, 0);
-
-    const StrIter_Next_t next = METHOD_PTR(STRINGITERATOR, CFISH_StrIter_Next);
-    int32_t code_point;
-    while (STR_OOB != (code_point = next(iter))) {
-        hashvalue = ((hashvalue << 5) + hashvalue) ^ (size_t)code_point;
-    }
-
-    return hashvalue;
+    return (size_t)Hashing_hash_bytes(self->ptr, self->size);
 }
 
 String*
@@ -368,6 +442,11 @@ Str_To_String_IMP(String *self) {
     return (String*)INCREF(self);
 }
 
+void
+Str_Cat_To_IMP(String *self, CharBuf *buf) {
+    CB_Cat(buf, self);
+}
+
 int64_t
 Str_To_I64_IMP(String *self) {
     return Str_BaseX_To_I64(self, 10);
@@ -482,6 +561,12 @@ Str_Equals_IMP(String *self, Obj *other) {
     return Str_Equals_Utf8(self, twin->ptr, twin->size);
 }
 
+void
+Str_Digest_IMP(String *self, uint64_t *digest) {
+    Hashing_digest_bytes(digest, HASHING_DIGEST_STRING, self->ptr,
+                         self->size);
+}
+
 int32_t
 Str_Compare_To_IMP(String *self, Obj *other) {
     String  *twin = (String*)CERTIFY(other, STRING);
@@ -809,6 +894,74 @@ StrIter_Next_IMP(StringIterator *self) {
     return retval;
 }
 
+// Decode up to `max` code points from UTF-8 to UTF-32. Store the number of
+// bytes consumed in `num_bytes_ptr` and return the number of code points.
+// Decoding stops early before a truncated multi-byte sequence at the end of
+// the input.
+static size_t
+S_decode_utf8(const uint8_t *ptr, size_t size, int32_t *buffer, size_t max,
+              size_t *num_bytes_ptr) {
+    size_t byte_offset     = 0;
+    size_t num_code_points = 0;
+
+    while (num_code_points < max && byte_offset < size) {
+        // Widen whole words of ASCII characters at once.
+        size_t ascii_end = SI_skip_ascii_words(ptr, byte_offset, size,
+                                               max - num_code_points);
+        while (byte_offset < ascii_end) {
+            buffer[num_code_points++] = ptr[byte_offset++];
+        }
+        if (num_code_points >= max || byte_offset >= size) { break; }
+
+        size_t  start  = byte_offset;
+        int32_t retval = ptr[byte_offset++];
+
+        if (retval >= 0x80) {
+            // See StrIter_Next_IMP for an explanation of the mask.
+            int32_t mask = 1 << 6;
+
+            do {
+                if (byte_offset >= size) {
+                    *num_bytes_ptr = start;
+                    return num_code_points;
+                }
+
+                retval = (retval << 6) | (ptr[byte_offset++] & 0x3F);
+                mask <<= 5;
+            } while (retval & mask);
+
+            retval &= mask - 1;
+        }
+
+        buffer[num_code_points++] = retval;
+    }
+
+    *num_bytes_ptr = byte_offset;
+    return num_code_points;
+}
+
+size_t
+StrIter_Next_Batch_IMP(StringIterator *self, int32_t *buffer, size_t max) {
+    String *string      = self->string;
+    size_t  byte_offset = self->byte_offset;
+
+    if (byte_offset >= string->size) { return 0; }
+
+    const uint8_t *const ptr = (const uint8_t*)string->ptr + byte_offset;
+    size_t size = string->size - byte_offset;
+    size_t num_bytes;
+    size_t num_code_points = S_decode_utf8(ptr, size, buffer, max,
+                                           &num_bytes);
+
+    if (num_code_points < max && num_bytes < size) {
+        THROW(ERR, "StrIter_Next_Batch: Invalid UTF-8");
+        UNREACHABLE_RETURN(size_t);
+    }
+
+    self->byte_offset = byte_offset + num_bytes;
+    return num_code_points;
+}
+
 int32_t
 StrIter_Prev_IMP(StringIterator *self) {
     size_t byte_offset = self->byte_offset;
@@ -858,7 +1011,12 @@ StrIter_Advance_IMP(StringIterator *self, size_t num) {
     const uint8_t *const ptr = (const uint8_t*)self->string->ptr;
 
     while (num_skipped < num) {
-        if (byte_offset >= size) {
+        // Skip whole words of ASCII characters at once.
+        size_t ascii_end = SI_skip_ascii_words(ptr, byte_offset, size,
+                                               num - num_skipped);
+        num_skipped += ascii_end - byte_offset;
+        byte_offset  = ascii_end;
+        if (num_skipped >= num || byte_offset >= size) {
             break;
         }
         uint8_t first_byte = ptr[byte_offset];
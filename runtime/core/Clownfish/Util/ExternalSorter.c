@@ -0,0 +1,583 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define C_CFISH_EXTERNALSORTER
+#define CFISH_USE_SHORT_NAMES
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "charmony.h"
+
+#ifdef CHY_HAS_UNISTD_H
+  #include <unistd.h>
+#endif
+
+#include "Clownfish/Util/ExternalSorter.h"
+#include "Clownfish/Blob.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Util/Memory.h"
+#include "Clownfish/Util/SortUtils.h"
+
+// Maximum number of runs merged at once.  If there are more runs, groups
+// of runs are merged into larger runs first.
+#define MAX_FAN_IN 64
+
+typedef struct {
+    size_t offset;
+    size_t size;
+} ExtSortRecord;
+
+typedef struct {
+    FILE   *file;
+    char   *buf;
+    size_t  size;
+    size_t  cap;
+    bool    exhausted;
+} ExtSortReader;
+
+/* K-way merge through a loser tree.  `tree[0]` holds the index of the
+ * reader with the smallest record, `tree[1]` to `tree[num_readers - 1]` the
+ * losers of the matches at the inner nodes.  The leaf for reader `i` is at
+ * node `num_readers + i`.  The merge doesn't own the files of its readers.
+ */
+typedef struct {
+    ExtSortReader *readers;
+    size_t        *tree;
+    size_t        *winners;
+    size_t         num_readers;
+    bool           started;
+} ExtSortMerge;
+
+/* State of ExtSorter_Finish, kept outside of the trapped routine so that
+ * the runs and the merge in progress can be released if it throws.
+ */
+typedef struct {
+    ExternalSorter  *sorter;
+    FILE           **runs;        // Runs of the current pass.
+    size_t           num_runs;
+    size_t           num_merged;  // Runs of the current pass already closed.
+    FILE            *out;
+    ExtSortMerge    *merge;
+} ExtSortFinisher;
+
+static int
+S_default_compare(void *context, const char *a, size_t a_size,
+                  const char *b, size_t b_size);
+
+static void
+S_spill(ExternalSorter *self);
+
+static void
+S_do_finish(void *context);
+
+static ExtSortMerge*
+S_merge_new(FILE **files, size_t num_files);
+
+static void
+S_merge_start(ExternalSorter *self, ExtSortMerge *merge);
+
+static const char*
+S_merge_next(ExternalSorter *self, ExtSortMerge *merge, size_t *size);
+
+static void
+S_merge_destroy(ExtSortMerge *merge);
+
+ExternalSorter*
+ExtSorter_new(size_t mem_budget, String *temp_dir) {
+    ExternalSorter *self = (ExternalSorter*)Class_Make_Obj(EXTERNALSORTER);
+    return ExtSorter_init(self, mem_budget, temp_dir);
+}
+
+ExternalSorter*
+ExtSorter_init(ExternalSorter *self, size_t mem_budget, String *temp_dir) {
+    self->compare     = S_default_compare;
+    self->context     = NULL;
+    self->mem_budget  = mem_budget;
+    self->temp_dir    = temp_dir ? Str_Clone(temp_dir) : NULL;
+    self->buf         = NULL;
+    self->buf_size    = 0;
+    self->buf_cap     = 0;
+    self->records     = NULL;
+    self->num_records = 0;
+    self->records_cap = 0;
+    self->scratch     = NULL;
+    self->scratch_cap = 0;
+    self->tick        = 0;
+    self->runs        = NULL;
+    self->num_runs    = 0;
+    self->runs_cap    = 0;
+    self->merge       = NULL;
+    self->finished    = false;
+    return self;
+}
+
+void
+ExtSorter_Destroy_IMP(ExternalSorter *self) {
+    if (self->merge) {
+        S_merge_destroy((ExtSortMerge*)self->merge);
+    }
+    for (size_t i = 0; i < self->num_runs; i++) {
+        fclose((FILE*)self->runs[i]);
+    }
+    FREEMEM(self->runs);
+    FREEMEM(self->records);
+    FREEMEM(self->scratch);
+    FREEMEM(self->buf);
+    DECREF(self->temp_dir);
+    SUPER_DESTROY(self, EXTERNALSORTER);
+}
+
+void
+ExtSorter_Set_Compare_IMP(ExternalSorter *self,
+                          CFISH_ExtSort_Compare_t compare, void *context) {
+    if (self->num_records || self->num_runs || self->finished) {
+        THROW(ERR, "Can't set compare function after adding records");
+    }
+    self->compare = compare;
+    self->context = context;
+}
+
+void
+ExtSorter_Add_IMP(ExternalSorter *self, Blob *record) {
+    ExtSorter_Add_Bytes(self, Blob_Get_Buf(record), Blob_Get_Size(record));
+}
+
+void
+ExtSorter_Add_Bytes_IMP(ExternalSorter *self, const char *bytes,
+                        size_t size) {
+    if (self->finished) {
+        THROW(ERR, "Can't add records after Finish");
+    }
+
+    // Account for the record entry and the sort scratch space.
+    size_t overhead = 2 * sizeof(ExtSortRecord);
+    if (self->num_records > 0
+        && self->buf_size + size
+           + (self->num_records + 1) * overhead > self->mem_budget
+       ) {
+        S_spill(self);
+    }
+
+    if (size > self->buf_cap - self->buf_size) {
+        size_t new_cap = Memory_oversize(self->buf_size + size, sizeof(char));
+        self->buf      = (char*)REALLOCATE(self->buf, new_cap);
+        self->buf_cap  = new_cap;
+    }
+    if (self->num_records == self->records_cap) {
+        size_t new_cap = Memory_oversize(self->num_records + 1,
+                                         sizeof(ExtSortRecord));
+        self->records     = REALLOCATE(self->records,
+                                       new_cap * sizeof(ExtSortRecord));
+        self->records_cap = new_cap;
+    }
+
+    ExtSortRecord *record = (ExtSortRecord*)self->records + self->num_records;
+    record->offset = self->buf_size;
+    record->size   = size;
+    if (size) { memcpy(self->buf + self->buf_size, bytes, size); }
+    self->buf_size += size;
+    self->num_records++;
+}
+
+static int
+S_default_compare(void *context, const char *a, size_t a_size,
+                  const char *b, size_t b_size) {
+    UNUSED_VAR(context);
+    size_t min_size = a_size < b_size ? a_size : b_size;
+    int comparison = min_size ? memcmp(a, b, min_size) : 0;
+    if (comparison != 0) { return comparison; }
+    return a_size < b_size ? -1 : a_size > b_size ? 1 : 0;
+}
+
+static int
+S_compare_records(void *context, const void *va, const void *vb) {
+    ExternalSorter      *self = (ExternalSorter*)context;
+    const ExtSortRecord *a    = (const ExtSortRecord*)va;
+    const ExtSortRecord *b    = (const ExtSortRecord*)vb;
+    return self->compare(self->context, self->buf + a->offset, a->size,
+                         self->buf + b->offset, b->size);
+}
+
+static void
+S_sort_records(ExternalSorter *self) {
+    // The scratch space is kept in the object, so that it isn't leaked if
+    // the compare function throws.
+    if (self->records_cap > self->scratch_cap) {
+        FREEMEM(self->scratch);
+        self->scratch     = MALLOCATE(self->records_cap
+                                      * sizeof(ExtSortRecord));
+        self->scratch_cap = self->records_cap;
+    }
+    Sort_mergesort(self->records, self->scratch, self->num_records,
+                   sizeof(ExtSortRecord), S_compare_records, self);
+}
+
+static FILE*
+S_open_temp(ExternalSorter *self) {
+    FILE *file = NULL;
+
+#ifdef CHY_HAS_UNISTD_H
+    if (self->temp_dir) {
+        String *pattern = Str_newf("%o/cfish_extsort_XXXXXX", self->temp_dir);
+        char   *path    = Str_To_Utf8(pattern);
+        int     fd      = mkstemp(path);
+        if (fd >= 0) {
+            // The file is deleted once it's closed.
+            unlink(path);
+            file = fdopen(fd, "w+b");
+            if (!file) { close(fd); }
+        }
+        FREEMEM(path);
+        DECREF(pattern);
+    }
+    else
+#endif
+    {
+        file = tmpfile();
+    }
+
+    if (!file) {
+        THROW(ERR, "Can't create temporary file: %s", strerror(errno));
+    }
+    return file;
+}
+
+static void
+S_write_record(FILE *file, const char *bytes, size_t size) {
+    uint64_t size64 = (uint64_t)size;
+    if (fwrite(&size64, sizeof(size64), 1, file) != 1
+        || (size && fwrite(bytes, size, 1, file) != 1)
+       ) {
+        THROW(ERR, "Error writing temporary file: %s", strerror(errno));
+    }
+}
+
+static void
+S_add_run(ExternalSorter *self, FILE *file) {
+    if (self->num_runs == self->runs_cap) {
+        size_t new_cap = Memory_oversize(self->num_runs + 1, sizeof(void*));
+        self->runs     = (void**)REALLOCATE(self->runs,
+                                            new_cap * sizeof(void*));
+        self->runs_cap = new_cap;
+    }
+    self->runs[self->num_runs++] = file;
+}
+
+static void
+S_flush_run(FILE *file) {
+    if (fflush(file) != 0) {
+        THROW(ERR, "Error writing temporary file: %s", strerror(errno));
+    }
+}
+
+// Sort the buffered records and write them to a new run.
+static void
+S_spill(ExternalSorter *self) {
+    S_sort_records(self);
+
+    // Add the run before writing, so that the file is closed by Destroy
+    // if writing fails.
+    FILE *file = S_open_temp(self);
+    S_add_run(self, file);
+    ExtSortRecord *records = (ExtSortRecord*)self->records;
+    for (size_t i = 0; i < self->num_records; i++) {
+        S_write_record(file, self->buf + records[i].offset, records[i].size);
+    }
+    S_flush_run(file);
+
+    self->num_records = 0;
+    self->buf_size    = 0;
+}
+
+void
+ExtSorter_Finish_IMP(ExternalSorter *self) {
+    if (self->finished) {
+        THROW(ERR, "Finish called twice");
+    }
+    self->finished = true;
+
+    ExtSortFinisher finisher;
+    finisher.sorter     = self;
+    finisher.runs       = NULL;
+    finisher.num_runs   = 0;
+    finisher.num_merged = 0;
+    finisher.out        = NULL;
+    finisher.merge      = NULL;
+
+    Err *error = Err_trap(S_do_finish, &finisher);
+    if (error) {
+        // Release the merge in progress and close the runs of the
+        // interrupted pass.  The runs in `self->runs` are closed by Destroy.
+        if (finisher.merge) {
+            if (finisher.merge == self->merge) { self->merge = NULL; }
+            S_merge_destroy(finisher.merge);
+        }
+        for (size_t i = finisher.num_merged; i < finisher.num_runs; i++) {
+            fclose(finisher.runs[i]);
+        }
+        FREEMEM(finisher.runs);
+        if (finisher.out) { fclose(finisher.out); }
+        self->num_records = 0;
+        RETHROW(error);
+    }
+}
+
+static void
+S_do_finish(void *context) {
+    ExtSortFinisher *finisher = (ExtSortFinisher*)context;
+    ExternalSorter  *self     = finisher->sorter;
+
+    if (self->num_runs == 0) {
+        // Everything fits into memory.
+        S_sort_records(self);
+        return;
+    }
+
+    if (self->num_records > 0) { S_spill(self); }
+    FREEMEM(self->buf);
+    FREEMEM(self->records);
+    FREEMEM(self->scratch);
+    self->buf         = NULL;
+    self->records     = NULL;
+    self->scratch     = NULL;
+    self->num_records = 0;
+    self->buf_cap     = 0;
+    self->records_cap = 0;
+    self->scratch_cap = 0;
+
+    // Merge groups of runs until they can be merged in a single pass.
+    // Runs are merged in order and the result replaces the merged runs,
+    // which keeps the sort stable.
+    while (self->num_runs > MAX_FAN_IN) {
+        finisher->runs       = (FILE**)self->runs;
+        finisher->num_runs   = self->num_runs;
+        finisher->num_merged = 0;
+
+        self->runs     = NULL;
+        self->num_runs = 0;
+        self->runs_cap = 0;
+
+        while (finisher->num_merged < finisher->num_runs) {
+            size_t group = finisher->num_runs - finisher->num_merged;
+            if (group > MAX_FAN_IN) { group = MAX_FAN_IN; }
+            FILE **runs = finisher->runs + finisher->num_merged;
+
+            finisher->out   = S_open_temp(self);
+            finisher->merge = S_merge_new(runs, group);
+            S_merge_start(self, finisher->merge);
+            const char *bytes;
+            size_t size;
+            while (NULL != (bytes = S_merge_next(self, finisher->merge,
+                                                 &size))) {
+                S_write_record(finisher->out, bytes, size);
+            }
+            S_flush_run(finisher->out);
+
+            S_merge_destroy(finisher->merge);
+            finisher->merge = NULL;
+            for (size_t i = 0; i < group; i++) {
+                fclose(runs[i]);
+            }
+            finisher->num_merged += group;
+            S_add_run(self, finisher->out);
+            finisher->out = NULL;
+        }
+
+        FREEMEM(finisher->runs);
+        finisher->runs     = NULL;
+        finisher->num_runs = 0;
+    }
+
+    self->merge     = S_merge_new((FILE**)self->runs, self->num_runs);
+    finisher->merge = (ExtSortMerge*)self->merge;
+    S_merge_start(self, finisher->merge);
+    finisher->merge = NULL;
+}
+
+Blob*
+ExtSorter_Next_IMP(ExternalSorter *self) {
+    size_t size;
+    const char *bytes = ExtSorter_Next_Bytes(self, &size);
+    return bytes ? Blob_new(bytes, size) : NULL;
+}
+
+const char*
+ExtSorter_Next_Bytes_IMP(ExternalSorter *self, size_t *size) {
+    if (!self->finished) {
+        THROW(ERR, "Finish must be called before Next");
+    }
+
+    if (self->merge) {
+        return S_merge_next(self, (ExtSortMerge*)self->merge, size);
+    }
+
+    if (self->tick >= self->num_records) {
+        *size = 0;
+        return NULL;
+    }
+    ExtSortRecord *record = (ExtSortRecord*)self->records + self->tick++;
+    *size = record->size;
+    // The buffer is NULL if all records are empty.
+    return self->buf ? self->buf + record->offset : "";
+}
+
+size_t
+ExtSorter_Get_Num_Runs_IMP(ExternalSorter *self) {
+    return self->num_runs;
+}
+
+/****************************** Loser tree merge ****************************/
+
+static void
+S_read_record(ExtSortReader *reader) {
+    uint64_t size64;
+    if (fread(&size64, sizeof(size64), 1, reader->file) != 1) {
+        if (ferror(reader->file)) {
+            THROW(ERR, "Error reading temporary file: %s", strerror(errno));
+        }
+        reader->exhausted = true;
+        reader->size      = 0;
+        return;
+    }
+
+    size_t size = (size_t)size64;
+    if (size > reader->cap) {
+        size_t new_cap = Memory_oversize(size, sizeof(char));
+        reader->buf = (char*)REALLOCATE(reader->buf, new_cap);
+        reader->cap = new_cap;
+    }
+    if (size && fread(reader->buf, size, 1, reader->file) != 1) {
+        THROW(ERR, "Truncated temporary file");
+    }
+    reader->size = size;
+}
+
+// Return true if the current record of reader `a` sorts before that of
+// reader `b`.  Exhausted readers sort last, ties go to the earlier run.
+static bool
+S_beats(ExternalSorter *self, ExtSortMerge *merge, size_t a, size_t b) {
+    ExtSortReader *reader_a = &merge->readers[a];
+    ExtSortReader *reader_b = &merge->readers[b];
+    if (reader_a->exhausted) { return false; }
+    if (reader_b->exhausted) { return true; }
+    int comparison = self->compare(self->context,
+                                   reader_a->buf, reader_a->size,
+                                   reader_b->buf, reader_b->size);
+    if (comparison != 0) { return comparison < 0; }
+    return a < b;
+}
+
+static ExtSortMerge*
+S_merge_new(FILE **files, size_t num_files) {
+    ExtSortMerge *merge = (ExtSortMerge*)MALLOCATE(sizeof(ExtSortMerge));
+    merge->readers     = (ExtSortReader*)CALLOCATE(num_files,
+                                                   sizeof(ExtSortReader));
+    merge->tree        = (size_t*)MALLOCATE(num_files * sizeof(size_t));
+    merge->winners     = (size_t*)MALLOCATE(2 * num_files * sizeof(size_t));
+    merge->num_readers = num_files;
+    merge->started     = false;
+
+    for (size_t i = 0; i < num_files; i++) {
+        ExtSortReader *reader = &merge->readers[i];
+        reader->file = files[i];
+        // Always allocate, so that empty records aren't mistaken for the
+        // end of the run.
+        reader->cap  = 64;
+        reader->buf  = (char*)MALLOCATE(reader->cap);
+    }
+
+    return merge;
+}
+
+// Read the first record of every run and play the initial tournament
+// bottom-up.
+static void
+S_merge_start(ExternalSorter *self, ExtSortMerge *merge) {
+    size_t  num_readers = merge->num_readers;
+    size_t *winners     = merge->winners;
+
+    for (size_t i = 0; i < num_readers; i++) {
+        ExtSortReader *reader = &merge->readers[i];
+        rewind(reader->file);
+        S_read_record(reader);
+    }
+
+    for (size_t i = 0; i < num_readers; i++) {
+        winners[num_readers + i] = i;
+    }
+    for (size_t node = num_readers - 1; node > 0; node--) {
+        size_t left  = winners[2 * node];
+        size_t right = winners[2 * node + 1];
+        if (S_beats(self, merge, left, right)) {
+            winners[node]     = left;
+            merge->tree[node] = right;
+        }
+        else {
+            winners[node]     = right;
+            merge->tree[node] = left;
+        }
+    }
+    merge->tree[0] = num_readers > 1 ? winners[1] : 0;
+}
+
+static const char*
+S_merge_next(ExternalSorter *self, ExtSortMerge *merge, size_t *size) {
+    size_t *tree = merge->tree;
+
+    if (merge->started) {
+        // Advance the previous winner and replay its path to the root.
+        size_t winner = tree[0];
+        S_read_record(&merge->readers[winner]);
+        for (size_t node = (merge->num_readers + winner) / 2;
+             node > 0;
+             node /= 2
+            ) {
+            if (S_beats(self, merge, tree[node], winner)) {
+                size_t temp = tree[node];
+                tree[node] = winner;
+                winner     = temp;
+            }
+        }
+        tree[0] = winner;
+    }
+    merge->started = true;
+
+    ExtSortReader *reader = &merge->readers[tree[0]];
+    if (reader->exhausted) {
+        *size = 0;
+        return NULL;
+    }
+    *size = reader->size;
+    return reader->buf;
+}
+
+static void
+S_merge_destroy(ExtSortMerge *merge) {
+    for (size_t i = 0; i < merge->num_readers; i++) {
+        FREEMEM(merge->readers[i].buf);
+    }
+    FREEMEM(merge->readers);
+    FREEMEM(merge->tree);
+    FREEMEM(merge->winners);
+    FREEMEM(merge);
+}
+
@@ -0,0 +1,354 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define CFISH_USE_SHORT_NAMES
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "charmony.h"
+
+#include "Clownfish/Util/Hashing.h"
+#include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/Memory.h"
+
+#ifdef CFISH_HASH_WYHASH
+  #define DEFAULT_HASH_FUNC HASHING_WYHASH
+#else
+  #define DEFAULT_HASH_FUNC HASHING_SIPHASH13
+#endif
+
+typedef struct {
+    int      func;
+    uint64_t k0;
+    uint64_t k1;
+} HashingState;
+
+static HashingState *volatile Hashing_state;
+
+static HashingState*
+S_init_state(void);
+
+static CFISH_INLINE uint64_t
+SI_rotl(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+static CFISH_INLINE uint64_t
+SI_load_le64(const uint8_t *p) {
+#ifdef CHY_LITTLE_END
+    uint64_t value;
+    memcpy(&value, p, 8);
+    return value;
+#else
+    return (uint64_t)p[0]
+           | ((uint64_t)p[1] << 8)
+           | ((uint64_t)p[2] << 16)
+           | ((uint64_t)p[3] << 24)
+           | ((uint64_t)p[4] << 32)
+           | ((uint64_t)p[5] << 40)
+           | ((uint64_t)p[6] << 48)
+           | ((uint64_t)p[7] << 56);
+#endif
+}
+
+/******************************** SipHash *********************************/
+
+#define SIPROUND \
+    do { \
+        v0 += v1; v1 = SI_rotl(v1, 13); v1 ^= v0; v0 = SI_rotl(v0, 32); \
+        v2 += v3; v3 = SI_rotl(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = SI_rotl(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = SI_rotl(v1, 17); v1 ^= v2; v2 = SI_rotl(v2, 32); \
+    } while (0)
+
+static CFISH_INLINE uint64_t
+SI_siphash13(const uint8_t *ptr, size_t size, uint64_t k0, uint64_t k1) {
+    uint64_t v0 = k0 ^ UINT64_C(0x736f6d6570736575);
+    uint64_t v1 = k1 ^ UINT64_C(0x646f72616e646f6d);
+    uint64_t v2 = k0 ^ UINT64_C(0x6c7967656e657261);
+    uint64_t v3 = k1 ^ UINT64_C(0x7465646279746573);
+    const uint8_t *end = ptr + (size & ~(size_t)7);
+
+    // One compression round per 8-byte word.
+    for (; ptr < end; ptr += 8) {
+        uint64_t m = SI_load_le64(ptr);
+        v3 ^= m;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    // Final word holds the remaining bytes and the low byte of the size.
+    uint64_t b = (uint64_t)size << 56;
+    switch (size & 7) {
+        case 7: b |= (uint64_t)ptr[6] << 48; /* fall through */
+        case 6: b |= (uint64_t)ptr[5] << 40; /* fall through */
+        case 5: b |= (uint64_t)ptr[4] << 32; /* fall through */
+        case 4: b |= (uint64_t)ptr[3] << 24; /* fall through */
+        case 3: b |= (uint64_t)ptr[2] << 16; /* fall through */
+        case 2: b |= (uint64_t)ptr[1] << 8;  /* fall through */
+        case 1: b |= (uint64_t)ptr[0];       /* fall through */
+        case 0: break;
+    }
+    v3 ^= b;
+    SIPROUND;
+    v0 ^= b;
+
+    // Three finalization rounds.
+    v2 ^= 0xFF;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+uint64_t
+Hashing_siphash13(const void *data, size_t size, uint64_t k0, uint64_t k1) {
+    return SI_siphash13((const uint8_t*)data, size, k0, k1);
+}
+
+/******************************** wyhash **********************************/
+
+static const uint64_t WYHASH_SECRET[4] = {
+    UINT64_C(0x2d358dccaa6c78a5), UINT64_C(0x8bb84b93962eacc9),
+    UINT64_C(0x4b33a62ed433d4a3), UINT64_C(0x4d5a2da51de1aa47)
+};
+
+// Compute the full 128-bit product of `*a` and `*b`, storing the low half
+// in `*a` and the high half in `*b`.
+static CFISH_INLINE void
+SI_mum(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+    __extension__ unsigned __int128 r = *a;
+    r *= *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t  = rl + (rm0 << 32);
+    uint64_t c  = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static CFISH_INLINE uint64_t
+SI_mix(uint64_t a, uint64_t b) {
+    SI_mum(&a, &b);
+    return a ^ b;
+}
+
+static CFISH_INLINE uint64_t
+SI_load64(const uint8_t *p) {
+    uint64_t value;
+    memcpy(&value, p, 8);
+    return value;
+}
+
+static CFISH_INLINE uint64_t
+SI_load32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+static CFISH_INLINE uint64_t
+SI_wyhash(const uint8_t *ptr, size_t size, uint64_t seed) {
+    const uint64_t *secret = WYHASH_SECRET;
+    uint64_t a, b;
+
+    seed ^= SI_mix(seed ^ secret[0], secret[1]);
+
+    if (size <= 16) {
+        if (size >= 4) {
+            size_t mid = (size >> 3) << 2;
+            a = (SI_load32(ptr) << 32) | SI_load32(ptr + mid);
+            b = (SI_load32(ptr + size - 4) << 32)
+                | SI_load32(ptr + size - 4 - mid);
+        }
+        else if (size > 0) {
+            a = ((uint64_t)ptr[0] << 16)
+                | ((uint64_t)ptr[size >> 1] << 8)
+                | ptr[size - 1];
+            b = 0;
+        }
+        else {
+            a = b = 0;
+        }
+    }
+    else {
+        size_t remaining = size;
+        if (remaining > 48) {
+            // Three independent lanes of 16 bytes each.
+            uint64_t see1 = seed;
+            uint64_t see2 = seed;
+            do {
+                seed = SI_mix(SI_load64(ptr) ^ secret[1],
+                              SI_load64(ptr + 8) ^ seed);
+                see1 = SI_mix(SI_load64(ptr + 16) ^ secret[2],
+                              SI_load64(ptr + 24) ^ see1);
+                see2 = SI_mix(SI_load64(ptr + 32) ^ secret[3],
+                              SI_load64(ptr + 40) ^ see2);
+                ptr       += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (remaining > 16) {
+            seed = SI_mix(SI_load64(ptr) ^ secret[1],
+                          SI_load64(ptr + 8) ^ seed);
+            ptr       += 16;
+            remaining -= 16;
+        }
+        a = SI_load64(ptr + remaining - 16);
+        b = SI_load64(ptr + remaining - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    SI_mum(&a, &b);
+    return SI_mix(a ^ secret[0] ^ (uint64_t)size, b ^ secret[1]);
+}
+
+uint64_t
+Hashing_wyhash(const void *data, size_t size, uint64_t seed) {
+    return SI_wyhash((const uint8_t*)data, size, seed);
+}
+
+/***************************** Hash state *********************************/
+
+static uint64_t
+S_splitmix64(uint64_t *state) {
+    uint64_t z = (*state += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+static void
+S_random_seed(uint64_t *k0, uint64_t *k1) {
+    uint64_t entropy[2];
+    bool     have_entropy = false;
+
+    FILE *urandom = fopen("/dev/urandom", "rb");
+    if (urandom) {
+        have_entropy = fread(entropy, sizeof(entropy), 1, urandom) == 1;
+        fclose(urandom);
+    }
+
+    if (!have_entropy) {
+        // Fall back to the clock and to addresses randomized by ASLR.
+        uint64_t state = (uint64_t)time(NULL);
+        state ^= (uint64_t)clock() << 32;
+        state ^= (uint64_t)(uintptr_t)&state;
+        state ^= (uint64_t)(uintptr_t)&Hashing_state << 16;
+        entropy[0] = S_splitmix64(&state);
+        entropy[1] = S_splitmix64(&state);
+    }
+
+    *k0 = entropy[0];
+    *k1 = entropy[1];
+}
+
+static HashingState*
+S_init_state() {
+    HashingState *state = (HashingState*)MALLOCATE(sizeof(HashingState));
+    state->func = DEFAULT_HASH_FUNC;
+
+    const char *func = getenv("CLOWNFISH_HASH_FUNC");
+    if (func) {
+        if (strcmp(func, "siphash13") == 0) {
+            state->func = HASHING_SIPHASH13;
+        }
+        else if (strcmp(func, "wyhash") == 0) {
+            state->func = HASHING_WYHASH;
+        }
+    }
+
+    const char *seed = getenv("CLOWNFISH_HASH_SEED");
+    if (seed && *seed) {
+        uint64_t mix = (uint64_t)strtoull(seed, NULL, 0);
+        state->k0 = S_splitmix64(&mix);
+        state->k1 = S_splitmix64(&mix);
+    }
+    else {
+        S_random_seed(&state->k0, &state->k1);
+    }
+
+    if (!Atomic_cas_ptr((void*volatile*)&Hashing_state, NULL, state)) {
+        // Another thread beat us to it.
+        FREEMEM(state);
+    }
+
+    return Hashing_state;
+}
+
+bool
+Hashing_init(int func, uint64_t k0, uint64_t k1) {
+    if (func != HASHING_SIPHASH13 && func != HASHING_WYHASH) {
+        return false;
+    }
+
+    HashingState *state = (HashingState*)MALLOCATE(sizeof(HashingState));
+    state->func = func;
+    state->k0   = k0;
+    state->k1   = k1;
+
+    if (!Atomic_cas_ptr((void*volatile*)&Hashing_state, NULL, state)) {
+        FREEMEM(state);
+        return false;
+    }
+
+    return true;
+}
+
+int
+Hashing_get_func() {
+    HashingState *state = Hashing_state;
+    if (state == NULL) { state = S_init_state(); }
+    return state->func;
+}
+
+uint64_t
+Hashing_hash_bytes(const void *data, size_t size) {
+    HashingState *state = Hashing_state;
+    if (state == NULL) { state = S_init_state(); }
+
+    if (state->func == HASHING_WYHASH) {
+        return SI_wyhash((const uint8_t*)data, size, state->k0);
+    }
+    else {
+        return SI_siphash13((const uint8_t*)data, size, state->k0, state->k1);
+    }
+}
+
+/******************************** Digests *********************************/
+
+void
+Hashing_digest_bytes(uint64_t *digest, uint64_t tag, const void *data,
+                     size_t size) {
+    const uint8_t *bytes = (const uint8_t*)data;
+    digest[0] = SI_wyhash(bytes, size, CFISH_HASHING_DIGEST_K0 ^ tag);
+    digest[1] = SI_wyhash(bytes, size, CFISH_HASHING_DIGEST_K1 ^ tag);
+}
@@ -0,0 +1,205 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef H_CLOWNFISH_UTIL_HASHING
+#define H_CLOWNFISH_UTIL_HASHING 1
+
+#include <stddef.h>
+
+#include "charmony.h"
+#include "cfish_parcel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Seeded hash functions for byte strings.
+ *
+ * Two functions are available:
+ *
+ * - SipHash-1-3, a keyed pseudo-random function which makes it infeasible
+ *   to construct colliding keys without knowing the seed.  This is the
+ *   default because Hash keys are often supplied by untrusted users.
+ * - wyhash, which is considerably faster on long keys but offers no
+ *   guarantees against deliberately crafted collisions.
+ *
+ * The function used by `Str_Hash_Sum` is chosen once per process.
+ * The default can be switched to wyhash at build time by defining
+ * `CFISH_HASH_WYHASH`.  At init time, the environment variable
+ * `CLOWNFISH_HASH_FUNC` may be set to `siphash13` or `wyhash`, and
+ * `CLOWNFISH_HASH_SEED` to a decimal or hex integer which replaces the
+ * random per-process seed.  Embedders can also call
+ * `cfish_Hashing_init` before bootstrapping Clownfish.
+ *
+ * Since the seed is random by default, hash sums and the iteration order of
+ * Hashes differ between processes.  Set `CLOWNFISH_HASH_SEED` to get
+ * reproducible results, e.g. when debugging.
+ */
+
+#define CFISH_HASHING_SIPHASH13  1
+#define CFISH_HASHING_WYHASH     2
+
+/** Compute the SipHash-1-3 hash of a byte string with a 128-bit key.
+ */
+CFISH_VISIBLE uint64_t
+cfish_Hashing_siphash13(const void *data, size_t size, uint64_t k0,
+                        uint64_t k1);
+
+/** Compute the wyhash of a byte string.
+ */
+CFISH_VISIBLE uint64_t
+cfish_Hashing_wyhash(const void *data, size_t size, uint64_t seed);
+
+/** Select the process-wide hash function and seed.  Must be called before
+ * the first string is hashed, which usually means before bootstrapping the
+ * Clownfish parcel.
+ *
+ * @param func One of `CFISH_HASHING_SIPHASH13` or `CFISH_HASHING_WYHASH`.
+ * @return true on success, false if the hash state was already initialized.
+ */
+CFISH_VISIBLE bool
+cfish_Hashing_init(int func, uint64_t k0, uint64_t k1);
+
+/** Return the hash function in use, initializing the hash state if
+ * necessary.
+ */
+CFISH_VISIBLE int
+cfish_Hashing_get_func(void);
+
+/** Hash a byte string with the process-wide hash function and seed.
+ */
+CFISH_VISIBLE uint64_t
+cfish_Hashing_hash_bytes(const void *data, size_t size);
+
+/* Helpers for implementing `Obj_Digest`.
+ *
+ * A digest is an array of two uint64_t.  Unlike hash sums, digests don't
+ * depend on the process-wide seed.  Every kind of value mixes in its own
+ * tag, so that values of different kinds which are never equal are
+ * unlikely to have the same digest.
+ */
+
+#define CFISH_HASHING_DIGEST_NULL     0
+#define CFISH_HASHING_DIGEST_OBJ      1
+#define CFISH_HASHING_DIGEST_STRING   2
+#define CFISH_HASHING_DIGEST_BLOB     3
+#define CFISH_HASHING_DIGEST_BYTEBUF  4
+#define CFISH_HASHING_DIGEST_INTEGER  5
+#define CFISH_HASHING_DIGEST_FLOAT    6
+#define CFISH_HASHING_DIGEST_BOOLEAN  7
+#define CFISH_HASHING_DIGEST_VECTOR   8
+#define CFISH_HASHING_DIGEST_HASH     9
+#define CFISH_HASHING_DIGEST_ENTRY    10
+#define CFISH_HASHING_DIGEST_DEQUE    11
+#define CFISH_HASHING_DIGEST_I32ARRAY 12
+#define CFISH_HASHING_DIGEST_I64ARRAY 13
+#define CFISH_HASHING_DIGEST_F32ARRAY 14
+#define CFISH_HASHING_DIGEST_F64ARRAY 15
+
+// Fixed seeds, so that digests are the same in every process.
+#define CFISH_HASHING_DIGEST_K0 UINT64_C(0xa0761d6478bd642f)
+#define CFISH_HASHING_DIGEST_K1 UINT64_C(0xe7037ed1a0b428db)
+
+// MurmurHash3 finalizer.
+static CFISH_INLINE uint64_t
+cfish_Hashing_fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= UINT64_C(0xff51afd7ed558ccd);
+    k ^= k >> 33;
+    k *= UINT64_C(0xc4ceb9fe1a85ec53);
+    k ^= k >> 33;
+    return k;
+}
+
+/** Start a digest with a tag.
+ */
+static CFISH_INLINE void
+cfish_Hashing_digest_init(uint64_t *digest, uint64_t tag) {
+    digest[0] = CFISH_HASHING_DIGEST_K0 ^ tag;
+    digest[1] = CFISH_HASHING_DIGEST_K1 ^ tag;
+}
+
+/** Mix a value into a digest.  The result depends on the order in which
+ * values are mixed in.
+ */
+static CFISH_INLINE void
+cfish_Hashing_digest_mix(uint64_t *digest, uint64_t value) {
+    uint64_t rotated = (value << 32) | (value >> 32);
+    digest[0] = cfish_Hashing_fmix64(digest[0] ^ value);
+    digest[1] = cfish_Hashing_fmix64(digest[1] ^ rotated) + digest[0];
+}
+
+/** Mix another digest into a digest.  The result depends on the order in
+ * which digests are mixed in.
+ */
+static CFISH_INLINE void
+cfish_Hashing_digest_mix_digest(uint64_t *digest, const uint64_t *other) {
+    digest[0] = cfish_Hashing_fmix64(digest[0] ^ other[0]);
+    digest[1] = cfish_Hashing_fmix64(digest[1] ^ other[1]) + digest[0];
+}
+
+/** Compute the digest of a tagged 64-bit value.
+ */
+static CFISH_INLINE void
+cfish_Hashing_digest_u64(uint64_t *digest, uint64_t tag, uint64_t value) {
+    cfish_Hashing_digest_init(digest, tag);
+    cfish_Hashing_digest_mix(digest, value);
+}
+
+/** Compute the digest of a tagged byte string.
+ */
+CFISH_VISIBLE void
+cfish_Hashing_digest_bytes(uint64_t *digest, uint64_t tag, const void *data,
+                           size_t size);
+
+#ifdef CFISH_USE_SHORT_NAMES
+  #define HASHING_SIPHASH13     CFISH_HASHING_SIPHASH13
+  #define HASHING_WYHASH        CFISH_HASHING_WYHASH
+  #define Hashing_siphash13     cfish_Hashing_siphash13
+  #define Hashing_wyhash        cfish_Hashing_wyhash
+  #define Hashing_init          cfish_Hashing_init
+  #define Hashing_get_func      cfish_Hashing_get_func
+  #define Hashing_hash_bytes    cfish_Hashing_hash_bytes
+  #define HASHING_DIGEST_NULL       CFISH_HASHING_DIGEST_NULL
+  #define HASHING_DIGEST_OBJ        CFISH_HASHING_DIGEST_OBJ
+  #define HASHING_DIGEST_STRING     CFISH_HASHING_DIGEST_STRING
+  #define HASHING_DIGEST_BLOB       CFISH_HASHING_DIGEST_BLOB
+  #define HASHING_DIGEST_BYTEBUF    CFISH_HASHING_DIGEST_BYTEBUF
+  #define HASHING_DIGEST_INTEGER    CFISH_HASHING_DIGEST_INTEGER
+  #define HASHING_DIGEST_FLOAT      CFISH_HASHING_DIGEST_FLOAT
+  #define HASHING_DIGEST_BOOLEAN    CFISH_HASHING_DIGEST_BOOLEAN
+  #define HASHING_DIGEST_VECTOR     CFISH_HASHING_DIGEST_VECTOR
+  #define HASHING_DIGEST_HASH       CFISH_HASHING_DIGEST_HASH
+  #define HASHING_DIGEST_ENTRY      CFISH_HASHING_DIGEST_ENTRY
+  #define HASHING_DIGEST_DEQUE      CFISH_HASHING_DIGEST_DEQUE
+  #define HASHING_DIGEST_I32ARRAY   CFISH_HASHING_DIGEST_I32ARRAY
+  #define HASHING_DIGEST_I64ARRAY   CFISH_HASHING_DIGEST_I64ARRAY
+  #define HASHING_DIGEST_F32ARRAY   CFISH_HASHING_DIGEST_F32ARRAY
+  #define HASHING_DIGEST_F64ARRAY   CFISH_HASHING_DIGEST_F64ARRAY
+  #define Hashing_digest_init       cfish_Hashing_digest_init
+  #define Hashing_digest_mix        cfish_Hashing_digest_mix
+  #define Hashing_digest_mix_digest cfish_Hashing_digest_mix_digest
+  #define Hashing_digest_u64        cfish_Hashing_digest_u64
+  #define Hashing_digest_bytes      cfish_Hashing_digest_bytes
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_CLOWNFISH_UTIL_HASHING */
+
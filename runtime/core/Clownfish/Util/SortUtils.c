@@ -14,134 +14,1177 @@
  * limitations under the License.
  */
 
+
 #define C_CFISH_SORTUTILS
 #define CFISH_USE_SHORT_NAMES
 
 #include <string.h>
+
+#include "charmony.h"
+
 #include "Clownfish/Util/SortUtils.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/Util/Memory.h"
+
+/* The merge sort below is an adaptive, stable sort modeled on Tim Peters'
+ * TimSort (see "listsort.txt" in the CPython sources).
+ *
+ * Natural runs are detected and strictly descending runs are reversed.
+ * Runs shorter than `min_run` are extended with binary insertion sort.
+ * Runs are pushed on a stack and merged while maintaining invariants which
+ * keep merges balanced.  Merges copy only the shorter run into scratch
+ * space and merge directly back into place, switching to galloping mode
+ * when one run keeps winning.
+ */
+
+// Number of consecutive wins before a merge switches to galloping mode.
+#define MIN_GALLOP 7
+
+// Maximum height of the run stack.  Enough for 2^64 elements.
+#define MAX_RUNS 85
+
+typedef struct {
+    uint8_t              *elems;
+    uint8_t              *scratch;
+    size_t                width;
+    CFISH_Sort_Compare_t  compare;
+    void                 *context;
+    size_t                min_gallop;
+    size_t                num_runs;
+    size_t                run_base[MAX_RUNS];
+    size_t                run_len[MAX_RUNS];
+} SortState;
+
+static size_t
+S_count_run(SortState *state, size_t lo, size_t hi);
 
-// Recursive merge sorting functions.
 static void
-S_msort4(void *velems, void *vscratch, size_t left, size_t right,
-         CFISH_Sort_Compare_t compare, void *context);
+S_binary_insertion_sort(SortState *state, size_t lo, size_t hi,
+                        size_t start);
+
 static void
-S_msort8(void *velems, void *vscratch, size_t left, size_t right,
-         CFISH_Sort_Compare_t compare, void *context);
+S_merge_collapse(SortState *state);
+
+static void
+S_merge_force_collapse(SortState *state);
+
+static void
+S_merge_at(SortState *state, size_t i);
+
+static void
+S_merge_lo(SortState *state, size_t base1, size_t len1, size_t base2,
+           size_t len2);
+
 static void
-S_msort_any(void *velems, void *vscratch, size_t left, size_t right,
-            CFISH_Sort_Compare_t compare, void *context, size_t width);
+S_merge_hi(SortState *state, size_t base1, size_t len1, size_t base2,
+           size_t len2);
+
+static size_t
+S_gallop_left(SortState *state, const uint8_t *key, const uint8_t *elems,
+              size_t num_elems, size_t hint);
+
+static size_t
+S_gallop_right(SortState *state, const uint8_t *key, const uint8_t *elems,
+               size_t num_elems, size_t hint);
+
+/* The helpers below use local copies of `width`, `compare` and `context`.
+ * Element copies go through byte pointers which may alias the SortState, so
+ * reading the struct members on every access would force reloads.
+ */
+#define ELEM(ptr, tick) ((ptr) + (tick) * width)
+#define LESS(a, b)      (compare(context, (a), (b)) < 0)
 
 static CFISH_INLINE void
-SI_merge(void *left_vptr,  size_t left_size,
-         void *right_vptr, size_t right_size,
-         void *vdest, size_t width, CFISH_Sort_Compare_t compare, void *context);
+SI_copy(size_t width, uint8_t *dest, const uint8_t *src, size_t num) {
+    // Let the compiler inline single-element copies of common widths.
+    if (num == 1) {
+        switch (width) {
+            case 4:
+                memcpy(dest, src, 4);
+                return;
+            case 8:
+                memcpy(dest, src, 8);
+                return;
+        }
+    }
+    memcpy(dest, src, num * width);
+}
+
+static CFISH_INLINE void
+SI_move(size_t width, uint8_t *dest, const uint8_t *src, size_t num) {
+    memmove(dest, src, num * width);
+}
+
+static size_t
+S_compute_min_run(size_t num_elems) {
+    // Take the six most significant bits, plus one if any of the remaining
+    // bits are set.  The result is between 32 and 64 for large arrays and
+    // makes num_elems / min_run close to a power of two.
+    size_t extra = 0;
+    while (num_elems >= 64) {
+        extra |= num_elems & 1;
+        num_elems >>= 1;
+    }
+    return num_elems + extra;
+}
 
 void
 Sort_mergesort(void *elems, void *scratch, size_t num_elems, size_t width,
                CFISH_Sort_Compare_t compare, void *context) {
     // Arrays of 0 or 1 items are already sorted.
     if (num_elems < 2) { return; }
+    if (width == 0) {
+        THROW(ERR, "Parameter 'width' cannot be 0");
+        return;
+    }
 
-    // Dispatch by element size.
-    switch (width) {
-        case 0:
-            THROW(ERR, "Parameter 'width' cannot be 0");
-            break;
-        case 4:
-            S_msort4(elems, scratch, 0, num_elems - 1, compare, context);
-            break;
-        case 8:
-            S_msort8(elems, scratch, 0, num_elems - 1, compare, context);
-            break;
-        default:
-            S_msort_any(elems, scratch, 0, num_elems - 1, compare,
-                        context, width);
+    SortState state;
+    state.elems      = (uint8_t*)elems;
+    state.scratch    = (uint8_t*)scratch;
+    state.width      = width;
+    state.compare    = compare;
+    state.context    = context;
+    state.min_gallop = MIN_GALLOP;
+    state.num_runs   = 0;
+
+    const size_t min_run   = S_compute_min_run(num_elems);
+    size_t       lo        = 0;
+    size_t       remaining = num_elems;
+    while (remaining > 0) {
+        size_t run_len = S_count_run(&state, lo, lo + remaining);
+
+        // Extend short runs to min_run elements.
+        if (run_len < min_run) {
+            size_t forced = remaining <= min_run ? remaining : min_run;
+            S_binary_insertion_sort(&state, lo, lo + forced, lo + run_len);
+            run_len = forced;
+        }
+
+        state.run_base[state.num_runs] = lo;
+        state.run_len[state.num_runs]  = run_len;
+        state.num_runs++;
+        S_merge_collapse(&state);
+
+        lo        += run_len;
+        remaining -= run_len;
+    }
+
+    S_merge_force_collapse(&state);
+}
+
+/* Return the length of the run starting at `lo`.  Strictly descending runs
+ * are reversed in place.  Runs which are merely non-ascending can't be
+ * reversed without breaking stability.
+ */
+static size_t
+S_count_run(SortState *state, size_t lo, size_t hi) {
+    const size_t          width   = state->width;
+    CFISH_Sort_Compare_t  compare = state->compare;
+    void                 *context = state->context;
+    uint8_t              *elems   = state->elems;
+    size_t                next    = lo + 1;
+    if (next == hi) { return 1; }
+
+    if (LESS(ELEM(elems, next), ELEM(elems, lo))) {
+        for (next++; next < hi; next++) {
+            if (!LESS(ELEM(elems, next), ELEM(elems, next - 1))) {
+                break;
+            }
+        }
+
+        // Reverse, using the scratch space as swap buffer.
+        uint8_t *temp  = state->scratch;
+        size_t   left  = lo;
+        size_t   right = next - 1;
+        while (left < right) {
+            SI_copy(width, temp, ELEM(elems, left), 1);
+            SI_copy(width, ELEM(elems, left), ELEM(elems, right), 1);
+            SI_copy(width, ELEM(elems, right), temp, 1);
+            left++;
+            right--;
+        }
+    }
+    else {
+        for (next++; next < hi; next++) {
+            if (LESS(ELEM(elems, next), ELEM(elems, next - 1))) {
+                break;
+            }
+        }
+    }
+
+    return next - lo;
+}
+
+/* Sort elems[lo, hi) given that elems[lo, start) is already sorted.
+ */
+static void
+S_binary_insertion_sort(SortState *state, size_t lo, size_t hi,
+                        size_t start) {
+    const size_t          width   = state->width;
+    CFISH_Sort_Compare_t  compare = state->compare;
+    void                 *context = state->context;
+    uint8_t              *elems   = state->elems;
+    uint8_t              *pivot   = state->scratch;
+
+    for (; start < hi; start++) {
+        SI_copy(width, pivot, ELEM(elems, start), 1);
+
+        // Find the insertion point after any equal elements.
+        size_t left  = lo;
+        size_t right = start;
+        while (left < right) {
+            size_t mid = left + ((right - left) >> 1);
+            if (LESS(pivot, ELEM(elems, mid))) {
+                right = mid;
+            }
+            else {
+                left = mid + 1;
+            }
+        }
+
+        SI_move(width, ELEM(elems, left + 1), ELEM(elems, left),
+                start - left);
+        SI_copy(width, ELEM(elems, left), pivot, 1);
+    }
+}
+
+/* Merge runs until the stack invariants hold again:
+ *
+ *     run_len[i - 2] > run_len[i - 1] + run_len[i]
+ *     run_len[i - 1] > run_len[i]
+ *
+ * The invariants are checked for the top four runs, which fixes a flaw in
+ * the original TimSort.
+ */
+static void
+S_merge_collapse(SortState *state) {
+    size_t *len = state->run_len;
+    while (state->num_runs > 1) {
+        size_t n = state->num_runs - 2;
+        if ((n > 0 && len[n - 1] <= len[n] + len[n + 1])
+            || (n > 1 && len[n - 2] <= len[n - 1] + len[n])
+           ) {
+            if (len[n - 1] < len[n + 1]) { n--; }
+        }
+        else if (len[n] > len[n + 1]) {
             break;
+        }
+        S_merge_at(state, n);
     }
 }
 
-#define WIDTH 4
 static void
-S_msort4(void *velems, void *vscratch, size_t left, size_t right,
-         CFISH_Sort_Compare_t compare, void *context) {
-    uint8_t *elems   = (uint8_t*)velems;
-    uint8_t *scratch = (uint8_t*)vscratch;
-    if (right > left) {
-        const size_t mid = left + (right - left) / 2 + 1;
-        S_msort4(elems, scratch, left, mid - 1, compare, context);
-        S_msort4(elems, scratch, mid,  right, compare, context);
-        SI_merge((elems + left * WIDTH), (mid - left),
-                 (elems + mid * WIDTH), (right - mid + 1),
-                 scratch, WIDTH, compare, context);
-        memcpy((elems + left * WIDTH), scratch, ((right - left + 1) * WIDTH));
+S_merge_force_collapse(SortState *state) {
+    size_t *len = state->run_len;
+    while (state->num_runs > 1) {
+        size_t n = state->num_runs - 2;
+        if (n > 0 && len[n - 1] < len[n + 1]) { n--; }
+        S_merge_at(state, n);
     }
 }
 
-#undef WIDTH
-#define WIDTH 8
+/* Merge the runs at stack positions `i` and `i + 1`.
+ */
 static void
-S_msort8(void *velems, void *vscratch, size_t left, size_t right,
-         CFISH_Sort_Compare_t compare, void *context) {
-    uint8_t *elems   = (uint8_t*)velems;
-    uint8_t *scratch = (uint8_t*)vscratch;
-    if (right > left) {
-        const size_t mid = left + (right - left) / 2 + 1;
-        S_msort8(elems, scratch, left, mid - 1, compare, context);
-        S_msort8(elems, scratch, mid,  right, compare, context);
-        SI_merge((elems + left * WIDTH), (mid - left),
-                 (elems + mid * WIDTH), (right - mid + 1),
-                 scratch, WIDTH, compare, context);
-        memcpy((elems + left * WIDTH), scratch, ((right - left + 1) * WIDTH));
+S_merge_at(SortState *state, size_t i) {
+    const size_t  width = state->width;
+    uint8_t      *elems = state->elems;
+    size_t        base1 = state->run_base[i];
+    size_t        len1  = state->run_len[i];
+    size_t        base2 = state->run_base[i + 1];
+    size_t        len2  = state->run_len[i + 1];
+
+    state->run_len[i] = len1 + len2;
+    if (i == state->num_runs - 3) {
+        state->run_base[i + 1] = state->run_base[i + 2];
+        state->run_len[i + 1]  = state->run_len[i + 2];
+    }
+    state->num_runs--;
+
+    // Elements of run 1 which are not greater than the first element of
+    // run 2 are already in place.
+    size_t k = S_gallop_right(state, ELEM(elems, base2), ELEM(elems, base1),
+                              len1, 0);
+    base1 += k;
+    len1  -= k;
+    if (len1 == 0) { return; }
+
+    // Elements of run 2 which are not less than the last element of run 1
+    // are already in place.
+    len2 = S_gallop_left(state, ELEM(elems, base1 + len1 - 1),
+                         ELEM(elems, base2), len2, len2 - 1);
+    if (len2 == 0) { return; }
+
+    if (len1 <= len2) {
+        S_merge_lo(state, base1, len1, base2, len2);
+    }
+    else {
+        S_merge_hi(state, base1, len1, base2, len2);
     }
 }
 
-#undef WIDTH
+/* Merge two adjacent runs, copying the first one into scratch space and
+ * merging from the left.  Requires len1 <= len2, the first element of run 2
+ * to be less than the first element of run 1, and the last element of run 1
+ * to be greater than all elements of run 2.
+ */
 static void
-S_msort_any(void *velems, void *vscratch, size_t left, size_t right,
-            CFISH_Sort_Compare_t compare, void *context, size_t width) {
-    uint8_t *elems   = (uint8_t*)velems;
-    uint8_t *scratch = (uint8_t*)vscratch;
-    if (right > left) {
-        const size_t mid = left + (right - left) / 2 + 1;
-        S_msort_any(elems, scratch, left, mid - 1, compare, context, width);
-        S_msort_any(elems, scratch, mid,  right,   compare, context, width);
-        SI_merge((elems + left * width), (mid - left),
-                 (elems + mid * width), (right - mid + 1),
-                 scratch, width, compare, context);
-        memcpy((elems + left * width), scratch, ((right - left + 1) * width));
+S_merge_lo(SortState *state, size_t base1, size_t len1, size_t base2,
+           size_t len2) {
+    const size_t          width      = state->width;
+    CFISH_Sort_Compare_t  compare    = state->compare;
+    void                 *context    = state->context;
+    size_t                min_gallop = state->min_gallop;
+    size_t                num_a      = len1;
+    size_t                num_b      = len2;
+    uint8_t              *a          = state->scratch;
+    uint8_t              *b          = ELEM(state->elems, base2);
+    uint8_t              *dest       = ELEM(state->elems, base1);
+    size_t                k;
+
+    SI_copy(width, a, dest, len1);
+
+    SI_copy(width, dest, b, 1);
+    dest += width;
+    b    += width;
+    num_b--;
+    if (num_b == 0) { goto SUCCEED; }
+    if (num_a == 1) { goto COPY_B; }
+
+    while (1) {
+        size_t a_count = 0;
+        size_t b_count = 0;
+
+        // Merge one element at a time until one run wins consistently.
+        while (1) {
+            if (LESS(b, a)) {
+                SI_copy(width, dest, b, 1);
+                dest += width;
+                b    += width;
+                num_b--;
+                b_count++;
+                a_count = 0;
+                if (num_b == 0) { goto SUCCEED; }
+                if (b_count >= min_gallop) { break; }
+            }
+            else {
+                SI_copy(width, dest, a, 1);
+                dest += width;
+                a    += width;
+                num_a--;
+                a_count++;
+                b_count = 0;
+                if (num_a == 1) { goto COPY_B; }
+                if (a_count >= min_gallop) { break; }
+            }
+        }
+
+        // Gallop until neither run wins consistently anymore.
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            state->min_gallop = min_gallop;
+
+            k = S_gallop_right(state, b, a, num_a, 0);
+            a_count = k;
+            if (k) {
+                SI_copy(width, dest, a, k);
+                dest  += k * width;
+                a     += k * width;
+                num_a -= k;
+                // num_a == 0 is impossible for consistent comparators.
+                if (num_a <= 1) {
+                    if (num_a == 1) { goto COPY_B; }
+                    goto SUCCEED;
+                }
+            }
+            SI_copy(width, dest, b, 1);
+            dest += width;
+            b    += width;
+            num_b--;
+            if (num_b == 0) { goto SUCCEED; }
+
+            k = S_gallop_left(state, a, b, num_b, 0);
+            b_count = k;
+            if (k) {
+                SI_move(width, dest, b, k);
+                dest  += k * width;
+                b     += k * width;
+                num_b -= k;
+                if (num_b == 0) { goto SUCCEED; }
+            }
+            SI_copy(width, dest, a, 1);
+            dest += width;
+            a    += width;
+            num_a--;
+            if (num_a == 1) { goto COPY_B; }
+        } while (a_count >= MIN_GALLOP || b_count >= MIN_GALLOP);
+        min_gallop++;
+        state->min_gallop = min_gallop;
+    }
+
+SUCCEED:
+    SI_copy(width, dest, a, num_a);
+    return;
+
+COPY_B:
+    // The last element of run 1 belongs at the end of the merge.
+    SI_move(width, dest, b, num_b);
+    SI_copy(width, dest + num_b * width, a, 1);
+}
+
+/* Merge two adjacent runs, copying the second one into scratch space and
+ * merging from the right.  Requires len1 >= len2 and the same conditions
+ * as S_merge_lo.
+ */
+static void
+S_merge_hi(SortState *state, size_t base1, size_t len1, size_t base2,
+           size_t len2) {
+    // The cursors point one element past the last remaining element, so
+    // they never move in front of the start of their array.
+    const size_t          width      = state->width;
+    CFISH_Sort_Compare_t  compare    = state->compare;
+    void                 *context    = state->context;
+    size_t                min_gallop = state->min_gallop;
+    size_t                num_a      = len1;
+    size_t                num_b      = len2;
+    uint8_t              *a_start    = ELEM(state->elems, base1);
+    uint8_t              *b_start    = state->scratch;
+    uint8_t              *a_end      = ELEM(state->elems, base1 + len1);
+    uint8_t              *b_end      = ELEM(b_start, len2);
+    uint8_t              *dest_end   = ELEM(state->elems, base2 + len2);
+    size_t                k;
+
+    SI_copy(width, b_start, ELEM(state->elems, base2), len2);
+
+    dest_end -= width;
+    a_end    -= width;
+    SI_copy(width, dest_end, a_end, 1);
+    num_a--;
+    if (num_a == 0) { goto SUCCEED; }
+    if (num_b == 1) { goto COPY_A; }
+
+    while (1) {
+        size_t a_count = 0;
+        size_t b_count = 0;
+
+        // Merge one element at a time until one run wins consistently.
+        while (1) {
+            if (LESS(b_end - width, a_end - width)) {
+                dest_end -= width;
+                a_end    -= width;
+                SI_copy(width, dest_end, a_end, 1);
+                num_a--;
+                a_count++;
+                b_count = 0;
+                if (num_a == 0) { goto SUCCEED; }
+                if (a_count >= min_gallop) { break; }
+            }
+            else {
+                dest_end -= width;
+                b_end    -= width;
+                SI_copy(width, dest_end, b_end, 1);
+                num_b--;
+                b_count++;
+                a_count = 0;
+                if (num_b == 1) { goto COPY_A; }
+                if (b_count >= min_gallop) { break; }
+            }
+        }
+
+        // Gallop until neither run wins consistently anymore.
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            state->min_gallop = min_gallop;
+
+            k = num_a - S_gallop_right(state, b_end - width, a_start, num_a,
+                                       num_a - 1);
+            a_count = k;
+            if (k) {
+                dest_end -= k * width;
+                a_end    -= k * width;
+                SI_move(width, dest_end, a_end, k);
+                num_a -= k;
+                if (num_a == 0) { goto SUCCEED; }
+            }
+            dest_end -= width;
+            b_end    -= width;
+            SI_copy(width, dest_end, b_end, 1);
+            num_b--;
+            if (num_b == 1) { goto COPY_A; }
+
+            k = num_b - S_gallop_left(state, a_end - width, b_start, num_b,
+                                      num_b - 1);
+            b_count = k;
+            if (k) {
+                dest_end -= k * width;
+                b_end    -= k * width;
+                SI_copy(width, dest_end, b_end, k);
+                num_b -= k;
+                // num_b == 0 is impossible for consistent comparators.
+                if (num_b <= 1) {
+                    if (num_b == 1) { goto COPY_A; }
+                    goto SUCCEED;
+                }
+            }
+            dest_end -= width;
+            a_end    -= width;
+            SI_copy(width, dest_end, a_end, 1);
+            num_a--;
+            if (num_a == 0) { goto SUCCEED; }
+        } while (a_count >= MIN_GALLOP || b_count >= MIN_GALLOP);
+        min_gallop++;
+        state->min_gallop = min_gallop;
+    }
+
+SUCCEED:
+    SI_copy(width, ELEM(a_start, num_a), b_start, num_b);
+    return;
+
+COPY_A:
+    // The first element of run 2 belongs at the start of the merge.
+    SI_move(width, ELEM(a_start, 1), a_start, num_a);
+    SI_copy(width, a_start, b_start, 1);
+}
+
+/* Locate the position at which to insert `key` into the sorted array
+ * `elems` before any equal elements, starting the search at `hint`.
+ * Returns k such that elems[k - 1] < key <= elems[k].
+ */
+static size_t
+S_gallop_left(SortState *state, const uint8_t *key, const uint8_t *elems,
+              size_t num_elems, size_t hint) {
+    const size_t          width    = state->width;
+    CFISH_Sort_Compare_t  compare  = state->compare;
+    void                 *context  = state->context;
+    size_t                last_ofs = 0;
+    size_t                ofs      = 1;
+    size_t                lo, hi;
+
+    if (LESS(ELEM(elems, hint), key)) {
+        // elems[hint] < key: gallop right until
+        // elems[hint + last_ofs] < key <= elems[hint + ofs].
+        const size_t max_ofs = num_elems - hint;
+        while (ofs < max_ofs && LESS(ELEM(elems, hint + ofs), key)) {
+            last_ofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > max_ofs) { ofs = max_ofs; }
+        lo = hint + last_ofs + 1;
+        hi = hint + ofs;
+    }
+    else {
+        // key <= elems[hint]: gallop left until
+        // elems[hint - ofs] < key <= elems[hint - last_ofs].
+        const size_t max_ofs = hint + 1;
+        while (ofs < max_ofs
+               && !LESS(ELEM(elems, hint - ofs), key)
+              ) {
+            last_ofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > max_ofs) { ofs = max_ofs; }
+        lo = hint + 1 - ofs;
+        hi = hint - last_ofs;
+    }
+
+    // Binary search in [lo, hi].
+    while (lo < hi) {
+        size_t mid = lo + ((hi - lo) >> 1);
+        if (LESS(ELEM(elems, mid), key)) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
     }
+
+    return hi;
 }
 
+/* Locate the position at which to insert `key` into the sorted array
+ * `elems` after any equal elements, starting the search at `hint`.
+ * Returns k such that elems[k - 1] <= key < elems[k].
+ */
+static size_t
+S_gallop_right(SortState *state, const uint8_t *key, const uint8_t *elems,
+               size_t num_elems, size_t hint) {
+    const size_t          width    = state->width;
+    CFISH_Sort_Compare_t  compare  = state->compare;
+    void                 *context  = state->context;
+    size_t                last_ofs = 0;
+    size_t                ofs      = 1;
+    size_t                lo, hi;
+
+    if (LESS(key, ELEM(elems, hint))) {
+        // key < elems[hint]: gallop left until
+        // elems[hint - ofs] <= key < elems[hint - last_ofs].
+        const size_t max_ofs = hint + 1;
+        while (ofs < max_ofs && LESS(key, ELEM(elems, hint - ofs))) {
+            last_ofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > max_ofs) { ofs = max_ofs; }
+        lo = hint + 1 - ofs;
+        hi = hint - last_ofs;
+    }
+    else {
+        // elems[hint] <= key: gallop right until
+        // elems[hint + last_ofs] <= key < elems[hint + ofs].
+        const size_t max_ofs = num_elems - hint;
+        while (ofs < max_ofs
+               && !LESS(key, ELEM(elems, hint + ofs))
+              ) {
+            last_ofs = ofs;
+            ofs = (ofs << 1) + 1;
+        }
+        if (ofs > max_ofs) { ofs = max_ofs; }
+        lo = hint + last_ofs + 1;
+        hi = hint + ofs;
+    }
+
+    // Binary search in [lo, hi].
+    while (lo < hi) {
+        size_t mid = lo + ((hi - lo) >> 1);
+        if (LESS(key, ELEM(elems, mid))) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+
+    return hi;
+}
+
+/***************************** Partial sorting ******************************/
+
+// Ranges at most this long are finished with insertion sort.
+#define SELECT_INSERTION_THRESHOLD 16
+
 static CFISH_INLINE void
-SI_merge(void *left_vptr,  size_t left_size,
-         void *right_vptr, size_t right_size,
-         void *vdest, size_t width, CFISH_Sort_Compare_t compare,
-         void *context) {
-    uint8_t *left_ptr    = (uint8_t*)left_vptr;
-    uint8_t *right_ptr   = (uint8_t*)right_vptr;
-    uint8_t *left_limit  = left_ptr + left_size * width;
-    uint8_t *right_limit = right_ptr + right_size * width;
-    uint8_t *dest        = (uint8_t*)vdest;
-
-    while (left_ptr < left_limit && right_ptr < right_limit) {
-        if (compare(context, left_ptr, right_ptr) < 1) {
-            memcpy(dest, left_ptr, width);
-            dest += width;
-            left_ptr += width;
+SI_swap(size_t width, uint8_t *a, uint8_t *b) {
+    uint8_t buf[64];
+    while (width > 0) {
+        size_t chunk = width < sizeof(buf) ? width : sizeof(buf);
+        memcpy(buf, a, chunk);
+        memcpy(a, b, chunk);
+        memcpy(b, buf, chunk);
+        a     += chunk;
+        b     += chunk;
+        width -= chunk;
+    }
+}
+
+/* Restore the max-heap property for the subtree rooted at `root` of the
+ * heap elems[0, num_elems).
+ */
+static void
+S_sift_down(uint8_t *elems, size_t root, size_t num_elems, size_t width,
+            CFISH_Sort_Compare_t compare, void *context) {
+    while (1) {
+        size_t child = 2 * root + 1;
+        if (child >= num_elems) { break; }
+        if (child + 1 < num_elems
+            && LESS(ELEM(elems, child), ELEM(elems, child + 1))
+           ) {
+            child++;
+        }
+        if (!LESS(ELEM(elems, root), ELEM(elems, child))) { break; }
+        SI_swap(width, ELEM(elems, root), ELEM(elems, child));
+        root = child;
+    }
+}
+
+/* Move the `k` smallest elements of elems[0, num_elems) into a max-heap at
+ * elems[0, k).
+ */
+static void
+S_heap_select(uint8_t *elems, size_t num_elems, size_t k, size_t width,
+              CFISH_Sort_Compare_t compare, void *context) {
+    for (size_t i = k / 2; i-- > 0;) {
+        S_sift_down(elems, i, k, width, compare, context);
+    }
+    for (size_t i = k; i < num_elems; i++) {
+        if (LESS(ELEM(elems, i), elems)) {
+            SI_swap(width, ELEM(elems, i), elems);
+            S_sift_down(elems, 0, k, width, compare, context);
+        }
+    }
+}
+
+void
+Sort_partial(void *velems, size_t num_elems, size_t k, size_t width,
+             CFISH_Sort_Compare_t compare, void *context) {
+    uint8_t *elems = (uint8_t*)velems;
+    if (width == 0) {
+        THROW(ERR, "Parameter 'width' cannot be 0");
+        return;
+    }
+    if (k > num_elems) { k = num_elems; }
+    if (k == 0) { return; }
+
+    S_heap_select(elems, num_elems, k, width, compare, context);
+
+    // Heap sort the selected elements.
+    for (size_t end = k - 1; end > 0; end--) {
+        SI_swap(width, elems, ELEM(elems, end));
+        S_sift_down(elems, 0, end, width, compare, context);
+    }
+}
+
+static void
+S_insertion_sort(uint8_t *elems, size_t num_elems, size_t width,
+                 CFISH_Sort_Compare_t compare, void *context) {
+    for (size_t i = 1; i < num_elems; i++) {
+        for (size_t j = i;
+             j > 0 && LESS(ELEM(elems, j), ELEM(elems, j - 1));
+             j--
+            ) {
+            SI_swap(width, ELEM(elems, j), ELEM(elems, j - 1));
+        }
+    }
+}
+
+void
+Sort_select(void *velems, size_t num_elems, size_t nth, size_t width,
+            CFISH_Sort_Compare_t compare, void *context) {
+    uint8_t *elems = (uint8_t*)velems;
+    if (width == 0) {
+        THROW(ERR, "Parameter 'width' cannot be 0");
+        return;
+    }
+    if (nth >= num_elems) { return; }
+
+    // Fall back to heap selection after 2 * log2(num_elems) partitioning
+    // rounds which didn't shrink the range enough.
+    size_t depth_limit = 0;
+    for (size_t n = num_elems; n > 1; n >>= 1) { depth_limit += 2; }
+
+    size_t lo = 0;
+    size_t hi = num_elems;
+    while (hi - lo > SELECT_INSERTION_THRESHOLD) {
+        if (depth_limit-- == 0) {
+            uint8_t *range = ELEM(elems, lo);
+            size_t   k     = nth - lo + 1;
+            S_heap_select(range, hi - lo, k, width, compare, context);
+            // The largest of the k smallest elements is the nth element.
+            SI_swap(width, range, ELEM(range, k - 1));
+            return;
+        }
+
+        // Move the median of three to the front as pivot.
+        size_t   mid   = lo + (hi - lo) / 2;
+        uint8_t *first = ELEM(elems, lo);
+        uint8_t *a     = ELEM(elems, lo + 1);
+        uint8_t *b     = ELEM(elems, mid);
+        uint8_t *c     = ELEM(elems, hi - 1);
+        if (LESS(b, a)) { SI_swap(width, a, b); }
+        if (LESS(c, b)) {
+            SI_swap(width, b, c);
+            if (LESS(b, a)) { SI_swap(width, a, b); }
+        }
+        SI_swap(width, first, b);
+
+        // Hoare partition.  Elements equal to the pivot end up on both
+        // sides, which keeps ranges of duplicates balanced.
+        size_t left  = lo + 1;
+        size_t right = hi - 1;
+        while (1) {
+            while (LESS(ELEM(elems, left), first))  { left++; }
+            while (LESS(first, ELEM(elems, right))) { right--; }
+            if (left >= right) { break; }
+            SI_swap(width, ELEM(elems, left), ELEM(elems, right));
+            left++;
+            right--;
+        }
+        SI_swap(width, first, ELEM(elems, right));
+
+        // The pivot is now in its final position.
+        if (nth == right)     { return; }
+        else if (nth < right) { hi = right; }
+        else                  { lo = right + 1; }
+    }
+
+    S_insertion_sort(ELEM(elems, lo), hi - lo, width, compare, context);
+}
+
+/******************************* Parallel sort ******************************/
+
+/* Sort_parallel_mergesort sorts equal chunks of the array on separate
+ * threads, then merges pairs of sorted runs until a single run remains.
+ * Each merge is split into segments of the output which are merged by
+ * different threads.  The split points are found with a binary search
+ * ("co-ranking"), so the merges stay stable.  Merges alternate between the
+ * array and the scratch buffer.
+ */
+
+// Don't start a thread for less than this many elements.
+#define MIN_ELEMS_PER_THREAD 8192
+
+#define MAX_THREADS 64
+
+// Each merge round creates at most one task per thread plus one per pair.
+#define MAX_TASKS (2 * MAX_THREADS)
+
+typedef struct {
+    CFISH_Sort_Compare_t  compare;
+    void                 *context;
+    size_t                width;
+    // Chunk to sort, or destination of a merge.
+    uint8_t              *elems;
+    uint8_t              *scratch;
+    size_t                num_elems;
+    // Runs to merge.  `scratch` is NULL for merge tasks.
+    const uint8_t        *left;
+    size_t                left_len;
+    const uint8_t        *right;
+    size_t                right_len;
+} SortTask;
+
+typedef struct {
+    SortTask *tasks;
+    size_t    num_tasks;
+    size_t    first;
+    size_t    stride;
+} SortWorker;
+
+static uint32_t Sort_max_threads = 0;
+
+static uint32_t
+S_num_cpus(void);
+
+static bool
+S_thread_start(void **handle, void (*routine)(void *arg), void *arg);
+
+static void
+S_thread_join(void *handle);
+
+void
+Sort_set_max_threads(uint32_t max_threads) {
+    Sort_max_threads = max_threads;
+}
+
+uint32_t
+Sort_get_max_threads() {
+    uint32_t max_threads = Sort_max_threads ? Sort_max_threads : S_num_cpus();
+    return max_threads > MAX_THREADS ? MAX_THREADS : max_threads;
+}
+
+/* Return the number of elements of the left run among the first `rank`
+ * elements of the stable merge of both runs.
+ */
+static size_t
+S_co_rank(const uint8_t *left, size_t left_len, const uint8_t *right,
+          size_t right_len, size_t rank, size_t width,
+          CFISH_Sort_Compare_t compare, void *context) {
+    size_t lo = rank > right_len ? rank - right_len : 0;
+    size_t hi = rank < left_len ? rank : left_len;
+
+    while (lo < hi) {
+        size_t i = lo + ((hi - lo) >> 1);
+        size_t j = rank - i;
+        // Too few elements from the left run if left[i] must precede
+        // right[j - 1].  Ties go to the left run.
+        if (j > 0 && !LESS(ELEM(right, j - 1), ELEM(left, i))) {
+            lo = i + 1;
         }
         else {
-            memcpy(dest, right_ptr, width);
-            dest += width;
-            right_ptr += width;
+            hi = i;
         }
     }
 
-    const ptrdiff_t left_remaining = left_limit - left_ptr;
-    memcpy(dest, left_ptr, (size_t)left_remaining);
-    dest += left_remaining;
-    const ptrdiff_t right_remaining = right_limit - right_ptr;
-    memcpy(dest, right_ptr, (size_t)right_remaining);
+    return lo;
 }
 
+static void
+S_merge_segment(SortTask *task) {
+    const size_t          width       = task->width;
+    CFISH_Sort_Compare_t  compare     = task->compare;
+    void                 *context     = task->context;
+    const uint8_t        *left        = task->left;
+    const uint8_t        *left_limit  = ELEM(left, task->left_len);
+    const uint8_t        *right       = task->right;
+    const uint8_t        *right_limit = ELEM(right, task->right_len);
+    uint8_t              *dest        = task->elems;
+
+    while (left < left_limit && right < right_limit) {
+        if (LESS(right, left)) {
+            SI_copy(width, dest, right, 1);
+            right += width;
+        }
+        else {
+            SI_copy(width, dest, left, 1);
+            left += width;
+        }
+        dest += width;
+    }
+    SI_copy(width, dest, left, (size_t)(left_limit - left) / width);
+    dest += left_limit - left;
+    SI_copy(width, dest, right, (size_t)(right_limit - right) / width);
+}
+
+static void
+S_run_worker(void *arg) {
+    SortWorker *worker = (SortWorker*)arg;
+    for (size_t i = worker->first; i < worker->num_tasks; i += worker->stride) {
+        SortTask *task = &worker->tasks[i];
+        if (task->scratch) {
+            Sort_mergesort(task->elems, task->scratch, task->num_elems,
+                           task->width, task->compare, task->context);
+        }
+        else {
+            S_merge_segment(task);
+        }
+    }
+}
+
+static void
+S_run_tasks(SortTask *tasks, size_t num_tasks, size_t num_threads) {
+    SortWorker  workers[MAX_THREADS];
+    void       *handles[MAX_THREADS];
+    bool        started[MAX_THREADS];
+
+    if (num_threads > num_tasks) { num_threads = num_tasks; }
+    for (size_t i = 0; i < num_threads; i++) {
+        workers[i].tasks     = tasks;
+        workers[i].num_tasks = num_tasks;
+        workers[i].first     = i;
+        workers[i].stride    = num_threads;
+    }
+
+    // The calling thread acts as the first worker.  If a thread can't be
+    // started, its tasks run on the calling thread.
+    for (size_t i = 1; i < num_threads; i++) {
+        started[i] = S_thread_start(&handles[i], S_run_worker, &workers[i]);
+    }
+    S_run_worker(&workers[0]);
+    for (size_t i = 1; i < num_threads; i++) {
+        if (started[i]) {
+            S_thread_join(handles[i]);
+        }
+        else {
+            S_run_worker(&workers[i]);
+        }
+    }
+}
+
+void
+Sort_parallel_mergesort(void *elems, void *scratch, size_t num_elems,
+                        size_t width, CFISH_Sort_Compare_t compare,
+                        void *context) {
+    size_t num_threads = Sort_get_max_threads();
+    if (num_threads > num_elems / MIN_ELEMS_PER_THREAD) {
+        num_threads = num_elems / MIN_ELEMS_PER_THREAD;
+    }
+    if (num_threads < 2 || width == 0) {
+        Sort_mergesort(elems, scratch, num_elems, width, compare, context);
+        return;
+    }
+
+    SortTask  tasks[MAX_TASKS];
+    size_t    bounds[MAX_THREADS + 1];
+    size_t    num_runs = num_threads;
+    uint8_t  *source   = (uint8_t*)elems;
+    uint8_t  *dest     = (uint8_t*)scratch;
+
+    // Sort chunks.
+    for (size_t i = 0; i <= num_runs; i++) {
+        bounds[i] = num_elems / num_runs * i + num_elems % num_runs * i
+                    / num_runs;
+    }
+    for (size_t i = 0; i < num_runs; i++) {
+        SortTask *task = &tasks[i];
+        memset(task, 0, sizeof(SortTask));
+        task->compare   = compare;
+        task->context   = context;
+        task->width     = width;
+        task->elems     = ELEM(source, bounds[i]);
+        task->scratch   = ELEM(dest, bounds[i]);
+        task->num_elems = bounds[i + 1] - bounds[i];
+    }
+    S_run_tasks(tasks, num_runs, num_threads);
+
+    // Merge pairs of runs.  A trailing odd run is "merged" with an empty
+    // run, which copies it.
+    while (num_runs > 1) {
+        size_t num_tasks    = 0;
+        size_t num_new_runs = 0;
+
+        for (size_t r = 0; r < num_runs; r += 2) {
+            size_t start    = bounds[r];
+            size_t mid      = bounds[r + 1];
+            size_t end      = r + 2 <= num_runs ? bounds[r + 2] : mid;
+            size_t pair_len = end - start;
+            size_t segments = num_threads * pair_len / num_elems;
+            if (segments == 0) { segments = 1; }
+
+            // Split points are computed up front and forced to be
+            // monotonic, so that the segments form a permutation even if
+            // the compare function is inconsistent.
+            size_t left_len  = mid - start;
+            size_t right_len = end - mid;
+            size_t prev_rank = 0;
+            size_t prev_left = 0;
+            for (size_t s = 1; s <= segments; s++) {
+                size_t rank = pair_len / segments * s
+                              + pair_len % segments * s / segments;
+                size_t split = S_co_rank(ELEM(source, start), left_len,
+                                         ELEM(source, mid), right_len,
+                                         rank, width, compare, context);
+                if (split < prev_left) { split = prev_left; }
+                if (split > prev_left + (rank - prev_rank)) {
+                    split = prev_left + (rank - prev_rank);
+                }
+
+                SortTask *task = &tasks[num_tasks++];
+                memset(task, 0, sizeof(SortTask));
+                task->compare   = compare;
+                task->context   = context;
+                task->width     = width;
+                task->elems     = ELEM(dest, start + prev_rank);
+                task->left      = ELEM(source, start + prev_left);
+                task->left_len  = split - prev_left;
+                task->right     = ELEM(source, mid + (prev_rank - prev_left));
+                task->right_len = (rank - split) - (prev_rank - prev_left);
+
+                prev_rank = rank;
+                prev_left = split;
+            }
+
+            bounds[num_new_runs++] = start;
+        }
+        bounds[num_new_runs] = num_elems;
+
+        S_run_tasks(tasks, num_tasks, num_threads);
+
+        num_runs = num_new_runs;
+        uint8_t *temp = source;
+        source = dest;
+        dest   = temp;
+    }
+
+    if (source != elems) {
+        memcpy(elems, source, num_elems * width);
+    }
+}
+
+/********************************* Windows *********************************/
+#if !defined(CFISH_NOTHREADS) && defined(CHY_HAS_WINDOWS_H)
+
+#include <windows.h>
+
+typedef struct {
+    HANDLE   handle;
+    void   (*routine)(void *arg);
+    void    *arg;
+} SortThread;
+
+static DWORD __stdcall
+S_thread(void *arg) {
+    SortThread *thread = (SortThread*)arg;
+    thread->routine(thread->arg);
+    return 0;
+}
+
+static bool
+S_thread_start(void **handle, void (*routine)(void *arg), void *arg) {
+    SortThread *thread = (SortThread*)MALLOCATE(sizeof(SortThread));
+    thread->routine = routine;
+    thread->arg     = arg;
+    thread->handle  = CreateThread(NULL, 0, S_thread, thread, 0, NULL);
+    if (thread->handle == NULL) {
+        FREEMEM(thread);
+        return false;
+    }
+    *handle = thread;
+    return true;
+}
+
+static void
+S_thread_join(void *handle) {
+    SortThread *thread = (SortThread*)handle;
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    FREEMEM(thread);
+}
+
+static uint32_t
+S_num_cpus(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint32_t)info.dwNumberOfProcessors;
+}
+
+/******************************** pthreads *********************************/
+#elif !defined(CFISH_NOTHREADS) && defined(CHY_HAS_PTHREAD_H)
+
+#include <pthread.h>
+#include <unistd.h>
+
+typedef struct {
+    pthread_t   pthread;
+    void      (*routine)(void *arg);
+    void       *arg;
+} SortThread;
+
+static void*
+S_thread(void *arg) {
+    SortThread *thread = (SortThread*)arg;
+    thread->routine(thread->arg);
+    return NULL;
+}
+
+static bool
+S_thread_start(void **handle, void (*routine)(void *arg), void *arg) {
+    SortThread *thread = (SortThread*)MALLOCATE(sizeof(SortThread));
+    thread->routine = routine;
+    thread->arg     = arg;
+    if (pthread_create(&thread->pthread, NULL, S_thread, thread) != 0) {
+        FREEMEM(thread);
+        return false;
+    }
+    *handle = thread;
+    return true;
+}
+
+static void
+S_thread_join(void *handle) {
+    SortThread *thread = (SortThread*)handle;
+    pthread_join(thread->pthread, NULL);
+    FREEMEM(thread);
+}
+
+static uint32_t
+S_num_cpus(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return num_cpus > 0 ? (uint32_t)num_cpus : 1;
+#else
+    return 1;
+#endif
+}
+
+/**************************** No thread support ****************************/
+#else
+
+static bool
+S_thread_start(void **handle, void (*routine)(void *arg), void *arg) {
+    UNUSED_VAR(handle);
+    UNUSED_VAR(routine);
+    UNUSED_VAR(arg);
+    return false;
+}
+
+static void
+S_thread_join(void *handle) {
+    UNUSED_VAR(handle);
+}
+
+static uint32_t
+S_num_cpus(void) {
+    return 1;
+}
 
+#endif
@@ -17,17 +17,38 @@
 #define C_CFISH_VECTOR
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #define CFISH_USE_SHORT_NAMES
 
 #include "Clownfish/Class.h"
 #include "Clownfish/Vector.h"
+#include "Clownfish/CharBuf.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/SegmentedVector.h"
+#include "Clownfish/String.h"
 #include "Clownfish/Util/Memory.h"
+#include "Clownfish/Util/Hashing.h"
 #include "Clownfish/Util/SortUtils.h"
 
 #define MAX_VECTOR_SIZE (SIZE_MAX / sizeof(Obj*))
 
+// Below this size, specialized sorts use a merge sort on the keys rather
+// than a radix sort.
+#define RADIX_SORT_THRESHOLD 64
+
+#define KEY_SIGN_BIT UINT64_C(0x8000000000000000)
+
+// An object paired with an unsigned integer key whose ordering matches the
+// ordering of the objects (or, for Strings, of their first eight bytes).
+typedef struct {
+    uint64_t  key;
+    Obj      *obj;
+} SortKey;
+
 static CFISH_INLINE void
 SI_copy_and_incref(Obj **dst, Obj **src, size_t num);
 
@@ -37,6 +58,13 @@ SI_add_grow_and_oversize(Vector *self, size_t size, size_t extra);
 static void
 S_grow_and_oversize(Vector *self, size_t min_size);
 
+static bool
+S_sort_specialized(Vector *self, bool parallel);
+
+static void
+S_sort_elems(Vector *self, size_t num_elems, CFISH_Sort_Compare_t compare,
+             void *context);
+
 static void
 S_overflow_error(void);
 
@@ -64,11 +92,7 @@ Vec_init(Vector *self, size_t capacity) {
 void
 Vec_Destroy_IMP(Vector *self) {
     if (self->elems) {
-        Obj **elems        = self->elems;
-        Obj **const limit  = elems + self->size;
-        for (; elems < limit; elems++) {
-            DECREF(*elems);
-        }
+        cfish_decref_array(self->elems, self->size);
         FREEMEM(self->elems);
     }
     SUPER_DESTROY(self, VECTOR);
@@ -192,10 +216,7 @@ Vec_Excise_IMP(Vector *self, size_t offset, size_t length) {
     if (offset >= self->size)         { return; }
     if (length > self->size - offset) { length = self->size - offset; }
 
-    Obj **elems = self->elems;
-    for (size_t i = 0; i < length; i++) {
-        DECREF(elems[offset + i]);
-    }
+    cfish_decref_array(self->elems + offset, length);
 
     size_t num_to_move = self->size - (offset + length);
     memmove(self->elems + offset, self->elems + offset + length,
@@ -242,19 +263,592 @@ S_default_compare(void *context, const void *va, const void *vb) {
     else  /* b == NULL */            { return -1; } // NULL to the back
 }
 
+// State of a generic sort, kept outside of the trapped routine so that the
+// buffers can be freed if `compare` throws.
+typedef struct {
+    Obj                  **elems;
+    Obj                  **scratch;
+    size_t                 num_elems;
+    CFISH_Sort_Compare_t   compare;
+    void                  *context;
+} ElemSorter;
+
+static void
+S_do_sort_elems(void *vsorter) {
+    ElemSorter *sorter = (ElemSorter*)vsorter;
+    Sort_mergesort(sorter->elems, sorter->scratch, sorter->num_elems,
+                   sizeof(Obj*), sorter->compare, sorter->context);
+}
+
+// Sort the first `num_elems` elements with a merge sort.  A merge which is
+// interrupted by an exception leaves its array with elements lost or
+// duplicated, so sort a copy and only write it back on success.
+static void
+S_sort_elems(Vector *self, size_t num_elems, CFISH_Sort_Compare_t compare,
+             void *context) {
+    ElemSorter sorter;
+    sorter.elems     = (Obj**)MALLOCATE(2 * num_elems * sizeof(Obj*));
+    sorter.scratch   = sorter.elems + num_elems;
+    sorter.num_elems = num_elems;
+    sorter.compare   = compare;
+    sorter.context   = context;
+    memcpy(sorter.elems, self->elems, num_elems * sizeof(Obj*));
+
+    Err *error = Err_trap(S_do_sort_elems, &sorter);
+    if (!error) {
+        memcpy(self->elems, sorter.elems, num_elems * sizeof(Obj*));
+    }
+    FREEMEM(sorter.elems);
+    if (error) {
+        RETHROW(error);
+    }
+}
+
 void
 Vec_Sort_IMP(Vector *self) {
-    void *scratch = MALLOCATE(self->size * sizeof(Obj*));
-    Sort_mergesort(self->elems, scratch, self->size, sizeof(void*),
-                   S_default_compare, NULL);
-    FREEMEM(scratch);
+    if (self->size < 2) { return; }
+    if (S_sort_specialized(self, false)) { return; }
+    S_sort_elems(self, self->size, S_default_compare, NULL);
+}
+
+void
+Vec_Sort_Parallel_IMP(Vector *self) {
+    if (self->size < 2) { return; }
+    if (S_sort_specialized(self, true)) { return; }
+
+    // Compare_To may throw or call into the host language, which isn't
+    // possible on worker threads, so other Vectors are sorted serially.
+    S_sort_elems(self, self->size, S_default_compare, NULL);
+}
+
+// Break ties by the original position, which makes partial sorts and
+// selection agree with the stable Sort.
+static int
+S_compare_with_position(void *context, const void *va, const void *vb) {
+    const SortKey *a = (const SortKey*)va;
+    const SortKey *b = (const SortKey*)vb;
+    int comparison = S_default_compare(context, &a->obj, &b->obj);
+    if (comparison != 0) { return comparison; }
+    return a->key < b->key ? -1 : a->key > b->key ? 1 : 0;
+}
+
+static SortKey*
+S_position_keys(Vector *self) {
+    SortKey *keys = (SortKey*)MALLOCATE(self->size * sizeof(SortKey));
+    for (size_t i = 0; i < self->size; i++) {
+        keys[i].key = i;
+        keys[i].obj = self->elems[i];
+    }
+    return keys;
+}
+
+void
+Vec_Sort_Top_K_IMP(Vector *self, size_t k) {
+    if (k > self->size) { k = self->size; }
+    if (k == 0) { return; }
+
+    SortKey *keys = S_position_keys(self);
+    Sort_partial(keys, self->size, k, sizeof(SortKey),
+                 S_compare_with_position, NULL);
+    for (size_t i = 0; i < self->size; i++) {
+        self->elems[i] = keys[i].obj;
+    }
+    FREEMEM(keys);
+}
+
+Obj*
+Vec_Select_IMP(Vector *self, size_t nth) {
+    if (nth >= self->size) { return NULL; }
+
+    SortKey *keys = S_position_keys(self);
+    Sort_select(keys, self->size, nth, sizeof(SortKey),
+                S_compare_with_position, NULL);
+    for (size_t i = 0; i < self->size; i++) {
+        self->elems[i] = keys[i].obj;
+    }
+    FREEMEM(keys);
+
+    return self->elems[nth];
+}
+
+static CFISH_INLINE uint64_t
+SI_integer_key(int64_t value) {
+    // Flip the sign bit so that unsigned order matches signed order.
+    return (uint64_t)value ^ KEY_SIGN_BIT;
+}
+
+static CFISH_INLINE uint64_t
+SI_float_key(double value) {
+    uint64_t bits;
+    // -0.0 and 0.0 compare as equal, so they must share a key.
+    if (value == 0.0) { value = 0.0; }
+    memcpy(&bits, &value, sizeof(bits));
+    // Negative numbers have all bits flipped to reverse their order,
+    // positive numbers only the sign bit.
+    return (bits & KEY_SIGN_BIT) ? ~bits : bits | KEY_SIGN_BIT;
+}
+
+static CFISH_INLINE uint64_t
+SI_bytes_key(const char *bytes, size_t size) {
+    const uint8_t *ptr = (const uint8_t*)bytes;
+    uint64_t       key = 0;
+
+    // Big-endian prefix of the first eight bytes, padded with zeroes.
+    for (size_t i = 0; i < 8; i++) {
+        key <<= 8;
+        if (i < size) { key |= ptr[i]; }
+    }
+
+    return key;
+}
+
+static CFISH_INLINE uint64_t
+SI_string_key(String *string) {
+    return SI_bytes_key(Str_Get_Ptr8(string), Str_Get_Size(string));
+}
+
+static int
+S_compare_keys(void *context, const void *va, const void *vb) {
+    const SortKey *a = (const SortKey*)va;
+    const SortKey *b = (const SortKey*)vb;
+    UNUSED_VAR(context);
+    return a->key < b->key ? -1 : a->key > b->key ? 1 : 0;
+}
+
+// Compare byte strings with equal prefix keys.  Bytes covered by the keys
+// are known to be equal.
+static CFISH_INLINE int
+SI_compare_byte_tails(const char *ptr_a, size_t size_a, const char *ptr_b,
+                      size_t size_b) {
+    size_t  min    = size_a < size_b ? size_a : size_b;
+    size_t  start  = min < 8 ? min : 8;
+    int comparison = memcmp(ptr_a + start, ptr_b + start, min - start);
+    if (comparison != 0) { return comparison < 0 ? -1 : 1; }
+    return size_a < size_b ? -1 : size_a > size_b ? 1 : 0;
+}
+
+// Same as Str_Compare_To, but without dispatch and type checks, for
+// Strings with equal prefix keys.
+static CFISH_INLINE int
+SI_compare_string_tails(String *str_a, String *str_b) {
+    return SI_compare_byte_tails(Str_Get_Ptr8(str_a), Str_Get_Size(str_a),
+                                 Str_Get_Ptr8(str_b), Str_Get_Size(str_b));
+}
+
+static int
+S_compare_string_keys(void *context, const void *va, const void *vb) {
+    const SortKey *a = (const SortKey*)va;
+    const SortKey *b = (const SortKey*)vb;
+    UNUSED_VAR(context);
+    if (a->key != b->key) { return a->key < b->key ? -1 : 1; }
+    return SI_compare_string_tails((String*)a->obj, (String*)b->obj);
+}
+
+/* Stable LSD radix sort on the keys, one byte per pass.  Passes where all
+ * keys share the same byte are skipped.  Returns whichever of `keys` and
+ * `scratch` holds the sorted result.
+ */
+static SortKey*
+S_radix_sort(SortKey *keys, SortKey *scratch, size_t num_keys) {
+    size_t   counts[8][256];
+    SortKey *source = keys;
+    SortKey *dest   = scratch;
+
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < num_keys; i++) {
+        uint64_t key = keys[i].key;
+        for (size_t pass = 0; pass < 8; pass++) {
+            counts[pass][(key >> (pass * 8)) & 0xFF]++;
+        }
+    }
+
+    for (size_t pass = 0; pass < 8; pass++) {
+        size_t   *offsets = counts[pass];
+        unsigned  shift   = (unsigned)(pass * 8);
+        if (offsets[(source[0].key >> shift) & 0xFF] == num_keys) {
+            continue;
+        }
+
+        size_t total = 0;
+        for (size_t i = 0; i < 256; i++) {
+            size_t count = offsets[i];
+            offsets[i] = total;
+            total += count;
+        }
+        for (size_t i = 0; i < num_keys; i++) {
+            dest[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+
+        SortKey *temp = source;
+        source = dest;
+        dest   = temp;
+    }
+
+    return source;
+}
+
+/* Sort Vectors whose elements are all Strings, all Integers or all Floats
+ * (NULLs allowed) without method dispatch.  The result is identical to the
+ * generic merge sort.  Returns false if the Vector isn't homogeneous.
+ */
+static bool
+S_sort_specialized(Vector *self, bool parallel) {
+    Class  *klass    = NULL;
+    size_t  num_objs = 0;
+
+    for (size_t i = 0; i < self->size; i++) {
+        Obj *elem = self->elems[i];
+        if (elem == NULL) { continue; }
+        Class *elem_class = Obj_get_class(elem);
+        if (klass == NULL) {
+            klass = elem_class;
+            if (klass != STRING && klass != INTEGER && klass != FLOAT) {
+                return false;
+            }
+        }
+        else if (elem_class != klass) {
+            return false;
+        }
+        // NaNs don't have a consistent ordering.
+        if (klass == FLOAT && isnan(Float_Get_Value((Float*)elem))) {
+            return false;
+        }
+        num_objs++;
+    }
+
+    // Only NULLs.
+    if (klass == NULL) { return true; }
+
+    SortKey *keys    = (SortKey*)MALLOCATE(2 * num_objs * sizeof(SortKey));
+    SortKey *scratch = keys + num_objs;
+    size_t   num_keys = 0;
+    for (size_t i = 0; i < self->size; i++) {
+        Obj *elem = self->elems[i];
+        if (elem == NULL) { continue; }
+        uint64_t key
+            = klass == STRING  ? SI_string_key((String*)elem)
+            : klass == INTEGER ? SI_integer_key(Int_Get_Value((Integer*)elem))
+            : SI_float_key(Float_Get_Value((Float*)elem));
+        keys[num_keys].key = key;
+        keys[num_keys].obj = elem;
+        num_keys++;
+    }
+
+    CFISH_Sort_Compare_t compare = klass == STRING
+                                   ? S_compare_string_keys
+                                   : S_compare_keys;
+    SortKey *sorted = keys;
+    if (parallel) {
+        // The key comparators are thread-safe.
+        Sort_parallel_mergesort(keys, scratch, num_keys, sizeof(SortKey),
+                                compare, NULL);
+    }
+    else if (num_keys < RADIX_SORT_THRESHOLD) {
+        Sort_mergesort(keys, scratch, num_keys, sizeof(SortKey), compare,
+                       NULL);
+    }
+    else {
+        sorted = S_radix_sort(keys, scratch, num_keys);
+        SortKey *free_buf = sorted == keys ? scratch : keys;
+
+        if (klass == STRING) {
+            // Resolve runs of Strings with the same prefix.
+            size_t start = 0;
+            while (start < num_keys) {
+                size_t end = start + 1;
+                while (end < num_keys && sorted[end].key == sorted[start].key) {
+                    end++;
+                }
+                if (end - start > 1) {
+                    Sort_mergesort(sorted + start, free_buf, end - start,
+                                   sizeof(SortKey), compare, NULL);
+                }
+                start = end;
+            }
+        }
+    }
+
+    // Write back, moving NULLs to the end.
+    for (size_t i = 0; i < num_keys; i++) {
+        self->elems[i] = sorted[i].obj;
+    }
+    for (size_t i = num_keys; i < self->size; i++) {
+        self->elems[i] = NULL;
+    }
+
+    FREEMEM(keys);
+    return true;
+}
+
+typedef struct {
+    CFISH_Vec_Compare_t  compare;
+    void                *context;
+} CompareWrapper;
+
+static int
+S_compare_with(void *context, const void *va, const void *vb) {
+    CompareWrapper *wrapper = (CompareWrapper*)context;
+    return wrapper->compare(wrapper->context, *(Obj**)va, *(Obj**)vb);
+}
+
+// Move NULL elements to the end, keeping the order of the other elements.
+// Returns the number of non-NULL elements.
+static size_t
+S_move_nulls_to_end(Vector *self) {
+    size_t num_objs = 0;
+    for (size_t i = 0; i < self->size; i++) {
+        Obj *elem = self->elems[i];
+        if (elem != NULL) { self->elems[num_objs++] = elem; }
+    }
+    for (size_t i = num_objs; i < self->size; i++) {
+        self->elems[i] = NULL;
+    }
+    return num_objs;
+}
+
+void
+Vec_Sort_With_IMP(Vector *self, CFISH_Vec_Compare_t compare,
+                  void *context) {
+    size_t num_objs = S_move_nulls_to_end(self);
+    if (num_objs < 2) { return; }
+
+    CompareWrapper wrapper;
+    wrapper.compare = compare;
+    wrapper.context = context;
+    S_sort_elems(self, num_objs, S_compare_with, &wrapper);
+}
+
+// A sort key extracted from an element.  String keys also keep their
+// bytes to resolve equal prefixes.
+typedef struct {
+    uint64_t    key;
+    Obj        *obj;
+    const char *ptr;
+    size_t      size;
+} ExtractedKey;
+
+// State of Sort_By_Key, kept outside of the trapped routine so that the
+// keys can be freed if `extract` throws.
+typedef struct {
+    Vector               *vector;
+    size_t                num_objs;
+    int                   key_type;
+    CFISH_Vec_Sort_Key_t  extract;
+    void                 *context;
+    ExtractedKey         *keys;
+} KeySorter;
+
+static void
+S_do_sort_by_key(void *context);
+
+static int
+S_compare_extracted_keys(void *context, const void *va, const void *vb) {
+    const ExtractedKey *a = (const ExtractedKey*)va;
+    const ExtractedKey *b = (const ExtractedKey*)vb;
+    UNUSED_VAR(context);
+    return a->key < b->key ? -1 : a->key > b->key ? 1 : 0;
+}
+
+static int
+S_compare_extracted_string_keys(void *context, const void *va,
+                                const void *vb) {
+    const ExtractedKey *a = (const ExtractedKey*)va;
+    const ExtractedKey *b = (const ExtractedKey*)vb;
+    UNUSED_VAR(context);
+    if (a->key != b->key) { return a->key < b->key ? -1 : 1; }
+    return SI_compare_byte_tails(a->ptr, a->size, b->ptr, b->size);
+}
+
+void
+Vec_Sort_By_Key_IMP(Vector *self, int key_type,
+                    CFISH_Vec_Sort_Key_t extract, void *context) {
+    if (key_type != VEC_KEY_INT64
+        && key_type != VEC_KEY_DOUBLE
+        && key_type != VEC_KEY_STRING
+       ) {
+        THROW(ERR, "Invalid key type: %i32", (int32_t)key_type);
+    }
+
+    size_t num_objs = S_move_nulls_to_end(self);
+    if (num_objs == 0) { return; }
+
+    // The first half of the allocation holds the keys, the second half is
+    // scratch space for the sort.
+    KeySorter sorter;
+    sorter.vector   = self;
+    sorter.num_objs = num_objs;
+    sorter.key_type = key_type;
+    sorter.extract  = extract;
+    sorter.context  = context;
+    sorter.keys     = (ExtractedKey*)MALLOCATE(2 * num_objs
+                                               * sizeof(ExtractedKey));
+
+    Err *error = Err_trap(S_do_sort_by_key, &sorter);
+    FREEMEM(sorter.keys);
+    if (error) {
+        RETHROW(error);
+    }
+}
+
+static void
+S_do_sort_by_key(void *context) {
+    KeySorter    *sorter   = (KeySorter*)context;
+    Obj         **elems    = sorter->vector->elems;
+    size_t        num_objs = sorter->num_objs;
+    int           key_type = sorter->key_type;
+    ExtractedKey *keys     = sorter->keys;
+    ExtractedKey *scratch  = keys + num_objs;
+
+    // Compute the keys once.  Entries without keys are stored from the
+    // back and reversed afterwards to preserve their order.
+    size_t num_keys = 0;
+    size_t null_pos = num_objs;
+    for (size_t i = 0; i < num_objs; i++) {
+        VecSortKey value;
+        if (!sorter->extract(sorter->context, elems[i], &value)) {
+            ExtractedKey *entry = &keys[--null_pos];
+            entry->key  = 0;
+            entry->obj  = elems[i];
+            entry->ptr  = NULL;
+            entry->size = 0;
+            continue;
+        }
+
+        ExtractedKey *entry = &keys[num_keys++];
+        entry->obj  = elems[i];
+        entry->ptr  = NULL;
+        entry->size = 0;
+        if (key_type == VEC_KEY_INT64) {
+            entry->key = SI_integer_key(value.i64);
+        }
+        else if (key_type == VEC_KEY_DOUBLE) {
+            // NaNs don't have a consistent ordering, so they sort last.
+            entry->key = isnan(value.f64)
+                         ? UINT64_MAX
+                         : SI_float_key(value.f64);
+        }
+        else {
+            entry->key  = SI_bytes_key(value.str.ptr, value.str.size);
+            entry->ptr  = value.str.ptr;
+            entry->size = value.str.size;
+        }
+    }
+    for (size_t lo = null_pos, hi = num_objs; lo + 1 < hi; lo++, hi--) {
+        ExtractedKey temp = keys[lo];
+        keys[lo]     = keys[hi - 1];
+        keys[hi - 1] = temp;
+    }
+
+    if (num_keys > 1) {
+        CFISH_Sort_Compare_t compare = key_type == VEC_KEY_STRING
+                                       ? S_compare_extracted_string_keys
+                                       : S_compare_extracted_keys;
+        Sort_mergesort(keys, scratch, num_keys, sizeof(ExtractedKey),
+                       compare, NULL);
+    }
+
+    for (size_t i = 0; i < num_objs; i++) {
+        elems[i] = keys[i].obj;
+    }
+}
+
+String*
+Vec_To_String_IMP(Vector *self) {
+    CharBuf *buf = CB_new(self->size * 8 + 2);
+    Vec_Cat_To_IMP(self, buf);
+    String *string = CB_Yield_String(buf);
+    DECREF(buf);
+    return string;
+}
+
+void
+Vec_Cat_To_IMP(Vector *self, CharBuf *buf) {
+    Vec_cat_container_to((Obj*)self, buf);
+}
+
+// A Vector or Hash which is being formatted, linked to the container which
+// holds it.
+typedef struct CatToFrame {
+    Obj               *container;
+    struct CatToFrame *parent;
+} CatToFrame;
+
+static void
+S_cat_container(Obj *container, CharBuf *buf, CatToFrame *parent);
+
+static void
+S_cat_member(Obj *member, CharBuf *buf, CatToFrame *frame) {
+    if (member == NULL) {
+        CB_Cat_Trusted_Utf8(buf, "[NULL]", 6);
+    }
+    else if (Obj_is_a(member, VECTOR) || Obj_is_a(member, HASH)) {
+        for (CatToFrame *ancestor = frame; ancestor;
+             ancestor = ancestor->parent
+            ) {
+            if (ancestor->container == member) {
+                if (Obj_is_a(member, VECTOR)) {
+                    CB_Cat_Trusted_Utf8(buf, "[...]", 5);
+                }
+                else {
+                    CB_Cat_Trusted_Utf8(buf, "{...}", 5);
+                }
+                return;
+            }
+        }
+        S_cat_container(member, buf, frame);
+    }
+    else {
+        Obj_Cat_To(member, buf);
+    }
+}
+
+static void
+S_cat_container(Obj *container, CharBuf *buf, CatToFrame *parent) {
+    CatToFrame frame;
+    frame.container = container;
+    frame.parent    = parent;
+
+    if (Obj_is_a(container, VECTOR)) {
+        Vector *vector = (Vector*)container;
+        CB_Cat_Trusted_Utf8(buf, "[", 1);
+        for (size_t i = 0, max = vector->size; i < max; i++) {
+            if (i > 0) { CB_Cat_Trusted_Utf8(buf, ", ", 2); }
+            S_cat_member(vector->elems[i], buf, &frame);
+        }
+        CB_Cat_Trusted_Utf8(buf, "]", 1);
+    }
+    else {
+        HashIterator *iter  = HashIter_new((Hash*)container);
+        bool          first = true;
+        CB_Cat_Trusted_Utf8(buf, "{", 1);
+        while (HashIter_Next(iter)) {
+            if (!first) { CB_Cat_Trusted_Utf8(buf, ", ", 2); }
+            first = false;
+            CB_Cat(buf, HashIter_Get_Key(iter));
+            CB_Cat_Trusted_Utf8(buf, ": ", 2);
+            S_cat_member(HashIter_Get_Value(iter), buf, &frame);
+        }
+        CB_Cat_Trusted_Utf8(buf, "}", 1);
+        DECREF(iter);
+    }
+}
+
+void
+Vec_cat_container_to(Obj *container, CharBuf *buf) {
+    S_cat_container(container, buf, NULL);
 }
 
 bool
 Vec_Equals_IMP(Vector *self, Obj *other) {
     Vector *twin = (Vector*)other;
     if (twin == self)             { return true; }
-    if (!Obj_is_a(other, VECTOR)) { return false; }
+    if (!Obj_is_a(other, VECTOR)) {
+        // SegmentedVector implements the comparison in both directions.
+        if (Obj_is_a(other, SEGMENTEDVECTOR)) {
+            return SegVec_Equals((SegmentedVector*)other, (Obj*)self);
+        }
+        return false;
+    }
     if (twin->size != self->size) {
         return false;
     }
@@ -279,6 +873,24 @@ Vec_Equals_IMP(Vector *self, Obj *other) {
     return true;
 }
 
+void
+Vec_Digest_IMP(Vector *self, uint64_t *digest) {
+    // Keep in sync with SegVec_Digest.
+    Hashing_digest_init(digest, HASHING_DIGEST_VECTOR);
+    Hashing_digest_mix(digest, (uint64_t)self->size);
+    for (size_t i = 0, max = self->size; i < max; i++) {
+        Obj      *elem = self->elems[i];
+        uint64_t  elem_digest[2];
+        if (elem) {
+            Obj_Digest(elem, elem_digest);
+        }
+        else {
+            Hashing_digest_init(elem_digest, HASHING_DIGEST_NULL);
+        }
+        Hashing_digest_mix_digest(digest, elem_digest);
+    }
+}
+
 Vector*
 Vec_Slice_IMP(Vector *self, size_t offset, size_t length) {
     // Adjust ranges if necessary.
@@ -300,9 +912,8 @@ Vec_Slice_IMP(Vector *self, size_t offset, size_t length) {
 
 static CFISH_INLINE void
 SI_copy_and_incref(Obj **dst, Obj **src, size_t num) {
-    for (size_t i = 0; i < num; i++) {
-        dst[i] = INCREF(src[i]);
-    }
+    memcpy(dst, src, num * sizeof(Obj*));
+    cfish_incref_array(dst, num);
 }
 
 // Ensure that the vector's capacity is at least (size + extra).
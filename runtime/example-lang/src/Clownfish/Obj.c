@@ -36,6 +36,27 @@ cfish_dec_refcount(void *vself) {
     UNREACHABLE_RETURN(uint32_t);
 }
 
+void
+cfish_incref_array(cfish_Obj **elems, size_t num) {
+    THROW(CFISH_ERR, "TODO");
+}
+
+void
+cfish_decref_array(cfish_Obj **elems, size_t num) {
+    THROW(CFISH_ERR, "TODO");
+}
+
+void
+cfish_make_immortal(void *vself) {
+    THROW(CFISH_ERR, "TODO");
+}
+
+bool
+cfish_is_immortal(void *vself) {
+    THROW(CFISH_ERR, "TODO");
+    UNREACHABLE_RETURN(bool);
+}
+
 void*
 CFISH_Obj_To_Host_IMP(cfish_Obj *self, void *vcache) {
     THROW(CFISH_ERR, "TODO");
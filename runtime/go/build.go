@@ -169,6 +169,10 @@ func specMethods(parcel *cfc.Parcel) {
 	vecBinding.SetSuppressCtor(true)
 	vecBinding.Register()
 
+	dequeBinding := cfc.NewGoClass(parcel, "Clownfish::Deque")
+	dequeBinding.SetSuppressCtor(true)
+	dequeBinding.Register()
+
 	hashBinding := cfc.NewGoClass(parcel, "Clownfish::Hash")
 	hashBinding.SpecMethod("Keys", "Keys() []string")
 	hashBinding.SetSuppressCtor(true)
@@ -19,6 +19,8 @@ package clownfish
 import "testing"
 import "unsafe"
 import "reflect"
+import "io/ioutil"
+import "os"
 
 func TestBlobNewBlob(t *testing.T) {
 	content := []byte("foo")
@@ -95,3 +97,23 @@ func TestBlobEquals(t *testing.T) {
 		t.Error("Comparison against String should fail")
 	}
 }
+
+func TestBlobNewBlobMmap(t *testing.T) {
+	file, err := ioutil.TempFile("", "cfish_blob")
+	if err != nil {
+		t.Skip("Can't create temp file")
+	}
+	defer os.Remove(file.Name())
+	file.Write([]byte("abcdefghij"))
+	file.Close()
+
+	blob := NewBlobMmap(file.Name(), 2, 3)
+	if !blob.IsMapped() {
+		t.Error("IsMapped")
+	}
+	converted := BlobToGo(unsafe.Pointer(blob.TOPTR()))
+	if !reflect.DeepEqual(converted, []byte("cde")) {
+		t.Errorf("Expected \"cde\", got %v", converted)
+	}
+	blob.Advise("sequential")
+}
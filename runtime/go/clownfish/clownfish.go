@@ -30,6 +30,7 @@ package clownfish
 #include "Clownfish/Class.h"
 #include "Clownfish/String.h"
 #include "Clownfish/Blob.h"
+#include "Clownfish/Deque.h"
 #include "Clownfish/Hash.h"
 #include "Clownfish/HashIterator.h"
 #include "Clownfish/Vector.h"
@@ -188,6 +189,14 @@ func NewVector(size int) Vector {
 	return WRAPVector(unsafe.Pointer(cfObj))
 }
 
+func NewDeque(capacity int) Deque {
+	if (capacity < 0 || uint64(capacity) > ^uint64(0)) {
+		panic(NewErr(fmt.Sprintf("Param 'capacity' out of range: %d", capacity)))
+	}
+	cfObj := C.cfish_Deque_new(C.size_t(capacity))
+	return WRAPDeque(unsafe.Pointer(cfObj))
+}
+
 func NewHash(size int) Hash {
 	if (size < 0 || uint64(size) > ^uint64(0)) {
 		panic(NewErr(fmt.Sprintf("Param 'size' out of range: %d", size)))
@@ -673,6 +682,16 @@ func NewBlob(content []byte) Blob {
 	return WRAPBlob(unsafe.Pointer(obj))
 }
 
+// NewBlobMmap maps `length` bytes of the file at `path`, starting at
+// `offset`, into memory without copying.  A negative length maps the rest of
+// the file.
+func NewBlobMmap(path string, offset, length int64) Blob {
+	pathCF := (*C.cfish_String)(goToString(path, false))
+	defer C.cfish_decref(unsafe.Pointer(pathCF))
+	obj := C.cfish_Blob_new_mmap(pathCF, C.int64_t(offset), C.int64_t(length))
+	return WRAPBlob(unsafe.Pointer(obj))
+}
+
 func (b *BlobIMP) GetBuf() uintptr {
 	self := (*C.cfish_Blob)(Unwrap(b, "b"))
 	return uintptr(unsafe.Pointer(C.CFISH_Blob_Get_Buf(self)))
@@ -0,0 +1,53 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package clownfish
+
+import "testing"
+
+func TestDequePushPop(t *testing.T) {
+	deque := NewDeque(0)
+	deque.Push("b")
+	deque.PushFront("a")
+	deque.Push("c")
+	if size := deque.GetSize(); size != 3 {
+		t.Errorf("Expected size 3, got %d", size)
+	}
+	if got := deque.Fetch(1); got != "b" {
+		t.Errorf("Expected \"b\", got %v", got)
+	}
+	if got := deque.PopFront(); got != "a" {
+		t.Errorf("PopFront: expected \"a\", got %v", got)
+	}
+	if got := deque.Pop(); got != "c" {
+		t.Errorf("Pop: expected \"c\", got %v", got)
+	}
+}
+
+func TestDequeFIFO(t *testing.T) {
+	deque := NewDeque(0)
+	for i := 0; i < 100; i++ {
+		deque.Push(int64(i))
+	}
+	for i := 0; i < 100; i++ {
+		if got := deque.PopFront(); got != int64(i) {
+			t.Fatalf("Expected %d, got %v", i, got)
+		}
+	}
+	if got := deque.PopFront(); got != nil {
+		t.Errorf("PopFront on empty Deque should return nil, got %v", got)
+	}
+}
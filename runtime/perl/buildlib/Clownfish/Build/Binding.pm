@@ -33,6 +33,8 @@ sub bind_all {
     $class->bind_err;
     $class->bind_hash;
     $class->bind_hashiterator;
+    $class->bind_instream;
+    $class->bind_outstream;
     $class->bind_float;
     $class->bind_integer;
     $class->bind_obj;
@@ -122,9 +124,21 @@ END_SYNOPSIS
     my $blob = Clownfish::Blob->new($byte_string);
 
 Create a Blob containing the passed-in bytes.
+END_CONSTRUCTOR
+    my $mmap_constructor = <<'END_CONSTRUCTOR';
+    my $blob = Clownfish::Blob->new_mmap(
+        path   => $path,      # required
+        offset => $offset,    # default: 0
+        length => $length,    # default: rest of the file
+    );
 END_CONSTRUCTOR
     $pod_spec->set_synopsis($synopsis);
     $pod_spec->add_constructor( pod => $constructor );
+    $pod_spec->add_constructor(
+        alias    => 'new_mmap',
+        pod_func => 'init_mmap',
+        sample   => $mmap_constructor,
+    );
 
     my $xs_code = <<'END_XS_CODE';
 MODULE = Clownfish     PACKAGE = Clownfish::Blob
@@ -151,6 +165,10 @@ END_XS_CODE
     $binding->set_pod_spec($pod_spec);
     $binding->append_xs($xs_code);
     $binding->exclude_constructor;
+    $binding->bind_constructor(
+        alias       => 'new_mmap',
+        initializer => 'init_mmap',
+    );
 
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
@@ -561,6 +579,89 @@ END_XS_CODE
     Clownfish::CFC::Binding::Perl::Class->register($binding);
 }
 
+sub bind_instream {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $instream = Clownfish::InStream->open( path => $path );
+    my $size     = $instream->read_c32;
+    my $blob     = $instream->read_blob($size);
+END_SYNOPSIS
+    my $open_constructor = <<'END_CONSTRUCTOR';
+    my $instream = Clownfish::InStream->open( path => $path );
+END_CONSTRUCTOR
+    my $blob_constructor = <<'END_CONSTRUCTOR';
+    my $instream = Clownfish::InStream->new_blob( blob => $blob );
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor(
+        alias    => 'open',
+        pod_func => 'do_open',
+        sample   => $open_constructor,
+    );
+    $pod_spec->add_constructor(
+        alias    => 'new_blob',
+        pod_func => 'init_blob',
+        sample   => $blob_constructor,
+    );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        class_name => "Clownfish::InStream",
+    );
+    $binding->set_pod_spec($pod_spec);
+    $binding->bind_constructor(
+        alias       => 'open',
+        initializer => 'do_open',
+    );
+    $binding->bind_constructor(
+        alias       => 'new_blob',
+        initializer => 'init_blob',
+    );
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
+sub bind_outstream {
+    my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
+    my $synopsis = <<'END_SYNOPSIS';
+    my $outstream = Clownfish::OutStream->open( path => $path );
+    $outstream->write_c32( $blob->get_size );
+    $outstream->write_blob($blob);
+    $outstream->close;
+END_SYNOPSIS
+    my $open_constructor = <<'END_CONSTRUCTOR';
+    my $outstream = Clownfish::OutStream->open( path => $path );
+END_CONSTRUCTOR
+    my $bytebuf_constructor = <<'END_CONSTRUCTOR';
+    my $outstream = Clownfish::OutStream->new_bytebuf( bytebuf => $bytebuf );
+END_CONSTRUCTOR
+    $pod_spec->set_synopsis($synopsis);
+    $pod_spec->add_constructor(
+        alias    => 'open',
+        pod_func => 'do_open',
+        sample   => $open_constructor,
+    );
+    $pod_spec->add_constructor(
+        alias    => 'new_bytebuf',
+        pod_func => 'init_bytebuf',
+        sample   => $bytebuf_constructor,
+    );
+
+    my $binding = Clownfish::CFC::Binding::Perl::Class->new(
+        class_name => "Clownfish::OutStream",
+    );
+    $binding->set_pod_spec($pod_spec);
+    $binding->bind_constructor(
+        alias       => 'open',
+        initializer => 'do_open',
+    );
+    $binding->bind_constructor(
+        alias       => 'new_bytebuf',
+        initializer => 'init_bytebuf',
+    );
+
+    Clownfish::CFC::Binding::Perl::Class->register($binding);
+}
+
 sub bind_float {
     my $pod_spec = Clownfish::CFC::Binding::Perl::Pod->new;
     my $synopsis = <<'END_SYNOPSIS';
@@ -16,7 +16,7 @@
 use strict;
 use warnings;
 
-use Test::More tests => 4;
+use Test::More tests => 5;
 use Clownfish qw( to_clownfish );
 
 my ( $vector, $twin );
@@ -60,6 +60,11 @@ is(
 my $roundtripped = $vector->to_perl;
 is_deeply( $roundtripped, $arrayref, 'to_perl handles circular references');
 
+my $foreign = bless {}, 'NotClownfish';
+eval { Clownfish::Vector->new->push_all($foreign) };
+like( $@, qr/Can't convert to Clownfish::Vector/,
+    'Object blessed into a non-Clownfish class is rejected' );
+
 # During global destruction, Clownfish destructors can be invoked forcefully
 # in a random order. Circular references in Clownfish objects must be broken
 # to avoid segfaults.
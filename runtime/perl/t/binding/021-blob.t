@@ -17,7 +17,7 @@ use strict;
 use warnings;
 use lib 'buildlib';
 
-use Test::More tests => 8;
+use Test::More tests => 12;
 use Clownfish;
 
 my $blob = Clownfish::Blob->new('abc');
@@ -35,3 +35,17 @@ $blob = $other->clone_raw;
 isa_ok( $blob, 'Clownfish::Blob', 'clone' );
 ok( $blob->equals($other), 'equals after clone' );
 
+my $path = 'blob_mmap_test.bin';
+open( my $fh, '>', $path ) or die "Can't open $path: $!";
+binmode $fh;
+print $fh 'abcdefghij';
+close $fh or die "Can't close $path: $!";
+my $mapped = Clownfish::Blob->new_mmap( path => $path, offset => 2 );
+ok( $mapped->is_mapped, 'new_mmap' );
+is( $mapped->to_perl, 'cdefghij', 'new_mmap maps rest of file' );
+$mapped = Clownfish::Blob->new_mmap( path => $path, offset => 1, length => 3 );
+is( $mapped->to_perl, 'bcd', 'new_mmap with length' );
+is( $mapped->slice( offset => 1, length => 2 )->to_perl, 'cd', 'slice' );
+undef $mapped;
+unlink $path;
+
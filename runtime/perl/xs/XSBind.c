@@ -46,6 +46,9 @@
 #define XSBIND_REFCOUNT_FLAG   1
 #define XSBIND_REFCOUNT_SHIFT  1
 
+// Refcount of objects made immortal with cfish_make_immortal.
+#define XSBIND_REFCOUNT_IMMORTAL  SIZE_MAX
+
 // Used to remember converted objects in array and hash conversion to
 // handle circular references. The root object and SV are stored separately
 // to allow lazy creation of the seen PtrHash.
@@ -55,10 +58,6 @@ typedef struct {
     cfish_PtrHash *seen;
 } cfish_ConversionCache;
 
-// Indicate whether the class is a descendent of `ancestor`.
-static bool
-S_class_is_a(cfish_Class *klass, cfish_Class *ancestor);
-
 // Create a new host object wrapper.
 static cfish_Obj*
 S_new_wrapper(cfish_Class *klass, SV *sv);
@@ -86,18 +85,6 @@ S_perl_hash_to_cfish_hash(pTHX_ HV *phash, cfish_ConversionCache *cache);
 static cfish_Vector*
 S_perl_array_to_cfish_array(pTHX_ AV *parray, cfish_ConversionCache *cache);
 
-static bool
-S_class_is_a(cfish_Class *klass, cfish_Class *ancestor) {
-    while (klass != NULL) {
-        if (klass == ancestor) {
-            return true;
-        }
-        klass = klass->parent;
-    }
-
-    return false;
-}
-
 cfish_Obj*
 XSBind_new_blank_obj(pTHX_ SV *either_sv) {
     HV *stash = NULL;
@@ -212,7 +199,8 @@ S_maybe_perl_to_cfish(pTHX_ SV *sv, cfish_Class *klass, bool increment,
             = CFISH_SSTR_WRAP_UTF8(HvNAME(stash), HvNAMELEN(stash));
         cfish_Class *sv_class = cfish_Class_fetch_class(sv_class_name);
 
-        if (S_class_is_a(sv_class, klass)) {
+        // Objects blessed into other packages have no Class.
+        if (sv_class != NULL && cfish_class_is_a(sv_class, klass)) {
             cfish_Obj *obj;
 
             if (sv_class->flags & CFISH_fHOST) {
@@ -747,12 +735,15 @@ S_lazy_init_host_obj(pTHX_ cfish_Obj *self, bool increment) {
      * self->ref.count.  We're replacing ref.count with ref.host_obj, which
      * will assume responsibility for maintaining the refcount. */
     cfish_ref_t old_ref = self->ref;
-    size_t excess = old_ref.count >> XSBIND_REFCOUNT_SHIFT;
+    bool immortal = old_ref.count == XSBIND_REFCOUNT_IMMORTAL;
+    // Immortal objects keep an extra reference to their host object, so
+    // that DESTROY is never invoked.
+    size_t excess = immortal ? 2 : old_ref.count >> XSBIND_REFCOUNT_SHIFT;
     if (!increment) { excess -= 1; }
     SvREFCNT(inner_obj) += excess;
 
     // Overwrite refcount with host object.
-    if (SI_immortal(klass)) {
+    if (immortal || SI_immortal(klass)) {
         SvSHARE(inner_obj);
         if (!cfish_Atomic_cas_ptr((void**)&self->ref, old_ref.host_obj,
                                   inner_obj)) {
@@ -796,8 +787,11 @@ cfish_inc_refcount(void *vself) {
     cfish_Class *const klass = self->klass;
     if (klass->flags & CFISH_fREFCOUNTSPECIAL) {
         if (SI_is_string_type(klass)) {
-            // Only copy-on-incref Strings get special-cased.  Ordinary
-            // Strings fall through to the general case.
+            // Immortal and copy-on-incref Strings get special-cased.
+            // Ordinary Strings fall through to the general case.
+            if (cfish_Str_is_immortal((cfish_String*)self)) {
+                return self;
+            }
             if (CFISH_Str_Is_Copy_On_IncRef((cfish_String*)self)) {
                 const char *utf8 = CFISH_Str_Get_Ptr8((cfish_String*)self);
                 size_t size = CFISH_Str_Get_Size((cfish_String*)self);
@@ -813,7 +807,9 @@ cfish_inc_refcount(void *vself) {
         if (self->ref.count == XSBIND_REFCOUNT_FLAG) {
             CFISH_THROW(CFISH_ERR, "Illegal refcount of 0");
         }
-        self->ref.count += 1 << XSBIND_REFCOUNT_SHIFT;
+        if (self->ref.count != XSBIND_REFCOUNT_IMMORTAL) {
+            self->ref.count += 1 << XSBIND_REFCOUNT_SHIFT;
+        }
     }
     else {
         SvREFCNT_inc_simple_void_NN((SV*)self->ref.host_obj);
@@ -830,6 +826,11 @@ cfish_dec_refcount(void *vself) {
         if (SI_immortal(klass)) {
             return 1;
         }
+        else if (SI_is_string_type(klass)
+                 && cfish_Str_is_immortal((cfish_String*)self)
+                ) {
+            return 1;
+        }
     }
 
     uint32_t modified_refcount = I32_MAX;
@@ -837,6 +838,9 @@ cfish_dec_refcount(void *vself) {
         if (self->ref.count == XSBIND_REFCOUNT_FLAG) {
             CFISH_THROW(CFISH_ERR, "Illegal refcount of 0");
         }
+        if (self->ref.count == XSBIND_REFCOUNT_IMMORTAL) {
+            return modified_refcount;
+        }
         if (self->ref.count
             == ((1 << XSBIND_REFCOUNT_SHIFT) | XSBIND_REFCOUNT_FLAG)) {
             modified_refcount = 0;
@@ -857,6 +861,84 @@ cfish_dec_refcount(void *vself) {
     return modified_refcount;
 }
 
+void
+cfish_incref_array(cfish_Obj **elems, size_t num) {
+    for (size_t i = 0; i < num; i++) {
+        cfish_Obj *self = elems[i];
+        if (self == NULL) { continue; }
+        // Only special cases and unusable refcounts need the full function
+        // call.
+        if ((self->klass->flags & CFISH_fREFCOUNTSPECIAL)
+            || self->ref.count == XSBIND_REFCOUNT_FLAG
+            || self->ref.count == XSBIND_REFCOUNT_IMMORTAL
+           ) {
+            elems[i] = cfish_inc_refcount(self);
+        }
+        else if (self->ref.count & XSBIND_REFCOUNT_FLAG) {
+            self->ref.count += 1 << XSBIND_REFCOUNT_SHIFT;
+        }
+        else {
+            SvREFCNT_inc_simple_void_NN((SV*)self->ref.host_obj);
+        }
+    }
+}
+
+void
+cfish_decref_array(cfish_Obj **elems, size_t num) {
+    dTHX;
+    for (size_t i = 0; i < num; i++) {
+        cfish_Obj *self = elems[i];
+        if (self == NULL) { continue; }
+        if (self->klass->flags & CFISH_fREFCOUNTSPECIAL) {
+            cfish_dec_refcount(self);
+        }
+        else if (self->ref.count & XSBIND_REFCOUNT_FLAG) {
+            // Destruction, immortals and errors are left to
+            // cfish_dec_refcount.
+            if (self->ref.count
+                > ((1 << XSBIND_REFCOUNT_SHIFT) | XSBIND_REFCOUNT_FLAG)
+                && self->ref.count != XSBIND_REFCOUNT_IMMORTAL
+               ) {
+                self->ref.count -= 1 << XSBIND_REFCOUNT_SHIFT;
+            }
+            else {
+                cfish_dec_refcount(self);
+            }
+        }
+        else {
+            SvREFCNT_dec((SV*)self->ref.host_obj);
+        }
+    }
+}
+
+void
+cfish_make_immortal(void *vself) {
+    cfish_Obj *self = (cfish_Obj*)vself;
+    if (self->ref.count & XSBIND_REFCOUNT_FLAG) {
+        self->ref.count = XSBIND_REFCOUNT_IMMORTAL;
+    }
+    else {
+        // Keep the host object alive forever.
+        dTHX;
+        SvREFCNT_inc_simple_void_NN((SV*)self->ref.host_obj);
+    }
+}
+
+bool
+cfish_is_immortal(void *vself) {
+    cfish_Obj *self = (cfish_Obj*)vself;
+    cfish_Class *klass = self->klass;
+    if (SI_immortal(klass)) {
+        return true;
+    }
+    if (SI_is_string_type(klass)
+        && cfish_Str_is_immortal((cfish_String*)self)
+       ) {
+        return true;
+    }
+    return self->ref.count == XSBIND_REFCOUNT_IMMORTAL;
+}
+
 SV*
 XSBind_cfish_obj_to_sv_inc(pTHX_ cfish_Obj *obj) {
     if (obj == NULL) { return newSV(0); }
@@ -841,8 +841,11 @@ cfish_inc_refcount(void *vself) {
 
     // Handle special cases.
     if (self->klass == CFISH_STRING) {
-        // Only copy-on-incref Strings get special-cased.  Ordinary
+        // Immortal and copy-on-incref Strings get special-cased.  Ordinary
         // Strings fall through to the general case.
+        if (cfish_Str_is_immortal((cfish_String*)self)) {
+            return self;
+        }
         if (CFISH_Str_Is_Copy_On_IncRef((cfish_String*)self)) {
             const char *utf8 = CFISH_Str_Get_Ptr8((cfish_String*)self);
             size_t size = CFISH_Str_Get_Size((cfish_String*)self);
@@ -856,11 +859,69 @@ cfish_inc_refcount(void *vself) {
 
 uint32_t
 cfish_dec_refcount(void *vself) {
+    cfish_Obj *self = (cfish_Obj*)vself;
     uint32_t modified_refcount = Py_REFCNT(vself);
+    if (self->klass == CFISH_STRING
+        && cfish_Str_is_immortal((cfish_String*)self)
+       ) {
+        return modified_refcount;
+    }
     Py_DECREF(vself);
     return modified_refcount;
 }
 
+void
+cfish_incref_array(cfish_Obj **elems, size_t num) {
+    for (size_t i = 0; i < num; i++) {
+        cfish_Obj *self = elems[i];
+        if (self == NULL) { continue; }
+        // Only Strings need special-casing.
+        if (self->klass == CFISH_STRING) {
+            elems[i] = cfish_inc_refcount(self);
+        }
+        else {
+            Py_INCREF(self);
+        }
+    }
+}
+
+void
+cfish_decref_array(cfish_Obj **elems, size_t num) {
+    for (size_t i = 0; i < num; i++) {
+        cfish_Obj *self = elems[i];
+        if (self == NULL) { continue; }
+        if (self->klass == CFISH_STRING) {
+            cfish_dec_refcount(self);
+        }
+        else {
+            Py_DECREF(self);
+        }
+    }
+}
+
+// Python objects can't portably be exempted from refcounting, so immortal
+// objects get a bias large enough that their refcount never drops to zero.
+#define IMMORTAL_REFCOUNT_BIAS (PY_SSIZE_T_MAX / 4)
+
+void
+cfish_make_immortal(void *vself) {
+    PyObject *self = (PyObject*)vself;
+    if (Py_REFCNT(self) < IMMORTAL_REFCOUNT_BIAS) {
+        self->ob_refcnt += IMMORTAL_REFCOUNT_BIAS;
+    }
+}
+
+bool
+cfish_is_immortal(void *vself) {
+    cfish_Obj *self = (cfish_Obj*)vself;
+    if (self->klass == CFISH_STRING
+        && cfish_Str_is_immortal((cfish_String*)self)
+       ) {
+        return true;
+    }
+    return Py_REFCNT(vself) >= IMMORTAL_REFCOUNT_BIAS;
+}
+
 /**** Obj ******************************************************************/
 
 void*
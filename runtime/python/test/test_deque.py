@@ -0,0 +1,41 @@
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.
+# The ASF licenses this file to You under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License.  You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+import clownfish
+
+class TestDeque(unittest.TestCase):
+
+    def testPushPop(self):
+        deque = clownfish.Deque()
+        deque.push("b")
+        deque.push_front("a")
+        deque.push("c")
+        self.assertEqual(deque.get_size(), 3)
+        self.assertEqual(deque.fetch(1), "b")
+        self.assertEqual(deque.pop_front(), "a")
+        self.assertEqual(deque.pop(), "c")
+        self.assertEqual(deque.pop(), "b")
+        self.assertEqual(deque.pop(), None)
+
+    def testFIFO(self):
+        deque = clownfish.Deque()
+        for i in range(100):
+            deque.push(i)
+        got = [deque.pop_front() for i in range(100)]
+        self.assertEqual(got, list(range(100)))
+
+if __name__ == '__main__':
+    unittest.main()
@@ -25,20 +25,30 @@
 #include "Clownfish/Test/TestBlob.h"
 #include "Clownfish/Test/TestBoolean.h"
 #include "Clownfish/Test/TestByteBuf.h"
+#include "Clownfish/Test/TestStreams.h"
 #include "Clownfish/Test/TestString.h"
 #include "Clownfish/Test/TestCharBuf.h"
 #include "Clownfish/Test/TestClass.h"
+#include "Clownfish/Test/TestDeque.h"
 #include "Clownfish/Test/TestErr.h"
 #include "Clownfish/Test/TestHash.h"
 #include "Clownfish/Test/TestHashIterator.h"
 #include "Clownfish/Test/TestLockFreeRegistry.h"
 #include "Clownfish/Test/TestMethod.h"
 #include "Clownfish/Test/TestNum.h"
+#include "Clownfish/Test/TestNumArray.h"
 #include "Clownfish/Test/TestObj.h"
 #include "Clownfish/Test/TestPtrHash.h"
+#include "Clownfish/Test/TestSegmentedVector.h"
+#include "Clownfish/Test/TestSerializer.h"
+#include "Clownfish/Test/TestJson.h"
+#include "Clownfish/Test/TestFrozenImage.h"
 #include "Clownfish/Test/TestVector.h"
 #include "Clownfish/Test/Util/TestAtomic.h"
+#include "Clownfish/Test/Util/TestHashing.h"
 #include "Clownfish/Test/Util/TestMemory.h"
+#include "Clownfish/Test/Util/TestSortUtils.h"
+#include "Clownfish/Test/Util/TestExternalSorter.h"
 
 TestSuite*
 Test_create_test_suite() {
@@ -47,6 +57,9 @@ Test_create_test_suite() {
     TestSuite_Add_Batch(suite, (TestBatch*)TestClass_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestMethod_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestVector_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestNumArr_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestDeque_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestSegVec_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestHash_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestHashIterator_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestObj_new());
@@ -54,12 +67,19 @@ Test_create_test_suite() {
     TestSuite_Add_Batch(suite, (TestBatch*)TestBlob_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestBB_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestStr_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestStreams_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestSerializer_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestJson_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestFrozenImage_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestCB_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestBoolean_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestNum_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestAtomic_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestHashing_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestLFReg_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestMemory_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestSortUtils_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestExtSorter_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestPtrHash_new());
 
     return suite;
@@ -20,14 +20,21 @@
 #include "Clownfish/Test/TestBlob.h"
 
 #include "Clownfish/Blob.h"
+#include "Clownfish/ByteBuf.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/String.h"
 #include "Clownfish/Test.h"
 #include "Clownfish/TestHarness/TestBatchRunner.h"
 #include "Clownfish/TestHarness/TestUtils.h"
 #include "Clownfish/Class.h"
 #include "Clownfish/Util/Memory.h"
 
+#include <stdio.h>
 #include <string.h>
 
+#define MMAP_FILE_NAME "_test_blob_mmap.bin"
+#define MMAP_FILE_SIZE 10000
+
 TestBlob*
 TestBlob_new() {
     return (TestBlob*)Class_Make_Obj(TESTBLOB);
@@ -134,14 +141,167 @@ test_Compare_To(TestBatchRunner *runner) {
     }
 }
 
+static void
+test_Slice(TestBatchRunner *runner) {
+    Blob *blob  = Blob_new("0123456789", 10);
+    Blob *slice = Blob_Slice(blob, 2, 5);
+    TEST_TRUE(runner, Blob_Equals_Bytes(slice, "23456", 5), "Slice");
+    TEST_TRUE(runner, Blob_Get_Buf(slice) == Blob_Get_Buf(blob) + 2,
+              "Slice shares buffer");
+
+    Blob *nested = Blob_Slice(slice, 1, 100);
+    TEST_TRUE(runner, Blob_Equals_Bytes(nested, "3456", 4),
+              "Slice of slice, truncated length");
+    DECREF(blob);
+    DECREF(slice);
+    TEST_TRUE(runner, Blob_Equals_Bytes(nested, "3456", 4),
+              "Slice keeps buffer alive");
+    DECREF(nested);
+
+    blob  = Blob_new("abc", 3);
+    slice = Blob_Slice(blob, 5, 1);
+    TEST_UINT_EQ(runner, Blob_Get_Size(slice), 0, "Slice past end is empty");
+    DECREF(slice);
+    slice = Blob_Slice(blob, 0, 3);
+    TEST_TRUE(runner, slice == blob, "Slice of whole Blob returns self");
+    DECREF(slice);
+    DECREF(blob);
+}
+
+static void
+test_new_view(TestBatchRunner *runner) {
+    ByteBuf *bb = BB_new_bytes("foobar", 6);
+    Blob *view = Blob_new_view(bb);
+    TEST_TRUE(runner, Blob_Get_Buf(view) == BB_Get_Buf(bb),
+              "new_view shares buffer");
+    TEST_TRUE(runner, BB_Is_Frozen(bb), "new_view freezes ByteBuf");
+
+    Blob *slice = Blob_Slice(view, 3, 3);
+    DECREF(view);
+    DECREF(bb);
+    TEST_TRUE(runner, Blob_Equals_Bytes(slice, "bar", 3),
+              "Slice of view keeps ByteBuf alive");
+    DECREF(slice);
+}
+
+typedef struct {
+    String     *path;
+    int64_t     offset;
+    int64_t     length;
+    const char *advice;
+    Blob       *blob;
+} MmapContext;
+
+static void
+S_attempt_new_mmap(void *vcontext) {
+    MmapContext *context = (MmapContext*)vcontext;
+    // Keep the Blob in the context so that the caller can release it if
+    // Advise throws.
+    context->blob = Blob_new_mmap(context->path, context->offset,
+                                  context->length);
+    if (context->advice) {
+        Blob_Advise(context->blob, SSTR_WRAP_C(context->advice));
+    }
+    DECREF(context->blob);
+    context->blob = NULL;
+}
+
+static void
+test_new_mmap(TestBatchRunner *runner) {
+    char content[MMAP_FILE_SIZE];
+    for (size_t i = 0; i < MMAP_FILE_SIZE; i++) {
+        content[i] = (char)(i * 7 % 251);
+    }
+    FILE *file = fopen(MMAP_FILE_NAME, "wb");
+    if (!file
+        || fwrite(content, 1, MMAP_FILE_SIZE, file) != MMAP_FILE_SIZE
+        || fclose(file) != 0
+       ) {
+        SKIP(runner, 12, "Can't write test file");
+        return;
+    }
+
+    String *path = SSTR_WRAP_C(MMAP_FILE_NAME);
+    Blob   *blob = Blob_new_mmap(path, 0, -1);
+    TEST_TRUE(runner, Blob_Is_Mapped(blob), "new_mmap maps the file");
+    TEST_TRUE(runner, Blob_Equals_Bytes(blob, content, MMAP_FILE_SIZE),
+              "new_mmap maps the whole file by default");
+    DECREF(blob);
+
+    blob = Blob_new_mmap(path, 4099, 100);
+    TEST_TRUE(runner, Blob_Equals_Bytes(blob, content + 4099, 100),
+              "new_mmap with unaligned offset and length");
+    Blob *slice = Blob_Slice(blob, 10, 20);
+    DECREF(blob);
+    TEST_TRUE(runner, Blob_Is_Mapped(slice), "Slice shares mapping");
+    Blob_Advise(slice, SSTR_WRAP_C("willneed"));
+    TEST_TRUE(runner, Blob_Equals_Bytes(slice, content + 4109, 20),
+              "Slice keeps mapping alive");
+    DECREF(slice);
+
+    blob = Blob_new_mmap(path, MMAP_FILE_SIZE - 10, -1);
+    TEST_UINT_EQ(runner, Blob_Get_Size(blob), 10,
+                 "new_mmap maps the rest of the file");
+    DECREF(blob);
+
+    blob = Blob_new_mmap(path, MMAP_FILE_SIZE, -1);
+    TEST_UINT_EQ(runner, Blob_Get_Size(blob), 0,
+                 "new_mmap with offset at end of file");
+    DECREF(blob);
+
+    MmapContext context;
+    context.path   = path;
+    context.offset = 0;
+    context.length = -1;
+    context.advice = "sequential";
+    context.blob   = NULL;
+    Err *error = Err_trap(S_attempt_new_mmap, &context);
+    context.advice = "random";
+    if (!error) { error = Err_trap(S_attempt_new_mmap, &context); }
+    context.advice = "willneed";
+    if (!error) { error = Err_trap(S_attempt_new_mmap, &context); }
+    TEST_TRUE(runner, error == NULL, "Advise");
+    DECREF(error);
+
+    context.advice = "bogus";
+    error = Err_trap(S_attempt_new_mmap, &context);
+    TEST_TRUE(runner, error != NULL, "Advise throws on invalid advice");
+    DECREF(error);
+    DECREF(context.blob);
+    context.blob = NULL;
+
+    context.advice = NULL;
+    context.offset = MMAP_FILE_SIZE - 10;
+    context.length = 11;
+    error = Err_trap(S_attempt_new_mmap, &context);
+    TEST_TRUE(runner, error != NULL, "new_mmap throws past end of file");
+    DECREF(error);
+
+    context.offset = -1;
+    context.length = -1;
+    error = Err_trap(S_attempt_new_mmap, &context);
+    TEST_TRUE(runner, error != NULL, "new_mmap throws on negative offset");
+    DECREF(error);
+
+    remove(MMAP_FILE_NAME);
+
+    context.offset = 0;
+    error = Err_trap(S_attempt_new_mmap, &context);
+    TEST_TRUE(runner, error != NULL, "new_mmap throws on missing file");
+    DECREF(error);
+}
+
 void
 TestBlob_Run_IMP(TestBlob *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 17);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 38);
     test_new_steal(runner);
     test_new_wrap(runner);
     test_Equals(runner);
     test_Clone(runner);
     test_Compare_To(runner);
+    test_Slice(runner);
+    test_new_view(runner);
+    test_new_mmap(runner);
 }
 
 
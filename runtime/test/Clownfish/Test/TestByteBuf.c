@@ -201,9 +201,44 @@ test_Yield_Blob(TestBatchRunner *runner) {
     DECREF(bb);
 }
 
+static void
+S_cat_frozen(void *context) {
+    ByteBuf *bb = (ByteBuf*)context;
+    BB_Cat_Bytes(bb, "x", 1);
+}
+
+static void
+S_yield_frozen(void *context) {
+    ByteBuf *bb = (ByteBuf*)context;
+    Blob *blob = BB_Yield_Blob(bb);
+    DECREF(blob);
+}
+
+static void
+test_Freeze(TestBatchRunner *runner) {
+    ByteBuf *bb = BB_new_bytes("abc", 3);
+    TEST_FALSE(runner, BB_Is_Frozen(bb), "ByteBuf isn't frozen initially");
+    BB_Freeze(bb);
+    TEST_TRUE(runner, BB_Is_Frozen(bb), "Freeze");
+
+    Err *error = Err_trap(S_cat_frozen, bb);
+    TEST_TRUE(runner, error != NULL, "Cat_Bytes on frozen ByteBuf throws");
+    DECREF(error);
+    error = Err_trap(S_yield_frozen, bb);
+    TEST_TRUE(runner, error != NULL, "Yield_Blob on frozen ByteBuf throws");
+    DECREF(error);
+    TEST_TRUE(runner, BB_Equals_Bytes(bb, "abc", 3),
+              "Frozen ByteBuf unchanged");
+
+    ByteBuf *clone = BB_Clone(bb);
+    TEST_FALSE(runner, BB_Is_Frozen(clone), "Clone isn't frozen");
+    DECREF(clone);
+    DECREF(bb);
+}
+
 void
 TestBB_Run_IMP(TestByteBuf *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 27);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 33);
     test_new_steal_bytes(runner);
     test_Equals(runner);
     test_Grow(runner);
@@ -213,6 +248,7 @@ TestBB_Run_IMP(TestByteBuf *self, TestBatchRunner *runner) {
     test_Utf8_To_String(runner);
     test_Set_Size(runner);
     test_Yield_Blob(runner);
+    test_Freeze(runner);
 }
 
 
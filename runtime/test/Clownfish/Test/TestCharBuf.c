@@ -400,6 +400,62 @@ test_vcatf_invalid(TestBatchRunner *runner) {
     DECREF(context.charbuf);
 }
 
+static void
+S_compile_invalid_pattern(void *vcontext) {
+    CatfContext *context = (CatfContext*)vcontext;
+    CompiledFormat *format = CB_compile_format(context->pattern);
+    CB_free_format(format);
+}
+
+static void
+test_compiled_format(TestBatchRunner *runner) {
+    CompiledFormat *format = CB_compile_format("%s: %i32 %%%o %f64!");
+    TEST_TRUE(runner, CB_format_size_estimate(format) >= 6,
+              "format_size_estimate counts literal text");
+
+    CharBuf *got = S_get_cb("");
+    for (int i = 0; i < 2; i++) {
+        String *str = Str_newf("obj%i32", (int32_t)i);
+        CB_catf_compiled(got, format, "foo", (int32_t)-i, str, 0.5);
+        DECREF(str);
+    }
+    String *wanted = S_get_str("foo: 0 %obj0 0.5!foo: -1 %obj1 0.5!");
+    TEST_TRUE(runner, S_cb_equals(got, wanted), "catf_compiled");
+    DECREF(wanted);
+    DECREF(got);
+    CB_free_format(format);
+
+    CatfContext context;
+    context.charbuf = NULL;
+    context.pattern = "bar %i65 baz";
+    Err *error = Err_trap(S_compile_invalid_pattern, &context);
+    TEST_TRUE(runner, error != NULL,
+              "compile_format throws with invalid pattern");
+    DECREF(error);
+}
+
+static void
+test_vcatf_reused_pattern(TestBatchRunner *runner) {
+    // The format cache is keyed by address, so make sure that it notices
+    // when the text at an address changes.
+    char pattern[32];
+    CharBuf *got = S_get_cb("");
+
+    strcpy(pattern, "a %i32 b");
+    CB_catf(got, pattern, (int32_t)1);
+    CB_catf(got, pattern, (int32_t)2);
+    strcpy(pattern, "[%u64]");
+    CB_catf(got, pattern, UINT64_C(3));
+    strcpy(pattern, "%s");
+    CB_catf(got, pattern, "c");
+
+    String *wanted = S_get_str("a 1 ba 2 b[3]c");
+    TEST_TRUE(runner, S_cb_equals(got, wanted),
+              "catf with pattern buffer reused for different text");
+    DECREF(wanted);
+    DECREF(got);
+}
+
 static void
 test_Clear(TestBatchRunner *runner) {
     CharBuf *cb = S_get_cb("foo");
@@ -432,7 +488,7 @@ test_Get_Size(TestBatchRunner *runner) {
 
 void
 TestCB_Run_IMP(TestCharBuf *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 46);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 50);
     test_vcatf_percent(runner);
     test_vcatf_s(runner);
     test_vcatf_s_invalid_utf8(runner);
@@ -449,6 +505,8 @@ TestCB_Run_IMP(TestCharBuf *self, TestBatchRunner *runner) {
     test_vcatf_f64(runner);
     test_vcatf_x32(runner);
     test_vcatf_invalid(runner);
+    test_compiled_format(runner);
+    test_vcatf_reused_pattern(runner);
     test_Cat(runner);
     test_roundtrip(runner);
     test_invalid_chars(runner);
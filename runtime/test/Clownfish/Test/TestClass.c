@@ -117,7 +117,35 @@ test_simple_subclass(TestBatchRunner *runner) {
     String *str = Obj_To_String(obj);
     TEST_TRUE(runner, Str_Equals_Utf8(str, "delta", 5), "Override");
     DECREF(str);
+    str = Str_newf("%o", obj);
+    TEST_TRUE(runner, Str_Equals_Utf8(str, "delta", 5),
+              "Default Cat_To uses overridden To_String");
+    DECREF(str);
+
+    DECREF(obj);
+}
+
+static void
+test_subclass_is_a(TestBatchRunner *runner) {
+    String *base_name    = SSTR_WRAP_C("Clownfish::Test::MyBase");
+    String *derived_name = SSTR_WRAP_C("Clownfish::Test::MyDerived");
+    Class  *base         = Class_singleton(base_name, OBJ);
+    Class  *derived      = Class_singleton(derived_name, base);
+
+    Obj *obj      = Class_Make_Obj(derived);
+    Obj *base_obj = Class_Make_Obj(base);
+    TEST_TRUE(runner,
+              Obj_is_a(obj, derived) && Obj_is_a(obj, base)
+              && Obj_is_a(obj, OBJ),
+              "Host subclasses are subclasses of all ancestors");
+    TEST_FALSE(runner, Obj_is_a(obj, STRING), "Unrelated class");
+    TEST_FALSE(runner, Obj_is_a(base_obj, derived),
+               "Parent class isn't subclass");
+    TEST_TRUE(runner,
+              CERTIFY(obj, base) == obj && DOWNCAST(NULL, base) == NULL,
+              "CERTIFY and DOWNCAST with subclasses");
 
+    DECREF(base_obj);
     DECREF(obj);
 }
 
@@ -155,9 +183,10 @@ test_Get_Methods(TestBatchRunner *runner) {
 
 void
 TestClass_Run_IMP(TestClass *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 12);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 17);
     test_bootstrap_idempotence(runner);
     test_simple_subclass(runner);
+    test_subclass_is_a(runner);
     test_add_alias_to_registry(runner);
     test_Get_Methods(runner);
 }
@@ -0,0 +1,192 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestDeque.h"
+
+#include "Clownfish/Deque.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/Class.h"
+
+TestDeque*
+TestDeque_new() {
+    return (TestDeque*)Class_Make_Obj(TESTDEQUE);
+}
+
+static int64_t
+S_int_at(Deque *deque, size_t tick) {
+    Integer *integer = (Integer*)Deque_Fetch(deque, tick);
+    return integer ? Int_Get_Value(integer) : -1;
+}
+
+static void
+test_Push_Pop(TestBatchRunner *runner) {
+    Deque *deque = Deque_new(0);
+
+    Deque_Push(deque, (Obj*)Str_newf("b"));
+    Deque_Push(deque, (Obj*)Str_newf("c"));
+    Deque_Push_Front(deque, (Obj*)Str_newf("a"));
+    Deque_Push(deque, NULL);
+    TEST_UINT_EQ(runner, Deque_Get_Size(deque), 4, "Get_Size");
+    TEST_TRUE(runner,
+              Str_Equals_Utf8((String*)Deque_Fetch(deque, 0), "a", 1)
+              && Str_Equals_Utf8((String*)Deque_Fetch(deque, 2), "c", 1),
+              "Fetch");
+    TEST_TRUE(runner, Deque_Fetch(deque, 4) == NULL,
+              "Fetch out of bounds returns NULL");
+
+    Obj *elem = Deque_Pop(deque);
+    TEST_TRUE(runner, elem == NULL && Deque_Get_Size(deque) == 3,
+              "Pop NULL element");
+
+    String *string = (String*)Deque_Pop_Front(deque);
+    TEST_TRUE(runner, Str_Equals_Utf8(string, "a", 1), "Pop_Front");
+    DECREF(string);
+
+    string = (String*)Deque_Pop(deque);
+    TEST_TRUE(runner, Str_Equals_Utf8(string, "c", 1), "Pop");
+    DECREF(string);
+
+    string = (String*)Deque_Pop(deque);
+    DECREF(string);
+    TEST_TRUE(runner, Deque_Pop(deque) == NULL, "Pop from empty Deque");
+    TEST_TRUE(runner, Deque_Pop_Front(deque) == NULL,
+              "Pop_Front from empty Deque");
+
+    DECREF(deque);
+}
+
+static void
+test_wrap_around(TestBatchRunner *runner) {
+    Deque *deque = Deque_new(8);
+    size_t cap   = Deque_Get_Capacity(deque);
+
+    // Move the head around the ring buffer several times.
+    bool fifo_ok = true;
+    int64_t next = 0;
+    for (int64_t i = 0; i < 100; i++) {
+        Deque_Push(deque, (Obj*)Int_new(i));
+        if (i % 3 != 2) { continue; }
+        for (int j = 0; j < 2; j++) {
+            Integer *integer = (Integer*)Deque_Pop_Front(deque);
+            if (Int_Get_Value(integer) != next++) { fifo_ok = false; }
+            DECREF(integer);
+        }
+    }
+    TEST_TRUE(runner, fifo_ok, "FIFO order across wrap-around");
+    TEST_TRUE(runner, Deque_Get_Capacity(deque) > cap,
+              "Deque grows when full");
+
+    // Grow while the elements wrap around the end of the buffer.
+    Deque_Clear(deque);
+    cap = Deque_Get_Capacity(deque);
+    for (int64_t i = 0; i < (int64_t)cap; i++) {
+        Deque_Push_Front(deque, (Obj*)Int_new(-i - 1));
+    }
+    Deque_Push(deque, (Obj*)Int_new(0));
+    bool order_ok = Deque_Get_Size(deque) == cap + 1;
+    for (size_t i = 0; i <= cap; i++) {
+        if (S_int_at(deque, i) != (int64_t)i - (int64_t)cap) {
+            order_ok = false;
+        }
+    }
+    TEST_TRUE(runner, order_ok, "Grow preserves order of wrapped elements");
+
+    Deque_Clear(deque);
+    TEST_UINT_EQ(runner, Deque_Get_Size(deque), 0, "Clear");
+
+    DECREF(deque);
+}
+
+static void
+test_large_queue(TestBatchRunner *runner) {
+    Deque  *deque = Deque_new(0);
+    size_t  num   = 100000;
+
+    for (size_t i = 0; i < num; i++) {
+        Deque_Push(deque, (Obj*)Int_new((int64_t)i));
+    }
+    bool ok = true;
+    for (size_t i = 0; i < num; i++) {
+        Integer *integer = (Integer*)Deque_Pop_Front(deque);
+        if (Int_Get_Value(integer) != (int64_t)i) { ok = false; }
+        DECREF(integer);
+    }
+    TEST_TRUE(runner, ok && Deque_Get_Size(deque) == 0, "Large FIFO");
+
+    DECREF(deque);
+}
+
+static bool
+S_same_digest(Obj *a, Obj *b) {
+    uint64_t digest_a[2];
+    uint64_t digest_b[2];
+    Obj_Digest(a, digest_a);
+    Obj_Digest(b, digest_b);
+    return digest_a[0] == digest_b[0] && digest_a[1] == digest_b[1];
+}
+
+static void
+test_Equals_and_Clone(TestBatchRunner *runner) {
+    Deque *deque = Deque_new(4);
+    for (int64_t i = 0; i < 3; i++) {
+        Deque_Push_Front(deque, (Obj*)Int_new(i));
+    }
+    Deque_Push(deque, NULL);
+
+    Deque *twin = Deque_Clone(deque);
+    TEST_TRUE(runner, Deque_Equals(deque, (Obj*)twin), "Clone");
+    TEST_TRUE(runner, Deque_Fetch(deque, 0) == Deque_Fetch(twin, 0),
+              "Clone shares elements");
+
+    // The elements of `deque` wrap around the end of its ring buffer.
+    Deque *flat = Deque_new(4);
+    for (int64_t i = 2; i >= 0; i--) {
+        Deque_Push(flat, (Obj*)Int_new(i));
+    }
+    Deque_Push(flat, NULL);
+    TEST_TRUE(runner,
+              Deque_Equals(deque, (Obj*)flat)
+              && S_same_digest((Obj*)deque, (Obj*)flat),
+              "Equal Deques have the same Digest");
+    DECREF(flat);
+
+    DECREF(Deque_Pop_Front(twin));
+    Deque_Push(twin, (Obj*)Int_new(2));
+    TEST_FALSE(runner, Deque_Equals(deque, (Obj*)twin),
+               "Deques with different elements aren't equal");
+    TEST_FALSE(runner, S_same_digest((Obj*)deque, (Obj*)twin),
+               "Different elements change Digest");
+
+    DECREF(twin);
+    DECREF(deque);
+}
+
+void
+TestDeque_Run_IMP(TestDeque *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 18);
+    test_Push_Pop(runner);
+    test_wrap_around(runner);
+    test_large_queue(runner);
+    test_Equals_and_Clone(runner);
+}
+
@@ -0,0 +1,325 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestFrozenImage.h"
+
+#include "Clownfish/Blob.h"
+#include "Clownfish/Boolean.h"
+#include "Clownfish/ByteBuf.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/FrozenImage.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/OutStream.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Hashing.h"
+#include "Clownfish/Class.h"
+
+#define IMAGE_FILE_NAME "_test_frozen_image.bin"
+
+TestFrozenImage*
+TestFrozenImage_new() {
+    return (TestFrozenImage*)Class_Make_Obj(TESTFROZENIMAGE);
+}
+
+static ByteBuf*
+S_write_image(Obj *root) {
+    ByteBuf   *bb        = BB_new(0);
+    OutStream *outstream = OutStream_new_bytebuf(bb);
+    FrozenImage_write(root, outstream);
+    OutStream_Close(outstream);
+    DECREF(outstream);
+    return bb;
+}
+
+static FrozenImage*
+S_load_image(ByteBuf *bb) {
+    Blob        *blob  = Blob_new(BB_Get_Buf(bb), BB_Get_Size(bb));
+    FrozenImage *image = FrozenImage_new(blob);
+    DECREF(blob);
+    return image;
+}
+
+static Hash*
+S_make_graph() {
+    Hash *graph = Hash_new(0);
+    for (int i = 0; i < 50; i++) {
+        Vector *words = Vec_new(3);
+        Vec_Push(words, (Obj*)Str_newf("word %i32", (int32_t)i));
+        Vec_Push(words, (Obj*)Str_newf("common"));
+        Vec_Push(words, (Obj*)Int_new(-i * 1000000007LL));
+        String *key = Str_newf("key %i32", (int32_t)i);
+        Hash_Store(graph, key, (Obj*)words);
+        DECREF(key);
+    }
+    Hash *misc = Hash_new(0);
+    Hash_Store_Utf8(misc, "float", 5, (Obj*)Float_new(-2.5));
+    Hash_Store_Utf8(misc, "true", 4, (Obj*)INCREF(CFISH_TRUE));
+    Hash_Store_Utf8(misc, "false", 5, (Obj*)INCREF(CFISH_FALSE));
+    Hash_Store_Utf8(misc, "blob", 4, (Obj*)Blob_new("\0\1\2", 3));
+    Hash_Store_Utf8(misc, "empty", 5, (Obj*)Hash_new(0));
+    Hash_Store_Utf8(misc, "", 0, (Obj*)Str_newf(""));
+    Hash_Store_Utf8(graph, "misc", 4, (Obj*)misc);
+    return graph;
+}
+
+static void
+test_round_trip(TestBatchRunner *runner) {
+    Hash        *graph = S_make_graph();
+    ByteBuf     *bb    = S_write_image((Obj*)graph);
+    FrozenImage *image = S_load_image(bb);
+    Obj         *root  = FrozenImage_Get_Root(image);
+
+    TEST_TRUE(runner, root && Obj_is_a(root, HASH)
+              && Hash_Equals(graph, root),
+              "round trip");
+    TEST_UINT_EQ(runner, FrozenImage_Get_Size(image), BB_Get_Size(bb),
+                 "Get_Size");
+    TEST_TRUE(runner, cfish_is_immortal(root), "objects are immortal");
+
+    Vector *words = (Vector*)Hash_Fetch_Utf8((Hash*)root, "key 7", 5);
+    TEST_TRUE(runner,
+              Str_Equals_Utf8((String*)Vec_Fetch(words, 0), "word 7", 6),
+              "Hash_Fetch and Vec_Fetch");
+
+    // Refcounting has no effect on frozen objects.
+    Obj *elem = INCREF(Vec_Fetch(words, 0));
+    DECREF(elem);
+    DECREF(elem);
+    DECREF(words);
+    String *sub = Str_new_from_byte_range((String*)elem, 5, 1);
+    TEST_TRUE(runner, Str_Equals_Utf8(sub, "7", 1),
+              "substring of frozen String");
+    DECREF(sub);
+    TEST_TRUE(runner, Hash_Equals(graph, root), "graph intact after DECREF");
+
+    Vector *other = (Vector*)Hash_Fetch_Utf8((Hash*)root, "key 8", 5);
+    TEST_TRUE(runner, Vec_Fetch(words, 1) == Vec_Fetch(other, 1),
+              "equal Strings are stored once");
+
+    DECREF(image);
+    DECREF(bb);
+    DECREF(graph);
+}
+
+static void
+test_sharing(TestBatchRunner *runner) {
+    Vector *shared = Vec_new(0);
+    Vec_Push(shared, (Obj*)Int_new(42));
+    Vector *root = Vec_new(0);
+    Vec_Push(root, INCREF(shared));
+    Vec_Push(root, INCREF(shared));
+    Vec_Push(root, INCREF(root));
+    Vec_Push(root, NULL);
+
+    ByteBuf     *bb     = S_write_image((Obj*)root);
+    FrozenImage *image  = S_load_image(bb);
+    Vector      *frozen = (Vector*)FrozenImage_Get_Root(image);
+    TEST_TRUE(runner, Vec_Fetch(frozen, 0) == Vec_Fetch(frozen, 1),
+              "shared objects stay shared");
+    TEST_TRUE(runner, Vec_Fetch(frozen, 2) == (Obj*)frozen, "cycles");
+    TEST_TRUE(runner, Vec_Get_Size(frozen) == 4
+              && Vec_Fetch(frozen, 3) == NULL,
+              "NULL elements");
+
+    DECREF(image);
+    DECREF(bb);
+    Vec_Clear(root);
+    DECREF(root);
+    DECREF(shared);
+
+    bb    = S_write_image(NULL);
+    image = S_load_image(bb);
+    TEST_TRUE(runner, FrozenImage_Get_Root(image) == NULL, "NULL root");
+    DECREF(image);
+    DECREF(bb);
+
+    Float *num = Float_new(0.125);
+    bb    = S_write_image((Obj*)num);
+    image = S_load_image(bb);
+    TEST_TRUE(runner, Float_Equals(num, FrozenImage_Get_Root(image)),
+              "scalar root");
+    DECREF(image);
+    DECREF(bb);
+    DECREF(num);
+}
+
+static void
+test_mmap(TestBatchRunner *runner) {
+    Hash      *graph     = S_make_graph();
+    String    *path      = SSTR_WRAP_C(IMAGE_FILE_NAME);
+    OutStream *outstream = OutStream_open(path);
+    FrozenImage_write((Obj*)graph, outstream);
+    OutStream_Close(outstream);
+    DECREF(outstream);
+
+    FrozenImage *image = FrozenImage_new_mmap(path);
+    TEST_TRUE(runner, Hash_Equals(graph, FrozenImage_Get_Root(image)),
+              "new_mmap");
+    TEST_FALSE(runner, FrozenImage_Was_Rehashed(image),
+               "new_mmap with same hash seed doesn't rehash");
+    DECREF(image);
+
+    // A second mapping relocates its own private copy.
+    FrozenImage *image1 = FrozenImage_new_mmap(path);
+    FrozenImage *image2 = FrozenImage_new_mmap(path);
+    TEST_TRUE(runner, Hash_Equals((Hash*)FrozenImage_Get_Root(image1),
+                                  FrozenImage_Get_Root(image2)),
+              "multiple mappings");
+    DECREF(image1);
+    DECREF(image2);
+
+    remove(IMAGE_FILE_NAME);
+    DECREF(graph);
+}
+
+static void
+test_rehash(TestBatchRunner *runner) {
+    Hash    *graph = S_make_graph();
+    ByteBuf *bb    = S_write_image((Obj*)graph);
+
+    FrozenImage *image = S_load_image(bb);
+    TEST_FALSE(runner, FrozenImage_Was_Rehashed(image),
+               "same hash seed doesn't rehash");
+    DECREF(image);
+
+    // Simulate an image from a process with another seed by changing the
+    // hash of the probe string in the header.
+    const char *probe      = "Clownfish::FrozenImage";
+    uint64_t    probe_hash = Hashing_hash_bytes(probe, strlen(probe));
+    char       *buf        = BB_Get_Buf(bb);
+    bool        found      = false;
+    for (size_t i = 0; i + sizeof(probe_hash) <= 128; i += 8) {
+        if (memcmp(buf + i, &probe_hash, sizeof(probe_hash)) == 0) {
+            buf[i] ^= 1;
+            found = true;
+            break;
+        }
+    }
+    image = S_load_image(bb);
+    Obj *root = FrozenImage_Get_Root(image);
+    TEST_TRUE(runner, found && FrozenImage_Was_Rehashed(image),
+              "different hash seed rehashes");
+    TEST_TRUE(runner, Hash_Equals(graph, root),
+              "Hash lookups work after rehash");
+    DECREF(image);
+
+    DECREF(bb);
+    DECREF(graph);
+}
+
+typedef struct {
+    Obj       *root;
+    OutStream *outstream;
+} WriteContext;
+
+static void
+S_attempt_write(void *vcontext) {
+    WriteContext *context = (WriteContext*)vcontext;
+    FrozenImage_write(context->root, context->outstream);
+}
+
+static void
+S_attempt_load(void *context) {
+    FrozenImage *image = FrozenImage_new((Blob*)context);
+    DECREF(image);
+}
+
+static void
+S_attempt_new_mmap(void *context) {
+    FrozenImage *image = FrozenImage_new_mmap((String*)context);
+    DECREF(image);
+}
+
+static void
+test_errors(TestBatchRunner *runner) {
+    Vector *unsupported = Vec_new(0);
+    Vec_Push(unsupported, (Obj*)BB_new(0));
+    ByteBuf      *unsupported_bb = BB_new(0);
+    WriteContext  context;
+    context.root      = (Obj*)unsupported;
+    context.outstream = OutStream_new_bytebuf(unsupported_bb);
+    Err *error = Err_trap(S_attempt_write, &context);
+    TEST_TRUE(runner, error != NULL, "write throws on unsupported class");
+    DECREF(error);
+    DECREF(context.outstream);
+    DECREF(unsupported_bb);
+    DECREF(unsupported);
+
+    Hash    *graph = S_make_graph();
+    ByteBuf *bb    = S_write_image((Obj*)graph);
+    size_t   size  = BB_Get_Size(bb);
+    char    *buf   = BB_Get_Buf(bb);
+
+    Blob *truncated = Blob_new(buf, size - 1);
+    error = Err_trap(S_attempt_load, truncated);
+    TEST_TRUE(runner, error != NULL, "load throws on truncated image");
+    DECREF(error);
+    DECREF(truncated);
+
+    buf[0] = 'X';
+    Blob *bad_magic = Blob_new(buf, size);
+    buf[0] = 'C';
+    error = Err_trap(S_attempt_load, bad_magic);
+    TEST_TRUE(runner, error != NULL, "load throws on bad magic");
+    DECREF(error);
+    DECREF(bad_magic);
+
+    // Corrupt every word in the object and array sections in turn.  Each
+    // corruption must either be detected or leave a usable image.
+    size_t num_thrown = 0;
+    for (size_t offset = 64; offset + 8 <= size; offset += 8) {
+        char saved[8];
+        memcpy(saved, buf + offset, 8);
+        memset(buf + offset, 0x41, 8);
+        Blob *corrupt = Blob_new(buf, size);
+        memcpy(buf + offset, saved, 8);
+        error = Err_trap(S_attempt_load, corrupt);
+        if (error) { num_thrown++; }
+        DECREF(error);
+        DECREF(corrupt);
+    }
+    TEST_TRUE(runner, num_thrown > 0, "load detects corruption");
+
+    error = Err_trap(S_attempt_new_mmap, SSTR_WRAP_C("_no_such_image.bin"));
+    TEST_TRUE(runner, error != NULL, "new_mmap throws on missing file");
+    DECREF(error);
+
+    DECREF(bb);
+    DECREF(graph);
+}
+
+void
+TestFrozenImage_Run_IMP(TestFrozenImage *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 23);
+    test_round_trip(runner);
+    test_sharing(runner);
+    test_mmap(runner);
+    test_rehash(runner);
+    test_errors(runner);
+}
+
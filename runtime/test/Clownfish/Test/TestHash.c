@@ -26,6 +26,7 @@
 #include "Clownfish/String.h"
 #include "Clownfish/Boolean.h"
 #include "Clownfish/Hash.h"
+#include "Clownfish/Num.h"
 #include "Clownfish/Test.h"
 #include "Clownfish/TestHarness/TestBatchRunner.h"
 #include "Clownfish/TestHarness/TestUtils.h"
@@ -62,6 +63,47 @@ test_Equals(TestBatchRunner *runner) {
     DECREF(other);
 }
 
+static bool
+S_same_digest(Obj *a, Obj *b) {
+    uint64_t digest_a[2];
+    uint64_t digest_b[2];
+    Obj_Digest(a, digest_a);
+    Obj_Digest(b, digest_b);
+    return digest_a[0] == digest_b[0] && digest_a[1] == digest_b[1];
+}
+
+static void
+test_Digest(TestBatchRunner *runner) {
+    Hash *hash  = Hash_new(0);
+    Hash *other = Hash_new(100);
+
+    for (int32_t i = 0; i < 50; i++) {
+        String *key = Str_newf("%i32", i);
+        Hash_Store(hash, key, (Obj*)Int_new(i));
+        DECREF(key);
+    }
+    for (int32_t i = 49; i >= 0; i--) {
+        String *key = Str_newf("%i32", i);
+        Hash_Store(other, key, (Obj*)Int_new(i));
+        DECREF(key);
+    }
+    TEST_TRUE(runner, S_same_digest((Obj*)hash, (Obj*)other),
+              "Digest doesn't depend on order of entries");
+
+    Hash_Store_Utf8(other, "7", 1, (Obj*)Int_new(8));
+    TEST_FALSE(runner, S_same_digest((Obj*)hash, (Obj*)other),
+               "Different value changes Digest");
+
+    Hash_Store_Utf8(other, "7", 1, (Obj*)Int_new(7));
+    Hash_Store_Utf8(hash, "foo", 3, (Obj*)CFISH_TRUE);
+    Hash_Store_Utf8(other, "bar", 3, (Obj*)CFISH_TRUE);
+    TEST_FALSE(runner, S_same_digest((Obj*)hash, (Obj*)other),
+               "Different key changes Digest");
+
+    DECREF(hash);
+    DECREF(other);
+}
+
 static void
 test_Store_and_Fetch(TestBatchRunner *runner) {
     Hash          *hash         = Hash_new(100);
@@ -225,11 +267,22 @@ test_stress(TestBatchRunner *runner) {
 static void
 test_collision(TestBatchRunner *runner) {
     Hash   *hash = Hash_new(0);
+    size_t  mask = Hash_Get_Capacity(hash) - 1;
     String *one  = Str_newf("A");
-    String *two  = Str_newf("P{2}|=~-ULE/d");
+    size_t  slot = Str_Hash_Sum(one) & mask;
 
-    TEST_TRUE(runner, Str_Hash_Sum(one) == Str_Hash_Sum(two),
-              "Keys have the same hash sum");
+    // Find a key which maps to the same bucket.
+    String *two = NULL;
+    for (int i = 0; i < 100000; i++) {
+        two = Str_newf("%i32", i);
+        if (slot == (Str_Hash_Sum(two) & mask)) {
+            break;
+        }
+        DECREF(two);
+        two = NULL;
+    }
+
+    TEST_TRUE(runner, two != NULL, "Keys map to the same bucket");
 
     Hash_Store(hash, one, INCREF(one));
     Hash_Store(hash, two, INCREF(two));
@@ -293,26 +346,61 @@ test_threshold_accounting(TestBatchRunner *runner) {
 
 static void
 test_tombstone_identification(TestBatchRunner *runner) {
-    Hash   *hash = Hash_new(20);
-    String *key  = Str_newf("P{2}|=~-U@!y>");
-
-    // Tombstones have a zero hash_sum.
-    TEST_UINT_EQ(runner, Str_Hash_Sum(key), 0, "Key has zero hash sum");
+    Hash   *hash      = Hash_new(20);
+    String *tombstone = Hash_get_tombstone();
+    String *key       = Str_newf("%o", tombstone);
 
+    // Tombstones keep the hash sum of the deleted key.  A key with the same
+    // content as the tombstone's reaches every comparison except the
+    // identity check.
     Hash_Store(hash, key, (Obj*)CFISH_TRUE);
     Hash_Delete(hash, key);
     TEST_TRUE(runner, Hash_Fetch(hash, key) == NULL,
-              "Key with zero hash sum isn't mistaken for tombstone");
+              "Key equal to tombstone isn't found in its tombstone's slot");
+    TEST_TRUE(runner, Hash_Delete(hash, key) == NULL,
+              "Tombstone isn't deleted again");
+    TEST_UINT_EQ(runner, Hash_Get_Size(hash), 0,
+                 "Tombstone isn't counted");
+
+    Hash_Store(hash, key, (Obj*)CFISH_TRUE);
+    TEST_TRUE(runner, Hash_Fetch(hash, key) == (Obj*)CFISH_TRUE,
+              "Key equal to tombstone can be stored again");
+    TEST_UINT_EQ(runner, Hash_Get_Size(hash), 1,
+                 "Key equal to tombstone is counted once");
 
     DECREF(key);
     DECREF(hash);
 }
 
+static void
+test_To_String(TestBatchRunner *runner) {
+    Hash   *hash  = Hash_new(0);
+    Vector *value = Vec_new(1);
+    Vec_Push(value, (Obj*)CFISH_FALSE);
+    Hash_Store_Utf8(hash, "key", 3, (Obj*)value);
+
+    String *string = Hash_To_String(hash);
+    TEST_TRUE(runner, Str_Equals_Utf8(string, "{key: [false]}", 14),
+              "To_String");
+    DECREF(string);
+
+    // Cycle through a Vector.
+    Vec_Push(value, INCREF(hash));
+    string = Str_newf("%o", hash);
+    TEST_TRUE(runner,
+              Str_Equals_Utf8(string, "{key: [false, {...}]}", 21),
+              "To_String of Hash containing itself");
+    DECREF(string);
+    Vec_Clear(value);
+    DECREF(hash);
+}
+
 void
 TestHash_Run_IMP(TestHash *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 39);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 47);
     srand((unsigned int)time((time_t*)NULL));
     test_Equals(runner);
+    test_Digest(runner);
     test_Store_and_Fetch(runner);
     test_Keys_Values(runner);
     test_stress(runner);
@@ -320,6 +408,7 @@ TestHash_Run_IMP(TestHash *self, TestBatchRunner *runner) {
     test_store_skips_tombstone(runner);
     test_threshold_accounting(runner);
     test_tombstone_identification(runner);
+    test_To_String(runner);
 }
 
 
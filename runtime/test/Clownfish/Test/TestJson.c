@@ -0,0 +1,316 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestJson.h"
+
+#include "Clownfish/Boolean.h"
+#include "Clownfish/CharBuf.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/Json.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Util/Memory.h"
+
+TestJson*
+TestJson_new() {
+    return (TestJson*)Class_Make_Obj(TESTJSON);
+}
+
+static Obj*
+S_decode(const char *json) {
+    return Json_decode_utf8(json, strlen(json));
+}
+
+static bool
+S_encodes_as(Obj *obj, const char *expected) {
+    String *json   = Json_encode(obj);
+    bool    result = Str_Equals_Utf8(json, expected, strlen(expected));
+    DECREF(json);
+    return result;
+}
+
+static void
+test_decode(TestBatchRunner *runner) {
+    Obj *got = S_decode(
+        " {\"name\": \"ada\", \"tags\": [1, 2.5, true, false, null],"
+        " \"nested\": {\"empty\": [], \"none\": {}}} ");
+    Hash *expected = Hash_new(0);
+    Hash_Store_Utf8(expected, "name", 4, (Obj*)Str_newf("ada"));
+    Vector *tags = Vec_new(0);
+    Vec_Push(tags, (Obj*)Int_new(1));
+    Vec_Push(tags, (Obj*)Float_new(2.5));
+    Vec_Push(tags, (Obj*)INCREF(CFISH_TRUE));
+    Vec_Push(tags, (Obj*)INCREF(CFISH_FALSE));
+    Vec_Push(tags, NULL);
+    Hash_Store_Utf8(expected, "tags", 4, (Obj*)tags);
+    Hash *nested = Hash_new(0);
+    Hash_Store_Utf8(nested, "empty", 5, (Obj*)Vec_new(0));
+    Hash_Store_Utf8(nested, "none", 4, (Obj*)Hash_new(0));
+    Hash_Store_Utf8(expected, "nested", 6, (Obj*)nested);
+    TEST_TRUE(runner, got && Obj_is_a(got, HASH) && Hash_Equals(expected, got),
+              "decode object");
+    DECREF(expected);
+    DECREF(got);
+
+    got = S_decode("\"plain\"");
+    TEST_TRUE(runner, got && Obj_is_a(got, STRING)
+              && Str_Equals_Utf8((String*)got, "plain", 5),
+              "decode top-level string");
+    DECREF(got);
+
+    got = S_decode("null");
+    TEST_TRUE(runner, got == NULL, "decode null");
+
+    got = S_decode("{\"a\": 1, \"a\": 2}");
+    Obj *value = Hash_Fetch_Utf8((Hash*)got, "a", 1);
+    TEST_TRUE(runner, Hash_Get_Size((Hash*)got) == 1
+              && Int_Get_Value((Integer*)value) == 2,
+              "duplicate keys: last one wins");
+    DECREF(got);
+}
+
+static void
+test_substrings(TestBatchRunner *runner) {
+    String *json = Str_newf("[\"a long string without escapes\", \"x\\ty\"]");
+    const char *start = Str_Get_Ptr8(json);
+    const char *limit = start + Str_Get_Size(json);
+    Vector *got = (Vector*)Json_decode(json);
+
+    String *plain = (String*)Vec_Fetch(got, 0);
+    const char *ptr = Str_Get_Ptr8(plain);
+    TEST_TRUE(runner, ptr > start && ptr < limit,
+              "unescaped string shares source buffer");
+    TEST_TRUE(runner, Str_Equals_Utf8(plain, "a long string without escapes",
+                                      29),
+              "shared substring has right content");
+
+    String *escaped = (String*)Vec_Fetch(got, 1);
+    TEST_TRUE(runner, Str_Equals_Utf8(escaped, "x\ty", 3),
+              "escaped string decoded");
+
+    // Substrings keep the source alive.
+    INCREF(plain);
+    DECREF(got);
+    DECREF(json);
+    TEST_TRUE(runner, Str_Equals_Utf8(plain, "a long string without escapes",
+                                      29),
+              "substring outlives source");
+    DECREF(plain);
+}
+
+static void
+test_escapes(TestBatchRunner *runner) {
+    Obj *got = S_decode("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"");
+    TEST_TRUE(runner, Str_Equals_Utf8((String*)got, "\"\\/\b\f\n\r\t", 8),
+              "simple escapes");
+    DECREF(got);
+
+    got = S_decode("\"caf\\u00e9 \\u20AC \\ud83d\\ude00\"");
+    TEST_TRUE(runner,
+              Str_Equals_Utf8((String*)got,
+                              "caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80", 14),
+              "unicode escapes and surrogate pair");
+    DECREF(got);
+
+    // A run long enough to exercise the vectorized scanner on both sides
+    // of an escape.
+    got = S_decode("\"0123456789abcdef0123456789\\nabcdef0123456789abcdef\"");
+    TEST_TRUE(runner,
+              Str_Equals_Utf8((String*)got,
+                "0123456789abcdef0123456789\nabcdef0123456789abcdef", 49),
+              "escape inside long string");
+    DECREF(got);
+
+    String *string = Str_newf("tab\there \"quoted\" \\ %s", "\x01");
+    TEST_TRUE(runner,
+              S_encodes_as((Obj*)string,
+                           "\"tab\\there \\\"quoted\\\" \\\\ \\u0001\""),
+              "encode escapes");
+    String *json = Json_encode((Obj*)string);
+    Obj    *copy = Json_decode(json);
+    TEST_TRUE(runner, Str_Equals(string, copy), "escaped string round trip");
+    DECREF(copy);
+    DECREF(json);
+    DECREF(string);
+}
+
+static void
+test_numbers(TestBatchRunner *runner) {
+    Obj *got = S_decode("[0, -0, 9223372036854775807, -9223372036854775808,"
+                        " 9223372036854775808, 1e3, -2.5E-1, -0.0]");
+    Vector *vec = (Vector*)got;
+    Obj *elem = Vec_Fetch(vec, 2);
+    TEST_TRUE(runner, Obj_is_a(elem, INTEGER)
+              && Int_Get_Value((Integer*)elem) == INT64_MAX,
+              "INT64_MAX");
+    elem = Vec_Fetch(vec, 3);
+    TEST_TRUE(runner, Obj_is_a(elem, INTEGER)
+              && Int_Get_Value((Integer*)elem) == INT64_MIN,
+              "INT64_MIN");
+    elem = Vec_Fetch(vec, 4);
+    TEST_TRUE(runner, Obj_is_a(elem, FLOAT)
+              && Float_Get_Value((Float*)elem) == 9223372036854775808.0,
+              "integer overflow decodes as Float");
+    elem = Vec_Fetch(vec, 5);
+    TEST_TRUE(runner, Obj_is_a(elem, FLOAT)
+              && Float_Get_Value((Float*)elem) == 1000.0,
+              "exponent");
+    elem = Vec_Fetch(vec, 6);
+    TEST_TRUE(runner, Obj_is_a(elem, FLOAT)
+              && Float_Get_Value((Float*)elem) == -0.25,
+              "negative fraction with exponent");
+    DECREF(got);
+
+    Float *third = Float_new(1.0 / 3.0);
+    String *json = Json_encode((Obj*)third);
+    got = Json_decode(json);
+    TEST_TRUE(runner, Float_Equals(third, got), "Float round trip");
+    DECREF(got);
+    DECREF(json);
+    DECREF(third);
+
+    Vector *nums = Vec_new(0);
+    Vec_Push(nums, (Obj*)Int_new(INT64_MIN));
+    Vec_Push(nums, (Obj*)Int_new(42));
+    Vec_Push(nums, (Obj*)Float_new(2.0));
+    Vec_Push(nums, (Obj*)Float_new(0.5));
+    TEST_TRUE(runner,
+              S_encodes_as((Obj*)nums, "[-9223372036854775808,42,2.0,0.5]"),
+              "encode numbers");
+    DECREF(nums);
+}
+
+static void
+test_encode(TestBatchRunner *runner) {
+    Hash *hash = Hash_new(0);
+    Vector *vec = Vec_new(0);
+    Vec_Push(vec, (Obj*)INCREF(CFISH_TRUE));
+    Vec_Push(vec, NULL);
+    Vec_Push(vec, (Obj*)Str_newf("s"));
+    Hash_Store_Utf8(hash, "list", 4, (Obj*)vec);
+    TEST_TRUE(runner, S_encodes_as((Obj*)hash, "{\"list\":[true,null,\"s\"]}"),
+              "encode hash and vector");
+
+    CharBuf *buf = CB_new(0);
+    CB_Cat_Utf8(buf, "prefix:", 7);
+    Json_encode_to((Obj*)vec, buf);
+    String *string = CB_To_String(buf);
+    TEST_TRUE(runner, Str_Equals_Utf8(string, "prefix:[true,null,\"s\"]", 22),
+              "encode_to appends");
+    DECREF(string);
+    DECREF(buf);
+
+    String *json = Json_encode((Obj*)hash);
+    Obj    *copy = Json_decode(json);
+    TEST_TRUE(runner, Hash_Equals(hash, copy), "round trip");
+    DECREF(copy);
+    DECREF(json);
+    DECREF(hash);
+}
+
+static void
+S_attempt_decode(void *context) {
+    Obj *obj = S_decode((const char*)context);
+    DECREF(obj);
+}
+
+static void
+S_attempt_encode(void *context) {
+    String *json = Json_encode((Obj*)context);
+    DECREF(json);
+}
+
+static void
+test_errors(TestBatchRunner *runner) {
+    static const char *const bad_inputs[] = {
+        "",
+        "[1, 2",
+        "[1 2]",
+        "{\"a\" 1}",
+        "{a: 1}",
+        "[1,]",
+        "01",
+        "1.",
+        "-",
+        "1e",
+        "tru",
+        "\"unterminated",
+        "\"bad \\x escape\"",
+        "\"\\ud800\"",
+        "\"\\udc00\"",
+        "\"\\u12G4\"",
+        "\"raw\ncontrol\"",
+        "[] []",
+    };
+    size_t num_bad = sizeof(bad_inputs) / sizeof(bad_inputs[0]);
+    size_t num_thrown = 0;
+    for (size_t i = 0; i < num_bad; i++) {
+        Err *error = Err_trap(S_attempt_decode, (void*)bad_inputs[i]);
+        if (error) { num_thrown++; }
+        DECREF(error);
+    }
+    TEST_UINT_EQ(runner, num_thrown, num_bad, "decode throws on bad input");
+
+    CharBuf *nested = CB_new(0);
+    for (int i = 0; i < 1000; i++) { CB_Cat_Trusted_Utf8(nested, "[", 1); }
+    for (int i = 0; i < 1000; i++) { CB_Cat_Trusted_Utf8(nested, "]", 1); }
+    String *nested_str = CB_Yield_String(nested);
+    char *nested_json = Str_To_Utf8(nested_str);
+    Err *error = Err_trap(S_attempt_decode, nested_json);
+    TEST_TRUE(runner, error != NULL, "decode throws on deep nesting");
+    DECREF(error);
+    FREEMEM(nested_json);
+    DECREF(nested_str);
+    DECREF(nested);
+
+    Float *nan = Float_new(0.0 / 0.0);
+    error = Err_trap(S_attempt_encode, nan);
+    TEST_TRUE(runner, error != NULL, "encode throws on NaN");
+    DECREF(error);
+    DECREF(nan);
+
+    Vector *cycle = Vec_new(1);
+    Vec_Push(cycle, INCREF(cycle));
+    error = Err_trap(S_attempt_encode, cycle);
+    TEST_TRUE(runner, error != NULL, "encode throws on cycle");
+    DECREF(error);
+    Vec_Clear(cycle);
+    DECREF(cycle);
+}
+
+void
+TestJson_Run_IMP(TestJson *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 27);
+    test_decode(runner);
+    test_substrings(runner);
+    test_escapes(runner);
+    test_numbers(runner);
+    test_encode(runner);
+    test_errors(runner);
+}
+
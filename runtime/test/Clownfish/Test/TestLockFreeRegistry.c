@@ -76,6 +76,34 @@ test_all(TestBatchRunner *runner) {
     LFReg_destroy(registry);
 }
 
+static void
+test_growth(TestBatchRunner *runner) {
+    LockFreeRegistry *registry = LFReg_new(1);
+    uint32_t num_keys = 1000;
+
+    for (uint32_t i = 0; i < num_keys; i++) {
+        String *key = Str_newf("key%u32", i);
+        LFReg_register(registry, key, (Obj*)key);
+        DECREF(key);
+    }
+
+    uint32_t num_found = 0;
+    uint32_t num_dupes = 0;
+    for (uint32_t i = 0; i < num_keys; i++) {
+        String *key   = Str_newf("key%u32", i);
+        Obj    *value = LFReg_fetch(registry, key);
+        if (value && Str_Equals(key, value)) { num_found++; }
+        if (LFReg_register(registry, key, (Obj*)key)) { num_dupes++; }
+        DECREF(key);
+    }
+    TEST_UINT_EQ(runner, num_found, num_keys,
+                 "Fetch() finds all keys after growing");
+    TEST_UINT_EQ(runner, num_dupes, 0,
+                 "Can't Register() keys again after growing");
+
+    LFReg_destroy(registry);
+}
+
 static void
 S_register_many(void *varg) {
     ThreadArgs *args = (ThreadArgs*)varg;
@@ -160,8 +188,9 @@ test_threads(TestBatchRunner *runner) {
 
 void
 TestLFReg_Run_IMP(TestLockFreeRegistry *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 7);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 9);
     test_all(runner);
+    test_growth(runner);
     test_threads(runner);
 }
 
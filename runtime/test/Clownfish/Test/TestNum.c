@@ -250,6 +250,43 @@ test_Equals_and_Compare_To(TestBatchRunner *runner) {
     S_test_compare_float_int(runner, 1.0, 2, -1);
 }
 
+static bool
+S_same_digest(Obj *a, Obj *b) {
+    uint64_t digest_a[2];
+    uint64_t digest_b[2];
+    Obj_Digest(a, digest_a);
+    Obj_Digest(b, digest_b);
+    return digest_a[0] == digest_b[0] && digest_a[1] == digest_b[1];
+}
+
+static void
+test_Digest(TestBatchRunner *runner) {
+    Integer *i64      = Int_new(-3);
+    Integer *zero     = Int_new(0);
+    Float   *f64      = Float_new(-3.0);
+    Float   *neg_zero = Float_new(-0.0);
+    Float   *half     = Float_new(0.5);
+    Float   *big      = Float_new(9223372036854775808.0);
+    Integer *max      = Int_new(INT64_MAX);
+
+    TEST_TRUE(runner, S_same_digest((Obj*)i64, (Obj*)f64),
+              "Equal Integer and Float have the same Digest");
+    TEST_TRUE(runner, S_same_digest((Obj*)zero, (Obj*)neg_zero),
+              "Digest of -0.0 equals Digest of 0");
+    TEST_FALSE(runner, S_same_digest((Obj*)zero, (Obj*)half),
+               "Digest of fractional Float");
+    TEST_FALSE(runner, S_same_digest((Obj*)max, (Obj*)big),
+               "Digest of Float out of int64 range");
+
+    DECREF(max);
+    DECREF(big);
+    DECREF(half);
+    DECREF(neg_zero);
+    DECREF(f64);
+    DECREF(zero);
+    DECREF(i64);
+}
+
 static void
 test_Clone(TestBatchRunner *runner) {
     Float   *f64 = Float_new(1.33);
@@ -268,10 +305,11 @@ test_Clone(TestBatchRunner *runner) {
 
 void
 TestNum_Run_IMP(TestNum *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 82);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 86);
     test_To_String(runner);
     test_accessors(runner);
     test_Equals_and_Compare_To(runner);
+    test_Digest(runner);
     test_Clone(runner);
 }
 
@@ -0,0 +1,434 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include <string.h>
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestNumArray.h"
+
+#include "Clownfish/Err.h"
+#include "Clownfish/NumArray.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Util/Memory.h"
+#include "Clownfish/Class.h"
+
+// Limit the random values so that the reference results can be computed
+// without overflow.  Floating point values are multiples of 0.25, which
+// makes all sums exact regardless of the summation order.
+#define I32_LIMIT (INT64_C(1) << 25)
+#define I64_LIMIT INT64_C(10000000)
+#define F32_LIMIT INT64_C(100)
+#define F64_LIMIT INT64_C(100000)
+
+// Sizes which exercise both the vectorized loops and the scalar tails.
+static const size_t sizes[] = { 1, 3, 17, 1001 };
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+TestNumArray*
+TestNumArr_new() {
+    return (TestNumArray*)Class_Make_Obj(TESTNUMARRAY);
+}
+
+static void
+test_basics(TestBatchRunner *runner) {
+    I32Array *array = I32Arr_new(0);
+
+    for (int32_t i = 0; i < 100; i++) {
+        I32Arr_Push(array, i * 3);
+    }
+    TEST_UINT_EQ(runner, I32Arr_Get_Size(array), 100, "Push grows array");
+    TEST_INT_EQ(runner, I32Arr_Fetch(array, 42), 126, "Fetch");
+
+    I32Arr_Store(array, 104, -5);
+    TEST_UINT_EQ(runner, I32Arr_Get_Size(array), 105,
+                 "Store beyond size grows array");
+    TEST_TRUE(runner,
+              I32Arr_Fetch(array, 101) == 0 && I32Arr_Fetch(array, 104) == -5,
+              "Store beyond size fills with zeroes");
+
+    int32_t *data = I32Arr_Get_Data(array);
+    TEST_TRUE(runner, data[42] == 126 && data[104] == -5, "Get_Data");
+
+    I32Arr_Grow(array, 5000);
+    TEST_TRUE(runner, I32Arr_Get_Capacity(array) >= 5000, "Grow");
+
+    I32Array *clone = I32Arr_Clone(array);
+    TEST_TRUE(runner, I32Arr_Equals(array, (Obj*)clone), "Clone");
+    I32Arr_Store(clone, 0, 1);
+    TEST_FALSE(runner, I32Arr_Equals(array, (Obj*)clone),
+               "Arrays with different elements aren't equal");
+    DECREF(clone);
+
+    I32Arr_Resize(array, 10);
+    I32Arr_Resize(array, 20);
+    TEST_TRUE(runner,
+              I32Arr_Get_Size(array) == 20 && I32Arr_Fetch(array, 9) == 27
+              && I32Arr_Fetch(array, 10) == 0,
+              "Resize");
+
+    I32Arr_Clear(array);
+    TEST_UINT_EQ(runner, I32Arr_Get_Size(array), 0, "Clear");
+
+    DECREF(array);
+}
+
+static void
+test_reductions_i32(TestBatchRunner *runner) {
+    bool sum_ok = true;
+    bool min_ok = true;
+    bool max_ok = true;
+    bool dot_ok = true;
+
+    for (size_t s = 0; s < NUM_SIZES; s++) {
+        size_t    size    = sizes[s];
+        int64_t  *rands_a = TestUtils_random_i64s(NULL, size, -I32_LIMIT,
+                                                  I32_LIMIT);
+        int64_t  *rands_b = TestUtils_random_i64s(NULL, size, -I32_LIMIT,
+                                                  I32_LIMIT);
+        I32Array *a       = I32Arr_new(0);
+        I32Array *b       = I32Arr_new(0);
+        int64_t   sum     = 0;
+        int64_t   dot     = 0;
+        int32_t   min     = (int32_t)rands_a[0];
+        int32_t   max     = (int32_t)rands_a[0];
+
+        for (size_t i = 0; i < size; i++) {
+            int32_t value_a = (int32_t)rands_a[i];
+            int32_t value_b = (int32_t)rands_b[i];
+            I32Arr_Push(a, value_a);
+            I32Arr_Push(b, value_b);
+            sum += value_a;
+            dot += (int64_t)value_a * value_b;
+            if (value_a < min) { min = value_a; }
+            if (value_a > max) { max = value_a; }
+        }
+
+        if (I32Arr_Sum(a) != sum) { sum_ok = false; }
+        if (I32Arr_Min(a) != min) { min_ok = false; }
+        if (I32Arr_Max(a) != max) { max_ok = false; }
+        if (I32Arr_Dot(a, b) != dot) { dot_ok = false; }
+
+        DECREF(a);
+        DECREF(b);
+        FREEMEM(rands_a);
+        FREEMEM(rands_b);
+    }
+
+    TEST_TRUE(runner, sum_ok, "I32Array Sum");
+    TEST_TRUE(runner, min_ok, "I32Array Min");
+    TEST_TRUE(runner, max_ok, "I32Array Max");
+    TEST_TRUE(runner, dot_ok, "I32Array Dot");
+}
+
+static void
+test_reductions_i64(TestBatchRunner *runner) {
+    bool sum_ok = true;
+    bool min_ok = true;
+    bool max_ok = true;
+    bool dot_ok = true;
+
+    for (size_t s = 0; s < NUM_SIZES; s++) {
+        size_t    size    = sizes[s];
+        int64_t  *rands_a = TestUtils_random_i64s(NULL, size, -I64_LIMIT,
+                                                  I64_LIMIT);
+        int64_t  *rands_b = TestUtils_random_i64s(NULL, size, -I64_LIMIT,
+                                                  I64_LIMIT);
+        I64Array *a       = I64Arr_new(0);
+        I64Array *b       = I64Arr_new(0);
+        int64_t   sum     = 0;
+        int64_t   dot     = 0;
+        int64_t   min     = rands_a[0];
+        int64_t   max     = rands_a[0];
+
+        for (size_t i = 0; i < size; i++) {
+            int64_t value_a = rands_a[i];
+            int64_t value_b = rands_b[i];
+            I64Arr_Push(a, value_a);
+            I64Arr_Push(b, value_b);
+            sum += value_a;
+            dot += (int64_t)value_a * value_b;
+            if (value_a < min) { min = value_a; }
+            if (value_a > max) { max = value_a; }
+        }
+
+        if (I64Arr_Sum(a) != sum) { sum_ok = false; }
+        if (I64Arr_Min(a) != min) { min_ok = false; }
+        if (I64Arr_Max(a) != max) { max_ok = false; }
+        if (I64Arr_Dot(a, b) != dot) { dot_ok = false; }
+
+        DECREF(a);
+        DECREF(b);
+        FREEMEM(rands_a);
+        FREEMEM(rands_b);
+    }
+
+    TEST_TRUE(runner, sum_ok, "I64Array Sum");
+    TEST_TRUE(runner, min_ok, "I64Array Min");
+    TEST_TRUE(runner, max_ok, "I64Array Max");
+    TEST_TRUE(runner, dot_ok, "I64Array Dot");
+}
+
+static void
+test_reductions_f32(TestBatchRunner *runner) {
+    bool sum_ok = true;
+    bool min_ok = true;
+    bool max_ok = true;
+    bool dot_ok = true;
+
+    for (size_t s = 0; s < NUM_SIZES; s++) {
+        size_t    size    = sizes[s];
+        int64_t  *rands_a = TestUtils_random_i64s(NULL, size, -F32_LIMIT,
+                                                  F32_LIMIT);
+        int64_t  *rands_b = TestUtils_random_i64s(NULL, size, -F32_LIMIT,
+                                                  F32_LIMIT);
+        F32Array *a       = F32Arr_new(0);
+        F32Array *b       = F32Arr_new(0);
+        float     sum     = 0;
+        float     dot     = 0;
+        float     min     = 0.25f * (float)rands_a[0];
+        float     max     = 0.25f * (float)rands_a[0];
+
+        for (size_t i = 0; i < size; i++) {
+            float value_a = 0.25f * (float)rands_a[i];
+            float value_b = 0.25f * (float)rands_b[i];
+            F32Arr_Push(a, value_a);
+            F32Arr_Push(b, value_b);
+            sum += value_a;
+            dot += (float)value_a * value_b;
+            if (value_a < min) { min = value_a; }
+            if (value_a > max) { max = value_a; }
+        }
+
+        if (F32Arr_Sum(a) != sum) { sum_ok = false; }
+        if (F32Arr_Min(a) != min) { min_ok = false; }
+        if (F32Arr_Max(a) != max) { max_ok = false; }
+        if (F32Arr_Dot(a, b) != dot) { dot_ok = false; }
+
+        DECREF(a);
+        DECREF(b);
+        FREEMEM(rands_a);
+        FREEMEM(rands_b);
+    }
+
+    TEST_TRUE(runner, sum_ok, "F32Array Sum");
+    TEST_TRUE(runner, min_ok, "F32Array Min");
+    TEST_TRUE(runner, max_ok, "F32Array Max");
+    TEST_TRUE(runner, dot_ok, "F32Array Dot");
+}
+
+static void
+test_reductions_f64(TestBatchRunner *runner) {
+    bool sum_ok = true;
+    bool min_ok = true;
+    bool max_ok = true;
+    bool dot_ok = true;
+
+    for (size_t s = 0; s < NUM_SIZES; s++) {
+        size_t    size    = sizes[s];
+        int64_t  *rands_a = TestUtils_random_i64s(NULL, size, -F64_LIMIT,
+                                                  F64_LIMIT);
+        int64_t  *rands_b = TestUtils_random_i64s(NULL, size, -F64_LIMIT,
+                                                  F64_LIMIT);
+        F64Array *a       = F64Arr_new(0);
+        F64Array *b       = F64Arr_new(0);
+        double    sum     = 0;
+        double    dot     = 0;
+        double    min     = 0.25 * (double)rands_a[0];
+        double    max     = 0.25 * (double)rands_a[0];
+
+        for (size_t i = 0; i < size; i++) {
+            double value_a = 0.25 * (double)rands_a[i];
+            double value_b = 0.25 * (double)rands_b[i];
+            F64Arr_Push(a, value_a);
+            F64Arr_Push(b, value_b);
+            sum += value_a;
+            dot += (double)value_a * value_b;
+            if (value_a < min) { min = value_a; }
+            if (value_a > max) { max = value_a; }
+        }
+
+        if (F64Arr_Sum(a) != sum) { sum_ok = false; }
+        if (F64Arr_Min(a) != min) { min_ok = false; }
+        if (F64Arr_Max(a) != max) { max_ok = false; }
+        if (F64Arr_Dot(a, b) != dot) { dot_ok = false; }
+
+        DECREF(a);
+        DECREF(b);
+        FREEMEM(rands_a);
+        FREEMEM(rands_b);
+    }
+
+    TEST_TRUE(runner, sum_ok, "F64Array Sum");
+    TEST_TRUE(runner, min_ok, "F64Array Min");
+    TEST_TRUE(runner, max_ok, "F64Array Max");
+    TEST_TRUE(runner, dot_ok, "F64Array Dot");
+}
+
+static void
+S_fetch_out_of_range(void *context) {
+    I32Arr_Fetch((I32Array*)context, 3);
+}
+
+static void
+S_min_of_empty(void *context) {
+    F64Arr_Min((F64Array*)context);
+}
+
+typedef struct {
+    I32Array *a;
+    I32Array *b;
+} DotContext;
+
+static void
+S_dot_size_mismatch(void *vcontext) {
+    DotContext *context = (DotContext*)vcontext;
+    I32Arr_Dot(context->a, context->b);
+}
+
+static void
+test_exceptions(TestBatchRunner *runner) {
+    I32Array *a     = I32Arr_new(0);
+    I32Array *b     = I32Arr_new(0);
+    F64Array *empty = F64Arr_new(0);
+    I32Arr_Push(a, 1);
+    I32Arr_Push(a, 2);
+    I32Arr_Push(b, 1);
+
+    Err *error = Err_trap(S_fetch_out_of_range, a);
+    TEST_TRUE(runner, error != NULL, "Fetch out of range throws");
+    DECREF(error);
+
+    error = Err_trap(S_min_of_empty, empty);
+    TEST_TRUE(runner, error != NULL, "Min of empty array throws");
+    DECREF(error);
+
+    DotContext context;
+    context.a = a;
+    context.b = b;
+    error = Err_trap(S_dot_size_mismatch, &context);
+    TEST_TRUE(runner, error != NULL, "Dot with size mismatch throws");
+    DECREF(error);
+
+    DECREF(a);
+    DECREF(b);
+    DECREF(empty);
+}
+
+static void
+test_float_Equals(TestBatchRunner *runner) {
+    F64Array *a = F64Arr_new(1);
+    F64Array *b = F64Arr_new(1);
+
+    F64Arr_Push(a, 0.0);
+    F64Arr_Push(b, -0.0);
+    TEST_TRUE(runner, F64Arr_Equals(a, (Obj*)b), "0.0 equals -0.0");
+
+    F64Arr_Store(a, 0, NAN);
+    F64Arr_Store(b, 0, NAN);
+    TEST_FALSE(runner, F64Arr_Equals(a, (Obj*)b), "NaN doesn't equal NaN");
+
+    DECREF(a);
+    DECREF(b);
+}
+
+static bool
+S_same_digest(Obj *a, Obj *b) {
+    uint64_t digest_a[2];
+    uint64_t digest_b[2];
+    Obj_Digest(a, digest_a);
+    Obj_Digest(b, digest_b);
+    return digest_a[0] == digest_b[0] && digest_a[1] == digest_b[1];
+}
+
+static void
+test_Digest(TestBatchRunner *runner) {
+    I32Array *i32 = I32Arr_new(0);
+    I32Array *i32_twin = I32Arr_new(0);
+    I64Array *i64 = I64Arr_new(0);
+    I64Array *i64_twin = I64Arr_new(0);
+    for (int32_t i = 0; i < 100; i++) {
+        I32Arr_Push(i32, i * 3);
+        I32Arr_Push(i32_twin, i * 3);
+        I64Arr_Push(i64, i * 3);
+        I64Arr_Push(i64_twin, i * 3);
+    }
+    TEST_TRUE(runner,
+              S_same_digest((Obj*)i32, (Obj*)i32_twin)
+              && S_same_digest((Obj*)i64, (Obj*)i64_twin),
+              "Equal integer arrays have the same Digest");
+    I32Arr_Store(i32_twin, 50, -1);
+    I64Arr_Store(i64_twin, 50, -1);
+    TEST_FALSE(runner,
+               S_same_digest((Obj*)i32, (Obj*)i32_twin)
+               || S_same_digest((Obj*)i64, (Obj*)i64_twin),
+               "Different elements change Digest");
+    TEST_FALSE(runner, S_same_digest((Obj*)i32, (Obj*)i64),
+               "Digest depends on element type");
+    DECREF(i32);
+    DECREF(i32_twin);
+    DECREF(i64);
+    DECREF(i64_twin);
+
+    F32Array *f32_a = F32Arr_new(2);
+    F32Array *f32_b = F32Arr_new(2);
+    F64Array *f64_a = F64Arr_new(2);
+    F64Array *f64_b = F64Arr_new(2);
+    F32Arr_Push(f32_a, 1.5f);
+    F32Arr_Push(f32_a, 0.0f);
+    F32Arr_Push(f32_b, 1.5f);
+    F32Arr_Push(f32_b, -0.0f);
+    F64Arr_Push(f64_a, 1.5);
+    F64Arr_Push(f64_a, 0.0);
+    F64Arr_Push(f64_b, 1.5);
+    F64Arr_Push(f64_b, -0.0);
+    TEST_TRUE(runner,
+              F32Arr_Equals(f32_a, (Obj*)f32_b)
+              && S_same_digest((Obj*)f32_a, (Obj*)f32_b)
+              && F64Arr_Equals(f64_a, (Obj*)f64_b)
+              && S_same_digest((Obj*)f64_a, (Obj*)f64_b),
+              "Digest of -0.0 equals Digest of 0.0");
+    F32Arr_Store(f32_b, 0, 2.5f);
+    F64Arr_Store(f64_b, 0, 2.5);
+    TEST_FALSE(runner,
+               S_same_digest((Obj*)f32_a, (Obj*)f32_b)
+               || S_same_digest((Obj*)f64_a, (Obj*)f64_b),
+               "Different float elements change Digest");
+    DECREF(f32_a);
+    DECREF(f32_b);
+    DECREF(f64_a);
+    DECREF(f64_b);
+}
+
+void
+TestNumArr_Run_IMP(TestNumArray *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 36);
+    test_basics(runner);
+    test_reductions_i32(runner);
+    test_reductions_i64(runner);
+    test_reductions_f32(runner);
+    test_reductions_f64(runner);
+    test_exceptions(runner);
+    test_float_Equals(runner);
+    test_Digest(runner);
+}
+
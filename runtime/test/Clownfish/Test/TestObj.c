@@ -23,7 +23,12 @@
 
 #include "Clownfish/Test/TestObj.h"
 
+#include "Clownfish/Boolean.h"
 #include "Clownfish/String.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/Vector.h"
 #include "Clownfish/Err.h"
 #include "Clownfish/Test.h"
 #include "Clownfish/TestHarness/TestBatchRunner.h"
@@ -62,6 +67,119 @@ test_refcounts(TestBatchRunner *runner) {
     DECREF(obj);
 }
 
+static void
+test_refcount_arrays(TestBatchRunner *runner) {
+    Obj *obj = S_new_testobj();
+    Obj *boolean = (Obj*)CFISH_TRUE;
+    Obj *klass = (Obj*)STRING;
+    uint32_t bool_refcount  = CFISH_REFCOUNT_NN(boolean);
+    uint32_t class_refcount = CFISH_REFCOUNT_NN(klass);
+    Obj *elems[5];
+    elems[0] = obj;
+    elems[1] = NULL;
+    elems[2] = obj;
+    elems[3] = boolean;
+    elems[4] = klass;
+
+    cfish_incref_array(elems, 5);
+    TEST_INT_EQ(runner, CFISH_REFCOUNT_NN(obj), 3,
+                "incref_array skips NULL elements");
+    TEST_TRUE(runner,
+              CFISH_REFCOUNT_NN(boolean) == bool_refcount
+              && CFISH_REFCOUNT_NN(klass) == class_refcount,
+              "incref_array leaves special cases alone");
+
+    cfish_decref_array(elems, 5);
+    TEST_INT_EQ(runner, CFISH_REFCOUNT_NN(obj), 1, "decref_array");
+    TEST_TRUE(runner,
+              CFISH_REFCOUNT_NN(boolean) == bool_refcount
+              && CFISH_REFCOUNT_NN(klass) == class_refcount,
+              "decref_array leaves special cases alone");
+
+    DECREF(obj);
+}
+
+static void
+test_immortal(TestBatchRunner *runner) {
+    // Immortal objects are never destroyed, so use stack memory.
+    Obj *template_obj = S_new_testobj();
+    Class *klass = Obj_get_class(template_obj);
+    Obj *obj = Class_Init_Obj(klass, CFISH_ALLOCA_OBJ(klass));
+    DECREF(template_obj);
+
+    TEST_FALSE(runner, cfish_is_immortal(obj), "not immortal by default");
+    cfish_make_immortal(obj);
+    TEST_TRUE(runner, cfish_is_immortal(obj), "make_immortal");
+
+    uint32_t refcount = CFISH_REFCOUNT_NN(obj);
+    TEST_TRUE(runner, CFISH_INCREF_NN(obj) == obj, "INCREF of immortal");
+    CFISH_DECREF_NN(obj);
+    CFISH_DECREF_NN(obj);
+    TEST_UINT_EQ(runner, CFISH_REFCOUNT_NN(obj), refcount,
+                 "refcount of immortal is frozen");
+
+    Obj *elems[2] = { obj, obj };
+    cfish_incref_array(elems, 2);
+    cfish_decref_array(elems, 2);
+    cfish_decref_array(elems, 2);
+    TEST_UINT_EQ(runner, CFISH_REFCOUNT_NN(obj), refcount,
+                 "array refcounting skips immortals");
+
+    TEST_TRUE(runner, cfish_is_immortal(CFISH_TRUE),
+              "Booleans are immortal");
+}
+
+static void
+test_Freeze_Graph(TestBatchRunner *runner) {
+    // Frozen objects are never destroyed, so this test leaks on purpose.
+    Hash   *hash   = Hash_new(0);
+    Vector *vector = Vec_new(0);
+    String *string = Str_newf("frozen string");
+    String *substr = Str_SubString(string, 7, 6);
+    Vec_Push(vector, (Obj*)substr);
+    Vec_Push(vector, (Obj*)Int_new(42));
+    Vec_Push(vector, NULL);
+    Vec_Push(vector, INCREF(hash));
+    Hash_Store_Utf8(hash, "vector", 6, (Obj*)vector);
+
+    Hash_Freeze_Graph(hash);
+    TEST_TRUE(runner, cfish_is_immortal(hash) && cfish_is_immortal(vector),
+              "Freeze_Graph freezes containers");
+    TEST_TRUE(runner,
+              cfish_is_immortal(Vec_Fetch(vector, 0))
+              && cfish_is_immortal(Vec_Fetch(vector, 1)),
+              "Freeze_Graph freezes elements");
+    TEST_TRUE(runner, cfish_is_immortal(string),
+              "Freeze_Graph freezes origin of substrings");
+
+    HashIterator *iter = HashIter_new(hash);
+    HashIter_Next(iter);
+    TEST_TRUE(runner, cfish_is_immortal(HashIter_Get_Key(iter)),
+              "Freeze_Graph freezes hash keys");
+    DECREF(iter);
+
+    Hash_Freeze_Graph(hash);
+    DECREF(string);
+    DECREF(hash);
+    TEST_TRUE(runner, Vec_Fetch(vector, 3) == (Obj*)hash,
+              "frozen graph survives DECREF");
+
+    // Containers made immortal by hand may hold mortal members.
+    Vector *immortal = Vec_new(0);
+    Hash   *inner    = Hash_new(0);
+    String *value    = Str_newf("mortal value");
+    Hash_Store_Utf8(inner, "value", 5, (Obj*)value);
+    Hash_Store_Utf8(inner, "cycle", 5, INCREF(immortal));
+    Vec_Push(immortal, (Obj*)inner);
+    cfish_make_immortal(immortal);
+    Vector *outer = Vec_new(0);
+    Vec_Push(outer, (Obj*)immortal);
+
+    Vec_Freeze_Graph(outer);
+    TEST_TRUE(runner, cfish_is_immortal(inner) && cfish_is_immortal(value),
+              "Freeze_Graph walks members of immortal containers");
+}
+
 static void
 test_To_String(TestBatchRunner *runner) {
     Obj *testobj = S_new_testobj();
@@ -187,8 +305,11 @@ test_abstract_routines(TestBatchRunner *runner) {
 
 void
 TestObj_Run_IMP(TestObj *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 20);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 36);
     test_refcounts(runner);
+    test_refcount_arrays(runner);
+    test_immortal(runner);
+    test_Freeze_Graph(runner);
     test_To_String(runner);
     test_Equals(runner);
     test_is_a(runner);
@@ -0,0 +1,178 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestSegmentedVector.h"
+
+#include "Clownfish/Num.h"
+#include "Clownfish/SegmentedVector.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Class.h"
+
+TestSegmentedVector*
+TestSegVec_new() {
+    return (TestSegmentedVector*)Class_Make_Obj(TESTSEGMENTEDVECTOR);
+}
+
+static void
+test_Push_Fetch(TestBatchRunner *runner) {
+    SegmentedVector *array = SegVec_new(0);
+    size_t           num   = 5000;
+
+    for (size_t i = 0; i < num; i++) {
+        SegVec_Push(array, (Obj*)Int_new((int64_t)i));
+    }
+    TEST_UINT_EQ(runner, SegVec_Get_Size(array), num, "Get_Size");
+    TEST_TRUE(runner, SegVec_Get_Capacity(array) >= num, "Get_Capacity");
+
+    bool ok = true;
+    for (size_t i = 0; i < num; i++) {
+        Integer *integer = (Integer*)SegVec_Fetch(array, i);
+        if (Int_Get_Value(integer) != (int64_t)i) { ok = false; }
+    }
+    TEST_TRUE(runner, ok, "Fetch across segments");
+    TEST_TRUE(runner, SegVec_Fetch(array, num) == NULL,
+              "Fetch out of bounds returns NULL");
+
+    Integer *integer = (Integer*)SegVec_Pop(array);
+    TEST_INT_EQ(runner, Int_Get_Value(integer), (int64_t)num - 1, "Pop");
+    DECREF(integer);
+
+    DECREF(array);
+}
+
+static void
+test_stable_addresses(TestBatchRunner *runner) {
+    SegmentedVector *array = SegVec_new(0);
+
+    SegVec_Push(array, (Obj*)Str_newf("first"));
+    Obj **addr = SegVec_Fetch_Addr(array, 0);
+    for (int64_t i = 0; i < 10000; i++) {
+        SegVec_Push(array, (Obj*)Int_new(i));
+    }
+    TEST_TRUE(runner, SegVec_Fetch_Addr(array, 0) == addr,
+              "Element addresses are stable when growing");
+    TEST_TRUE(runner, Str_Equals_Utf8((String*)*addr, "first", 5),
+              "Element still accessible through old address");
+    TEST_TRUE(runner, SegVec_Fetch_Addr(array, 10001) == NULL,
+              "Fetch_Addr out of bounds returns NULL");
+
+    DECREF(array);
+}
+
+static void
+test_Store_Delete_Resize(TestBatchRunner *runner) {
+    SegmentedVector *array = SegVec_new(0);
+
+    SegVec_Store(array, 2000, (Obj*)Str_newf("foo"));
+    TEST_UINT_EQ(runner, SegVec_Get_Size(array), 2001,
+                 "Store beyond size grows array");
+    TEST_TRUE(runner, SegVec_Fetch(array, 1999) == NULL,
+              "Store beyond size fills with NULL");
+
+    SegVec_Store(array, 2000, (Obj*)Str_newf("bar"));
+    TEST_TRUE(runner,
+              Str_Equals_Utf8((String*)SegVec_Fetch(array, 2000), "bar", 3),
+              "Store replaces element");
+
+    String *string = (String*)SegVec_Delete(array, 2000);
+    TEST_TRUE(runner,
+              Str_Equals_Utf8(string, "bar", 3)
+              && SegVec_Fetch(array, 2000) == NULL,
+              "Delete");
+    DECREF(string);
+
+    SegVec_Resize(array, 10);
+    TEST_UINT_EQ(runner, SegVec_Get_Size(array), 10, "Resize shrinks");
+    SegVec_Resize(array, 3000);
+    TEST_TRUE(runner,
+              SegVec_Get_Size(array) == 3000
+              && SegVec_Fetch(array, 2999) == NULL,
+              "Resize grows with NULLs");
+
+    SegVec_Clear(array);
+    TEST_UINT_EQ(runner, SegVec_Get_Size(array), 0, "Clear");
+
+    DECREF(array);
+}
+
+static bool
+S_same_digest(Obj *a, Obj *b) {
+    uint64_t digest_a[2];
+    uint64_t digest_b[2];
+    Obj_Digest(a, digest_a);
+    Obj_Digest(b, digest_b);
+    return digest_a[0] == digest_b[0] && digest_a[1] == digest_b[1];
+}
+
+static void
+test_Slice_Equals_Clone(TestBatchRunner *runner) {
+    SegmentedVector *array = SegVec_new(0);
+    Vector          *vec   = Vec_new(0);
+
+    for (int64_t i = 0; i < 3000; i++) {
+        Vec_Push(vec, i % 7 ? (Obj*)Int_new(i) : NULL);
+    }
+    SegVec_Push_All(array, vec);
+    TEST_TRUE(runner, SegVec_Equals(array, (Obj*)vec),
+              "Push_All and Equals Vector");
+    TEST_TRUE(runner, Vec_Equals(vec, (Obj*)array),
+              "Vector Equals SegmentedVector");
+    TEST_TRUE(runner, S_same_digest((Obj*)array, (Obj*)vec),
+              "SegmentedVector has the same Digest as equal Vector");
+
+    SegmentedVector *twin = SegVec_Clone(array);
+    TEST_TRUE(runner, SegVec_Equals(array, (Obj*)twin), "Clone");
+    SegVec_Store(twin, 1500, (Obj*)Str_newf("changed"));
+    TEST_FALSE(runner, SegVec_Equals(array, (Obj*)twin),
+               "Different elements aren't equal");
+    TEST_FALSE(runner, S_same_digest((Obj*)array, (Obj*)twin),
+               "Different elements change Digest");
+    TEST_FALSE(runner, Vec_Equals(vec, (Obj*)twin),
+               "Vector doesn't equal SegmentedVector with other elements");
+    DECREF(twin);
+
+    Vector *slice  = SegVec_Slice(array, 1000, 1100);
+    Vector *wanted = Vec_Slice(vec, 1000, 1100);
+    TEST_TRUE(runner, Vec_Equals(slice, (Obj*)wanted),
+              "Slice across segments");
+    DECREF(slice);
+    DECREF(wanted);
+
+    slice = SegVec_Slice(array, 2900, 1000);
+    TEST_UINT_EQ(runner, Vec_Get_Size(slice), 100,
+                 "Slice past the end is truncated");
+    DECREF(slice);
+
+    DECREF(vec);
+    DECREF(array);
+}
+
+void
+TestSegVec_Run_IMP(TestSegmentedVector *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 24);
+    test_Push_Fetch(runner);
+    test_stable_addresses(runner);
+    test_Store_Delete_Resize(runner);
+    test_Slice_Equals_Clone(runner);
+}
+
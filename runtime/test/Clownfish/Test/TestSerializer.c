@@ -0,0 +1,389 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "charmony.h"
+
+#ifdef CHY_HAS_UNISTD_H
+  #include <unistd.h>
+#endif
+
+#include "Clownfish/Test/TestSerializer.h"
+
+#include "Clownfish/Blob.h"
+#include "Clownfish/Boolean.h"
+#include "Clownfish/ByteBuf.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/InStream.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/OutStream.h"
+#include "Clownfish/Serializer.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Class.h"
+
+TestSerializer*
+TestSerializer_new() {
+    return (TestSerializer*)Class_Make_Obj(TESTSERIALIZER);
+}
+
+static ByteBuf*
+S_serialize(Obj *obj) {
+    ByteBuf   *bb        = BB_new(0);
+    OutStream *outstream = OutStream_new_bytebuf(bb);
+    Obj_Serialize(obj, outstream);
+    OutStream_Close(outstream);
+    DECREF(outstream);
+    return bb;
+}
+
+static Obj*
+S_deserialize(ByteBuf *bb) {
+    InStream *instream = InStream_new_bytebuf(bb);
+    Obj      *obj      = Obj_deserialize(instream);
+    DECREF(instream);
+    return obj;
+}
+
+static Obj*
+S_round_trip(Obj *obj) {
+    ByteBuf *bb   = S_serialize(obj);
+    Obj     *copy = S_deserialize(bb);
+    DECREF(bb);
+    return copy;
+}
+
+static Hash*
+S_make_record(int64_t id, const char *name) {
+    Hash *record = Hash_new(0);
+    Hash_Store_Utf8(record, "id", 2, (Obj*)Int_new(id));
+    Hash_Store_Utf8(record, "name", 4, (Obj*)Str_newf("%s", name));
+    Hash_Store_Utf8(record, "active", 6, (Obj*)INCREF(CFISH_TRUE));
+    return record;
+}
+
+static void
+test_round_trip(TestBatchRunner *runner) {
+    Vector *vector = Vec_new(0);
+    Vec_Push(vector, (Obj*)Int_new(0));
+    Vec_Push(vector, (Obj*)Int_new(-1));
+    Vec_Push(vector, (Obj*)Int_new(INT64_MAX));
+    Vec_Push(vector, (Obj*)Int_new(INT64_MIN));
+    Vec_Push(vector, (Obj*)Float_new(-1.25));
+    Vec_Push(vector, (Obj*)INCREF(CFISH_FALSE));
+    Vec_Push(vector, NULL);
+    Vec_Push(vector, (Obj*)Str_newf("caf\xC3\xA9 \xE2\x98\x83"));
+    Vec_Push(vector, (Obj*)Str_newf(""));
+    Vec_Push(vector, (Obj*)Blob_new("\0\1\2\3", 4));
+    Vec_Push(vector, (Obj*)Vec_new(0));
+    Vec_Push(vector, (Obj*)S_make_record(42, "Ada"));
+
+    Hash *root = Hash_new(0);
+    Hash_Store_Utf8(root, "values", 6, (Obj*)vector);
+    Hash_Store_Utf8(root, "empty", 5, (Obj*)Hash_new(0));
+
+    Obj *copy = S_round_trip((Obj*)root);
+    TEST_TRUE(runner, Hash_Equals(root, copy), "round trip of object graph");
+    TEST_TRUE(runner, Obj_is_a(copy, HASH), "root class survives");
+    DECREF(copy);
+    DECREF(root);
+
+    ByteBuf    *bb         = BB_new(0);
+    OutStream  *outstream  = OutStream_new_bytebuf(bb);
+    Serializer *serializer = Serializer_new(outstream);
+    Serializer_Write(serializer, NULL);
+    OutStream_Close(outstream);
+    copy = S_deserialize(bb);
+    TEST_TRUE(runner, copy == NULL, "round trip of NULL");
+    DECREF(serializer);
+    DECREF(outstream);
+    DECREF(bb);
+
+    Integer *integer = Int_new(-3);
+    bb = S_serialize((Obj*)integer);
+    TEST_TRUE(runner, BB_Equals_Bytes(bb, "\x03\x05", 2),
+              "small negative Integer uses zigzag varint");
+    copy = S_deserialize(bb);
+    TEST_TRUE(runner, Int_Equals(integer, copy), "Integer round trip");
+    DECREF(copy);
+    DECREF(bb);
+    DECREF(integer);
+}
+
+static void
+test_interned_keys(TestBatchRunner *runner) {
+    Vector *records = Vec_new(0);
+    Vec_Push(records, (Obj*)S_make_record(1, "a"));
+    Vec_Push(records, (Obj*)S_make_record(2, "b"));
+
+    ByteBuf *bb = S_serialize((Obj*)records);
+    // Tag and size of the Vector and of each Hash, the keys written in
+    // full once and as a single byte afterwards, and the values.
+    size_t expected = 2 + 2 * 2 + (4 + 6 + 8) + 3 + 2 * (2 + 3 + 1);
+    TEST_UINT_EQ(runner, BB_Get_Size(bb), expected,
+                 "repeated keys are written only once");
+
+    Vector *copy = (Vector*)S_deserialize(bb);
+    TEST_TRUE(runner, Vec_Equals(records, (Obj*)copy), "records round trip");
+
+    Vector       *first_keys = Hash_Keys((Hash*)Vec_Fetch(copy, 0));
+    HashIterator *iter       = HashIter_new((Hash*)Vec_Fetch(copy, 1));
+    size_t        num_shared = 0;
+    while (HashIter_Next(iter)) {
+        Obj *key = (Obj*)HashIter_Get_Key(iter);
+        for (size_t i = 0; i < Vec_Get_Size(first_keys); i++) {
+            if (Vec_Fetch(first_keys, i) == key) { num_shared++; }
+        }
+    }
+    TEST_UINT_EQ(runner, num_shared, 3,
+                 "interned keys are shared between Hashes");
+    DECREF(iter);
+    DECREF(first_keys);
+
+    DECREF(copy);
+    DECREF(bb);
+    DECREF(records);
+}
+
+static void
+test_shared_refs(TestBatchRunner *runner) {
+    String *string = Str_newf("shared");
+    Vector *inner  = Vec_new(0);
+    Vector *outer  = Vec_new(0);
+    Vec_Push(outer, INCREF(string));
+    Vec_Push(outer, INCREF(string));
+    Vec_Push(outer, INCREF(inner));
+    Vec_Push(outer, INCREF(inner));
+
+    Vector *copy = (Vector*)S_round_trip((Obj*)outer);
+    TEST_TRUE(runner, Vec_Equals(outer, (Obj*)copy),
+              "graph with shared objects round trips");
+    TEST_TRUE(runner, Vec_Fetch(copy, 0) == Vec_Fetch(copy, 1),
+              "shared String is restored as one object");
+    TEST_TRUE(runner, Vec_Fetch(copy, 2) == Vec_Fetch(copy, 3),
+              "shared Vector is restored as one object");
+    DECREF(copy);
+
+    // Cycle.
+    Vec_Push(inner, INCREF(outer));
+    copy = (Vector*)S_round_trip((Obj*)outer);
+    Vector *copy_inner = (Vector*)Vec_Fetch(copy, 2);
+    TEST_TRUE(runner, Vec_Fetch(copy_inner, 0) == (Obj*)copy,
+              "cyclic reference is restored");
+    Vec_Clear(copy_inner);
+    Vec_Clear(inner);
+    DECREF(copy);
+
+    DECREF(outer);
+    DECREF(inner);
+    DECREF(string);
+}
+
+static void
+test_streaming(TestBatchRunner *runner) {
+    ByteBuf    *bb         = BB_new(0);
+    OutStream  *outstream  = OutStream_new_bytebuf(bb);
+    Serializer *serializer = Serializer_new(outstream);
+    String     *string     = Str_newf("repeated");
+    Hash       *record     = S_make_record(7, "x");
+    Serializer_Write(serializer, (Obj*)record);
+    Serializer_Write(serializer, (Obj*)string);
+    Serializer_Write(serializer, (Obj*)string);
+    DECREF(record);
+    record = S_make_record(8, "y");
+    Serializer_Write(serializer, (Obj*)record);
+    DECREF(serializer);
+    OutStream_Close(outstream);
+    DECREF(outstream);
+
+    InStream     *instream     = InStream_new_bytebuf(bb);
+    Deserializer *deserializer = Deserializer_new(instream);
+    Obj *first  = Deserializer_Read(deserializer);
+    Obj *second = Deserializer_Read(deserializer);
+    Obj *third  = Deserializer_Read(deserializer);
+    Obj *fourth = Deserializer_Read(deserializer);
+    TEST_TRUE(runner, Str_Equals(string, second),
+              "stream of values round trips");
+    TEST_TRUE(runner, second == third,
+              "shared object across values in stream");
+    TEST_TRUE(runner, Hash_Equals(record, fourth),
+              "keys interned across values in stream");
+    TEST_INT_EQ(runner, InStream_Tell(instream), InStream_Length(instream),
+                "stream fully consumed");
+    DECREF(first);
+    DECREF(second);
+    DECREF(third);
+    DECREF(fourth);
+    DECREF(deserializer);
+    DECREF(instream);
+    DECREF(record);
+    DECREF(string);
+    DECREF(bb);
+}
+
+static void
+S_attempt_serialize(void *context) {
+    DECREF(S_serialize((Obj*)context));
+}
+
+static void
+S_attempt_deserialize(void *context) {
+    DECREF(S_deserialize((ByteBuf*)context));
+}
+
+static void
+test_errors(TestBatchRunner *runner) {
+    static const struct {
+        const char *bytes;
+        size_t      size;
+        const char *name;
+    } bad_inputs[] = {
+        { "\x0A",                 1, "unknown tag" },
+        { "\x05\x03" "ab",        4, "truncated String" },
+        { "\x05\x02\xC3\x28",     4, "invalid UTF-8" },
+        { "\x07\x02\x00",         3, "truncated Vector" },
+        { "\x07\x01\x09\x01",     4, "invalid object reference" },
+        { "\x08\x01\x02\x00",     4, "invalid key reference" },
+        { "\x07\xFF\xFF\xFF\xFF\x0F", 6, "oversized count" },
+    };
+    size_t num_bad = sizeof(bad_inputs) / sizeof(bad_inputs[0]);
+
+    for (size_t i = 0; i < num_bad; i++) {
+        ByteBuf *bb = BB_new_bytes(bad_inputs[i].bytes, bad_inputs[i].size);
+        Err *error = Err_trap(S_attempt_deserialize, bb);
+        TEST_TRUE(runner, error != NULL, "deserialize throws on %s",
+                  bad_inputs[i].name);
+        DECREF(error);
+        DECREF(bb);
+    }
+
+    ByteBuf *unsupported = BB_new(0);
+    Err *error = Err_trap(S_attempt_serialize, unsupported);
+    TEST_TRUE(runner, error != NULL, "serialize throws on unsupported class");
+    DECREF(error);
+    DECREF(unsupported);
+
+    Vector *deep = Vec_new(0);
+    Vector *leaf = deep;
+    for (int i = 0; i < SER_MAX_DEPTH; i++) {
+        Vector *child = Vec_new(1);
+        Vec_Push(leaf, (Obj*)child);
+        leaf = child;
+    }
+    error = Err_trap(S_attempt_serialize, deep);
+    TEST_TRUE(runner, error != NULL, "serialize throws on deep nesting");
+    DECREF(error);
+    DECREF(deep);
+
+    ByteBuf *nested = BB_new(0);
+    for (int i = 0; i <= SER_MAX_DEPTH; i++) {
+        BB_Cat_Bytes(nested, "\x07\x01", 2);
+    }
+    BB_Cat_Bytes(nested, "\x00", 1);
+    error = Err_trap(S_attempt_deserialize, nested);
+    TEST_TRUE(runner, error != NULL, "deserialize throws on deep nesting");
+    DECREF(error);
+    DECREF(nested);
+}
+
+#ifdef CHY_HAS_UNISTD_H
+
+// Return a stream of unknown length which reads `size` bytes from a pipe.
+static InStream*
+S_pipe_stream(const char *bytes, size_t size) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        THROW(ERR, "pipe failed");
+    }
+    if (write(fds[1], bytes, size) != (ssize_t)size) {
+        THROW(ERR, "write to pipe failed");
+    }
+    close(fds[1]);
+    return InStream_new_fd(fds[0], true);
+}
+
+static void
+S_attempt_deserialize_stream(void *context) {
+    DECREF(Obj_deserialize((InStream*)context));
+}
+
+static void
+test_unknown_length(TestBatchRunner *runner) {
+    Vector *vector = Vec_new(0);
+    for (int i = 0; i < SER_MAX_PREALLOC * 2; i++) {
+        Vec_Push(vector, (Obj*)Str_newf("%i32", (int32_t)i));
+    }
+    ByteBuf  *bb       = S_serialize((Obj*)vector);
+    InStream *instream = S_pipe_stream(BB_Get_Buf(bb), BB_Get_Size(bb));
+    TEST_TRUE(runner, InStream_Length(instream) < 0, "pipe has no length");
+    Obj *copy = Obj_deserialize(instream);
+    TEST_TRUE(runner, Vec_Equals(vector, copy),
+              "Vector larger than preallocation limit from pipe");
+    DECREF(copy);
+    DECREF(instream);
+    DECREF(bb);
+    DECREF(vector);
+
+    // Counts and lengths of 2^40 followed by a single entry or a few bytes.
+    static const struct {
+        const char *bytes;
+        size_t      size;
+        const char *name;
+    } huge_inputs[] = {
+        { "\x07\x80\x80\x80\x80\x80\x20\x00",         8, "Vector" },
+        { "\x08\x80\x80\x80\x80\x80\x20\x00\x01" "a\x00", 11, "Hash" },
+        { "\x05\x80\x80\x80\x80\x80\x20" "abc",        10, "String" },
+        { "\x06\x80\x80\x80\x80\x80\x20" "abc",        10, "Blob" },
+    };
+    for (size_t i = 0; i < 4; i++) {
+        instream = S_pipe_stream(huge_inputs[i].bytes, huge_inputs[i].size);
+        Err *error = Err_trap(S_attempt_deserialize_stream, instream);
+        TEST_TRUE(runner, error != NULL,
+                  "huge %s size from pipe throws at end of stream",
+                  huge_inputs[i].name);
+        DECREF(error);
+        DECREF(instream);
+    }
+}
+
+#else
+
+static void
+test_unknown_length(TestBatchRunner *runner) {
+    SKIP(runner, 6, "pipes not available");
+}
+
+#endif
+
+void
+TestSerializer_Run_IMP(TestSerializer *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 32);
+    test_round_trip(runner);
+    test_interned_keys(runner);
+    test_shared_refs(runner);
+    test_streaming(runner);
+    test_errors(runner);
+    test_unknown_length(runner);
+}
+
@@ -0,0 +1,338 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestStreams.h"
+
+#include "Clownfish/Blob.h"
+#include "Clownfish/ByteBuf.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/InStream.h"
+#include "Clownfish/OutStream.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Util/Memory.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define STREAM_FILE_NAME "_test_streams.bin"
+#define BIG_SIZE         200000
+#define NUM_VARINTS      50000
+
+TestStreams*
+TestStreams_new() {
+    return (TestStreams*)Class_Make_Obj(TESTSTREAMS);
+}
+
+static InStream*
+S_reader_for(ByteBuf *bb) {
+    Blob *blob = BB_Yield_Blob(bb);
+    InStream *instream = InStream_new_blob(blob);
+    DECREF(blob);
+    return instream;
+}
+
+static void
+test_fixed_width(TestBatchRunner *runner) {
+    static const char expected[] = {
+        1, 2, 2, 1,
+        1, 2, 3, 4, 4, 3, 2, 1,
+        1, 2, 3, 4, 5, 6, 7, 8, 8, 7, 6, 5, 4, 3, 2, 1
+    };
+
+    ByteBuf   *bb        = BB_new(0);
+    OutStream *outstream = OutStream_new_bytebuf(bb);
+    OutStream_Write_U16(outstream, 0x0102);
+    OutStream_Write_U16_LE(outstream, 0x0102);
+    OutStream_Write_U32(outstream, 0x01020304);
+    OutStream_Write_U32_LE(outstream, 0x01020304);
+    OutStream_Write_U64(outstream, UINT64_C(0x0102030405060708));
+    OutStream_Write_U64_LE(outstream, UINT64_C(0x0102030405060708));
+    TEST_UINT_EQ(runner, BB_Get_Size(bb), 0, "OutStream buffers output");
+    TEST_INT_EQ(runner, OutStream_Tell(outstream), sizeof(expected),
+                "Tell includes buffered bytes");
+    OutStream_Flush(outstream);
+    TEST_TRUE(runner, BB_Equals_Bytes(bb, expected, sizeof(expected)),
+              "big- and little-endian byte layout");
+
+    OutStream_Write_U8(outstream, 250);
+    OutStream_Write_I32(outstream, -12345);
+    OutStream_Write_I64(outstream, INT64_C(-1234567890123));
+    OutStream_Write_F32(outstream, 1.5f);
+    OutStream_Write_F64(outstream, -0.25);
+    OutStream_Close(outstream);
+    DECREF(outstream);
+
+    InStream *instream = S_reader_for(bb);
+    TEST_INT_EQ(runner, InStream_Length(instream),
+                sizeof(expected) + 1 + 4 + 8 + 4 + 8, "Length");
+    TEST_UINT_EQ(runner, InStream_Read_U16(instream), 0x0102, "Read_U16");
+    TEST_UINT_EQ(runner, InStream_Read_U16_LE(instream), 0x0102,
+                 "Read_U16_LE");
+    TEST_UINT_EQ(runner, InStream_Read_U32(instream), 0x01020304,
+                 "Read_U32");
+    TEST_UINT_EQ(runner, InStream_Read_U32_LE(instream), 0x01020304,
+                 "Read_U32_LE");
+    TEST_TRUE(runner, InStream_Read_U64(instream)
+                      == UINT64_C(0x0102030405060708), "Read_U64");
+    TEST_TRUE(runner, InStream_Read_U64_LE(instream)
+                      == UINT64_C(0x0102030405060708), "Read_U64_LE");
+    TEST_UINT_EQ(runner, InStream_Read_U8(instream), 250, "Read_U8");
+    TEST_INT_EQ(runner, InStream_Read_I32(instream), -12345, "Read_I32");
+    TEST_INT_EQ(runner, InStream_Read_I64(instream), INT64_C(-1234567890123),
+                "Read_I64");
+    TEST_TRUE(runner, InStream_Read_F32(instream) == 1.5f, "Read_F32");
+    TEST_TRUE(runner, InStream_Read_F64(instream) == -0.25, "Read_F64");
+    TEST_INT_EQ(runner, InStream_Tell(instream), InStream_Length(instream),
+                "Tell at end of stream");
+    DECREF(instream);
+    DECREF(bb);
+}
+
+static void
+test_varints(TestBatchRunner *runner) {
+    static const uint32_t c32_values[] = {
+        0, 1, 127, 128, 16383, 16384, 0x0FFFFFFF, 0x10000000, UINT32_MAX
+    };
+    static const uint64_t c64_values[] = {
+        0, 127, 128, UINT32_MAX, UINT64_C(0x7FFFFFFFFFFFFFFF),
+        UINT64_C(0x8000000000000000), UINT64_MAX
+    };
+    size_t num_c32 = sizeof(c32_values) / sizeof(c32_values[0]);
+    size_t num_c64 = sizeof(c64_values) / sizeof(c64_values[0]);
+
+    {
+        ByteBuf   *bb        = BB_new(0);
+        OutStream *outstream = OutStream_new_bytebuf(bb);
+        OutStream_Write_C32(outstream, UINT32_MAX);
+        OutStream_Write_C64(outstream, 300);
+        OutStream_Close(outstream);
+        TEST_TRUE(runner, BB_Equals_Bytes(bb, "\xFF\xFF\xFF\xFF\x0F\xAC\x02",
+                                          7),
+                  "varints use LEB128");
+        DECREF(outstream);
+        DECREF(bb);
+    }
+
+    // Each value is read once with plenty of bytes buffered and once at
+    // the end of the stream, where the slow path decodes it.
+    ByteBuf   *bb        = BB_new(0);
+    OutStream *outstream = OutStream_new_bytebuf(bb);
+    for (size_t i = 0; i < num_c32; i++) {
+        OutStream_Write_C32(outstream, c32_values[i]);
+    }
+    for (size_t i = 0; i < num_c64; i++) {
+        OutStream_Write_C64(outstream, c64_values[i]);
+    }
+    for (size_t i = 0; i < num_c32; i++) {
+        OutStream_Write_C32(outstream, c32_values[i]);
+    }
+    OutStream_Close(outstream);
+    DECREF(outstream);
+
+    InStream *instream = S_reader_for(bb);
+    size_t    failures = 0;
+    for (size_t i = 0; i < num_c32; i++) {
+        if (InStream_Read_C32(instream) != c32_values[i]) { failures++; }
+    }
+    for (size_t i = 0; i < num_c64; i++) {
+        if (InStream_Read_C64(instream) != c64_values[i]) { failures++; }
+    }
+    TEST_UINT_EQ(runner, failures, 0, "C32 and C64 round trip");
+
+    failures = 0;
+    for (size_t i = 0; i < num_c32; i++) {
+        if (InStream_Read_C32(instream) != c32_values[i]) { failures++; }
+    }
+    TEST_UINT_EQ(runner, failures, 0, "C32 round trip near end of stream");
+    DECREF(instream);
+    DECREF(bb);
+
+    bb = BB_new_bytes("\xFF\xFF\xFF\xFF\x0F\x0A", 6);
+    instream = S_reader_for(bb);
+    TEST_UINT_EQ(runner, InStream_Read_C32(instream), UINT32_MAX,
+                 "C32 slow path");
+    DECREF(instream);
+    DECREF(bb);
+}
+
+static void
+S_read_c32(void *context) {
+    InStream_Read_C32((InStream*)context);
+}
+
+static void
+S_read_c64(void *context) {
+    InStream_Read_C64((InStream*)context);
+}
+
+static void
+S_read_u32(void *context) {
+    InStream_Read_U32((InStream*)context);
+}
+
+static void
+S_write_u8(void *context) {
+    OutStream_Write_U8((OutStream*)context, 0);
+}
+
+static void
+test_errors(TestBatchRunner *runner) {
+    static const char too_long[] =
+        "\xFF\xFF\xFF\xFF\x1F\x00\x00\x00\x00\x00\x00";
+    static const char too_long_64[] =
+        "\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x02\x00";
+
+    ByteBuf  *bb       = BB_new_bytes(too_long, sizeof(too_long) - 1);
+    InStream *instream = S_reader_for(bb);
+    Err      *error    = Err_trap(S_read_c32, instream);
+    TEST_TRUE(runner, error != NULL, "Read_C32 rejects overlong varint");
+    DECREF(error);
+    DECREF(instream);
+    DECREF(bb);
+
+    bb       = BB_new_bytes(too_long_64, sizeof(too_long_64) - 1);
+    instream = S_reader_for(bb);
+    error    = Err_trap(S_read_c64, instream);
+    TEST_TRUE(runner, error != NULL, "Read_C64 rejects overlong varint");
+    DECREF(error);
+    DECREF(instream);
+    DECREF(bb);
+
+    bb       = BB_new_bytes("\x80\x80", 2);
+    instream = S_reader_for(bb);
+    error    = Err_trap(S_read_c32, instream);
+    TEST_TRUE(runner, error != NULL, "Read_C32 throws on truncated varint");
+    DECREF(error);
+    DECREF(instream);
+    DECREF(bb);
+
+    bb       = BB_new_bytes("abc", 3);
+    instream = S_reader_for(bb);
+    error    = Err_trap(S_read_u32, instream);
+    TEST_TRUE(runner, error != NULL, "Read past end of stream throws");
+    DECREF(error);
+    DECREF(instream);
+    DECREF(bb);
+
+    bb = BB_new(0);
+    OutStream *outstream = OutStream_new_bytebuf(bb);
+    OutStream_Close(outstream);
+    error = Err_trap(S_write_u8, outstream);
+    TEST_TRUE(runner, error != NULL, "Write to closed OutStream throws");
+    DECREF(error);
+    DECREF(outstream);
+    DECREF(bb);
+}
+
+static void
+test_Read_Blob(TestBatchRunner *runner) {
+    Blob     *blob     = Blob_new("0123456789", 10);
+    InStream *instream = InStream_new_blob(blob);
+    InStream_Seek(instream, 3);
+    Blob *slice = InStream_Read_Blob(instream, 4);
+    TEST_TRUE(runner, Blob_Equals_Bytes(slice, "3456", 4), "Read_Blob");
+    TEST_TRUE(runner, Blob_Get_Buf(slice) == Blob_Get_Buf(blob) + 3,
+              "Read_Blob shares memory of in-memory streams");
+    TEST_INT_EQ(runner, InStream_Tell(instream), 7, "Tell after Read_Blob");
+    DECREF(slice);
+    DECREF(instream);
+    DECREF(blob);
+}
+
+static void
+test_file(TestBatchRunner *runner) {
+    char *big = (char*)MALLOCATE(BIG_SIZE);
+    for (size_t i = 0; i < BIG_SIZE; i++) {
+        big[i] = (char)(i * 7 % 251);
+    }
+
+    FILE *probe = fopen(STREAM_FILE_NAME, "wb");
+    if (!probe || fclose(probe) != 0) {
+        SKIP(runner, 8, "Can't write test file");
+        FREEMEM(big);
+        return;
+    }
+
+    String *path = SSTR_WRAP_C(STREAM_FILE_NAME);
+    OutStream *outstream = OutStream_open(path);
+    OutStream_Write_U32(outstream, 0xDEADBEEF);
+    // Larger than the buffer, so written together with the buffered data.
+    OutStream_Write_Bytes(outstream, big, BIG_SIZE);
+    for (uint64_t i = 0; i < NUM_VARINTS; i++) {
+        OutStream_Write_C64(outstream, i * i * i);
+    }
+    int64_t varints_end = OutStream_Tell(outstream);
+    OutStream_Write_Bytes(outstream, big, 10);
+    OutStream_Close(outstream);
+    DECREF(outstream);
+
+    InStream *instream = InStream_open(path);
+    TEST_INT_EQ(runner, InStream_Length(instream), varints_end + 10,
+                "Length of file stream");
+    TEST_UINT_EQ(runner, InStream_Read_U32(instream), 0xDEADBEEF,
+                 "Read_U32 from file");
+
+    char *copy = (char*)MALLOCATE(BIG_SIZE);
+    InStream_Read_Bytes(instream, copy, BIG_SIZE);
+    TEST_TRUE(runner, memcmp(copy, big, BIG_SIZE) == 0,
+              "large Read_Bytes from file");
+
+    // Varints straddle buffer refills.
+    size_t failures = 0;
+    for (uint64_t i = 0; i < NUM_VARINTS; i++) {
+        if (InStream_Read_C64(instream) != i * i * i) { failures++; }
+    }
+    TEST_UINT_EQ(runner, failures, 0, "C64 round trip through file");
+    TEST_INT_EQ(runner, InStream_Tell(instream), varints_end,
+                "Tell after reading file");
+
+    Blob *blob = InStream_Read_Blob(instream, 10);
+    TEST_TRUE(runner, Blob_Equals_Bytes(blob, big, 10),
+              "Read_Blob from file");
+    DECREF(blob);
+
+    InStream_Seek(instream, 4 + 100000);
+    InStream_Read_Bytes(instream, copy, 1000);
+    TEST_TRUE(runner, memcmp(copy, big + 100000, 1000) == 0,
+              "Seek backwards in file");
+    InStream_Seek(instream, 0);
+    TEST_UINT_EQ(runner, InStream_Read_U32(instream), 0xDEADBEEF,
+                 "Seek to start of file");
+
+    DECREF(instream);
+    FREEMEM(copy);
+    FREEMEM(big);
+    remove(STREAM_FILE_NAME);
+}
+
+void
+TestStreams_Run_IMP(TestStreams *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 36);
+    test_fixed_width(runner);
+    test_varints(runner);
+    test_errors(runner);
+    test_Read_Blob(runner);
+    test_file(runner);
+}
+
@@ -797,6 +797,45 @@ test_Get_Ptr8(TestBatchRunner *runner) {
     DECREF(string);
 }
 
+DECLARE_STR_CONST(BANANA_CONST, "Banana");
+
+static void
+test_immortal(TestBatchRunner *runner) {
+    String *string = STR_CONST(BANANA_CONST);
+    TEST_TRUE(runner, Str_is_immortal(string), "STR_CONST is immortal");
+    TEST_TRUE(runner, Str_Equals_Utf8(string, "Banana", 6),
+              "STR_CONST content");
+    TEST_TRUE(runner, STR_CONST(BANANA_CONST) == string,
+              "STR_CONST is cached");
+    TEST_TRUE(runner, Str_Get_Ptr8(string) == BANANA_CONST.utf8,
+              "STR_CONST wraps literal");
+
+    String *incremented = (String*)INCREF(string);
+    TEST_TRUE(runner, incremented == string,
+              "INCREF of immortal returns same object");
+    DECREF(incremented);
+    DECREF(string);
+    TEST_TRUE(runner, Str_Equals_Utf8(string, "Banana", 6),
+              "DECREF of immortal is a no-op");
+
+    String *sub = Str_SubString(string, 1, 3);
+    TEST_TRUE(runner, Str_Equals_Utf8(sub, "ana", 3), "SubString of immortal");
+    TEST_TRUE(runner, Str_Get_Ptr8(sub) == BANANA_CONST.utf8 + 1,
+              "SubString of immortal shares buffer");
+    DECREF(sub);
+
+    String *cat = Str_Cat_Trusted_Utf8(string, "s", 1);
+    TEST_FALSE(runner, Str_is_immortal(cat), "Cat of immortal is mortal");
+    DECREF(cat);
+
+    String *class_name = Class_Get_Name(STRING);
+    TEST_TRUE(runner, Str_is_immortal(class_name), "Class name is immortal");
+    String *mortal = S_get_str("Banana");
+    TEST_FALSE(runner, Str_is_immortal(mortal),
+               "Regular String is not immortal");
+    DECREF(mortal);
+}
+
 static void
 test_iterator(TestBatchRunner *runner) {
     static const int32_t code_points[] = {
@@ -933,6 +972,75 @@ test_iterator(TestBatchRunner *runner) {
     DECREF(buf);
 }
 
+static void
+test_iterator_batch(TestBatchRunner *runner) {
+    // Mix ASCII runs longer than a machine word with multi-byte sequences.
+    static const int32_t code_points[] = {
+        'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k',
+        0x263A,
+        'l', 'm', 'n', 'o', 'p', 'q', 'r', 's',
+        0x80, 0x7FF, 0x800, 0xFFFF, 0x10000, 0x10FFFF,
+        't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1'
+    };
+    static size_t num_code_points
+        = sizeof(code_points) / sizeof(code_points[0]);
+
+    CharBuf *buf = CB_new(0);
+    for (size_t i = 0; i < num_code_points; ++i) {
+        CB_Cat_Char(buf, code_points[i]);
+    }
+    String *string = CB_Yield_String(buf);
+    int32_t decoded[64];
+
+    {
+        StringIterator *iter = Str_Top(string);
+        size_t num = StrIter_Next_Batch(iter, decoded, 64);
+        TEST_UINT_EQ(runner, num, num_code_points,
+                     "Next_Batch decodes whole string");
+        TEST_TRUE(runner,
+                  memcmp(decoded, code_points, sizeof(code_points)) == 0,
+                  "Next_Batch decodes correct code points");
+        TEST_FALSE(runner, StrIter_Has_Next(iter),
+                   "Next_Batch advances to end of string");
+        TEST_UINT_EQ(runner, StrIter_Next_Batch(iter, decoded, 64), 0,
+                     "Next_Batch at end of string");
+        DECREF(iter);
+    }
+
+    {
+        StringIterator *iter = Str_Top(string);
+        bool   equal = true;
+        size_t total = 0;
+        size_t num;
+        while (0 != (num = StrIter_Next_Batch(iter, decoded, 5))) {
+            for (size_t i = 0; i < num; i++) {
+                if (decoded[i] != code_points[total + i]) { equal = false; }
+            }
+            total += num;
+        }
+        TEST_UINT_EQ(runner, total, num_code_points,
+                     "Next_Batch in small chunks decodes whole string");
+        TEST_TRUE(runner, equal,
+                  "Next_Batch in small chunks decodes correct code points");
+        DECREF(iter);
+    }
+
+    {
+        StringIterator *iter = Str_Top(string);
+        TEST_UINT_EQ(runner, StrIter_Advance(iter, 9), 9,
+                     "Advance within ASCII run");
+        TEST_INT_EQ(runner, StrIter_Next(iter), code_points[9],
+                    "Advance within ASCII run lands on right code point");
+        DECREF(iter);
+    }
+
+    TEST_UINT_EQ(runner, Str_Length(string), num_code_points,
+                 "Length of mixed string");
+
+    DECREF(string);
+    DECREF(buf);
+}
+
 static void
 test_iterator_whitespace(TestBatchRunner *runner) {
     size_t num_spaces;
@@ -1100,7 +1208,7 @@ test_iterator_substring(TestBatchRunner *runner) {
 
 void
 TestStr_Run_IMP(TestString *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 200);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 220);
     test_all_code_points(runner);
     test_utf8_valid(runner);
     test_validate_utf8(runner);
@@ -1124,7 +1232,9 @@ TestStr_Run_IMP(TestString *self, TestBatchRunner *runner) {
     test_Starts_Ends_With(runner);
     test_Starts_Ends_With_Utf8(runner);
     test_Get_Ptr8(runner);
+    test_immortal(runner);
     test_iterator(runner);
+    test_iterator_batch(runner);
     test_iterator_whitespace(runner);
     test_iterator_substring(runner);
 }
@@ -16,6 +16,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 #define C_CFISH_VECTOR
 #define CFISH_USE_SHORT_NAMES
@@ -27,11 +28,15 @@
 
 #include "Clownfish/String.h"
 #include "Clownfish/Boolean.h"
+#include "Clownfish/CharBuf.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
 #include "Clownfish/Num.h"
 #include "Clownfish/Test.h"
 #include "Clownfish/TestHarness/TestBatchRunner.h"
 #include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Util/Memory.h"
+#include "Clownfish/Util/SortUtils.h"
 #include "Clownfish/Vector.h"
 #include "Clownfish/Class.h"
 
@@ -108,6 +113,51 @@ test_Equals(TestBatchRunner *runner) {
     DECREF(other);
 }
 
+static bool
+S_same_digest(Obj *a, Obj *b) {
+    uint64_t digest_a[2];
+    uint64_t digest_b[2];
+    Obj_Digest(a, digest_a);
+    Obj_Digest(b, digest_b);
+    return digest_a[0] == digest_b[0] && digest_a[1] == digest_b[1];
+}
+
+static Hash*
+S_new_hash() {
+    Hash *hash = Hash_new(0);
+    Hash_Store_Utf8(hash, "foo", 3, (Obj*)Str_newf("bar"));
+    return hash;
+}
+
+static void
+test_Digest(TestBatchRunner *runner) {
+    Vector *array = Vec_new(0);
+    Vector *other = Vec_new(0);
+
+    Vec_Push(array, (Obj*)Str_newf("a"));
+    Vec_Push(array, (Obj*)Int_new(1));
+    Vec_Push(array, (Obj*)S_new_hash());
+    Vec_Push(other, (Obj*)Str_newf("a"));
+    Vec_Push(other, (Obj*)Float_new(1.0));
+    Vec_Push(other, (Obj*)S_new_hash());
+    TEST_TRUE(runner, S_same_digest((Obj*)array, (Obj*)other),
+              "Equal Vectors have the same Digest");
+
+    Vec_Store(other, 2, (Obj*)Str_newf("a"));
+    Vec_Store(other, 0, (Obj*)S_new_hash());
+    TEST_FALSE(runner, S_same_digest((Obj*)array, (Obj*)other),
+               "Digest depends on order of elements");
+
+    Vec_Clear(array);
+    Vec_Clear(other);
+    Vec_Push(other, NULL);
+    TEST_FALSE(runner, S_same_digest((Obj*)array, (Obj*)other),
+               "NULL elements change Digest");
+
+    DECREF(array);
+    DECREF(other);
+}
+
 static void
 test_Store_Fetch(TestBatchRunner *runner) {
     Vector *array = Vec_new(0);
@@ -527,6 +577,504 @@ test_Sort(TestBatchRunner *runner) {
     DECREF(wanted);
 }
 
+// Check that two Vectors contain the identical objects in the same order.
+static bool
+S_same_elems(Vector *a, Vector *b) {
+    if (Vec_Get_Size(a) != Vec_Get_Size(b)) { return false; }
+    for (size_t i = 0; i < Vec_Get_Size(a); i++) {
+        if (Vec_Fetch(a, i) != Vec_Fetch(b, i)) { return false; }
+    }
+    return true;
+}
+
+static int
+S_compare_objs(Obj *a, Obj *b) {
+    if (a != NULL && b != NULL)      { return Obj_Compare_To(a, b); }
+    else if (a == NULL && b == NULL) { return 0;  }
+    else if (a == NULL)              { return 1;  }
+    else                             { return -1; }
+}
+
+// Sort a copy of the Vector and compare the result against a stable
+// insertion sort using Obj_Compare_To.
+static bool
+S_sorts_like_generic(Vector *array) {
+    size_t   size   = Vec_Get_Size(array);
+    Vector  *sorted = Vec_Clone(array);
+    Obj    **wanted = (Obj**)MALLOCATE(size * sizeof(Obj*));
+    bool     equal  = true;
+
+    for (size_t i = 0; i < size; i++) {
+        Obj *elem = Vec_Fetch(array, i);
+        size_t j = i;
+        while (j > 0 && S_compare_objs(wanted[j-1], elem) > 0) {
+            wanted[j] = wanted[j-1];
+            j--;
+        }
+        wanted[j] = elem;
+    }
+
+    Vec_Sort(sorted);
+    for (size_t i = 0; i < size; i++) {
+        if (Vec_Fetch(sorted, i) != wanted[i]) { equal = false; }
+    }
+
+    FREEMEM(wanted);
+    DECREF(sorted);
+    return equal;
+}
+
+static void
+test_Sort_specialized(TestBatchRunner *runner) {
+    static const char *const words[] = {
+        "", "a", "a", "ab", "abcdefgh", "abcdefgh", "abcdefghi",
+        "abcdefghij", "abcdefgi", "b", "\xC3\xA9t\xC3\xA9", "zz"
+    };
+    size_t num_words = sizeof(words) / sizeof(words[0]);
+    static const double floats[] = {
+        -1.5, -0.0, 0.0, 0.5, 1e300, -1e300, 3.25, 3.25, -7.0, 1e-300
+    };
+    size_t num_floats = sizeof(floats) / sizeof(floats[0]);
+
+    for (size_t size = 20; size <= 1000; size += 980) {
+        Vector *ints   = Vec_new(size);
+        Vector *flts   = Vec_new(size);
+        Vector *strs   = Vec_new(size);
+        Vector *mixed  = Vec_new(size);
+        int64_t *rands = TestUtils_random_i64s(NULL, size, -50, 50);
+
+        for (size_t i = 0; i < size; i++) {
+            int64_t r = rands[i];
+            uint64_t u = (uint64_t)(r + 50);
+            int64_t value = r == 0 ? INT64_MIN : r == 1 ? INT64_MAX
+                            : r * INT64_C(1000000007);
+            Vec_Push(ints, (Obj*)Int_new(value));
+            double f = u % 3 == 0
+                       ? floats[u % num_floats]
+                       : (double)r / 4.0;
+            Vec_Push(flts, (Obj*)Float_new(f));
+            if (u % 17 == 0) {
+                Vec_Push(strs, NULL);
+            }
+            else {
+                String *word = Str_newf("%s%s", words[u % num_words],
+                                        words[(u / 7) % num_words]);
+                Vec_Push(strs, (Obj*)word);
+            }
+            Vec_Push(mixed, u % 2 ? (Obj*)Int_new(r) : (Obj*)Float_new(f));
+        }
+
+        TEST_TRUE(runner, S_sorts_like_generic(ints),
+                  "Sort Integers (%u elements)", (unsigned)size);
+        TEST_TRUE(runner, S_sorts_like_generic(flts),
+                  "Sort Floats (%u elements)", (unsigned)size);
+        TEST_TRUE(runner, S_sorts_like_generic(strs),
+                  "Sort Strings with NULLs (%u elements)", (unsigned)size);
+        TEST_TRUE(runner, S_sorts_like_generic(mixed),
+                  "Sort mixed Integers and Floats (%u elements)",
+                  (unsigned)size);
+
+        FREEMEM(rands);
+        DECREF(ints);
+        DECREF(flts);
+        DECREF(strs);
+        DECREF(mixed);
+    }
+}
+
+static void
+test_Sort_Top_K_and_Select(TestBatchRunner *runner) {
+    size_t   size  = 500;
+    Vector  *array = Vec_new(size);
+    int64_t *rands = TestUtils_random_i64s(NULL, size, -20, 20);
+    for (size_t i = 0; i < size; i++) {
+        Obj *elem = rands[i] > 15 ? NULL
+                    : rands[i] % 2 ? (Obj*)Int_new(rands[i])
+                    : (Obj*)Float_new((double)rands[i]);
+        Vec_Push(array, elem);
+    }
+    Vector *wanted = Vec_Clone(array);
+    Vec_Sort(wanted);
+
+    bool top_k_ok = true;
+    bool select_ok = true;
+    size_t ks[] = { 0, 1, 10, 100, size - 1, size };
+    for (size_t i = 0; i < sizeof(ks) / sizeof(ks[0]); i++) {
+        size_t k = ks[i];
+        Vector *got = Vec_Clone(array);
+        Vec_Sort_Top_K(got, k);
+        for (size_t j = 0; j < k; j++) {
+            if (Vec_Fetch(got, j) != Vec_Fetch(wanted, j)) {
+                top_k_ok = false;
+            }
+        }
+        DECREF(got);
+
+        if (k >= size) { continue; }
+        got = Vec_Clone(array);
+        Obj *selected = Vec_Select(got, k);
+        if (selected != Vec_Fetch(wanted, k)
+            || Vec_Fetch(got, k) != selected
+           ) {
+            select_ok = false;
+        }
+        DECREF(got);
+    }
+    TEST_TRUE(runner, top_k_ok, "Sort_Top_K");
+    TEST_TRUE(runner, select_ok, "Select");
+    TEST_TRUE(runner, Vec_Select(array, size) == NULL,
+              "Select out of range returns NULL");
+
+    FREEMEM(rands);
+    DECREF(wanted);
+    DECREF(array);
+}
+
+static void
+S_sort_parallel_or_throw(void *context) {
+    Vec_Sort_Parallel((Vector*)context);
+}
+
+static void
+test_Sort_Parallel(TestBatchRunner *runner) {
+    size_t   size   = 40000;
+    Vector  *ints   = Vec_new(size);
+    Vector  *mixed  = Vec_new(size);
+    int64_t *rands  = TestUtils_random_i64s(NULL, size, -1000, 1000);
+
+    for (size_t i = 0; i < size; i++) {
+        Vec_Push(ints, (Obj*)Int_new(rands[i]));
+        Vec_Push(mixed, i % 3 == 0 ? NULL
+                        : i % 3 == 1 ? (Obj*)Int_new(rands[i])
+                        : (Obj*)Float_new((double)rands[i] / 3.0));
+    }
+
+    uint32_t max_threads = Sort_get_max_threads();
+    Sort_set_max_threads(4);
+
+    Vector *wanted = Vec_Clone(ints);
+    Vector *got    = Vec_Clone(ints);
+    Vec_Sort(wanted);
+    Vec_Sort_Parallel(got);
+    TEST_TRUE(runner, S_same_elems(got, wanted),
+              "Sort_Parallel Integers");
+    DECREF(wanted);
+    DECREF(got);
+
+    wanted = Vec_Clone(mixed);
+    got    = Vec_Clone(mixed);
+    Vec_Sort(wanted);
+    Vec_Sort_Parallel(got);
+    TEST_TRUE(runner, S_same_elems(got, wanted),
+              "Sort_Parallel mixed Integers, Floats and NULLs");
+    DECREF(wanted);
+    DECREF(got);
+
+    // Comparing Integers to Strings throws, which must happen on the
+    // calling thread.
+    Vec_Store(mixed, size / 2, (Obj*)Str_newf("string"));
+    got = Vec_Clone(mixed);
+    Err *error = Err_trap(S_sort_parallel_or_throw, got);
+    TEST_TRUE(runner, error != NULL && S_same_elems(got, mixed),
+              "Sort_Parallel rethrows from Compare_To");
+    DECREF(error);
+    DECREF(got);
+
+    Sort_set_max_threads(max_threads);
+    FREEMEM(rands);
+    DECREF(ints);
+    DECREF(mixed);
+}
+
+static int
+S_compare_reverse(void *context, Obj *a, Obj *b) {
+    UNUSED_VAR(context);
+    return Obj_Compare_To(b, a);
+}
+
+static int
+S_compare_first_char(void *context, Obj *a, Obj *b) {
+    UNUSED_VAR(context);
+    return (int)Str_Code_Point_At((String*)a, 0)
+           - (int)Str_Code_Point_At((String*)b, 0);
+}
+
+static void
+test_Sort_With(TestBatchRunner *runner) {
+    Vector *array  = Vec_new(8);
+    Vector *wanted = Vec_new(8);
+
+    Vec_Push(array, NULL);
+    Vec_Push(array, (Obj*)Str_newf("ab"));
+    Vec_Push(array, (Obj*)Str_newf("b"));
+    Vec_Push(array, NULL);
+    Vec_Push(array, (Obj*)Str_newf("aab"));
+    Vec_Push(wanted, (Obj*)Str_newf("b"));
+    Vec_Push(wanted, (Obj*)Str_newf("ab"));
+    Vec_Push(wanted, (Obj*)Str_newf("aab"));
+    Vec_Push(wanted, NULL);
+    Vec_Push(wanted, NULL);
+    Vec_Sort_With(array, S_compare_reverse, NULL);
+    TEST_TRUE(runner, Vec_Equals(array, (Obj*)wanted),
+              "Sort_With custom compare and NULLs");
+    DECREF(array);
+    DECREF(wanted);
+
+    array  = Vec_new(8);
+    wanted = Vec_new(8);
+    Vec_Push(array, (Obj*)Str_newf("b1"));
+    Vec_Push(array, (Obj*)Str_newf("a1"));
+    Vec_Push(array, (Obj*)Str_newf("b2"));
+    Vec_Push(array, (Obj*)Str_newf("a2"));
+    Vec_Push(wanted, (Obj*)Str_newf("a1"));
+    Vec_Push(wanted, (Obj*)Str_newf("a2"));
+    Vec_Push(wanted, (Obj*)Str_newf("b1"));
+    Vec_Push(wanted, (Obj*)Str_newf("b2"));
+    Vec_Sort_With(array, S_compare_first_char, NULL);
+    TEST_TRUE(runner, Vec_Equals(array, (Obj*)wanted), "Sort_With is stable");
+    DECREF(array);
+    DECREF(wanted);
+}
+
+static int
+S_compare_or_throw(void *context, Obj *a, Obj *b) {
+    size_t *budget = (size_t*)context;
+    if ((*budget)-- == 0) {
+        THROW(ERR, "Comparison budget exhausted");
+    }
+    return Obj_Compare_To(a, b);
+}
+
+typedef struct {
+    Vector *array;
+    size_t  budget;
+} ThrowingSort;
+
+static void
+S_sort_with_or_throw(void *context) {
+    ThrowingSort *sort = (ThrowingSort*)context;
+    Vec_Sort_With(sort->array, S_compare_or_throw, &sort->budget);
+}
+
+static void
+S_sort_or_throw(void *context) {
+    Vec_Sort((Vector*)context);
+}
+
+static void
+test_Sort_throwing_compare(TestBatchRunner *runner) {
+    // Large enough for several runs, so that merges get interrupted.
+    Vector *original = Vec_new(300);
+    for (int64_t i = 0; i < 300; i++) {
+        Vec_Push(original, (Obj*)Int_new((i * 7919) % 300));
+    }
+
+    // Count the comparisons of a full sort.
+    Vector       *array = Vec_Clone(original);
+    ThrowingSort  sort;
+    sort.array  = array;
+    sort.budget = SIZE_MAX;
+    Vec_Sort_With(array, S_compare_or_throw, &sort.budget);
+    size_t num_compares = SIZE_MAX - sort.budget;
+    DECREF(array);
+
+    bool all_thrown = true;
+    bool all_intact = true;
+    for (size_t budget = 0; budget < num_compares; budget++) {
+        array       = Vec_Clone(original);
+        sort.array  = array;
+        sort.budget = budget;
+        Err *error = Err_trap(S_sort_with_or_throw, &sort);
+        if (error == NULL) { all_thrown = false; }
+        if (!S_same_elems(array, original)) { all_intact = false; }
+        DECREF(error);
+        DECREF(array);
+    }
+    TEST_TRUE(runner, num_compares > 300 && all_thrown && all_intact,
+              "Vector is left unchanged when Sort_With compare throws");
+
+    // Comparing Integers to Strings throws.
+    array = Vec_Clone(original);
+    Vec_Store(array, 200, (Obj*)Str_newf("string"));
+    Vector *mixed = Vec_Clone(array);
+    Err    *error = Err_trap(S_sort_or_throw, array);
+    TEST_TRUE(runner, error != NULL && S_same_elems(array, mixed),
+              "Vector is left unchanged when Sort can't compare elements");
+    DECREF(error);
+    DECREF(mixed);
+    DECREF(array);
+    DECREF(original);
+}
+
+typedef struct {
+    String *field;
+    int     key_type;
+    size_t  num_calls;
+} FieldContext;
+
+static bool
+S_extract_field(void *vcontext, Obj *elem, VecSortKey *key) {
+    FieldContext *context = (FieldContext*)vcontext;
+    context->num_calls++;
+
+    Obj *value = Hash_Fetch((Hash*)elem, context->field);
+    if (value == NULL) { return false; }
+    if (context->key_type == VEC_KEY_INT64) {
+        key->i64 = Int_Get_Value((Integer*)value);
+    }
+    else if (context->key_type == VEC_KEY_DOUBLE) {
+        key->f64 = Obj_is_a(value, INTEGER)
+                   ? (double)Int_Get_Value((Integer*)value)
+                   : Float_Get_Value((Float*)value);
+    }
+    else {
+        key->str.ptr  = Str_Get_Ptr8((String*)value);
+        key->str.size = Str_Get_Size((String*)value);
+    }
+    return true;
+}
+
+// Compare Hashes by a field like Sort_By_Key: missing fields sort after
+// present fields, NULL elements after everything else.
+static int
+S_compare_by_field(String *field, Obj *a, Obj *b) {
+    if (a == NULL || b == NULL) { return (a == NULL) - (b == NULL); }
+    return S_compare_objs(Hash_Fetch((Hash*)a, field),
+                          Hash_Fetch((Hash*)b, field));
+}
+
+static bool
+S_sorts_by_field(Vector *array, const char *field_name, int key_type) {
+    size_t   size     = Vec_Get_Size(array);
+    Vector  *sorted   = Vec_Clone(array);
+    Obj    **wanted   = (Obj**)MALLOCATE(size * sizeof(Obj*));
+    String  *field    = Str_newf("%s", field_name);
+    size_t   num_objs = 0;
+    bool     equal    = true;
+
+    for (size_t i = 0; i < size; i++) {
+        Obj *elem = Vec_Fetch(array, i);
+        size_t j = i;
+        while (j > 0 && S_compare_by_field(field, wanted[j-1], elem) > 0) {
+            wanted[j] = wanted[j-1];
+            j--;
+        }
+        wanted[j] = elem;
+        if (elem) { num_objs++; }
+    }
+
+    FieldContext context;
+    context.field     = field;
+    context.key_type  = key_type;
+    context.num_calls = 0;
+    Vec_Sort_By_Key(sorted, key_type, S_extract_field, &context);
+    for (size_t i = 0; i < size; i++) {
+        if (Vec_Fetch(sorted, i) != wanted[i]) { equal = false; }
+    }
+    if (context.num_calls != num_objs) { equal = false; }
+
+    DECREF(field);
+    FREEMEM(wanted);
+    DECREF(sorted);
+    return equal;
+}
+
+static void
+test_Sort_By_Key(TestBatchRunner *runner) {
+    size_t   size  = 300;
+    Vector  *array = Vec_new(size);
+    int64_t *rands = TestUtils_random_i64s(NULL, size, -100, 100);
+
+    for (size_t i = 0; i < size; i++) {
+        int64_t r = rands[i];
+        if (i % 50 == 7) {
+            Vec_Push(array, NULL);
+            continue;
+        }
+        Hash *hash = Hash_new(0);
+        Hash_Store_Utf8(hash, "int", 3, (Obj*)Int_new(r / 3));
+        Hash_Store_Utf8(hash, "float", 5, (Obj*)Float_new((double)r / 8.0));
+        if (i % 13 != 0) {
+            String *name = Str_newf("name%i64 of %u64", r / 5, (uint64_t)i);
+            Hash_Store_Utf8(hash, "str", 3, (Obj*)name);
+        }
+        Hash_Store_Utf8(hash, "mixed", 5,
+                        i % 2 ? (Obj*)Int_new(r) : (Obj*)Float_new(r / 2.0));
+        Vec_Push(array, (Obj*)hash);
+    }
+
+    TEST_TRUE(runner, S_sorts_by_field(array, "int", VEC_KEY_INT64),
+              "Sort_By_Key with int64 keys");
+    TEST_TRUE(runner, S_sorts_by_field(array, "float", VEC_KEY_DOUBLE),
+              "Sort_By_Key with double keys");
+    TEST_TRUE(runner, S_sorts_by_field(array, "str", VEC_KEY_STRING),
+              "Sort_By_Key with string keys and missing keys");
+    TEST_TRUE(runner, S_sorts_by_field(array, "mixed", VEC_KEY_DOUBLE),
+              "Sort_By_Key with double keys from Integers and Floats");
+    TEST_TRUE(runner, S_sorts_by_field(array, "missing", VEC_KEY_INT64),
+              "Sort_By_Key with only missing keys");
+
+    FREEMEM(rands);
+    DECREF(array);
+}
+
+static bool
+S_extract_float(void *context, Obj *elem, VecSortKey *key) {
+    UNUSED_VAR(context);
+    key->f64 = Float_Get_Value((Float*)elem);
+    return true;
+}
+
+static bool
+S_extract_or_throw(void *context, Obj *elem, VecSortKey *key) {
+    size_t *budget = (size_t*)context;
+    if ((*budget)-- == 0) {
+        THROW(ERR, "Key extraction failed");
+    }
+    key->i64 = Int_Get_Value((Integer*)elem);
+    return true;
+}
+
+static void
+S_sort_by_key_or_throw(void *context) {
+    Vector *array  = (Vector*)context;
+    size_t  budget = 50;
+    Vec_Sort_By_Key(array, VEC_KEY_INT64, S_extract_or_throw, &budget);
+}
+
+static void
+test_Sort_By_Key_edge_cases(TestBatchRunner *runner) {
+    Vector *array = Vec_new(4);
+    Vec_Push(array, (Obj*)Float_new(NAN));
+    Vec_Push(array, (Obj*)Float_new(1.0));
+    Vec_Push(array, (Obj*)Float_new(-INFINITY));
+    Vec_Push(array, (Obj*)Float_new(-0.0));
+    Vec_Sort_By_Key(array, VEC_KEY_DOUBLE, S_extract_float, NULL);
+    TEST_TRUE(runner,
+              Float_Get_Value((Float*)Vec_Fetch(array, 0)) == -INFINITY
+              && Float_Get_Value((Float*)Vec_Fetch(array, 1)) == 0.0
+              && Float_Get_Value((Float*)Vec_Fetch(array, 2)) == 1.0
+              && isnan(Float_Get_Value((Float*)Vec_Fetch(array, 3))),
+              "Sort_By_Key sorts NaN keys last");
+    DECREF(array);
+
+    array = Vec_new(100);
+    for (int64_t i = 100; i > 0; i--) {
+        Vec_Push(array, (Obj*)Int_new(i));
+    }
+    Err *error = Err_trap(S_sort_by_key_or_throw, array);
+    TEST_TRUE(runner, error != NULL, "Sort_By_Key rethrows from extract");
+    bool intact = Vec_Get_Size(array) == 100;
+    for (size_t i = 0; i < 100 && intact; i++) {
+        Integer *elem = (Integer*)Vec_Fetch(array, i);
+        if (Int_Get_Value(elem) != (int64_t)(100 - i)) { intact = false; }
+    }
+    TEST_TRUE(runner, intact,
+              "Vector is left unchanged when extract throws");
+    DECREF(error);
+    DECREF(array);
+}
+
 static void
 test_Grow(TestBatchRunner *runner) {
     Vector *array = Vec_new(500);
@@ -551,10 +1099,55 @@ test_Grow(TestBatchRunner *runner) {
     DECREF(array);
 }
 
+static void
+test_To_String(TestBatchRunner *runner) {
+    Vector *inner = Vec_new(2);
+    Vec_Push(inner, (Obj*)Float_new(2.5));
+    Vec_Push(inner, (Obj*)CFISH_TRUE);
+    Vector *array = Vec_new(4);
+    Vec_Push(array, (Obj*)Int_new(1));
+    Vec_Push(array, (Obj*)Str_newf("two"));
+    Vec_Store(array, 3, (Obj*)inner);
+
+    String *string = Vec_To_String(array);
+    TEST_TRUE(runner,
+              Str_Equals_Utf8(string, "[1, two, [NULL], [2.5, true]]", 29),
+              "To_String formats nested elements");
+    DECREF(string);
+
+    CharBuf *buf = CB_new(0);
+    CB_Cat_Trusted_Utf8(buf, "x", 1);
+    Obj_Cat_To((Obj*)inner, buf);
+    CB_catf(buf, " %o", array);
+    string = CB_Yield_String(buf);
+    TEST_TRUE(runner,
+              Str_Equals_Utf8(string, "x[2.5, true] [1, two, [NULL], "
+                              "[2.5, true]]", 42),
+              "Cat_To and %%o append in place");
+    DECREF(string);
+    DECREF(buf);
+    DECREF(array);
+
+    // Shared elements which don't form a cycle are formatted in full.
+    Vector *shared = Vec_new(1);
+    Vec_Push(shared, (Obj*)Int_new(7));
+    Vector *cyclic = Vec_new(3);
+    Vec_Push(cyclic, INCREF(shared));
+    Vec_Push(cyclic, (Obj*)shared);
+    Vec_Push(cyclic, INCREF(cyclic));
+    string = Str_newf("%o", cyclic);
+    TEST_TRUE(runner, Str_Equals_Utf8(string, "[[7], [7], [...]]", 17),
+              "To_String of Vector containing itself");
+    DECREF(string);
+    Vec_Clear(cyclic);
+    DECREF(cyclic);
+}
+
 void
 TestVector_Run_IMP(TestVector *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 62);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 94);
     test_Equals(runner);
+    test_Digest(runner);
     test_Store_Fetch(runner);
     test_Push_Pop_Insert(runner);
     test_Insert_All(runner);
@@ -566,7 +1159,15 @@ TestVector_Run_IMP(TestVector *self, TestBatchRunner *runner) {
     test_Clone(runner);
     test_exceptions(runner);
     test_Sort(runner);
+    test_Sort_specialized(runner);
+    test_Sort_Parallel(runner);
+    test_Sort_Top_K_and_Select(runner);
+    test_Sort_With(runner);
+    test_Sort_throwing_compare(runner);
+    test_Sort_By_Key(runner);
+    test_Sort_By_Key_edge_cases(runner);
     test_Grow(runner);
+    test_To_String(runner);
 }
 
 
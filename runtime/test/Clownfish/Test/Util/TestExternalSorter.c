@@ -0,0 +1,282 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include <string.h>
+
+#include "charmony.h"
+
+#ifdef CHY_HAS_UNISTD_H
+  #include <unistd.h>
+#endif
+
+#include "Clownfish/Test/Util/TestExternalSorter.h"
+
+#include "Clownfish/Blob.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Util/ExternalSorter.h"
+#include "Clownfish/Util/Memory.h"
+#include "Clownfish/Class.h"
+
+// Records consist of a 4-byte key followed by a 4-byte index, both
+// big-endian.  The keys are drawn from a small range to create duplicates.
+#define RECORD_SIZE 8
+#define KEY_RANGE   1000
+
+TestExternalSorter*
+TestExtSorter_new() {
+    return (TestExternalSorter*)Class_Make_Obj(TESTEXTERNALSORTER);
+}
+
+static void
+S_encode_u32(char *buf, uint32_t value) {
+    buf[0] = (char)(value >> 24);
+    buf[1] = (char)(value >> 16);
+    buf[2] = (char)(value >> 8);
+    buf[3] = (char)value;
+}
+
+static uint32_t
+S_decode_u32(const char *buf) {
+    const uint8_t *bytes = (const uint8_t*)buf;
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16)
+           | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+static int
+S_compare_keys(void *context, const char *a, size_t a_size,
+               const char *b, size_t b_size) {
+    UNUSED_VAR(context);
+    UNUSED_VAR(a_size);
+    UNUSED_VAR(b_size);
+    return memcmp(a, b, 4);
+}
+
+static void
+S_add_records(ExternalSorter *sorter, uint32_t num_records) {
+    uint64_t *randoms = TestUtils_random_u64s(NULL, num_records, 0,
+                                              KEY_RANGE);
+    char record[RECORD_SIZE];
+    for (uint32_t i = 0; i < num_records; i++) {
+        S_encode_u32(record, (uint32_t)randoms[i]);
+        S_encode_u32(record + 4, i);
+        ExtSorter_Add_Bytes(sorter, record, RECORD_SIZE);
+    }
+    FREEMEM(randoms);
+}
+
+// Verify that the records are sorted by key, that records with equal keys
+// are returned in insertion order, and that every record is returned once.
+static bool
+S_check_sorted(ExternalSorter *sorter, uint32_t num_records) {
+    bool     *seen       = (bool*)CALLOCATE(num_records, sizeof(bool));
+    bool      success    = true;
+    uint32_t  count      = 0;
+    uint32_t  last_key   = 0;
+    uint32_t  last_index = 0;
+    const char *bytes;
+    size_t size;
+
+    while (NULL != (bytes = ExtSorter_Next_Bytes(sorter, &size))) {
+        if (size != RECORD_SIZE) { success = false; break; }
+        uint32_t key   = S_decode_u32(bytes);
+        uint32_t index = S_decode_u32(bytes + 4);
+        if (index >= num_records || seen[index]) { success = false; break; }
+        if (count > 0
+            && (key < last_key
+                || (key == last_key && index < last_index))
+           ) {
+            success = false;
+            break;
+        }
+        seen[index] = true;
+        last_key    = key;
+        last_index  = index;
+        count++;
+    }
+
+    FREEMEM(seen);
+    return success && count == num_records;
+}
+
+static void
+test_in_memory(TestBatchRunner *runner) {
+    ExternalSorter *sorter = ExtSorter_new(1024 * 1024, NULL);
+    ExtSorter_Set_Compare(sorter, S_compare_keys, NULL);
+    S_add_records(sorter, 1000);
+    ExtSorter_Finish(sorter);
+    TEST_UINT_EQ(runner, ExtSorter_Get_Num_Runs(sorter), 0,
+                 "no runs spilled within memory budget");
+    TEST_TRUE(runner, S_check_sorted(sorter, 1000), "sort in memory");
+    DECREF(sorter);
+}
+
+static void
+test_spilled(TestBatchRunner *runner, String *temp_dir, const char *label) {
+    ExternalSorter *sorter = ExtSorter_new(4096, temp_dir);
+    ExtSorter_Set_Compare(sorter, S_compare_keys, NULL);
+    S_add_records(sorter, 10000);
+    ExtSorter_Finish(sorter);
+    TEST_TRUE(runner, ExtSorter_Get_Num_Runs(sorter) > 1,
+              "runs spilled (%s)", label);
+    TEST_TRUE(runner, S_check_sorted(sorter, 10000),
+              "stable sort with spilled runs (%s)", label);
+    DECREF(sorter);
+}
+
+static void
+test_multi_pass(TestBatchRunner *runner) {
+    // A tiny budget creates hundreds of runs which need more than a single
+    // merge pass.
+    ExternalSorter *sorter = ExtSorter_new(256, NULL);
+    ExtSorter_Set_Compare(sorter, S_compare_keys, NULL);
+    S_add_records(sorter, 5000);
+    ExtSorter_Finish(sorter);
+    TEST_TRUE(runner, S_check_sorted(sorter, 5000),
+              "stable sort with multiple merge passes");
+    DECREF(sorter);
+}
+
+// Compare keys, but throw once the budget of comparisons is spent.
+static int
+S_compare_keys_or_throw(void *context, const char *a, size_t a_size,
+                        const char *b, size_t b_size) {
+    int *budget = (int*)context;
+    if ((*budget)-- <= 0) {
+        THROW(ERR, "Comparison budget exhausted");
+    }
+    return S_compare_keys(NULL, a, a_size, b, b_size);
+}
+
+static void
+S_finish(void *context) {
+    ExtSorter_Finish((ExternalSorter*)context);
+}
+
+static void
+S_test_failed_finish(TestBatchRunner *runner, size_t mem_budget,
+                     int compare_budget, const char *label) {
+    ExternalSorter *sorter = ExtSorter_new(mem_budget, NULL);
+    int    budget = INT32_MAX;
+    size_t size;
+    ExtSorter_Set_Compare(sorter, S_compare_keys_or_throw, &budget);
+    S_add_records(sorter, 5000);
+
+    budget = compare_budget;
+    Err *error = Err_trap(S_finish, sorter);
+    TEST_TRUE(runner, error != NULL, "Finish rethrows (%s)", label);
+    TEST_TRUE(runner, ExtSorter_Next_Bytes(sorter, &size) == NULL,
+              "no records after failed Finish (%s)", label);
+
+    DECREF(error);
+    DECREF(sorter);
+}
+
+static void
+test_failed_finish(TestBatchRunner *runner) {
+    // Runs and buffers must be released when the merge throws.  Leaks are
+    // reported when running under a leak checker.
+    S_test_failed_finish(runner, 256, 0, "start of intermediate pass");
+    S_test_failed_finish(runner, 256, 1000, "within intermediate pass");
+    S_test_failed_finish(runner, 4096, 0, "start of final merge");
+}
+
+static void
+test_default_compare(TestBatchRunner *runner) {
+    static const char *const strings[] = {
+        "b", "", "ab", "a", "abc", "ba", "a", "\xFF", "aa"
+    };
+    static const char *const wanted[] = {
+        "", "a", "a", "aa", "ab", "abc", "b", "ba", "\xFF"
+    };
+    size_t num_strings = sizeof(strings) / sizeof(strings[0]);
+
+    ExternalSorter *sorter = ExtSorter_new(16, NULL);
+    for (size_t i = 0; i < num_strings; i++) {
+        Blob *blob = Blob_new(strings[i], strlen(strings[i]));
+        ExtSorter_Add(sorter, blob);
+        DECREF(blob);
+    }
+    ExtSorter_Finish(sorter);
+
+    bool success = true;
+    for (size_t i = 0; i < num_strings; i++) {
+        Blob *blob = ExtSorter_Next(sorter);
+        if (!blob) { success = false; break; }
+        if (!Blob_Equals_Bytes(blob, wanted[i], strlen(wanted[i]))) {
+            success = false;
+        }
+        DECREF(blob);
+    }
+    if (ExtSorter_Next(sorter) != NULL) { success = false; }
+    TEST_TRUE(runner, success, "default byte-wise compare");
+
+    DECREF(sorter);
+}
+
+static void
+S_add_after_finish(void *context) {
+    ExtSorter_Add_Bytes((ExternalSorter*)context, "a", 1);
+}
+
+static void
+test_empty(TestBatchRunner *runner) {
+    ExternalSorter *sorter = ExtSorter_new(1024, NULL);
+    ExtSorter_Finish(sorter);
+    TEST_TRUE(runner, ExtSorter_Next(sorter) == NULL, "empty sorter");
+
+    Err *error = Err_trap(S_add_after_finish, sorter);
+    TEST_TRUE(runner, error != NULL, "Add after Finish throws");
+    DECREF(error);
+
+    DECREF(sorter);
+}
+
+static void
+test_temp_dir(TestBatchRunner *runner) {
+    test_spilled(runner, NULL, "default temp dir");
+
+#ifdef CHY_HAS_UNISTD_H
+    // Spill to tmpfs if available.
+    if (access("/dev/shm", W_OK) == 0) {
+        String *temp_dir = Str_newf("/dev/shm");
+        test_spilled(runner, temp_dir, "tmpfs");
+        DECREF(temp_dir);
+        return;
+    }
+#endif
+
+    SKIP(runner, 2, "tmpfs not available");
+}
+
+void
+TestExtSorter_Run_IMP(TestExternalSorter *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 16);
+    test_in_memory(runner);
+    test_temp_dir(runner);
+    test_multi_pass(runner);
+    test_failed_finish(runner);
+    test_default_compare(runner);
+    test_empty(runner);
+}
+
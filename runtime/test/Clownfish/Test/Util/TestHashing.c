@@ -0,0 +1,150 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include <string.h>
+
+#include "Clownfish/Test/Util/TestHashing.h"
+
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/Util/Hashing.h"
+#include "Clownfish/Class.h"
+
+TestHashing*
+TestHashing_new() {
+    return (TestHashing*)Class_Make_Obj(TESTHASHING);
+}
+
+static void
+test_siphash13(TestBatchRunner *runner) {
+    // Reference vectors for key 00 01 .. 0F and messages 00 01 .. (n-1).
+    static const struct {
+        size_t   size;
+        uint64_t hash;
+    } vectors[] = {
+        { 0,  UINT64_C(0xabac0158050fc4dc) },
+        { 7,  UINT64_C(0xd3927d989bb11140) },
+        { 8,  UINT64_C(0x369095118d299a8e) },
+        { 15, UINT64_C(0xd320d86d2a519956) },
+        { 16, UINT64_C(0xcc4fdd1a7d908b66) },
+        { 63, UINT64_C(0x9d199062b7bbb3a8) }
+    };
+    const uint64_t k0 = UINT64_C(0x0706050403020100);
+    const uint64_t k1 = UINT64_C(0x0f0e0d0c0b0a0908);
+    uint8_t message[64];
+
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = (uint8_t)i;
+    }
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        uint64_t hash = Hashing_siphash13(message, vectors[i].size, k0, k1);
+        TEST_TRUE(runner, hash == vectors[i].hash,
+                  "siphash13 reference vector, %u64 bytes",
+                  (uint64_t)vectors[i].size);
+    }
+}
+
+static void
+test_wyhash(TestBatchRunner *runner) {
+    // Reference vectors from the wyhash distribution, hashing message i
+    // with seed i.
+    static const struct {
+        const char *message;
+        uint64_t    hash;
+    } vectors[] = {
+        { "", UINT64_C(0x93228a4de0eec5a2) },
+        { "a", UINT64_C(0xc5bac3db178713c4) },
+        { "abc", UINT64_C(0xa97f2f7b1d9b3314) },
+        { "message digest", UINT64_C(0x786d1f1df3801df4) },
+        { "abcdefghijklmnopqrstuvwxyz", UINT64_C(0xdca5a8138ad37c87) },
+        {
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+            UINT64_C(0xb9e734f117cfaf70)
+        },
+        {
+            "1234567890123456789012345678901234567890"
+            "1234567890123456789012345678901234567890",
+            UINT64_C(0x6cc5eab49a92d617)
+        }
+    };
+
+    for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+        const char *message = vectors[i].message;
+        uint64_t hash = Hashing_wyhash(message, strlen(message), i);
+        TEST_TRUE(runner, hash == vectors[i].hash,
+                  "wyhash reference vector, %u64 bytes",
+                  (uint64_t)strlen(message));
+    }
+
+    static const char text[]
+        = "The quick brown fox jumps over the lazy dog, repeatedly.";
+    size_t size = sizeof(text) - 1;
+    bool   consistent = true;
+    bool   distinct   = true;
+
+    // Exercise every code path for short and long inputs.
+    for (size_t i = 0; i <= size; i++) {
+        uint64_t hash = Hashing_wyhash(text, i, 42);
+        if (hash != Hashing_wyhash(text, i, 42)) { consistent = false; }
+        if (i > 0 && hash == Hashing_wyhash(text, i - 1, 42)) {
+            distinct = false;
+        }
+    }
+
+    TEST_TRUE(runner, consistent, "wyhash is deterministic");
+    TEST_TRUE(runner, distinct, "wyhash distinguishes prefixes");
+    TEST_TRUE(runner,
+              Hashing_wyhash(text, size, 1) != Hashing_wyhash(text, size, 2),
+              "wyhash depends on seed");
+}
+
+static void
+test_hash_state(TestBatchRunner *runner) {
+    int func = Hashing_get_func();
+    TEST_TRUE(runner,
+              func == HASHING_SIPHASH13 || func == HASHING_WYHASH,
+              "get_func returns a valid hash function");
+    TEST_FALSE(runner, Hashing_init(HASHING_WYHASH, 1, 2),
+               "init fails once strings have been hashed");
+
+    String *one = Str_newf("a fairly long key which spans several words");
+    String *two = Str_newf("a fairly long key which spans several words");
+    TEST_TRUE(runner, Str_Hash_Sum(one) == Str_Hash_Sum(two),
+              "Equal strings have equal hash sums");
+    TEST_TRUE(runner,
+              Str_Hash_Sum(one)
+              == (size_t)Hashing_hash_bytes(Str_Get_Ptr8(one),
+                                            Str_Get_Size(one)),
+              "Hash_Sum uses process-wide hash function");
+    DECREF(one);
+    DECREF(two);
+}
+
+void
+TestHashing_Run_IMP(TestHashing *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 20);
+    test_siphash13(runner);
+    test_wyhash(runner);
+    test_hash_state(runner);
+}
+
+
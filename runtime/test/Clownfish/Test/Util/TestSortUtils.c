@@ -0,0 +1,317 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include <string.h>
+
+#include "Clownfish/Test/Util/TestSortUtils.h"
+
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Util/Memory.h"
+#include "Clownfish/Util/SortUtils.h"
+#include "Clownfish/Class.h"
+
+#define NUM_PATTERNS 8
+
+static const char *const pattern_names[NUM_PATTERNS] = {
+    "random", "sorted", "reversed", "nearly sorted", "sawtooth",
+    "descending with duplicates", "all equal", "organ pipe"
+};
+
+// Elements of various widths.  Only the key is compared.  The index
+// records the original position to verify stability.
+typedef struct {
+    uint32_t key;
+    uint32_t index;
+} Elem8;
+
+typedef struct {
+    uint32_t key;
+    uint32_t index;
+    uint32_t pad;
+} Elem12;
+
+TestSortUtils*
+TestSortUtils_new() {
+    return (TestSortUtils*)Class_Make_Obj(TESTSORTUTILS);
+}
+
+static int
+S_compare_u32(void *context, const void *va, const void *vb) {
+    // Compare the high 16 bits, the low 16 bits hold the index.
+    uint32_t a = *(const uint32_t*)va >> 16;
+    uint32_t b = *(const uint32_t*)vb >> 16;
+    UNUSED_VAR(context);
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static int
+S_compare_elem8(void *context, const void *va, const void *vb) {
+    uint32_t a = ((const Elem8*)va)->key;
+    uint32_t b = ((const Elem8*)vb)->key;
+    UNUSED_VAR(context);
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static int
+S_compare_elem12(void *context, const void *va, const void *vb) {
+    uint32_t a = ((const Elem12*)va)->key;
+    uint32_t b = ((const Elem12*)vb)->key;
+    UNUSED_VAR(context);
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static void
+S_fill_keys(uint32_t *keys, size_t size, int pattern) {
+    uint64_t *rands = TestUtils_random_u64s(NULL, size, 0, 1000);
+    for (size_t i = 0; i < size; i++) {
+        uint32_t r = (uint32_t)rands[i];
+        switch (pattern) {
+            case 0: keys[i] = r; break;
+            case 1: keys[i] = (uint32_t)i; break;
+            case 2: keys[i] = (uint32_t)(size - i); break;
+            case 3: keys[i] = r < 20 ? r : (uint32_t)i; break;
+            case 4: keys[i] = (uint32_t)(i % 97) * 10; break;
+            case 5: keys[i] = (uint32_t)(size - i) / 3; break;
+            case 6: keys[i] = 42; break;
+            default:
+                keys[i] = i < size / 2 ? (uint32_t)i : (uint32_t)(size - i);
+                break;
+        }
+        keys[i] &= 0xFFFF;
+    }
+    FREEMEM(rands);
+}
+
+static bool
+S_check_sort(size_t size, int pattern, size_t width, bool parallel) {
+    uint32_t *keys    = (uint32_t*)MALLOCATE((size + 1) * sizeof(uint32_t));
+    void     *elems   = MALLOCATE((size + 1) * width);
+    void     *scratch = MALLOCATE((size + 1) * width);
+    uint32_t  prev_key   = 0;
+    uint32_t  prev_index = 0;
+    bool      success    = true;
+
+    S_fill_keys(keys, size, pattern);
+
+    for (size_t i = 0; i < size; i++) {
+        if (width == 4) {
+            ((uint32_t*)elems)[i] = (keys[i] << 16) | (uint32_t)i;
+        }
+        else if (width == 8) {
+            ((Elem8*)elems)[i].key   = keys[i];
+            ((Elem8*)elems)[i].index = (uint32_t)i;
+        }
+        else {
+            ((Elem12*)elems)[i].key   = keys[i];
+            ((Elem12*)elems)[i].index = (uint32_t)i;
+            ((Elem12*)elems)[i].pad   = keys[i] ^ (uint32_t)i;
+        }
+    }
+
+    CFISH_Sort_Compare_t compare = width == 4 ? S_compare_u32
+                                   : width == 8 ? S_compare_elem8
+                                   : S_compare_elem12;
+    if (parallel) {
+        Sort_parallel_mergesort(elems, scratch, size, width, compare, NULL);
+    }
+    else {
+        Sort_mergesort(elems, scratch, size, width, compare, NULL);
+    }
+
+    uint32_t *counts = (uint32_t*)CALLOCATE(0x10000, sizeof(uint32_t));
+    for (size_t i = 0; i < size; i++) { counts[keys[i]]++; }
+
+    for (size_t i = 0; i < size; i++) {
+        uint32_t key, index;
+        if (width == 4) {
+            key   = ((uint32_t*)elems)[i] >> 16;
+            index = ((uint32_t*)elems)[i] & 0xFFFF;
+        }
+        else if (width == 8) {
+            key   = ((Elem8*)elems)[i].key;
+            index = ((Elem8*)elems)[i].index;
+        }
+        else {
+            key   = ((Elem12*)elems)[i].key;
+            index = ((Elem12*)elems)[i].index;
+            if (((Elem12*)elems)[i].pad != (key ^ index)) { success = false; }
+        }
+
+        if (index >= size || keys[index] != key) { success = false; break; }
+        if (i > 0) {
+            if (key < prev_key) { success = false; }
+            if (key == prev_key && index <= prev_index) { success = false; }
+        }
+        counts[key]--;
+        prev_key   = key;
+        prev_index = index;
+    }
+
+    // Every element must appear exactly once.
+    for (size_t i = 0; i < size; i++) {
+        if (counts[keys[i]] != 0) { success = false; }
+    }
+
+    FREEMEM(counts);
+    FREEMEM(scratch);
+    FREEMEM(elems);
+    FREEMEM(keys);
+    return success;
+}
+
+static void
+test_mergesort(TestBatchRunner *runner) {
+    static const size_t sizes[] = { 0, 1, 2, 3, 31, 64, 65, 1000, 20000 };
+    static const size_t widths[] = { 4, 8, 12 };
+    size_t num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+    for (size_t w = 0; w < 3; w++) {
+        for (int pattern = 0; pattern < NUM_PATTERNS; pattern++) {
+            bool success = true;
+            for (size_t i = 0; i < num_sizes; i++) {
+                // Indexes must fit into 16 bits for width 4.
+                if (widths[w] == 4 && sizes[i] > 0xFFFF) { continue; }
+                if (!S_check_sort(sizes[i], pattern, widths[w], false)) {
+                    success = false;
+                }
+            }
+            TEST_TRUE(runner, success, "mergesort %s, width %u",
+                      pattern_names[pattern], (unsigned)widths[w]);
+        }
+    }
+}
+
+static int
+S_compare_u64(void *context, const void *va, const void *vb) {
+    uint64_t a = *(const uint64_t*)va;
+    uint64_t b = *(const uint64_t*)vb;
+    UNUSED_VAR(context);
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static bool
+S_same_multiset(uint64_t *a, uint64_t *b, size_t size) {
+    uint64_t *a_copy  = (uint64_t*)MALLOCATE(size * sizeof(uint64_t) + 1);
+    uint64_t *b_copy  = (uint64_t*)MALLOCATE(size * sizeof(uint64_t) + 1);
+    uint64_t *scratch = (uint64_t*)MALLOCATE(size * sizeof(uint64_t) + 1);
+    memcpy(a_copy, a, size * sizeof(uint64_t));
+    memcpy(b_copy, b, size * sizeof(uint64_t));
+    Sort_mergesort(a_copy, scratch, size, sizeof(uint64_t), S_compare_u64,
+                   NULL);
+    Sort_mergesort(b_copy, scratch, size, sizeof(uint64_t), S_compare_u64,
+                   NULL);
+    bool same = memcmp(a_copy, b_copy, size * sizeof(uint64_t)) == 0;
+    FREEMEM(scratch);
+    FREEMEM(b_copy);
+    FREEMEM(a_copy);
+    return same;
+}
+
+static void
+test_partial_and_select(TestBatchRunner *runner) {
+    static const size_t sizes[] = { 1, 2, 17, 100, 5000 };
+    static const uint64_t limits[] = { 3, 1000000 };
+    bool partial_ok = true;
+    bool select_ok  = true;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t size = sizes[s];
+        for (size_t l = 0; l < 2; l++) {
+            uint64_t *orig    = TestUtils_random_u64s(NULL, size, 0,
+                                                      limits[l]);
+            uint64_t *sorted  = (uint64_t*)MALLOCATE(size * sizeof(uint64_t));
+            uint64_t *scratch = (uint64_t*)MALLOCATE(size * sizeof(uint64_t));
+            uint64_t *elems   = (uint64_t*)MALLOCATE(size * sizeof(uint64_t));
+            memcpy(sorted, orig, size * sizeof(uint64_t));
+            Sort_mergesort(sorted, scratch, size, sizeof(uint64_t),
+                           S_compare_u64, NULL);
+
+            size_t ks[] = { 0, 1, size / 3, size - 1, size, size + 5 };
+            for (size_t i = 0; i < sizeof(ks) / sizeof(ks[0]); i++) {
+                size_t k = ks[i];
+                memcpy(elems, orig, size * sizeof(uint64_t));
+                Sort_partial(elems, size, k, sizeof(uint64_t), S_compare_u64,
+                             NULL);
+                size_t num_sorted = k < size ? k : size;
+                if (memcmp(elems, sorted, num_sorted * sizeof(uint64_t)) != 0
+                    || !S_same_multiset(elems, orig, size)
+                   ) {
+                    partial_ok = false;
+                }
+
+                if (k >= size) { continue; }
+                memcpy(elems, orig, size * sizeof(uint64_t));
+                Sort_select(elems, size, k, sizeof(uint64_t), S_compare_u64,
+                            NULL);
+                if (elems[k] != sorted[k]
+                    || !S_same_multiset(elems, orig, size)
+                   ) {
+                    select_ok = false;
+                }
+                for (size_t j = 0; j < size; j++) {
+                    if (j < k && elems[j] > elems[k]) { select_ok = false; }
+                    if (j > k && elems[j] < elems[k]) { select_ok = false; }
+                }
+            }
+
+            FREEMEM(elems);
+            FREEMEM(scratch);
+            FREEMEM(sorted);
+            FREEMEM(orig);
+        }
+    }
+
+    TEST_TRUE(runner, partial_ok, "partial");
+    TEST_TRUE(runner, select_ok, "select");
+}
+
+static void
+test_parallel_mergesort(TestBatchRunner *runner) {
+    uint32_t max_threads = Sort_get_max_threads();
+
+    // Use several threads even on machines with a single CPU.
+    Sort_set_max_threads(5);
+    TEST_UINT_EQ(runner, Sort_get_max_threads(), 5, "set_max_threads");
+
+    for (int pattern = 0; pattern < NUM_PATTERNS; pattern++) {
+        bool success = S_check_sort(50000, pattern, 8, true)
+                       && S_check_sort(17, pattern, 8, true)
+                       && S_check_sort(30001, pattern, 12, true);
+        TEST_TRUE(runner, success, "parallel_mergesort %s",
+                  pattern_names[pattern]);
+    }
+
+    Sort_set_max_threads(0);
+    TEST_TRUE(runner, Sort_get_max_threads() >= 1,
+              "get_max_threads defaults to number of CPUs");
+    Sort_set_max_threads(max_threads);
+}
+
+void
+TestSortUtils_Run_IMP(TestSortUtils *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 4 * NUM_PATTERNS + 4);
+    test_mergesort(runner);
+    test_partial_and_select(runner);
+    test_parallel_mergesort(runner);
+}
+
+